@@ -8,6 +8,8 @@
  */
 #define Version "1.86"
 
+#define _GNU_SOURCE /* fopencookie() */
+
 /**
  *  Заголовочные файла
  */
@@ -22,7 +24,22 @@
 #include <errno.h>
 #include <unistd.h>
 #include <sys/select.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <ctype.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TAPE_SIMD_X86 (1)
+#endif
 
 #include <fcntl.h>   
 
@@ -131,6 +148,81 @@ static uint8_t LOGGING = 0;
 static uint32_t STEP = 0;
 static int32_t BREAKPOINT = INT32_MAX;
 
+/**
+ * Обнаружение холостого цикла в режиме непрерывной работы:
+ * IDLE_OFF - не проверять, IDLE_STOP - останов STOP_IDLE,
+ * IDLE_SKIP - пропустить остаток пакета команд run_for().
+ * На пульте по умолчанию выключено: программа может ждать оператора
+ * в переходе на себя. Пакетный режим включает IDLE_STOP.
+ */
+#define IDLE_OFF (0)
+#define IDLE_STOP (1)
+#define IDLE_SKIP (2)
+static uint8_t IDLE_DETECT = IDLE_OFF;
+
+/* Формат перфоленты ПЛ новых машин: TAPE_TEXT или TAPE_BIN (--ptp-bin) */
+static uint8_t PTP_FORMAT = 0;
+
+/* Пакетный режим: ввод-вывод в потоке устройств (--io-thread) */
+static uint8_t IO_THREAD = 0;
+
+/* Кэш декодированных перфолент, байт; 0 - без кэша (--tape-cache) */
+#define TAPE_CACHE_BYTES (64ull << 20)
+static uint64_t TAPE_CACHE_MAX = TAPE_CACHE_BYTES;
+
+/**
+ * Темп работы в реальном времени: коротких операций в секунду,
+ * 0 - без ограничения (полная скорость эмулятора).
+ * "Сетунь-1958" выполняла около PACE_SETUN_OPS коротких операций в секунду.
+ * Время операций PACE_..._US дано для этой скорости и пересчитывается
+ * пропорционально PACE_OPS. Время умножения, обмена с МБ и ввода-вывода -
+ * оценки по описанию машины.
+ */
+#define PACE_SETUN_OPS (4800)
+#define PACE_SHORT_US (208.3)	/* короткая операция */
+#define PACE_MUL_US (376.0)		/* умножение ++0, +++, ++- */
+#define PACE_DRUM_US (10000.0)	/* обмен зоной с МБ -0+, -0-: поиск и передача зоны */
+#define PACE_IO_US (50000.0)	/* ввод-вывод -00 */
+#define PACE_SLICE_US (10000)	/* квант планировщика, мкс эмулируемого времени */
+#define PACE_RESYNC_US (100000) /* отставание, после которого отсчёт начинается заново */
+static uint32_t PACE_OPS = 0;
+
+/**
+ * Количество команд, выполняемых за один проход цикла пульта управления
+ * в состоянии непрерывной работы
+ */
+#define RUN_BATCH_STEPS (100000)
+
+/**
+ * Длительность пакета команд run_for() между проверками очереди команд
+ * пульта управления, мс. Размер пакета подстраивается под этот период
+ * в пределах RUN_BATCH_MIN .. RUN_BATCH_MAX.
+ * В пропускаемом холостом цикле поток эмуляции ждёт команду POLL_INPUT_MS.
+ */
+#define RUN_BATCH_MS (1)
+#define POLL_INPUT_MS (20)
+#define RUN_BATCH_MIN (1000)
+#define RUN_BATCH_MAX (10000000)
+
+/**
+ * Код завершения пакетного режима (параметры командной строки)
+ */
+#define BATCH_EXIT_STOP (0)	  /* STOP */
+#define BATCH_EXIT_BUDGET (1) /* исчерпан бюджет команд или времени */
+#define BATCH_EXIT_OVER (2)	  /* STOP_OVER */
+#define BATCH_EXIT_ERROR (3)  /* STOP_ERROR, STOP_ERROR_MB_NUMBER */
+#define BATCH_EXIT_BREAK (4)  /* STOP_BREAKPOINT, STOP_IDLE */
+#define BATCH_EXIT_USAGE (5)  /* ошибка параметров или файлов */
+
+#define JOB_THREADS_MAX (256) /* потоков параллельного запуска заданий */
+#define JOB_SLICE_STEPS (1000000) /* квант задания планировщика с кражей */
+#define JOB_SCHED_SHARED (0)	  /* общий счётчик заданий */
+#define JOB_SCHED_STEAL (1)		  /* деки потоков и кража заданий */
+#define SWEEP_SET_MAX (64)		  /* замен в строке варианта перебора */
+#define SWEEP_CELLS_MAX (64)	  /* ячеек FRAM в результате перебора */
+#define SWEEP_BIN_MAGIC "SETUNSW1"
+static uint64_t job_steals = 0;	  /* краж в последнем run_jobs() */
+
 /**
  * Статус выполнения операции  "Сетунь-1958"
  */
@@ -141,7 +233,9 @@ enum
 	STOP = 2,				 /* Успешный останов машины */
 	STOP_OVER = 3,			 /* Останов по переполнению результата операции машины */
 	STOP_ERROR = 4,			 /* Аварийный останов машины */
-	STOP_ERROR_MB_NUMBER = 5 /* Номер зоны DRUM не поддерживается */
+	STOP_ERROR_MB_NUMBER = 5, /* Номер зоны DRUM не поддерживается */
+	STOP_BREAKPOINT = 6,	  /* Останов по адресу точки останова */
+	STOP_IDLE = 7			  /* Останов по холостому циклу */
 };
 
 /* Состояние работы эмулятора */
@@ -160,43 +254,342 @@ typedef enum {
 
 static emustatus_e emu_stat = NOREADY_EMU_ST;
 
+/* Состояние целочисленных регистров S, R, F, W в режиме native */
+enum
+{
+	NATIVE_NONE = 0,  /* целые значения не загружены */
+	NATIVE_CLEAN = 1, /* целые значения совпадают с тритами регистров */
+	NATIVE_DIRTY = 2  /* целые значения новее тритов регистров */
+};
+
 /**
- * Виртуальные устройства Ввода и Вывода "Сетунь-1958"
+ * Снимок состояния для обнаружения холостого цикла (idle_check)
  */
-/* Фотосчитыватель ФТ1 */
-FILE *ptr1;
-/* Фотосчитыватель ФТ2 */
-FILE *ptr2;
-/* Перфоратор ПЛ */
-FILE *ptp1;
-/* Печать Телетайп ТП, Пишущая машинка ПМ */
-FILE *tty1;
+typedef struct idle_snap
+{
+	uint8_t valid;	   /* снимок сделан */
+	uint32_t power;	   /* окно алгоритма Брента */
+	uint32_t lam;	   /* переходов назад после снимка */
+	uint32_t io_count; /* команд ввода-вывода и МБ при снимке */
+	trs_t C, F, W, ph1, ph2, S, R, MB;
+	trs_t mem_fram[SIZE_GR_TRIT_FRAM][SIZE_GRFRAM];
+} idle_snap_t;
 
 /**
- * Определение памяти машины "Сетунь-1958"
+ * Счётчики планировщика реального времени (run_paced)
  */
-trs_t mem_fram[SIZE_GR_TRIT_FRAM][SIZE_GRFRAM];						   /* оперативное запоминающее устройство на ферритовых сердечниках */
-trs_t mem_drum[NUMBER_ZONE_DRUM + ZONE_DRUM_BEG][SIZE_ZONE_TRIT_DRUM]; /* запоминающее устройство на магнитном барабане */
+typedef struct pace_stat
+{
+	uint8_t valid;		/* отсчёт времени начат */
+	double t_start;		/* начало работы по монотонным часам, с */
+	double t0;			/* начало отсчёта по монотонным часам, с */
+	double emu_us;		/* эмулируемое время от начала отсчёта, мкс */
+	double total_us;	/* эмулируемое время до начала отсчёта, мкс */
+	uint64_t slices;	/* квантов */
+	uint64_t late;		/* квантов без ожидания: хост не успевает */
+	uint64_t resync;	/* отсчёт начат заново после отставания */
+	double drift_sum;	/* опоздание пробуждения, сумма, мкс */
+	double drift_max;	/* опоздание пробуждения, максимум, мкс */
+} pace_stat_t;
 
-/** ***********************************
- *  Определение регистров "Сетунь-1958"
- *  -----------------------------------
+/**
+ * Фотосчитыватель: перфолента, отображённая в память, и курсор чтения.
+ * Позиция на ленте сохраняется между командами ввода. Канал, FIFO,
+ * сокет читаются потоком: data - окно буфера, дочитываемое read().
  */
-/* Основные регистры в порядке пульта управления */
-trs_t K = {.l = 9, .t0 = 0, .t1 = 0}; /* K(1:9)  код команды (адрес ячейки оперативной памяти) */
-trs_t F = {.l = 5, .t0 = 0, .t1 = 0}; /* F(1:5)  индекс регистр  */
-trs_t C = {.l = 5, .t0 = 0, .t1 = 0}; /* C(1:5)  программный счетчик  */
-trs_t W = {.l = 1, .t0 = 0, .t1 = 0}; /* W(1:1)  знак троичного числа */
-//
-trs_t ph1 = {.l = 1, .t0 = 0, .t1 = 0}; /* ph1(1:1) 1 разряд переполнения */
-trs_t ph2 = {.l = 1, .t0 = 0, .t1 = 0}; /* ph2(1:1) 1 разряд переполнения */
-trs_t S = {.l = 18, .t0 = 0, .t1 = 0};	/* S(1:18) аккумулятор */
-trs_t R = {.l = 18, .t0 = 0, .t1 = 0};	/* R(1:18) регистр множителя */
-trs_t MB = {.l = 4, .t0 = 0, .t1 = 0};	/* MB(1:4) троичное число зоны магнитного барабана */
+#define TAPE_TEXT (0)
+#define TAPE_BIN (1)
+
+/**
+ * Зона перфоленты: строки между промежутками из TAPE_GAP_ROWS пустых
+ * строк "___.__", как их пишет LoadFileListToPaperTxt()
+ */
+typedef struct tape_zone
+{
+	uint64_t offset; /* смещение первой строки зоны в файле, байт */
+	uint32_t row;	 /* номер первой строки на ленте, с 0 */
+	uint32_t rows;	 /* строк зоны без промежутка */
+	uint32_t sum;	 /* FNV-1a кодов строк зоны */
+	uint32_t reserved;
+} tape_zone_t;
+
+typedef struct tape_reader
+{
+	const uint8_t *data; /* образ перфоленты, NULL - чтение через FILE */
+	size_t size;
+	size_t pos;		/* курсор чтения */
+	uint8_t fmt;	/* TAPE_TEXT, TAPE_BIN */
+	uint8_t mapped; /* data отображено mmap() */
+	uint8_t owned;	/* data - строки, декодированные из текста, malloc() */
+	size_t bad;		/* первая ошибочная строка текста, с 1; 0 - нет */
+	uint8_t stream; /* поток из описателя fd */
+	uint8_t end;	/* поток закрыт писателем */
+	int fd;
+	uint64_t base;	/* смещение data[0] в потоке */
+	struct io_tape *pf; /* строки, прочитанные заранее потоком устройств */
+	tape_zone_t *zone;	/* указатель зон, malloc(); NULL - не построен */
+	uint32_t zones;
+	struct tape_cache_entry *cache; /* data - строки кэша, только чтение */
+} tape_reader_t;
+
+/**
+ * Буфер вывода устройства: запись в файл одним fwrite()
+ * в конце строки, при останове и при заполнении.
+ */
+#define DEV_BUF_SIZE (4096)
+
+typedef struct dev_buf
+{
+	uint32_t len;
+	char data[DEV_BUF_SIZE];
+} dev_buf_t;
+
+/**
+ * Устройство вывода ПМ или ПЛ: буфер устройства записывается в файл
+ * машины (tty1, ptp1), в растущий буфер памяти, никуда или передаётся
+ * функции вызывающего. Пакетный режим по умолчанию пишет в память.
+ */
+#define DEV_FILE (0) /* FILE машины */
+#define DEV_MEM (1)	 /* буфер data, realloc() */
+#define DEV_NULL (2) /* вывод отбрасывается */
+#define DEV_CALL (3) /* call(ctx, data, len) */
+
+typedef void (*dev_call_t)(void *ctx, const char *data, size_t len);
+
+typedef struct dev_out
+{
+	uint8_t kind;	 /* DEV_FILE, DEV_MEM, DEV_NULL, DEV_CALL */
+	char *data;		 /* DEV_MEM: вывод с открытия устройства */
+	size_t len;
+	size_t cap;
+	dev_call_t call; /* DEV_CALL */
+	void *ctx;
+	uint64_t bytes;	 /* записано с открытия устройства */
+} dev_out_t;
+
+/**
+ * Поток устройств ввода-вывода (--io-thread): печать ПМ и строки ПЛ
+ * передаются кольцом блоков и записываются в порядке команд,
+ * перфолента из потока читается и декодируется заранее.
+ */
+#define IO_RING_SIZE (256)	/* блоков вывода в кольце */
+#define IO_PREFETCH_ROWS (4096) /* строк в буфере чтения, зона команд - 270 строк */
+
+typedef struct io_block
+{
+	dev_out_t *dev;
+	FILE *file;
+	FILE *echo; /* копия печати ПМ на консоль */
+	dev_buf_t buf;
+} io_block_t;
+
+/* Чтение перфоленты заранее: два буфера строк, один у машины, другой у потока */
+typedef struct io_tape
+{
+	tape_reader_t src; /* поток перфоленты */
+	FILE *file;
+	uint8_t rows[2][IO_PREFETCH_ROWS];
+	size_t len[2];
+	uint8_t back;  /* буфер потока чтения */
+	uint8_t ready; /* буфер back заполнен */
+	uint8_t end;   /* лента прочитана до конца */
+	uint8_t stop;
+	uint64_t swaps;	 /* обменов буферов */
+	uint64_t stalls; /* машина ждала строк */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t th;
+} io_tape_t;
+
+typedef struct io_dev
+{
+	io_block_t ring[IO_RING_SIZE];
+	uint32_t head; /* блоки head - tail ждут вывода */
+	uint32_t tail;
+	uint8_t open; /* блок head заполняется, в кольцо ещё не поставлен */
+	uint8_t stop;
+	pthread_mutex_t lock;
+	pthread_cond_t work;  /* блок поставлен в кольцо */
+	pthread_cond_t space; /* блок выведен */
+	pthread_t th;
+	io_tape_t *tape[2]; /* ФТ1, ФТ2; NULL - лента в памяти */
+	uint64_t blocks;	/* блоков выведено */
+	uint64_t waits;		/* ожиданий места в кольце */
+} io_dev_t;
+
+/**
+ * Контекст машины "Сетунь-1958"
+ * ------------------------------
+ * Всё состояние одной машины: регистры пульта управления, память FRAM и DRUM,
+ * виртуальные устройства ввода/вывода и переключатели пишущей машинки.
+ * Функции ядра получают указатель на контекст первым параметром,
+ * поэтому в одном процессе может работать несколько машин.
+ */
+typedef struct setun_machine
+{
+	/* Основные регистры в порядке пульта управления */
+	trs_t K;   /* K(1:9)  код команды (адрес ячейки оперативной памяти) */
+	trs_t F;   /* F(1:5)  индекс регистр  */
+	trs_t C;   /* C(1:5)  программный счетчик  */
+	trs_t W;   /* W(1:1)  знак троичного числа */
+	trs_t ph1; /* ph1(1:1) 1 разряд переполнения */
+	trs_t ph2; /* ph2(1:1) 1 разряд переполнения */
+	trs_t S;   /* S(1:18) аккумулятор */
+	trs_t R;   /* R(1:18) регистр множителя */
+	trs_t MB;  /* MB(1:4) троичное число зоны магнитного барабана */
+
+	/* Дополнительные */
+	trs_t MR;		/* временный регистр для обмена с FRAM */
+	long_trs_t TMP; /* временная переменная для троичного числа */
+
+	/* Режим целочисленных регистров S, R, F, W */
+	uint8_t native;		  /* 1 - арифметика S, R, F на целых числах */
+	uint8_t native_state; /* NATIVE_NONE, NATIVE_CLEAN, NATIVE_DIRTY */
+	int32_t nS;			  /* S(1:18) целое значение */
+	int32_t nR;			  /* R(1:18) целое значение */
+	int32_t nF;			  /* F(1:5)  целое значение */
+	int8_t nW;			  /* W(1:1)  знак */
+
+	/* Обнаружение холостого цикла */
+	uint32_t io_count;	   /* выполнено команд ввода-вывода и МБ */
+	uint64_t idle_skipped; /* пропущено команд холостого цикла */
+	idle_snap_t idle;	   /* снимок состояния в начале цикла */
+
+	/* Работа в реальном времени */
+	pace_stat_t pace;
+
+	/* Память машины */
+	trs_t mem_fram[SIZE_GR_TRIT_FRAM][SIZE_GRFRAM];						   /* оперативное запоминающее устройство на ферритовых сердечниках */
+	trs_t mem_drum[NUMBER_ZONE_DRUM + ZONE_DRUM_BEG][SIZE_ZONE_TRIT_DRUM]; /* запоминающее устройство на магнитном барабане */
+
+	/* Виртуальные устройства Ввода и Вывода */
+	FILE *ptr1; /* Фотосчитыватель ФТ1 */
+	FILE *ptr2; /* Фотосчитыватель ФТ2 */
+	FILE *ptp1; /* Перфоратор ПЛ */
+	FILE *tty1; /* Печать Телетайп ТП, Пишущая машинка ПМ */
+	FILE *tty_echo; /* копия печати ПМ на консоль, NULL - без копии */
+	dev_out_t tty_dev; /* печать ПМ: файл tty1, память, ... */
+	dev_out_t ptp_dev; /* перфоратор ПЛ: файл ptp1, память, ... */
+	dev_buf_t tty_buf; /* буфер печати ПМ */
+	dev_buf_t ptp_buf; /* строки зоны для перфоратора ПЛ */
+	uint8_t ptp_fmt;   /* TAPE_TEXT, TAPE_BIN */
+	uint32_t ptp_rows; /* строк пробито на двоичной ленте */
+	io_dev_t *io;	   /* поток устройств, NULL - ввод-вывод в потоке машины */
+
+	/* Файлы виртуальных устройств */
+	const char *path_ptr1;
+	const char *path_ptr2;
+	const char *path_ptp1;
+	const char *path_tty1;
+	tape_reader_t ft1; /* перфолента ФТ1 */
+	tape_reader_t ft2; /* перфолента ФТ2 */
+
+	/* Переключатели пишущей машинки */
+	uint8_t russian_latin_sw; /* Регист переключения Русский/Латинский */
+	uint8_t letter_number_sw; /* Регист переключения Буквенный/Цифровой */
+	uint8_t color_sw;		  /* Регист переключения цвета печатающей ленты */
+} setun_machine_t;
+
+/**
+ * Задание параллельного запуска (run_jobs): своя машина, перфолента
+ * и выходные файлы. Результат записывается в поля ret, done, time.
+ */
+/**
+ * Замена при переборе вариантов: регистр K, F, C, W, S, R
+ * или ячейка FRAM по адресу A(1:5)
+ */
+typedef struct sweep_set
+{
+	uint8_t rg; /* имя регистра, 0 - ячейка FRAM */
+	trs_t addr; /* адрес ячейки FRAM */
+	trs_t v;	/* значение */
+} sweep_set_t;
+
+typedef struct setun_job
+{
+	const char *path_tape;				/* перфолента ФТ1 */
+	const char *path_out;				/* префикс файлов .tty, .ptp, .regs; NULL - без вывода */
+	void (*load)(setun_machine_t *m);	/* загрузка программы вместо перфоленты */
+	uint64_t steps;						/* бюджет команд, 0 - без ограничения */
+	double seconds;						/* бюджет времени, 0 - без ограничения */
+
+	/* Перебор вариантов: копия загруженной машины и замены */
+	const struct setun_machine *base; /* NULL - загрузка перфоленты или load */
+	const sweep_set_t *set;
+	int set_count;
+	const trs_t *cells; /* ячейки FRAM результата */
+	int cells_count;
+	int32_t *cell_val; /* значения ячеек после останова */
+
+	int ret;		  /* статус останова */
+	uint64_t done;	  /* выполнено команд */
+	double time;	  /* время работы, с */
+	double t_done;	  /* завершено от начала run_jobs(), с */
+	trs_t C, S, R;	  /* регистры после останова */
+	uint64_t tty_bytes; /* напечатано на ПМ, байт */
+	uint64_t ptp_bytes; /* пробито на ПЛ, байт */
+	uint32_t tty_sum;	/* FNV-1a печати в памяти */
+	uint32_t ptp_sum;	/* FNV-1a перфоленты в памяти */
+
+	/* Для планировщика */
+	struct setun_machine *m; /* машина задания между квантами */
+	uint8_t finished;
+	char path_tty[256]; /* файлы вывода машины задания, живут дольше job_begin() */
+	char path_ptp[256];
+} setun_job_t;
+
+/**
+ * Машина виртуального пульта управления и тестов.
+ * Слой совместимости: команды CLI работают с этим экземпляром.
+ */
+static setun_machine_t setun;
+
+/**
+ * Команды пульта управления для потока эмуляции
+ */
+enum
+{
+	EMU_CMD_BEGIN = 0, /* Начальный старт */
+	EMU_CMD_PAUSE,	   /* Пауза */
+	EMU_CMD_RUN,	   /* Непрерывная работа */
+	EMU_CMD_STEP,	   /* Выполнить одну команду */
+	EMU_CMD_BREAK,	   /* Адрес точки останова */
+	EMU_CMD_NATIVE,	   /* Режим целочисленных регистров */
+	EMU_CMD_IDLE,	   /* Режим холостого цикла */
+	EMU_CMD_PACE,	   /* Темп работы в реальном времени */
+	EMU_CMD_REG,	   /* Записать регистр */
+	EMU_CMD_SNAP,	   /* Снимок машины для просмотра */
+	EMU_CMD_TEST,	   /* Выполнить тест */
+	EMU_CMD_DUMP,	   /* Загрузить зону FRAM из файла */
+	EMU_CMD_ZONE,	   /* Зона перфоленты ФТ1 */
+	EMU_CMD_CLOSE,	   /* Пульт закрыт: работать до останова */
+	EMU_CMD_QUIT	   /* Завершить поток эмуляции */
+};
 
-/* Дополнительные */
-trs_t MR = {.l = 9, .t0 = 0, .t1 = 0};		  /* временный регистр для обмена с FRAM */
-long_trs_t TMP = {.l = 36, .t0 = 0, .t1 = 0}; /* временная переменная для троичного числа */
+#define EMU_CMD_PAR (80)	  /* длина строкового параметра команды */
+#define EMU_QUEUE_SIZE (64) /* ёмкость очереди команд, степень двойки */
+
+typedef struct emu_cmd
+{
+	uint32_t seq;			/* номер команды для подтверждения */
+	uint8_t code;			/* EMU_CMD_... */
+	int32_t val;			/* числовой параметр */
+	char rg;				/* имя регистра */
+	trs_t trs;				/* троичный параметр */
+	char par[EMU_CMD_PAR];	/* строковый параметр */
+} emu_cmd_t;
+
+/**
+ * Очередь команд без блокировок: один производитель (пульт управления)
+ * и один потребитель (поток эмуляции). Индексы растут непрерывно,
+ * ячейка выбирается по модулю EMU_QUEUE_SIZE.
+ */
+typedef struct emu_queue
+{
+	emu_cmd_t slot[EMU_QUEUE_SIZE];
+	_Alignas(64) _Atomic uint32_t head; /* пишет производитель */
+	_Alignas(64) _Atomic uint32_t tail; /* пишет потребитель */
+} emu_queue_t;
 
 /** ------------------------------------------------------
  *  Прототипы функций для виртуальной машины "Сетунь-1958"
@@ -284,54 +677,121 @@ int8_t str_symtrs2numb(uint8_t *s);
 trs_t smtr(uint8_t *s);
 
 /* Операции с ферритовой памятью машины FRAM */
-void clean_fram_zone(trs_t z);
-void clean_fram(void);
-trs_t ld_fram(trs_t ea);
-void st_fram(trs_t ea, trs_t v);
+void clean_fram_zone(setun_machine_t *m, trs_t z);
+void clean_fram(setun_machine_t *m);
+trs_t ld_fram(setun_machine_t *m, trs_t ea);
+void st_fram(setun_machine_t *m, trs_t ea, trs_t v);
+void init_tab_fram_addr(void);
+trs_t fetch_operand(setun_machine_t *m, trs_t ea);
 
 /* Операции ввода и вывода "Сетунь-1958" */
 
-/* Регист переключения Русский/Латинский */
-static uint8_t russian_latin_sw = 1;
-/* Регист переключения Буквенный/Цифровой */
-static uint8_t letter_number_sw = 0;
-/* Регист переключения цвета печатающей ленты */
-static uint8_t color_sw = 0;
-
 uint8_t pl_to_ind(uint8_t *perline);
 int ConvertSWtoPaper(char *path_lst, char *path_txt);
 int DumpFileTxs(char *pathfile);
 trs_t Decoder_Command_Paper_Line(char *paperline, uint8_t *err);
 trs_t Decoder_Symbol_Paper_Line(char *paperline, uint8_t *err);
-uint8_t Read_Commands_from_FT1(FILE *file, trs_t fa);
-uint8_t Read_Symbols_from_FT1(FILE *file, trs_t fa);
-uint8_t Read_Commands_from_FT2(FILE *file, trs_t fa);
-uint8_t Read_Symbols_from_FT1(FILE *file, trs_t fa);
-uint8_t Read_Symbols_from_FT2(FILE *file, trs_t fa);
-uint8_t Write_Commands_to_TTY1(FILE *file, trs_t fa);
-uint8_t Write_Symbols_to_TTY1(FILE *file, trs_t fa);
+int8_t paper_line_holes(const char *paperline);
+trs_t Decoder_Command_Row(int8_t holes, uint8_t *err);
+trs_t Decoder_Symbol_Row(int8_t holes, uint8_t *err);
+uint8_t tape_format(FILE *file);
+int tape_read_row(FILE *file, uint8_t fmt, int8_t *holes);
+void tape_open(tape_reader_t *r, FILE *file);
+void tape_open_mem(tape_reader_t *r, const void *data, size_t size);
+void tape_close(tape_reader_t *r);
+FILE *tape_fopen(const char *path);
+int tape_next_row(tape_reader_t *r, FILE *file, int8_t *holes);
+uint8_t tape_simd_level(void);
+size_t tape_decode_text(const uint8_t *text, size_t size, uint8_t *codes, size_t max, size_t *bad, uint8_t simd);
+int tape_text_to_bin(const char *path_in, const char *path_out);
+int tape_bin_to_text(const char *path_in, const char *path_out);
+int tape_index_open(tape_reader_t *r, const char *path, int scan);
+int tape_index_save(const tape_reader_t *r, const char *path);
+int tape_seek_zone(tape_reader_t *r, FILE *file, uint32_t n);
+void view_tape_index(const tape_reader_t *r);
+void view_tape_cache_stat(void);
+uint8_t Read_Commands_from_FT1(setun_machine_t *m, FILE *file, trs_t fa);
+uint8_t Read_Symbols_from_FT1(setun_machine_t *m, FILE *file, trs_t fa);
+uint8_t Read_Commands_from_FT2(setun_machine_t *m, FILE *file, trs_t fa);
+uint8_t Read_Symbols_from_FT1(setun_machine_t *m, FILE *file, trs_t fa);
+uint8_t Read_Symbols_from_FT2(setun_machine_t *m, FILE *file, trs_t fa);
+uint8_t Write_Commands_to_TTY1(setun_machine_t *m, FILE *file, trs_t fa);
+void tty_flush(setun_machine_t *m);
+void dev_set(dev_out_t *dev, uint8_t kind, dev_call_t call, void *ctx);
+void dev_free(dev_out_t *dev);
+uint32_t dev_sum(const dev_out_t *dev);
+uint8_t dev_kind(const char *arg);
+void view_dev_stat(setun_machine_t *m);
+void dev_sync(setun_machine_t *m);
+void dev_post(setun_machine_t *m);
+int io_start(setun_machine_t *m);
+void io_stop(setun_machine_t *m);
+void io_stat_str(setun_machine_t *m, char *s, size_t size);
+uint8_t Write_Symbols_to_TTY1(setun_machine_t *m, FILE *file, trs_t fa);
 uint8_t Perforation_Commands_to_PTP1(FILE *file, trs_t fa);
 uint8_t Perforation_Symbols_to_PTP1(FILE *file, trs_t fa);
+uint8_t Perforation_Zone_to_PTP1(setun_machine_t *m, trs_t fa, uint8_t symbols);
+void init_tab_punch(void);
+void ptp_begin(setun_machine_t *m);
+void ptp_end(setun_machine_t *m);
 void init_tab4(void);
+void init_tab_row_key(void);
+void init_tab_native(void);
+void init_tab_pace(void);
+void init_tables(void);
 
 /* Очистить память магнитного барабана DRUM */
-void clean_drum(void);
-trs_t ld_drum(trs_t ea, uint8_t ind);
-void st_drum(trs_t ea, uint8_t ind, trs_t v);
+void clean_drum(setun_machine_t *m);
+trs_t ld_drum(setun_machine_t *m, trs_t ea, uint8_t ind);
+void st_drum(setun_machine_t *m, trs_t ea, uint8_t ind, trs_t v);
 
 /* Операции копирования */
-void fram_to_drum(trs_t ea);
-void drum_to_fram(trs_t ea);
+void fram_to_drum(setun_machine_t *m, trs_t ea);
+void drum_to_fram(setun_machine_t *m, trs_t ea);
 
 /* Функции троичной машины Сетунь-1958 */
-void reset_setun_1958(void);				/* Сброс машины */
-trs_t control_trs(trs_t a);					/* Устройство управления */
-trs_t next_address(trs_t c);				/* Определить следующий адрес */
-int8_t execute_trs(trs_t addr, trs_t oper); /* Выполнение кодов операций */
+void init_setun_machine(setun_machine_t *m);					 /* Включение питания */
+void reset_setun_1958(setun_machine_t *m);						 /* Сброс машины */
+trs_t control_trs(setun_machine_t *m, trs_t a);					 /* Устройство управления */
+trs_t next_address(trs_t c);									 /* Определить следующий адрес */
+void init_tab_addr5(void);										 /* Таблицы 5-тритных адресов */
+int8_t execute_trs(setun_machine_t *m, trs_t addr, trs_t oper); /* Выполнение кодов операций */
+int Emu_Step(setun_machine_t *m);								 /* Выполнить одну команду */
+int run_for(setun_machine_t *m, uint64_t n, uint64_t *done);	 /* Выполнить не более n команд */
+int run_until_stop(setun_machine_t *m, uint64_t *done);			 /* Выполнять до останова */
+double time_monotonic(void);									 /* Время в секундах */
+int emu_queue_push(emu_queue_t *q, const emu_cmd_t *c);		 /* Команда в очередь */
+int emu_queue_pop(emu_queue_t *q, emu_cmd_t *c);				 /* Команда из очереди */
+uint8_t idle_check(setun_machine_t *m);							 /* Проверка холостого цикла */
+void view_idle_stat(setun_machine_t *m);						 /* Печать пропущенных команд */
+int run_paced(setun_machine_t *m, uint64_t n, uint64_t *done);	 /* Квант работы в темпе PACE_OPS */
+void view_pace_stat(setun_machine_t *m);						 /* Печать счётчиков темпа */
+int run_jobs(setun_job_t *jobs, int count, int threads, uint8_t sched); /* Параллельный запуск заданий */
+void sweep_apply(setun_machine_t *m, const sweep_set_t *set, int count); /* Замены варианта перебора */
+int sweep_parse(char *line, sweep_set_t *set, int max);					 /* Строка варианта в замены */
+void Emu_Open_Files(setun_machine_t *m);
+void Emu_Close_Files(setun_machine_t *m);
+int Emu_Fork_Server(setun_machine_t *base, const char *path_sock, uint64_t steps, double seconds);
+int fork_client_request(int fd, const char *path_sock, const char *line, char *reply, size_t size);
+int Emu_Daemon(const char *path_sock, int threads);
+int daemon_connect(const char *path_sock);
+int daemon_send(int fd, uint16_t type, uint16_t flags, uint32_t id,
+				const void *a, size_t alen, const void *b, size_t blen);
+int daemon_recv(int fd, daemon_hdr_t *h, char **buf);
+int sweep_jobs(const setun_machine_t *base, const char *path_variants, const char *cells_list,
+			   uint64_t steps, double seconds, setun_job_t **jobs_out, trs_t *cells, int *cells_count);
+void sweep_free(setun_job_t *jobs, int count);
+int host_cores(void);											 /* Число процессоров хоста */
+
+/* Режим целочисленных регистров S, R, F, W */
+void set_native_mode(setun_machine_t *m, uint8_t on);			 /* Включить/выключить режим */
+void native_load(setun_machine_t *m);							 /* Триты регистров в целые */
+void native_sync(setun_machine_t *m);							 /* Целые регистры в триты */
+int8_t execute_native(setun_machine_t *m, trs_t addr, trs_t oper); /* Выполнение в режиме native */
 
 /* Функции вывода отладочной информации */
 void view_short_reg(trs_t *t, uint8_t *ch);
-void view_short_regs(void);
+void view_short_regs(setun_machine_t *m);
 
 
 /** ---------------------------------------------------
@@ -1057,42 +1517,6 @@ trs_t add_trs(trs_t x, trs_t y)
 		p1 = 0;
 	}
 
-	/* Установить трит переполнения */
-	/* ph1 */
-	if (r.t0 & (1 << 19) > 0)
-	{
-		if (r.t1 & (1 << 19) > 0)
-		{
-			set_trit_setun(ph1, 1, 1);
-		}
-		else
-		{
-			set_trit_setun(ph1, 1, -1);
-		}
-	}
-	else
-	{
-		set_trit_setun(ph1, 1, 0);
-	}
-
-	/* Установить трит переполнения */
-	/* ph2 */
-	if (r.t0 & (1 << 18) > 0)
-	{
-		if (r.t1 & (1 << 18) > 0)
-		{
-			set_trit_setun(ph2, 1, 1);
-		}
-		else
-		{
-			set_trit_setun(ph2, 1, -1);
-		}
-	}
-	else
-	{
-		set_trit_setun(ph2, 1, 0);
-	}
-
 	/* результат */
 	r.l = j;
 
@@ -1234,42 +1658,6 @@ trs_t sub_trs(trs_t x, trs_t y)
 		p1 = 0;
 	}
 
-	/* Установить трит переполнения */
-	/* ph1 */
-	if (r.t0 & (1 << 19) > 0)
-	{
-		if (r.t1 & (1 << 19) > 0)
-		{
-			set_trit(ph1, 1, 1);
-		}
-		else
-		{
-			set_trit(ph1, 1, -1);
-		}
-	}
-	else
-	{
-		set_trit(ph1, 1, 0);
-	}
-
-	/* Установить трит переполнения */
-	/* ph2 */
-	if (r.t0 & (1 << 18) > 0)
-	{
-		if (r.t1 & (1 << 18) > 0)
-		{
-			set_trit_setun(ph2, 1, 1);
-		}
-		else
-		{
-			set_trit_setun(ph2, 1, -1);
-		}
-	}
-	else
-	{
-		set_trit_setun(ph2, 1, 0);
-	}
-
 	/* результат */
 	r.t1 = r.t1 & ~(0xFFFC0000); /* t[1.18] */
 	r.t0 = r.t0 & ~(0xFFFC0000); /* t[1.18] */
@@ -1514,6 +1902,10 @@ int8_t get_trit_setun(trs_t t, uint8_t pos)
 {
 	t.l = min(t.l, SIZE_WORD_LONG);
 	pos = min(pos, SIZE_WORD_LONG);
+	if ((pos == 0) || (pos > t.l))
+	{
+		return 0; /* нет трита в позиции */
+	}
 	if ((t.t0 & (1 << (t.l - pos))) > 0)
 	{
 		if ((t.t1 & (1 << (t.l - pos))) > 0)
@@ -1535,6 +1927,10 @@ trs_t set_trit_setun(trs_t t, uint8_t pos, int8_t trit)
 
 	t.l = min(t.l, SIZE_WORD_LONG);
 	pos = min(pos, SIZE_WORD_LONG);
+	if ((pos == 0) || (pos > t.l))
+	{
+		return r; /* нет трита в позиции */
+	}
 	if (trit > 0)
 	{
 		r.t1 |= (1 << (t.l - pos));
@@ -1608,9 +2004,9 @@ void copy_trs_setun(trs_t *src, trs_t *dst)
 }
 
 /* Проверить на переполнение 18-тритного числа */
-int8_t over_check(void)
+int8_t over_check(setun_machine_t *m)
 {
-	if (get_trit_setun(ph1, 1) != 0)
+	if (get_trit_setun(m->ph1, 1) != 0)
 	{
 		return 1; /* OVER Error  */
 	}
@@ -1621,12 +2017,12 @@ int8_t over_check(void)
 }
 
 /* Проверить на переполнение 18-тритного числа */
-int8_t over_word_long(trs_t x)
+int8_t over_word_long(setun_machine_t *m, trs_t x)
 {
-	ph1 = set_trit_setun(ph1, 1, get_trit_setun(x, 1));
-	ph2 = set_trit_setun(ph2, 1, get_trit_setun(x, 2));
+	m->ph1 = set_trit_setun(m->ph1, 1, get_trit_setun(x, 1));
+	m->ph2 = set_trit_setun(m->ph2, 1, get_trit_setun(x, 2));
 
-	if (get_trit_setun(ph1, 1) != 0)
+	if (get_trit_setun(m->ph1, 1) != 0)
 	{
 		return 1; /* OVER Error  */
 	}
@@ -1726,8 +2122,24 @@ trs_t rowzose2addr(uint8_t rind, uint8_t zind)
 	return r;
 }
 
-/* Новый адрес кода машины */
-trs_t next_address(trs_t c)
+/**
+ * Таблицы 5-тритных кодов адреса A(1:5), C(1:5), F(1:5).
+ * Код задаётся индексом 0..242 (значение + 121), индекс получается
+ * из упакованных битов t0 и t1 пяти тритов (TRS5_KEY).
+ */
+#define TRS5_KEY(t) (((t).t0 & 0x1F) | (((t).t1 & (t).t0 & 0x1F) << 5))
+#define TRS5_SIZE (243)
+#define TRS5_IND(t) (tab_key5_ind[TRS5_KEY(t)])
+#define TRS5_NEG(i) (TRS5_SIZE - 1 - (i))
+
+static uint8_t tab_key5_ind[1024];			 /* упакованные триты -> индекс */
+static trs_t tab_trs5[TRS5_SIZE];			 /* индекс -> 5-тритный код */
+static uint8_t tab_next_address[TRS5_SIZE]; /* следующий адрес команды */
+static uint8_t tab_next_ind[TRS5_SIZE];		 /* следующий индекс */
+static uint8_t tab_addr5_ready = 0;
+
+/* Новый адрес кода машины (потритно, для построения и проверки таблиц) */
+trs_t next_address_ref(trs_t c)
 {
 	trs_t r;
 	int8_t trit;
@@ -1743,8 +2155,8 @@ trs_t next_address(trs_t c)
 	return r;
 }
 
-/* Новый адрес кода машины */
-trs_t next_ind(trs_t c)
+/* Новый индекс кода машины (потритно, для построения и проверки таблиц) */
+trs_t next_ind_ref(trs_t c)
 {
 	trs_t r;
 	r = c;
@@ -1765,7 +2177,74 @@ trs_t next_ind(trs_t c)
 	return r;
 }
 
-void clean_fram_zone(trs_t z)
+void init_tab_addr5(void)
+{
+	trs_t t;
+	int8_t d[5];
+	uint8_t i, k;
+
+	if (tab_addr5_ready)
+	{
+		return;
+	}
+
+	/* Перебор всех 3^5 кодов по возрастанию значения */
+	k = 0;
+	for (d[0] = -1; d[0] <= 1; d[0]++)
+		for (d[1] = -1; d[1] <= 1; d[1]++)
+			for (d[2] = -1; d[2] <= 1; d[2]++)
+				for (d[3] = -1; d[3] <= 1; d[3]++)
+					for (d[4] = -1; d[4] <= 1; d[4]++)
+					{
+						t.l = 5;
+						t.t1 = 0;
+						t.t0 = 0;
+						for (i = 0; i < 5; i++)
+						{
+							t = set_trit_setun(t, i + 1, d[i]);
+						}
+						tab_trs5[k] = t;
+						tab_key5_ind[TRS5_KEY(t)] = k;
+						k++;
+					}
+
+	for (k = 0; k < TRS5_SIZE; k++)
+	{
+		tab_next_address[k] = TRS5_IND(next_address_ref(tab_trs5[k]));
+		tab_next_ind[k] = TRS5_IND(next_ind_ref(tab_trs5[k]));
+	}
+
+	tab_addr5_ready = 1;
+}
+
+/* Сложение индексов 5-тритных кодов по модулю 3^5 */
+uint8_t add_ind5(uint8_t a, uint8_t b)
+{
+	int16_t r = (int16_t)a + b - (TRS5_SIZE - 1) / 2;
+	if (r < 0)
+	{
+		r += TRS5_SIZE;
+	}
+	else if (r >= TRS5_SIZE)
+	{
+		r -= TRS5_SIZE;
+	}
+	return (uint8_t)r;
+}
+
+/* Новый адрес кода машины */
+trs_t next_address(trs_t c)
+{
+	return tab_trs5[tab_next_address[TRS5_IND(c)]];
+}
+
+/* Новый индекс кода машины */
+trs_t next_ind(trs_t c)
+{
+	return tab_trs5[tab_next_ind[TRS5_IND(c)]];
+}
+
+void clean_fram_zone(setun_machine_t *m, trs_t z)
 {
 
 	int8_t zn;
@@ -1788,14 +2267,14 @@ void clean_fram_zone(trs_t z)
 	}
 	for (row = 0; row < SIZE_GR_TRIT_FRAM; row++)
 	{
-		mem_fram[row][grfram].l = SIZE_WORD_SHORT;
-		mem_fram[row][grfram].t1 = 0;
-		mem_fram[row][grfram].t0 = 0;
+		m->mem_fram[row][grfram].l = SIZE_WORD_SHORT;
+		m->mem_fram[row][grfram].t1 = 0;
+		m->mem_fram[row][grfram].t0 = 0;
 	}
 }
 
 /* Операция очистить память ферритовую */
-void clean_fram(void)
+void clean_fram(setun_machine_t *m)
 {
 	int8_t grfram;
 	int8_t row;
@@ -1803,15 +2282,15 @@ void clean_fram(void)
 	{
 		for (row = 0; row < SIZE_GR_TRIT_FRAM; row++)
 		{
-			mem_fram[row][grfram].l = SIZE_WORD_SHORT;
-			mem_fram[row][grfram].t1 = 0;
-			mem_fram[row][grfram].t0 = 0;
+			m->mem_fram[row][grfram].l = SIZE_WORD_SHORT;
+			m->mem_fram[row][grfram].t1 = 0;
+			m->mem_fram[row][grfram].t0 = 0;
 		}
 	}
 }
 
 /* Операция очистить память на магнитном барабане */
-void clean_drum(void)
+void clean_drum(setun_machine_t *m)
 {
 	int8_t zone;
 	int8_t row;
@@ -1819,15 +2298,15 @@ void clean_drum(void)
 	{
 		for (row = 0; row < SIZE_ZONE_TRIT_DRUM; row++)
 		{
-			mem_drum[zone][row].l = SIZE_WORD_SHORT;
-			mem_drum[zone][row].t1 = 0;
-			mem_drum[zone][row].t0 = 0;
+			m->mem_drum[zone][row].l = SIZE_WORD_SHORT;
+			m->mem_drum[zone][row].t1 = 0;
+			m->mem_drum[zone][row].t0 = 0;
 		}
 	}
 }
 
 /* Функция "Читать троичное число из ферритовой памяти" */
-trs_t ld_fram(trs_t ea)
+trs_t ld_fram(setun_machine_t *m, trs_t ea)
 {
 	uint8_t zind;
 	uint8_t rind;
@@ -1854,13 +2333,13 @@ trs_t ld_fram(trs_t ea)
 	{
 		/* Прочитать 18-тритное число */
 		/* прочитать 1...9 старшую часть 18-тритного числа */
-		rrr = mem_fram[rind][0];
+		rrr = m->mem_fram[rind][0];
 		rrr = shift_trs(rrr, 9);
 		rrr.l = 18;
 		mod_3_n(&rrr, rrr.l);
 
 		/* прочитать 10...18 младшую часть 18-тритного числа */
-		res = mem_fram[rind][1];
+		res = m->mem_fram[rind][1];
 		res.l = 9;
 		res = add_trs(res, rrr);
 		res.l = 18;
@@ -1869,18 +2348,18 @@ trs_t ld_fram(trs_t ea)
 	else if (eap5 == 0)
 	{
 		/* Прочитать 1...9 старшую часть 18-тритного числа */
-		res = mem_fram[rind][zind];
+		res = m->mem_fram[rind][zind];
 	}
 	else
 	{ /* eap5 > 0 */
 		/* Прочитать 10...18 младшую часть 18-тритного числа */
-		res = mem_fram[rind][zind];
+		res = m->mem_fram[rind][zind];
 	}
 	return res;
 }
 
 /* Функция "Записи троичного числа в ферритовую память" */
-void st_fram(trs_t ea, trs_t v)
+void st_fram(setun_machine_t *m, trs_t ea, trs_t v)
 {
 	int8_t eap5;
 	uint8_t rind, zind;
@@ -1901,22 +2380,97 @@ void st_fram(trs_t ea, trs_t v)
 
 	if (eap5 < 0)
 	{ /* Записать 18-тритное число */
-		mem_fram[rind][0] = slice_trs_setun(s, 1, 9);
-		mem_fram[rind][1] = slice_trs_setun(s, 10, 18);
+		m->mem_fram[rind][0] = slice_trs_setun(s, 1, 9);
+		m->mem_fram[rind][1] = slice_trs_setun(s, 10, 18);
 	}
 	else if (eap5 == 0)
 	{ /* Записать 9-тритное число */
-		mem_fram[rind][zind] = slice_trs_setun(s, 1, 9);
+		m->mem_fram[rind][zind] = slice_trs_setun(s, 1, 9);
 	}
 	else
 	{ /* eap5 > 0 */
 		/* Записать 18-тритное число */
-		mem_fram[rind][zind] = slice_trs_setun(s, 1, 9);
+		m->mem_fram[rind][zind] = slice_trs_setun(s, 1, 9);
+	}
+}
+
+/**
+ * Дешифратор адреса A(1:5) ферритовой памяти FRAM.
+ * Индекс таблицы - упакованные биты t0 и t1 пяти тритов адреса (TRS5_KEY).
+ */
+typedef struct
+{
+	uint8_t row;  /* строка 0..80 */
+	uint8_t half; /* 0 - старшая, 1 - младшая половина строки */
+	int8_t p5;	  /* трит A(5), -1 - длинное 18-тритное слово */
+} fram_addr_t;
+
+static fram_addr_t tab_fram_addr[1024];
+static uint8_t tab_fram_addr_ready = 0;
+
+void init_tab_fram_addr(void)
+{
+	trs_t ea;
+	int8_t d[5];
+	uint8_t i;
+	fram_addr_t *p;
+
+	if (tab_fram_addr_ready)
+	{
+		return;
+	}
+
+	/* Перебор всех 3^5 адресов */
+	for (d[0] = -1; d[0] <= 1; d[0]++)
+		for (d[1] = -1; d[1] <= 1; d[1]++)
+			for (d[2] = -1; d[2] <= 1; d[2]++)
+				for (d[3] = -1; d[3] <= 1; d[3]++)
+					for (d[4] = -1; d[4] <= 1; d[4]++)
+					{
+						ea.l = 5;
+						ea.t1 = 0;
+						ea.t0 = 0;
+						for (i = 0; i < 5; i++)
+						{
+							ea = set_trit_setun(ea, i + 1, d[i]);
+						}
+						p = &tab_fram_addr[TRS5_KEY(ea)];
+						p->row = addr2row_fram(slice_trs_setun(ea, 1, 4));
+						p->half = addr2grfram(slice_trs_setun(ea, 5, 5));
+						p->p5 = d[4];
+					}
+
+	tab_fram_addr_ready = 1;
+}
+
+/**
+ * Выборка операнда A* для команд S и R.
+ * Короткий код дополняется нулями в девяти младших разрядах,
+ * длинный код (A(5) = -) собирается из двух половин строки.
+ * Результат равен ld_fram() с расширением до 18 тритов.
+ */
+trs_t fetch_operand(setun_machine_t *m, trs_t ea)
+{
+	fram_addr_t *d = &tab_fram_addr[TRS5_KEY(ea)];
+	trs_t *w = m->mem_fram[d->row];
+	trs_t r;
+
+	r.l = 18;
+	if (d->p5 < 0)
+	{
+		r.t1 = ((w[0].t1 & 0x1FF) << 9) | (w[1].t1 & 0x1FF);
+		r.t0 = ((w[0].t0 & 0x1FF) << 9) | (w[1].t0 & 0x1FF);
 	}
+	else
+	{
+		r.t1 = (w[d->half].t1 & 0x1FF) << 9;
+		r.t0 = (w[d->half].t0 & 0x1FF) << 9;
+	}
+	return r;
 }
 
 /* Копировать страницу из память fram на магнитного барабана drum */
-void fram_to_drum(trs_t ea)
+void fram_to_drum(setun_machine_t *m, trs_t ea)
 {
 	int8_t sng;
 	trs_t fram_inc;
@@ -1946,16 +2500,16 @@ void fram_to_drum(trs_t ea)
 	}
 
 	/* Копировать страницу */
-	for (uint8_t m = 0; m < SIZE_ZONE_TRIT_FRAM; m++)
+	for (uint8_t row = 0; row < SIZE_ZONE_TRIT_FRAM; row++)
 	{
-		mr = ld_fram(fram_inc);
-		st_drum(k2_k5, m, mr);
+		mr = ld_fram(m, fram_inc);
+		st_drum(m, k2_k5, row, mr);
 		fram_inc = next_address(fram_inc);
 	}
 }
 
 /*  Операция чтения в память магнитного барабана */
-trs_t ld_drum(trs_t ea, uint8_t ind)
+trs_t ld_drum(setun_machine_t *m, trs_t ea, uint8_t ind)
 {
 	uint8_t zind;
 	trs_t zr;
@@ -1975,12 +2529,12 @@ trs_t ld_drum(trs_t ea, uint8_t ind)
 		ind = 0;
 	}
 	res.l = 9;
-	copy_trs_setun(&mem_drum[zind][ind], &res);
+	copy_trs_setun(&m->mem_drum[zind][ind], &res);
 	return res;
 }
 
 /* Операция записи в память магнитного барабана */
-void st_drum(trs_t ea, uint8_t ind, trs_t v)
+void st_drum(setun_machine_t *m, trs_t ea, uint8_t ind, trs_t v)
 {
 	uint8_t zind;
 	uint8_t rind;
@@ -1995,11 +2549,11 @@ void st_drum(trs_t ea, uint8_t ind, trs_t v)
 	{
 		ind = SIZE_ZONE_TRIT_DRUM - 1;
 	}
-	copy_trs_setun(&v, &mem_drum[zind][ind]);
+	copy_trs_setun(&v, &m->mem_drum[zind][ind]);
 }
 
 /* Копировать страницу с магнитного барабана в память fram */
-void drum_to_fram(trs_t ea)
+void drum_to_fram(setun_machine_t *m, trs_t ea)
 {
 	int8_t sng;
 	trs_t zram;
@@ -2035,10 +2589,10 @@ void drum_to_fram(trs_t ea)
 	}
 
 	/* Копировать страницу */
-	for (uint8_t m = 0; m < SIZE_ZONE_TRIT_FRAM; m++)
+	for (uint8_t row = 0; row < SIZE_ZONE_TRIT_FRAM; row++)
 	{
-		mr = ld_drum(k2_k5, m);
-		st_fram(fram_inc, mr);
+		mr = ld_drum(m, k2_k5, row);
+		st_fram(m, fram_inc, mr);
 		fram_inc = next_address(fram_inc);
 	}
 }
@@ -2304,6 +2858,9 @@ void cmd_str_2_trs(uint8_t *syms, trs_t *r)
 		return;
 	}
 
+	r->l = 9;
+	r->t1 = 0;
+	r->t0 = 0;
 	sprintf(symtrs_str, "%2s%2s%2s%2s%2s",
 			lt2symtrs(syms[0]),
 			lt2symtrs(syms[1]),
@@ -2457,7 +3014,7 @@ void view_short_reg(trs_t *t, uint8_t *ch)
  * Печать троичного регистра
  *
  */
-void view_step_short_reg(trs_t *t, uint8_t *ch)
+void view_step_short_reg(setun_machine_t *m, trs_t *t, uint8_t *ch)
 {
 	int8_t i;
 	int8_t l;
@@ -2501,25 +3058,25 @@ void view_step_short_reg(trs_t *t, uint8_t *ch)
 	if (get_trit_setun(tv, 5) < 0)
 	{
 		tv = set_trit_setun(tv, 5, 0);
-		MR = ld_fram(tv);
-		trs2str(MR);
+		m->MR = ld_fram(m, tv);
+		trs2str(m->MR);
 		printf(" ");
 		tv = set_trit_setun(tv, 5, 1);
-		MR = ld_fram(tv);
-		trs2str(MR);
+		m->MR = ld_fram(m, tv);
+		trs2str(m->MR);
 		// printf("\r\n");
 		tv = set_trit_setun(tv, 5, -1);
-		MR = ld_fram(tv);
+		m->MR = ld_fram(m, tv);
 	}
 	else
 	{
-		MR = ld_fram(tv);
-		trs2str(MR);
+		m->MR = ld_fram(m, tv);
+		trs2str(m->MR);
 		// printf("\r\n");
 	}
 
 	printf(", ");
-	printf("(%li)", (long int)trs2digit(MR));
+	printf("(%li)", (long int)trs2digit(m->MR));
 	printf("\r\n");
 
 	//
@@ -2535,7 +3092,7 @@ void view_step_short_reg(trs_t *t, uint8_t *ch)
  * Печать троичного регистра
  *
  */
-void view_step_new_addres(trs_t *t, uint8_t *ch)
+void view_step_new_addres(setun_machine_t *m, trs_t *t, uint8_t *ch)
 {
 	int8_t i;
 	int8_t l;
@@ -2572,24 +3129,24 @@ void view_step_new_addres(trs_t *t, uint8_t *ch)
 	{
 
 		tv = set_trit_setun(tv, 5, 0);
-		MR = ld_fram(tv);
-		trs2str(MR);
+		m->MR = ld_fram(m, tv);
+		trs2str(m->MR);
 		printf(" ");
 		tv = set_trit_setun(tv, 5, 1);
-		MR = ld_fram(tv);
-		trs2str(MR);
+		m->MR = ld_fram(m, tv);
+		trs2str(m->MR);
 		// printf("\r\n");
 		tv = set_trit_setun(tv, 5, -1);
-		MR = ld_fram(tv);
+		m->MR = ld_fram(m, tv);
 	}
 	else
 	{
-		MR = ld_fram(tv);
-		trs2str(MR);
+		m->MR = ld_fram(m, tv);
+		trs2str(m->MR);
 		// printf("\r\n");
 	}
 	printf(", ");
-	printf("(%li)", (long int)trs2digit(MR));
+	printf("(%li)", (long int)trs2digit(m->MR));
 	printf("\r\n");
 
 #if 0	
@@ -2681,27 +3238,30 @@ void view_checksum_setun(trs_t t)
 /**
  * Печать регистров машины Сетунь-1958
  */
-void view_short_regs(void)
+void view_short_regs(setun_machine_t *m)
 {
 	int8_t i;
 
+	/* Материализовать целочисленные регистры режима native */
+	native_sync(m);
+
 	// printf("[Registers Setun-1958]\r\n");
 	printf("\r\n");
-	view_short_reg(&K, "  K  ");
-	view_short_reg(&F, "  F  ");
-	view_short_reg(&C, "  C  ");
-	view_short_reg(&W, "  W  ");
-	view_short_reg(&ph1, "  ph1");
-	view_short_reg(&ph2, "  ph2");
-	view_short_reg(&S, "  S  ");
-	view_short_reg(&R, "  R  ");
-	view_short_reg(&MB, "  MB ");
+	view_short_reg(&m->K, "  K  ");
+	view_short_reg(&m->F, "  F  ");
+	view_short_reg(&m->C, "  C  ");
+	view_short_reg(&m->W, "  W  ");
+	view_short_reg(&m->ph1, "  ph1");
+	view_short_reg(&m->ph2, "  ph2");
+	view_short_reg(&m->S, "  S  ");
+	view_short_reg(&m->R, "  R  ");
+	view_short_reg(&m->MB, "  MB ");
 }
 
 /**
  * Печать памяти FRAM машины Сетунь-1958
  */
-void view_elem_fram(trs_t ea)
+void view_elem_fram(setun_machine_t *m, trs_t ea)
 {
 	int8_t j;
 	trs_t tv;
@@ -2721,7 +3281,7 @@ void view_elem_fram(trs_t ea)
 	rr = slice_trs_setun(ea, 1, 4);
 	rind = addr2row_fram(rr);
 
-	r = mem_fram[rind][zind];
+	r = m->mem_fram[rind][zind];
 
 	printf("fram[");
 	for (j = 1; j < 6; j++)
@@ -2740,7 +3300,7 @@ void view_elem_fram(trs_t ea)
 	printf("\r\n");
 }
 
-void view_fram(trs_t addr1, trs_t addr2)
+void view_fram(setun_machine_t *m, trs_t addr1, trs_t addr2)
 {
 	trs_t ad1 = addr1;
 	trs_t ad2 = addr2;
@@ -2757,7 +3317,7 @@ void view_fram(trs_t addr1, trs_t addr2)
 				inc_trs(&ad1);
 				i += 1;
 			}
-			view_elem_fram(ad1);
+			view_elem_fram(m, ad1);
 			inc_trs(&ad1);
 		}
 	}
@@ -2766,7 +3326,7 @@ void view_fram(trs_t addr1, trs_t addr2)
 /**
  * Печать памяти FRAM машины Сетунь-1958
  */
-void dump_fram(void)
+void dump_fram(setun_machine_t *m)
 {
 	int8_t grfram;
 	int8_t row;
@@ -2780,7 +3340,7 @@ void dump_fram(void)
 	{
 		for (grfram = 0; grfram < SIZE_GRFRAM; grfram++)
 		{
-			r = mem_fram[row][grfram];
+			r = m->mem_fram[row][grfram];
 			r.l = 9;
 			// viv+ dbg view_short_reg(&r,"r");
 
@@ -2803,7 +3363,7 @@ void dump_fram(void)
  * Печать дампа зоны FRAM машины Сетунь-1958
  * по шаблону из книг математического обеспечения
  */
-void dump_fram_zone(trs_t z)
+void dump_fram_zone(setun_machine_t *m, trs_t z)
 {
 	int8_t grfram;
 	int8_t row;
@@ -2847,7 +3407,7 @@ void dump_fram_zone(trs_t z)
 	inr = set_trit_setun(inr, 5, 0);
 	for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
 	{
-		tv = ld_fram(inr);
+		tv = ld_fram(m, inr);
 		ksum = add_trs(ksum, tv);
 		inr = next_address(inr);
 	}
@@ -2872,7 +3432,7 @@ void dump_fram_zone(trs_t z)
 		trs2str(r);
 		printf("  ");
 		// addr 1
-		tv = ld_fram(fram_row1);
+		tv = ld_fram(m, fram_row1);
 		r = slice_trs_setun(tv, 1, 1);
 		trs2str(r);
 		printf(" ");
@@ -2903,7 +3463,7 @@ void dump_fram_zone(trs_t z)
 			trs2str(r);
 			printf("  ");
 
-			tv = ld_fram(fram_row2);
+			tv = ld_fram(m, fram_row2);
 			r = slice_trs_setun(tv, 1, 1);
 			trs2str(r);
 			printf(" ");
@@ -2946,7 +3506,7 @@ void dump_fram_zone(trs_t z)
 		printf("  ");
 		//
 		//
-		tv = ld_fram(fram_row1);
+		tv = ld_fram(m, fram_row1);
 		r = slice_trs_setun(tv, 1, 1);
 		trs2str(r);
 		printf(" ");
@@ -2974,7 +3534,7 @@ void dump_fram_zone(trs_t z)
 			trs2str(r);
 			printf("  ");
 			//
-			tv = ld_fram(fram_row2);
+			tv = ld_fram(m, fram_row2);
 			r = slice_trs_setun(tv, 1, 1);
 			trs2str(r);
 			printf(" ");
@@ -3021,7 +3581,7 @@ void dump_fram_zone(trs_t z)
 /**
  * Печать короткого слова DRUM машины Сетунь-1958
  */
-void view_drum_zone(trs_t zone)
+void view_drum_zone(setun_machine_t *m, trs_t zone)
 {
 	int8_t j;
 	trs_t zr;
@@ -3040,9 +3600,9 @@ void view_drum_zone(trs_t zone)
 	for (uint8_t i = 0; i < SIZE_ZONE_TRIT_DRUM; i++)
 	{
 		// Читать короткое слово
-		trs_t mr = ld_drum(zr, i);
+		trs_t mr = ld_drum(m, zr, i);
 		mr.l = 9;
-		uint32_t r = ld_drum(zr, i).t1 & (uint32_t)(0x3FFFF);
+		uint32_t r = ld_drum(m, zr, i).t1 & (uint32_t)(0x3FFFF);
 		printf("drum[% 3i:% 3i ] ", zind, i);
 		/* Вывод короткого троичного слова */
 		printf(" [");
@@ -3062,7 +3622,7 @@ void view_drum_zone(trs_t zone)
 /**
  * Печать памяти DRUM машины Сетунь-1958
  */
-void dump_drum(void)
+void dump_drum(setun_machine_t *m)
 {
 	int8_t zone;
 	int8_t row;
@@ -3076,7 +3636,7 @@ void dump_drum(void)
 	{
 		for (row = 0; row < SIZE_ZONE_TRIT_DRUM; row++)
 		{
-			copy_trs_setun(&mem_drum[zone][row], &r);
+			copy_trs_setun(&m->mem_drum[zone][row], &r);
 
 			printf("drum[%3i:%3i] = [", zone, row - SIZE_ZONE_TRIT_DRUM / 2);
 
@@ -3111,7 +3671,7 @@ uint8_t *tab4_4[TAB_SIZE][SYMBOL_SIZE];
 uint8_t *tab4_5[TAB_SIZE][SYMBOL_SIZE];
 uint8_t *tab4_6[TAB_SIZE][SYMBOL_SIZE];
 uint8_t *tab4_7[TAB_MIN_SIZE][STRING_PAPER_SIZE];
-trs_t tab4_8[TAB_MIN_SIZE];
+trs_t tab4_8[TAB_SIZE];
 
 /*
  * Инициализация таблицы кодирования
@@ -3151,6 +3711,8 @@ void init_tab4(void)
 	memmove(tab4_0[trs2digit(smtr("++0")) + offset], "O_O._O", STRING_PAPER_SIZE);
 	memmove(tab4_0[trs2digit(smtr("+++")) + offset], "O_O.__", STRING_PAPER_SIZE);
 
+	init_tab_punch();
+
 	/* Init tab4_1 */
 	tab4_1[pl_to_ind("_OO.O_")] = smtr("---");
 	tab4_1[pl_to_ind("_O_.OO")] = smtr("--0");
@@ -3496,1122 +4058,1709 @@ int16_t Decoder_String_from_Paper_Line(void)
 	return 1;
 }
 
-/* Декодирование комбинации пробивок в троичное число */
-trs_t Decoder_Command_Paper_Line(char *paperline, uint8_t *err)
+/**
+ * Строка перфоленты "OO_.O_" в номер комбинации пробивок 0..31,
+ * -1 - нет точки транспортной дорожки
+ */
+int8_t paper_line_holes(const char *paperline)
 {
+	int8_t byte = 0;
 
-	uint8_t byte;
-	int len;
-	int16_t count = 0;
-	trs_t res;
-
-	byte = 0;
-	for (int i = 0; i < strlen(paperline); i++)
+	for (int i = 0; paperline[i] != '\0'; i++)
 	{
-
 		if (i == 3)
 		{
 			if (paperline[i] != '.')
 			{
-				*err = 1;	/* Error#1 */
-				return res; /* error string paper */
+				return -1; /* error string paper */
 			}
 		}
-		else
+		else if ((paperline[i] == 'O') || (paperline[i] == 'o'))
 		{
-			if ((paperline[i] == 'O') || (paperline[i] == 'o'))
+			switch (i)
 			{
-
-				switch (i)
-				{
-				case 0:
-					byte |= (1 << 4);
-					break;
-				case 1:
-					byte |= (1 << 3);
-					break;
-				case 2:
-					byte |= (1 << 2);
-					break;
-				case 4:
-					byte |= (1 << 1);
-					break;
-				case 5:
-					byte |= (1 << 0);
-					break;
-				}
+			case 0:
+				byte |= (1 << 4);
+				break;
+			case 1:
+				byte |= (1 << 3);
+				break;
+			case 2:
+				byte |= (1 << 2);
+				break;
+			case 4:
+				byte |= (1 << 1);
+				break;
+			case 5:
+				byte |= (1 << 0);
+				break;
 			}
 		}
 	}
-	// printf(" byte=%i\r\n", byte);	//viv+ dbg
+	return byte;
+}
 
-	/* Проверить допустимые комбинации пробивок */
-	int r;
-	res = tab4_2[byte];
-	r = trs2digit(res);
+/* Декодирование комбинации пробивок в троичный код команды */
+trs_t Decoder_Command_Row(int8_t holes, uint8_t *err)
+{
+	trs_t res = {0};
 
-	if (r > 4)
+	if ((holes < 0) || (holes >= TAB_SIZE))
 	{
-		/* Error */
-		*err = 1; /* Error */
+		*err = 1; /* Error#1 */
+		return res;
 	}
-	else
+
+	/* Проверить допустимые комбинации пробивок */
+	res = tab4_2[holes];
+	*err = (trs2digit(res) > 4) ? 1 : 0;
+
+	return res;
+}
+
+/* Декодирование комбинации пробивок в троичный код символа */
+trs_t Decoder_Symbol_Row(int8_t holes, uint8_t *err)
+{
+	trs_t res = {0};
+
+	if ((holes < 0) || (holes >= TAB_SIZE))
 	{
-		/* Valid */
-		*err = 0; /* Ok' */
+		*err = 1; /* Error#1 */
+		return res;
 	}
+	res = tab4_1[holes];
+	*err = 0; /* Ok' */
 
 	return res;
 }
 
+/* Декодирование комбинации пробивок в троичное число */
+trs_t Decoder_Command_Paper_Line(char *paperline, uint8_t *err)
+{
+	return Decoder_Command_Row(paper_line_holes(paperline), err);
+}
+
 /* Декодирование комбинации пробивок в троичное число */
 trs_t Decoder_Symbol_Paper_Line(char *paperline, uint8_t *err)
 {
+	return Decoder_Symbol_Row(paper_line_holes(paperline), err);
+}
 
-	uint8_t byte;
-	int len;
-	int16_t count = 0;
-	trs_t res;
+/** ------------------------------------------------------------
+ *  Двоичный формат перфоленты
+ *  ------------------------------------------------------------
+ *  Заголовок tape_bin_hdr_t и по одному байту на строку: пробивки
+ *  в битах 4..0 (дорожки 1, 2, 3, 4, 5 слева направо, как в
+ *  paper_line_holes). Текстовая лента - строки "OO_.O_" с CRLF.
+ */
+#define TAPE_BIN_MAGIC "SETUNPL1"
+#define TAPE_TOKEN_MAX (19) /* длина слова текстовой перфоленты, как fscanf("%19s") */
+#define TAPE_KEY_BITS (7)	/* таблица ключей строк: 128 ячеек */
+#define TAPE_STREAM_BUF (65536) /* буфер чтения перфоленты из потока */
 
-	byte = 0;
-	for (int i = 0; i < strlen(paperline); i++)
+typedef struct tape_bin_hdr
+{
+	char magic[8];
+	uint32_t rows; /* строк перфоленты */
+	uint32_t reserved;
+} tape_bin_hdr_t;
+
+/* Формат открытой перфоленты, после заголовка двоичной или в начале текстовой */
+uint8_t tape_format(FILE *file)
+{
+	tape_bin_hdr_t h;
+
+	if (file == NULL)
+	{
+		return TAPE_TEXT;
+	}
+	if ((fread(&h, sizeof(h), 1, file) == 1) && (memcmp(h.magic, TAPE_BIN_MAGIC, 8) == 0))
 	{
+		return TAPE_BIN;
+	}
+	rewind(file);
+	return TAPE_TEXT;
+}
 
-		if (i == 3)
+/**
+ * Таблица строк текстовой перфоленты: ключ - шесть символов строки
+ * "OO_.O_" в младших байтах 64-битного слова, значение - номер
+ * комбинации пробивок. Строки из других символов ('o', пробелы)
+ * декодируются paper_line_holes().
+ */
+static uint64_t tab_row_key[1 << TAPE_KEY_BITS];
+static int8_t tab_row_holes[1 << TAPE_KEY_BITS];
+static pthread_once_t tab_row_once = PTHREAD_ONCE_INIT;
+
+/* Маска 'O' шести символов строки (бит 3 - '.') в комбинацию пробивок */
+static uint8_t tab_row_mask[64];
+
+static inline uint32_t tape_key_slot(uint64_t key)
+{
+	return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - TAPE_KEY_BITS));
+}
+
+/* Шесть символов строки в ключ */
+static inline uint64_t tape_row_key(const uint8_t *p)
+{
+	return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) |
+		   ((uint64_t)p[3] << 24) | ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40);
+}
+
+static void build_tab_row_key(void)
+{
+	memset(tab_row_key, 0, sizeof(tab_row_key));
+	memset(tab_row_holes, -1, sizeof(tab_row_holes));
+	for (int8_t holes = 0; holes < TAB_SIZE; holes++)
+	{
+		uint8_t row[6] = {'_', '_', '_', '.', '_', '_'};
+		uint64_t key;
+		uint32_t i;
+
+		row[0] = (holes & (1 << 4)) ? 'O' : '_';
+		row[1] = (holes & (1 << 3)) ? 'O' : '_';
+		row[2] = (holes & (1 << 2)) ? 'O' : '_';
+		row[4] = (holes & (1 << 1)) ? 'O' : '_';
+		row[5] = (holes & (1 << 0)) ? 'O' : '_';
+		key = tape_row_key(row);
+
+		/* Открытая адресация */
+		for (i = tape_key_slot(key); tab_row_key[i] != 0; i = (i + 1) & ((1 << TAPE_KEY_BITS) - 1))
+			;
+		tab_row_key[i] = key;
+		tab_row_holes[i] = holes;
+	}
+	for (uint8_t mask = 0; mask < 64; mask++)
+	{
+		tab_row_mask[mask] = (((mask >> 0) & 1) << 4) | (((mask >> 1) & 1) << 3) | (((mask >> 2) & 1) << 2) |
+							 (((mask >> 4) & 1) << 1) | ((mask >> 5) & 1);
+	}
+}
+
+/* Таблицы строятся один раз, вызов безопасен из любого потока */
+void init_tab_row_key(void)
+{
+	pthread_once(&tab_row_once, build_tab_row_key);
+}
+
+static void tape_predecode(tape_reader_t *r, const struct stat *st);
+static void tape_cache_put(struct tape_cache_entry *e);
+static size_t io_tape_swap(tape_reader_t *r);
+
+/**
+ * Дочитать поток: непрочитанный остаток сдвигается в начало буфера,
+ * read() не больше свободного места. Пустой канал - ожидание в poll()
+ * без опроса в цикле. Возврат: прочитано байт, 0 - конец потока.
+ * Лента, читаемая потоком устройств, - обмен на готовый буфер строк.
+ */
+static size_t tape_fill(tape_reader_t *r)
+{
+	uint8_t *buf = (uint8_t *)r->data;
+	ssize_t n;
+
+	if (r->pf != NULL)
+	{
+		return io_tape_swap(r);
+	}
+	if (r->end)
+	{
+		return 0;
+	}
+	if (r->pos > 0)
+	{
+		memmove(buf, buf + r->pos, r->size - r->pos);
+		r->base += r->pos;
+		r->size -= r->pos;
+		r->pos = 0;
+	}
+	if (r->size == TAPE_STREAM_BUF)
+	{
+		return 0;
+	}
+	while (1)
+	{
+		n = read(r->fd, buf + r->size, TAPE_STREAM_BUF - r->size);
+		if (n > 0)
 		{
-			if (paperline[i] != '.')
-			{
-				*err = 1;	/* Error#1 */
-				return res; /* error string paper */
-			}
+			r->size += n;
+			return (size_t)n;
 		}
-		else
+		if ((n < 0) && (errno == EINTR))
 		{
-			if ((paperline[i] == 'O') || (paperline[i] == 'o'))
-			{
+			continue;
+		}
+		if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+		{
+			struct pollfd pfd = {r->fd, POLLIN, 0};
 
-				switch (i)
-				{
-				case 0:
-					byte |= (1 << 4);
-					break;
-				case 1:
-					byte |= (1 << 3);
-					break;
-				case 2:
-					byte |= (1 << 2);
-					break;
-				case 4:
-					byte |= (1 << 1);
-					break;
-				case 5:
-					byte |= (1 << 0);
-					break;
-				}
-			}
+			poll(&pfd, 1, -1);
+			continue;
 		}
+		r->end = 1;
+		return 0;
 	}
+}
 
-	/* Проверить допустимые комбинации пробивок */
-	int r;
-	res = tab4_1[byte];
-	
-	/* Valid */
-	*err = 0; /* Ok' */
+/* Перфолента из канала, FIFO или сокета */
+static void tape_open_stream(tape_reader_t *r, int fd)
+{
+	uint8_t *buf = malloc(TAPE_STREAM_BUF);
 
-	return res;
+	if (buf == NULL)
+	{
+		return;
+	}
+	r->data = buf;
+	r->owned = 1;
+	r->stream = 1;
+	r->fd = fd;
+	while ((r->size < sizeof(tape_bin_hdr_t)) && (tape_fill(r) > 0))
+		;
+	if ((r->size >= sizeof(tape_bin_hdr_t)) && (memcmp(r->data, TAPE_BIN_MAGIC, 8) == 0))
+	{
+		r->fmt = TAPE_BIN;
+		r->pos = sizeof(tape_bin_hdr_t);
+	}
 }
 
-/**
- * Печать на электрифицированную пишущую машинку
- * 'An electrified typewriter'
- */
-void electrified_typewriter(trs_t t, uint8_t local)
+/* Файл перфоленты: путь, "-" - стандартный ввод, "fd:N" - открытый описатель N */
+FILE *tape_fopen(const char *path)
 {
+	FILE *f;
+	int fd;
 
-	int32_t code;
-
-	color_sw += 0;
+	if (strcmp(path, "-") == 0)
+	{
+		fd = dup(STDIN_FILENO);
+	}
+	else if (strncmp(path, "fd:", 3) == 0)
+	{
+		fd = dup(atoi(path + 3));
+	}
+	else
+	{
+		return fopen(path, "r");
+	}
+	if (fd < 0)
+	{
+		return NULL;
+	}
+	f = fdopen(fd, "r");
+	if (f == NULL)
+	{
+		close(fd);
+	}
+	return f;
+}
 
-	russian_latin_sw = local;
-	code = trs2digit(t);
+/* Открыть перфоленту файла: mmap() обычного файла или чтение через FILE */
+void tape_open(tape_reader_t *r, FILE *file)
+{
+	struct stat st;
 
-	switch (code)
+	memset(r, 0, sizeof(*r));
+	if (file == NULL)
 	{
-	case 6: /* t = 1-10 */
-		switch (russian_latin_sw)
+		return;
+	}
+	init_tab_row_key();
+	if ((fstat(fileno(file), &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0))
+	{
+		void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+		if (p != MAP_FAILED)
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
+			madvise(p, st.st_size, MADV_SEQUENTIAL);
+			r->data = p;
+			r->size = st.st_size;
+			r->mapped = 1;
+			if ((r->size >= sizeof(tape_bin_hdr_t)) && (memcmp(r->data, TAPE_BIN_MAGIC, 8) == 0))
 			{
-			case 0: /* letter */
-				printf("%s", "А");
-				fwrite("А", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "6");
-				fwrite("6", 1, 1, tty1);
-				break;
+				r->fmt = TAPE_BIN;
+				r->pos = sizeof(tape_bin_hdr_t);
 			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
+			else
 			{
-			case 0: /* letter */
-				printf("%s", "A");
-				fwrite("А", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "6");
-				fwrite("6", 1, 1, tty1);
-				break;
+				tape_predecode(r, &st);
 			}
-			break;
+			return;
 		}
-		break;
-
-	case 7: /* t = 1-11 */
-		switch (russian_latin_sw)
+	}
+	if ((fstat(fileno(file), &st) == 0) && !S_ISREG(st.st_mode))
+	{
+		tape_open_stream(r, fileno(file));
+		if (r->stream)
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "В");
-				fwrite("В", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "7");
-				fwrite("7", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "B");
-				fwrite("В", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "7");
-				fwrite("7", 1, 1, tty1);
-				break;
-			}
-			break;
+			return;
 		}
-		break;
+	}
+	r->fmt = tape_format(file);
+}
+
+/* Перфолента из памяти, data не освобождается */
+void tape_open_mem(tape_reader_t *r, const void *data, size_t size)
+{
+	memset(r, 0, sizeof(*r));
+	init_tab_row_key();
+	r->data = data;
+	r->size = size;
+	if ((size >= sizeof(tape_bin_hdr_t)) && (memcmp(data, TAPE_BIN_MAGIC, 8) == 0))
+	{
+		r->fmt = TAPE_BIN;
+		r->pos = sizeof(tape_bin_hdr_t);
+	}
+}
+
+void tape_close(tape_reader_t *r)
+{
+	if (r->mapped)
+	{
+		munmap((void *)r->data, r->size);
+	}
+	if (r->owned)
+	{
+		free((void *)r->data);
+	}
+	if (r->cache != NULL)
+	{
+		tape_cache_put(r->cache);
+	}
+	free(r->zone);
+	memset(r, 0, sizeof(*r));
+}
+
+/* Позиция на перфоленте */
+long tape_tell(const tape_reader_t *r, FILE *file)
+{
+	if (r->stream)
+	{
+		return (long)(r->base + r->pos);
+	}
+	if (r->data != NULL)
+	{
+		return (long)r->pos;
+	}
+	return (file != NULL) ? ftell(file) : 0;
+}
 
-	case 8: /* t = 10-1 */
-		switch (russian_latin_sw)
+void tape_seek(tape_reader_t *r, FILE *file, long pos)
+{
+	if (r->stream)
+	{
+		/* Поток - только вперёд */
+		while (r->base + r->size < (uint64_t)pos)
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "С");
-				fwrite("С", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "8");
-				fwrite("8", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
+			r->pos = r->size;
+			if (tape_fill(r) == 0)
 			{
-			case 0: /* letter */
-				printf("%s", "C");
-				fwrite("C", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "8");
-				fwrite("8", 1, 1, tty1);
 				break;
 			}
-			break;
 		}
-		break;
-
-	case 9: /* t = 100 */
-		switch (russian_latin_sw)
+		if ((uint64_t)pos > r->base)
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Д");
-				fwrite("Д", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "9");
-				fwrite("9", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "D");
-				fwrite("D", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "9");
-				fwrite("9", 1, 1, tty1);
-				break;
-			}
-			break;
+			r->pos = ((uint64_t)pos - r->base < r->size) ? (size_t)((uint64_t)pos - r->base) : r->size;
 		}
-		break;
+	}
+	else if (r->data != NULL)
+	{
+		r->pos = ((size_t)pos <= r->size) ? (size_t)pos : r->size;
+	}
+	else if (file != NULL)
+	{
+		fseek(file, pos, SEEK_SET);
+	}
+}
+
+/* Конец перфоленты, поток дочитывается */
+int tape_eof(tape_reader_t *r, FILE *file)
+{
+	if (r->stream)
+	{
+		return (r->pos >= r->size) && (tape_fill(r) == 0);
+	}
+	if (r->data != NULL)
+	{
+		return r->pos >= r->size;
+	}
+	return (file == NULL) || feof(file);
+}
+
+/**
+ * Следующая строка перфоленты: *holes - комбинация пробивок,
+ * -1 - строка не распознана. Возврат: 0 или EOF.
+ */
+int tape_next_row(tape_reader_t *r, FILE *file, int8_t *holes)
+{
+	const uint8_t *p;
+	size_t end;
+	size_t len;
 
-	case 10: /* t = 101 */
-		switch (russian_latin_sw)
+	if (r->data == NULL)
+	{
+		return (file != NULL) ? tape_read_row(file, r->fmt, holes) : EOF;
+	}
+	if (r->fmt == TAPE_BIN)
+	{
+		if ((r->pos >= r->size) && (!r->stream || (tape_fill(r) == 0)))
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Е");
-				fwrite("Е", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", " ");
-				fwrite(" ", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "E");
-				fwrite("E", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", " ");
-				fwrite(" ", 1, 1, tty1);
-				break;
-			}
-			break;
+			return EOF;
 		}
-		break;
+		*holes = (r->data[r->pos] < TAB_SIZE) ? r->data[r->pos] : -1;
+		r->pos++;
+		return 0;
+	}
 
-	case -12: /* t = -1-10 */
-		switch (russian_latin_sw)
+	while (1)
+	{
+		/* Пропустить разделители строк */
+		while ((r->pos < r->size) && isspace(r->data[r->pos]))
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Б");
-				fwrite("Б", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "-");
-				fwrite("-", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "F");
-				fwrite("F", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "-");
-				fwrite("-", 1, 1, tty1);
-				break;
-			}
-			break;
+			r->pos++;
 		}
-		break;
-
-	case -9: /* t = -100 */
-		switch (russian_latin_sw)
+		if (r->pos >= r->size)
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Щ");
-				fwrite("Щ", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "Ю");
-				fwrite("Ю", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
+			if (r->stream && (tape_fill(r) > 0))
 			{
-			case 0: /* letter */
-				printf("%s", "G");
-				fwrite("G", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "/");
-				fwrite("/", 1, 1, tty1);
-				break;
+				continue;
 			}
-			break;
+			return EOF;
+		}
+		end = r->pos;
+		while ((end < r->size) && !isspace(r->data[end]) && (end - r->pos < TAPE_TOKEN_MAX))
+		{
+			end++;
+		}
+		/* Слово на границе буфера потока */
+		if (r->stream && (end == r->size) && (end - r->pos < TAPE_TOKEN_MAX) && (tape_fill(r) > 0))
+		{
+			continue;
 		}
 		break;
+	}
+	p = r->data + r->pos;
+	len = end - r->pos;
+	r->pos = end;
+
+	if (len == 6)
+	{
+		uint64_t key = tape_row_key(p);
 
-	case -8: /* t = -101 */
-		switch (russian_latin_sw)
+		for (uint32_t i = tape_key_slot(key); tab_row_key[i] != 0; i = (i + 1) & ((1 << TAPE_KEY_BITS) - 1))
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Н");
-				fwrite("Н", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", ",");
-				fwrite(",", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
+			if (tab_row_key[i] == key)
 			{
-			case 0: /* letter */
-				printf("%s", "H");
-				fwrite("H", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", ".");
-				fwrite(".", 1, 1, tty1);
-				break;
+				*holes = tab_row_holes[i];
+				return 0;
 			}
-			break;
 		}
-		break;
+	}
 
-	case -6: /* t = -110  */
-		switch (russian_latin_sw)
-		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "I");
-				fwrite("I", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "+");
-				fwrite("+", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Л");
-				fwrite("Л", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "+");
-				fwrite("+", 1, 1, tty1);
-				break;
-			}
-			break;
-		}
-		break;
+	/* Строка не из 'O', '_', '.' */
+	char line[TAPE_TOKEN_MAX + 1];
+	memcpy(line, p, len);
+	line[len] = '\0';
+	*holes = paper_line_holes(line);
+	return 0;
+}
 
-	case -5: /* t = -111 */
-		switch (russian_latin_sw)
-		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Ы");
-				fwrite("Ы", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "Э");
-				fwrite("Э", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "J");
-				fwrite("J", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "V");
-				fwrite("V", 1, 1, tty1);
-				break;
-			}
-			break;
-		}
-		break;
+/** ------------------------------------------------------------
+ *  Декодирование текстовой перфоленты целиком
+ *  ------------------------------------------------------------
+ *  Строки "OO_.O_" с концом CRLF (8 байт) или LF (7 байт) идут
+ *  с постоянным шагом: 16 (SSE2) или 32 (AVX2) байта сравниваются
+ *  с 'O', '_', '.', '\r', '\n' за одну команду, маски movemask
+ *  проверяются по образцу шага, пробивки строки - шесть бит маски
+ *  'O' по таблице tab_row_mask. Блок не по образцу ('o', пробелы,
+ *  пустые строки, конец ленты) декодируется по строке tape_next_row().
+ */
+#define TAPE_SIMD_NONE (0)
+#define TAPE_SIMD_SSE2 (1)
+#define TAPE_SIMD_AVX2 (2)
 
-	case -4: /* t = 0-1-1 */
-		switch (russian_latin_sw)
-		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "К");
-				fwrite("К", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "Ж");
-				fwrite("Ж", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "K");
-				fwrite("K", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "W");
-				fwrite("W", 1, 1, tty1);
-				break;
-			}
-			break;
-		}
-		break;
+/* Пробивки символов таблицы tab4_0 и пустая строка; "OOO.xx" не пробиваются */
+#define TAPE_ROW_ALLOWED(h) (((h) & 0x1C) != 0x1C)
 
-	case -3: /* t = 0-10  */
-		switch (russian_latin_sw)
-		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Г");
-				fwrite("Г", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "Х");
-				fwrite("Х", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "L");
-				fwrite("L", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "X");
-				fwrite("X", 1, 1, tty1);
-				break;
-			}
-			break;
-		}
-		break;
+/* Образец блока строк с шагом step байт */
+typedef struct tape_simd_pat
+{
+	uint32_t hole; /* дорожки: 'O' или '_' */
+	uint32_t dot;  /* транспортная дорожка '.' */
+	uint32_t cr;
+	uint32_t lf;
+	uint8_t step; /* байт на строку */
+	uint8_t rows; /* строк в блоке */
+} tape_simd_pat_t;
+
+static void tape_simd_pat(tape_simd_pat_t *pat, uint8_t step, uint8_t width)
+{
+	memset(pat, 0, sizeof(*pat));
+	pat->step = step;
+	pat->rows = width / step;
+	for (uint8_t k = 0; k < pat->rows; k++)
+	{
+		uint32_t b = k * step;
 
-	case -2: /* t = 0-11  */
-		switch (russian_latin_sw)
+		pat->hole |= 0x37u << b;
+		pat->dot |= 0x08u << b;
+		if (step == 8)
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "М");
-				fwrite("М", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "У");
-				fwrite("У", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "M");
-				fwrite("M", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "Y");
-				fwrite("Y", 1, 1, tty1);
-				break;
-			}
-			break;
+			pat->cr |= 0x40u << b;
+			pat->lf |= 0x80u << b;
 		}
-		break;
-
-	case -1: /* t = 00-1  */
-		switch (russian_latin_sw)
+		else
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "И");
-				fwrite("И", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "Ц");
-				fwrite("Ц", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "N");
-				fwrite("N", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "Z");
-				fwrite("Z", 1, 1, tty1);
-				break;
-			}
-			break;
+			pat->lf |= 0x40u << b;
 		}
-		break;
+	}
+}
+
+/* Блок по образцу: пробивки строк в codes */
+static inline int tape_simd_rows(const tape_simd_pat_t *pat, uint32_t mo, uint32_t mu, uint32_t md,
+								 uint32_t mc, uint32_t ml, uint8_t *codes)
+{
+	if ((((mo | mu) & pat->hole) != pat->hole) || ((md & pat->dot) != pat->dot) ||
+		((mc & pat->cr) != pat->cr) || ((ml & pat->lf) != pat->lf))
+	{
+		return 0;
+	}
+	for (uint8_t k = 0; k < pat->rows; k++)
+	{
+		codes[k] = tab_row_mask[(mo >> (k * pat->step)) & 0x3F];
+	}
+	return 1;
+}
 
-	case 0: /* t = 000  */
-		switch (russian_latin_sw)
+#if defined(TAPE_SIMD_X86)
+__attribute__((target("sse2"))) static size_t tape_rows_sse2(const uint8_t *p, size_t n, const tape_simd_pat_t *pat,
+															  uint8_t *codes, size_t max)
+{
+	const __m128i vo = _mm_set1_epi8('O');
+	const __m128i vu = _mm_set1_epi8('_');
+	const __m128i vd = _mm_set1_epi8('.');
+	const __m128i vc = _mm_set1_epi8('\r');
+	const __m128i vl = _mm_set1_epi8('\n');
+	size_t rows = 0;
+
+	while ((n >= 16) && (rows + pat->rows <= max))
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)p);
+
+		if (!tape_simd_rows(pat, (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vo)),
+							(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vu)),
+							(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vd)),
+							(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vc)),
+							(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vl)), codes + rows))
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Р");
-				fwrite("P", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "О");
-				fwrite("О", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "P");
-				fwrite("P", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "O");
-				fwrite("O", 1, 1, tty1);
-				break;
-			}
 			break;
 		}
-		break;
+		rows += pat->rows;
+		p += pat->rows * pat->step;
+		n -= pat->rows * pat->step;
+	}
+	return rows;
+}
+
+__attribute__((target("avx2"))) static size_t tape_rows_avx2(const uint8_t *p, size_t n, const tape_simd_pat_t *pat,
+															  uint8_t *codes, size_t max)
+{
+	const __m256i vo = _mm256_set1_epi8('O');
+	const __m256i vu = _mm256_set1_epi8('_');
+	const __m256i vd = _mm256_set1_epi8('.');
+	const __m256i vc = _mm256_set1_epi8('\r');
+	const __m256i vl = _mm256_set1_epi8('\n');
+	size_t rows = 0;
+
+	while ((n >= 32) && (rows + pat->rows <= max))
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)p);
 
-	case 1: /* t = 001  */
-		switch (russian_latin_sw)
+		if (!tape_simd_rows(pat, (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vo)),
+							(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vu)),
+							(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vd)),
+							(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vc)),
+							(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vl)), codes + rows))
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Й");
-				fwrite("Й", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "1");
-				fwrite("1", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Q");
-				fwrite("Q", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "1");
-				fwrite("1", 1, 1, tty1);
-				break;
-			}
 			break;
 		}
-		break;
+		rows += pat->rows;
+		p += pat->rows * pat->step;
+		n -= pat->rows * pat->step;
+	}
+	return rows;
+}
+#endif
+
+/* Лучший набор команд процессора для tape_decode_text() */
+uint8_t tape_simd_level(void)
+{
+#if defined(TAPE_SIMD_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return TAPE_SIMD_AVX2;
+	}
+	if (__builtin_cpu_supports("sse2"))
+	{
+		return TAPE_SIMD_SSE2;
+	}
+#endif
+	return TAPE_SIMD_NONE;
+}
 
-	case 2: /* t = 01-1  */
-		switch (russian_latin_sw)
+/**
+ * Декодировать текстовую перфоленту text[size] в коды строк codes[max]:
+ * пробивки в битах 4..0, 0xFF - строка не распознана. *bad - номер первой
+ * строки без транспортной дорожки или с недопустимой комбинацией пробивок,
+ * с 1; 0 - ошибок нет. simd - TAPE_SIMD_NONE, _SSE2, _AVX2.
+ * Возврат: число строк, как при чтении tape_next_row().
+ */
+size_t tape_decode_text(const uint8_t *text, size_t size, uint8_t *codes, size_t max, size_t *bad, uint8_t simd)
+{
+	tape_simd_pat_t pat[2]; /* шаг 7 (LF) и 8 (CRLF) */
+	tape_reader_t r;
+	size_t rows = 0;
+	size_t first;
+	int8_t holes;
+
+	init_tab_row_key();
+	memset(&r, 0, sizeof(r));
+	r.data = text;
+	r.size = size;
+	*bad = 0;
+
+	tape_simd_pat(&pat[0], 7, (simd == TAPE_SIMD_AVX2) ? 32 : 16);
+	tape_simd_pat(&pat[1], 8, (simd == TAPE_SIMD_AVX2) ? 32 : 16);
+
+	while (rows < max)
+	{
+		while ((r.pos < size) && isspace(text[r.pos]))
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Я");
-				fwrite("Я", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "2");
-				fwrite("2", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "R");
-				fwrite("R", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "2");
-				fwrite("2", 1, 1, tty1);
-				break;
-			}
-			break;
+			r.pos++;
 		}
-		break;
-
-	case 3: /* t = 010  */
-		switch (russian_latin_sw)
+#if defined(TAPE_SIMD_X86)
+		if ((simd != TAPE_SIMD_NONE) && (r.pos + 8 <= size))
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Ь");
-				fwrite("Ь", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "3");
-				fwrite("3", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
+			const tape_simd_pat_t *p = NULL;
+			size_t n;
+
+			if ((text[r.pos + 6] == '\r') && (text[r.pos + 7] == '\n'))
 			{
-			case 0: /* letter */
-				printf("%s", "S");
-				fwrite("S", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "3");
-				fwrite("3", 1, 1, tty1);
-				break;
+				p = &pat[1];
 			}
-			break;
-		}
-		break;
-
-	case 4: /* t = 011  */
-		switch (russian_latin_sw)
-		{
-		case 0: /* russian */
-			switch (letter_number_sw)
+			else if (text[r.pos + 6] == '\n')
 			{
-			case 0: /* letter */
-				printf("%s", "Т");
-				fwrite("Т", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "4");
-				fwrite("4", 1, 1, tty1);
-				break;
+				p = &pat[0];
 			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
+			if (p != NULL)
 			{
-			case 0: /* letter */
-				printf("%s", "T");
-				fwrite("T", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "4");
-				fwrite("4", 1, 1, tty1);
-				break;
+				n = (simd == TAPE_SIMD_AVX2) ? tape_rows_avx2(text + r.pos, size - r.pos, p, codes + rows, max - rows)
+											 : tape_rows_sse2(text + r.pos, size - r.pos, p, codes + rows, max - rows);
+				if (n > 0)
+				{
+					/* Транспортная дорожка проверена образцом, остаются комбинации */
+					for (first = rows; (*bad == 0) && (first < rows + n); first++)
+					{
+						if (!TAPE_ROW_ALLOWED(codes[first]))
+						{
+							*bad = first + 1;
+						}
+					}
+					rows += n;
+					r.pos += n * p->step;
+					continue;
+				}
 			}
-			break;
 		}
-		break;
-
-	case 5: /* t = 1-1-1 */
-		switch (russian_latin_sw)
+#endif
+		if (tape_next_row(&r, NULL, &holes) == EOF)
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "П");
-				fwrite("П", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "5");
-				fwrite("5", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "U");
-				fwrite("U", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "5");
-				fwrite("5", 1, 1, tty1);
-				break;
-			}
 			break;
 		}
-		break;
-
-	case 13: /* t = 111 */
-		switch (russian_latin_sw)
+		codes[rows] = (uint8_t)holes;
+		if ((*bad == 0) && ((holes < 0) || !TAPE_ROW_ALLOWED(holes)))
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "Ш");
-				fwrite("Ш", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "Ф");
-				fwrite("Ф", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "(");
-				fwrite("(", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", ")");
-				fwrite(")", 1, 1, tty1);
-				break;
-			}
-			break;
+			*bad = rows + 1;
 		}
-		break;
+		rows++;
+	}
+	return rows;
+}
+
+/** ------------------------------------------------------------
+ *  Кэш декодированных перфолент
+ *  ------------------------------------------------------------
+ *  Текстовая лента декодируется один раз на процесс: строки хранятся
+ *  неизменяемым массивом, все машины и повторные запуски читают его
+ *  совместно, у фотосчитывателя - только ссылка и свой курсор.
+ *  Ключ - файл (устройство, inode), размер и хэш содержимого, поэтому
+ *  изменённая лента декодируется заново. Сверх TAPE_CACHE_MAX байт
+ *  вытесняются давно не открывавшиеся ленты без ссылок.
+ */
+#define TAPE_HASH_BASIS (14695981039346656037ull)
+#define TAPE_HASH_PRIME (1099511628211ull)
+
+typedef struct tape_cache_entry
+{
+	struct tape_cache_entry *next;
+	dev_t dev;
+	ino_t ino;
+	uint64_t size;	/* размер текста, байт */
+	uint64_t hash;	/* хэш текста */
+	uint8_t *codes; /* коды строк, не меняются до удаления */
+	size_t rows;
+	size_t bad;
+	uint32_t refs;	/* открытых фотосчитывателей */
+	uint64_t used;	/* такт последнего открытия */
+} tape_cache_entry_t;
+
+typedef struct tape_cache_stat
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t bytes; /* строк в кэше, байт */
+	uint32_t entries;
+} tape_cache_stat_t;
+
+static struct
+{
+	pthread_mutex_t lock;
+	tape_cache_entry_t *head;
+	uint64_t tick;
+	tape_cache_stat_t stat;
+} tape_cache = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+/* Хэш FNV-1a по словам по 8 байт: текст ленты читается со скоростью памяти */
+static uint64_t tape_hash(const uint8_t *data, size_t size)
+{
+	uint64_t h = TAPE_HASH_BASIS;
+	size_t i = 0;
+
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t w;
+
+		memcpy(&w, data + i, 8);
+		h = (h ^ w) * TAPE_HASH_PRIME;
+	}
+	for (; i < size; i++)
+	{
+		h = (h ^ data[i]) * TAPE_HASH_PRIME;
+	}
+	return h;
+}
+
+/* Удалить ленты без ссылок, начиная с давно не открывавшихся. Под lock */
+static void tape_cache_evict(uint64_t limit)
+{
+	while (tape_cache.stat.bytes > limit)
+	{
+		tape_cache_entry_t **old = NULL;
 
-	case -7: /* t = -11-1 */
-		switch (russian_latin_sw)
+		for (tape_cache_entry_t **e = &tape_cache.head; *e != NULL; e = &(*e)->next)
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "=");
-				fwrite("=", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "х");
-				fwrite("х", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
+			if (((*e)->refs == 0) && ((old == NULL) || ((*e)->used < (*old)->used)))
 			{
-			case 0: /* letter */
-				printf("%s", "=");
-				fwrite("=", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "x");
-				fwrite("x", 1, 1, tty1);
-				break;
+				old = e;
 			}
-			break;
 		}
-		break;
-
-	case -11: /* t = -1-11 */
-		switch (russian_latin_sw)
+		if (old == NULL)
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-					// переключить цвет черный
-				break;
-			default: /* number */
-					 // переключить цвет красный
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "?");
-				fwrite("?", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "?");
-				fwrite("?", 1, 1, tty1);
-				break;
-			}
-			break;
+			return;
 		}
-		break;
+		tape_cache_entry_t *p = *old;
+
+		*old = p->next;
+		tape_cache.stat.bytes -= p->rows;
+		tape_cache.stat.entries--;
+		tape_cache.stat.evictions++;
+		free(p->codes);
+		free(p);
+	}
+}
 
-	case 12: /* t = 110  */
-		switch (russian_latin_sw)
+/* Найти ленту в кэше и взять ссылку. Под lock */
+static tape_cache_entry_t *tape_cache_find(const struct stat *st, uint64_t hash)
+{
+	for (tape_cache_entry_t *e = tape_cache.head; e != NULL; e = e->next)
+	{
+		if ((e->dev == st->st_dev) && (e->ino == st->st_ino) &&
+			(e->size == (uint64_t)st->st_size) && (e->hash == hash))
 		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				letter_number_sw = 0;
-				break;
-			default: /* number */
-				letter_number_sw = 0;
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				letter_number_sw = 0;
-				break;
-			default: /* number */
-				letter_number_sw = 0;
-				break;
-			}
-			break;
+			e->refs++;
+			e->used = ++tape_cache.tick;
+			return e;
 		}
-		break;
+	}
+	return NULL;
+}
 
-	case 11: /* t = 11-1  */
-		switch (russian_latin_sw)
-		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				letter_number_sw = 1;
-				break;
-			default: /* number */
-				letter_number_sw = 1;
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				letter_number_sw = 1;
-				break;
-			default: /* number */
-				letter_number_sw = 1;
-				break;
-			}
-			break;
-		}
-		break;
+/**
+ * Строки текстовой ленты из кэша или декодированные и добавленные
+ * в кэш. Возврат: запись со ссылкой или NULL - нет памяти.
+ */
+static tape_cache_entry_t *tape_cache_get(const struct stat *st, const uint8_t *text, size_t size)
+{
+	uint64_t hash = tape_hash(text, size);
+	tape_cache_entry_t *e;
+	tape_cache_entry_t *n;
+	uint8_t *codes;
+
+	pthread_mutex_lock(&tape_cache.lock);
+	e = tape_cache_find(st, hash);
+	if (e != NULL)
+	{
+		tape_cache.stat.hits++;
+		pthread_mutex_unlock(&tape_cache.lock);
+		return e;
+	}
+	tape_cache.stat.misses++;
+	pthread_mutex_unlock(&tape_cache.lock);
 
-	case -10: /* t = -10-1 */
-		switch (russian_latin_sw)
-		{
-		case 0: /* russian */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "\r\n");
-				fwrite("\n", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "\r\n");
-				fwrite("\n", 1, 1, tty1);
-				break;
-			}
-			break;
-		default: /* latin */
-			switch (letter_number_sw)
-			{
-			case 0: /* letter */
-				printf("%s", "\r\n");
-				fwrite("\n", 1, 1, tty1);
-				break;
-			default: /* number */
-				printf("%s", "\r\n");
-				fwrite("\r\n", 1, 1, tty1);
-				break;
-			}
-			break;
-		}
-		break;
+	/* Декодировать без блокировки: другие ленты открываются параллельно */
+	n = calloc(1, sizeof(tape_cache_entry_t));
+	codes = malloc(size / 2 + 1);
+	if ((n == NULL) || (codes == NULL))
+	{
+		free(n);
+		free(codes);
+		return NULL;
+	}
+	n->rows = tape_decode_text(text, size, codes, size / 2 + 1, &n->bad, tape_simd_level());
+	n->codes = realloc(codes, n->rows + 1);
+	if (n->codes == NULL)
+	{
+		n->codes = codes;
+	}
+	n->dev = st->st_dev;
+	n->ino = st->st_ino;
+	n->size = size;
+	n->hash = hash;
+	n->refs = 1;
+
+	pthread_mutex_lock(&tape_cache.lock);
+	e = tape_cache_find(st, hash);
+	if (e == NULL)
+	{
+		/* Место для новой ленты освобождают ленты без ссылок */
+		tape_cache_evict((TAPE_CACHE_MAX > n->rows) ? TAPE_CACHE_MAX - n->rows : 0);
+		n->used = ++tape_cache.tick;
+		n->next = tape_cache.head;
+		tape_cache.head = n;
+		tape_cache.stat.bytes += n->rows;
+		tape_cache.stat.entries++;
+		e = n;
+		n = NULL;
+	}
+	pthread_mutex_unlock(&tape_cache.lock);
+	if (n != NULL)
+	{
+		/* Ту же ленту декодировал другой поток */
+		free(n->codes);
+		free(n);
 	}
+	return e;
 }
 
-uint8_t Begin_Read_Commands_from_FT1(FILE *file)
+/* Вернуть ссылку фотосчитывателя */
+static void tape_cache_put(tape_cache_entry_t *e)
 {
-	trs_t fa;
-	/* zone 0 FRAM */
-	fa = smtr("0---0");
-	return (Read_Commands_from_FT1(file, fa));
+	pthread_mutex_lock(&tape_cache.lock);
+	e->refs--;
+	tape_cache_evict(TAPE_CACHE_MAX);
+	pthread_mutex_unlock(&tape_cache.lock);
+}
+
+/* Статистика кэша перфолент */
+void tape_cache_stat(tape_cache_stat_t *st)
+{
+	pthread_mutex_lock(&tape_cache.lock);
+	*st = tape_cache.stat;
+	pthread_mutex_unlock(&tape_cache.lock);
+}
+
+void view_tape_cache_stat(void)
+{
+	tape_cache_stat_t st;
+
+	tape_cache_stat(&st);
+	printf("[ Tape cache: %llu hits, %llu misses, %llu evicted, %u tapes, %.1f KB ]\r\n",
+		   (unsigned long long)st.hits, (unsigned long long)st.misses,
+		   (unsigned long long)st.evictions, st.entries, st.bytes / 1024.0);
 }
 
 /**
- * Чтение команд с фотосчитывателя №1
+ * Текстовая перфолента, отображённая mmap(), декодируется целиком
+ * и читается дальше как двоичная из памяти: строки из кэша перфолент
+ * или, без кэша, в памяти фотосчитывателя.
  */
-uint8_t Read_Commands_from_FT1(FILE *file, trs_t fa)
+static void tape_predecode(tape_reader_t *r, const struct stat *st)
 {
-	if (LOGGING > 0)
+	/* Строка - слово и разделитель, не меньше двух байт */
+	size_t max = r->size / 2 + 1;
+	tape_cache_entry_t *e = NULL;
+	uint8_t *codes = NULL;
+	size_t rows;
+	size_t bad;
+
+	if (TAPE_CACHE_MAX > 0)
 	{
-		printf("[ Read commands from FT1 ]\r\n");
+		e = tape_cache_get(st, r->data, r->size);
 	}
+	if (e != NULL)
+	{
+		codes = e->codes;
+		rows = e->rows;
+		bad = e->bad;
+	}
+	else
+	{
+		codes = malloc(max);
+		if (codes == NULL)
+		{
+			return;
+		}
+		rows = tape_decode_text(r->data, r->size, codes, max, &bad, tape_simd_level());
+	}
+	munmap((void *)r->data, r->size);
+	r->data = codes;
+	r->size = rows;
+	r->pos = 0;
+	r->fmt = TAPE_BIN;
+	r->mapped = 0;
+	r->owned = (e == NULL);
+	r->cache = e;
+	r->bad = bad;
+}
 
-	uint8_t cnt = 0;
+/* Фотосчитыватель машины для файла перфоленты */
+static tape_reader_t *tape_reader_of(setun_machine_t *m, FILE *file)
+{
+	if ((file != NULL) && (file == m->ptr2))
+	{
+		return &m->ft2;
+	}
+	if ((file != NULL) && (file == m->ptr1))
+	{
+		return &m->ft1;
+	}
+	return NULL;
+}
 
-	if (file == NULL)
-		return 1; /* Error #1 */
+/**
+ * Прочитать строку перфоленты: *holes - комбинация пробивок,
+ * -1 - строка не распознана. Возврат: 0 или EOF.
+ */
+int tape_read_row(FILE *file, uint8_t fmt, int8_t *holes)
+{
+	char line[20];
 
-	trs_t dst;
-	trs_t addr;
-	trs_t oper;
-	uint8_t cmd[20];
+	if (fmt == TAPE_BIN)
+	{
+		int c = getc(file);
+		if (c == EOF)
+		{
+			return EOF;
+		}
+		*holes = (c < TAB_SIZE) ? c : -1;
+		return 0;
+	}
+	if (fscanf(file, "%19s", line) == EOF)
+	{
+		return EOF;
+	}
+	*holes = paper_line_holes(line);
+	return 0;
+}
 
-	/**
-	 * Загрузить
-	 */
+/* Текстовая перфолента в двоичную, 0 - успешно */
+int tape_text_to_bin(const char *path_in, const char *path_out)
+{
+	tape_bin_hdr_t h = {TAPE_BIN_MAGIC, 0, 0};
+	FILE *in = fopen(path_in, "r");
+	FILE *out;
+	tape_reader_t r;
+	int8_t holes;
+	int res = 0;
 
-	trs_t sum;
-	trs_t tmp;
+	if (in == NULL)
+	{
+		printf("ERR fopen %s\r\n", path_in);
+		return 1;
+	}
+	out = fopen(path_out, "wb");
+	if (out == NULL)
+	{
+		printf("ERR fopen %s\r\n", path_out);
+		fclose(in);
+		return 1;
+	}
 
-	tmp.l = 18;
-	tmp.t1 = 0;
-	tmp.t0 = 0;
+	fwrite(&h, sizeof(h), 1, out);
+	tape_open(&r, in);
+	while (tape_next_row(&r, in, &holes) != EOF)
+	{
+		/* Строки без транспортной дорожки читатели пропускают */
+		if (holes >= 0)
+		{
+			putc(holes, out);
+			h.rows++;
+		}
+	}
+	if (r.bad != 0)
+	{
+		printf("WARN %s: bad row %zu\r\n", path_in, r.bad);
+	}
+	tape_close(&r);
+	rewind(out);
+	fwrite(&h, sizeof(h), 1, out);
 
-	int64_t dsun = 0;
-	sum.l = 18;
-	sum.t1 = 0;
-	sum.t0 = 0;
-	//
-	dst.l = 9;
-	MR.l = 18;
-	int i = 0;
+	fclose(in);
+	if (fclose(out) != 0)
+	{
+		printf("ERR write %s\r\n", path_out);
+		res = 1;
+	}
+	return res;
+}
 
-	trs_t tcmd;
-	tcmd.l = 9;
-	tcmd.t0 = 0;
-	tcmd.t1 = 0;
-	//
-	uint8_t cnt_cmd = 54;
-	uint8_t cnt_line = 5;
-	//
-	while ((fscanf(file, "%s", cmd) != EOF) && (cnt_cmd != 0))
+/* Двоичная перфолента в текстовую, 0 - успешно */
+int tape_bin_to_text(const char *path_in, const char *path_out)
+{
+	FILE *in = fopen(path_in, "rb");
+	FILE *out;
+	int8_t holes;
+	int res = 0;
+
+	if (in == NULL)
 	{
-		uint8_t err = 0;
-		trs_t res;
+		printf("ERR fopen %s\r\n", path_in);
+		return 1;
+	}
+	if (tape_format(in) != TAPE_BIN)
+	{
+		printf("ERR %s: not a binary tape\r\n", path_in);
+		fclose(in);
+		return 1;
+	}
+	out = fopen(path_out, "w");
+	if (out == NULL)
+	{
+		printf("ERR fopen %s\r\n", path_out);
+		fclose(in);
+		return 1;
+	}
 
-		res = Decoder_Command_Paper_Line(cmd, &err);
-		if (err == 0)
+	while (tape_read_row(in, TAPE_BIN, &holes) != EOF)
+	{
+		char line[9] = "___.__\r\n";
+
+		if (holes < 0)
 		{
+			continue;
+		}
+		line[0] = (holes & (1 << 4)) ? 'O' : '_';
+		line[1] = (holes & (1 << 3)) ? 'O' : '_';
+		line[2] = (holes & (1 << 2)) ? 'O' : '_';
+		line[4] = (holes & (1 << 1)) ? 'O' : '_';
+		line[5] = (holes & (1 << 0)) ? 'O' : '_';
+		fwrite(line, 1, 8, out);
+	}
 
-			if (cnt_line > 0)
-			{
-				int8_t p1 = get_trit_setun(res, 1);
-				int8_t p2 = get_trit_setun(res, 2);
-				tcmd = set_trit_setun(tcmd, 8, p1);
-				tcmd = set_trit_setun(tcmd, 9, p2);
-				cnt_line -= 1;
-			}
-			if (cnt_line == 0)
-			{
-				cnt_line = 5;
-				cnt_cmd -= 1;
-				// view_short_reg(&tcmd, "tcmd");
-				//
-				sum = add_trs(sum, tcmd);
+	fclose(in);
+	if (fclose(out) != 0)
+	{
+		printf("ERR write %s\r\n", path_out);
+		res = 1;
+	}
+	return res;
+}
 
-				dsun += trs2digit(tcmd);
+/** ------------------------------------------------------------
+ *  Указатель зон перфоленты
+ *  ------------------------------------------------------------
+ *  Зона - строки между промежутками из TAPE_GAP_ROWS пустых строк.
+ *  Указатель строится одним проходом по ленте или читается из файла
+ *  FILE.idx рядом с лентой (--tape-index), если размер и время
+ *  изменения ленты совпадают с записанными. tape_seek_zone() ставит
+ *  фотосчитыватель на начало зоны N без чтения предыдущих зон.
+ */
+#define TAPE_GAP_ROWS (5)
+#define TAPE_INDEX_MAGIC "SETUNIX1"
+#define TAPE_FNV_BASIS (2166136261u)
+#define TAPE_FNV_PRIME (16777619u)
 
-				// LOGGING_print("%s -> [", tcmd);
-				LOGGING_print(" -> [");
+typedef struct tape_index_hdr
+{
+	char magic[8];
+	uint64_t size;	/* размер ленты, байт */
+	int64_t mtime;	/* время изменения ленты, с */
+	uint32_t zones;
+	uint32_t reserved;
+} tape_index_hdr_t;
+
+static inline uint32_t tape_fnv(uint32_t h, uint8_t code)
+{
+	return (h ^ code) * TAPE_FNV_PRIME;
+}
 
-				if (LOGGING > 0)
-				{
-					trs2str(tcmd);
-				}
-				LOGGING_print("]");
-				if (LOGGING > 0)
-				{
-					view_short_reg(&fa, " addr");
-				}
-				else
+/* Добавить зону в указатель. Возврат: 0 или -1 - нет памяти */
+static int tape_index_add(tape_reader_t *r, const tape_zone_t *z, uint32_t *cap)
+{
+	if (r->zones == *cap)
+	{
+		uint32_t n = (*cap > 0) ? *cap * 2 : 64;
+		tape_zone_t *p = realloc(r->zone, n * sizeof(tape_zone_t));
+
+		if (p == NULL)
+		{
+			return -1;
+		}
+		r->zone = p;
+		*cap = n;
+	}
+	r->zone[r->zones++] = *z;
+	return 0;
+}
+
+/**
+ * Построить указатель зон: src - лента в памяти, читается с начала.
+ * Пустые строки внутри зоны, меньше TAPE_GAP_ROWS подряд, входят в зону.
+ */
+static int tape_index_scan(tape_reader_t *r, tape_reader_t *src)
+{
+	tape_zone_t z = {0};
+	uint32_t cap = 0;
+	uint32_t row = 0;
+	uint32_t blank = 0; /* пустых строк подряд после последней непустой */
+	uint8_t open = 0;
+	int8_t holes;
+
+	free(r->zone);
+	r->zone = NULL;
+	r->zones = 0;
+	while (1)
+	{
+		uint64_t offset = (uint64_t)tape_tell(src, NULL);
+
+		if (tape_next_row(src, NULL, &holes) == EOF)
+		{
+			break;
+		}
+		if (holes == 0)
+		{
+			blank++;
+			if (open && (blank == TAPE_GAP_ROWS))
+			{
+				open = 0;
+				if (tape_index_add(r, &z, &cap) != 0)
 				{
-					if (LOGGING > 0)
-					{
-						printf("\r\n");
-					}
+					return -1;
 				}
-
-				st_fram(fa, tcmd);
-				fa = next_address(fa);
-				mod_3_n(&fa, 5);
-				tcmd.t0 = 0;
-				tcmd.t1 = 0;
-				//
-				i += 1;
+			}
+		}
+		else
+		{
+			if (!open)
+			{
+				memset(&z, 0, sizeof(z));
+				z.offset = offset;
+				z.row = row;
+				z.sum = TAPE_FNV_BASIS;
+				open = 1;
 			}
 			else
 			{
-				tcmd = shift_trs(tcmd, 2);
+				for (; blank > 0; blank--)
+				{
+					z.sum = tape_fnv(z.sum, 0);
+					z.rows++;
+				}
 			}
+			blank = 0;
+			z.sum = tape_fnv(z.sum, (uint8_t)holes);
+			z.rows++;
 		}
+		row++;
 	}
-
-	if (LOGGING > 0)
+	if (open && (tape_index_add(r, &z, &cap) != 0))
 	{
-		printf("\r\ni=%i\r\n", i);
-		/* Печать контрольных сумм */
-		view_checksum_setun(sum);
+		return -1;
 	}
+	return 0;
+}
 
-	if (cnt != SIZE_ZONE_TRIT_FRAM)
-		return 1; /* Error #2 */
+/* Имя файла указателя: FILE.idx */
+static void tape_index_path(const char *path, char *out, size_t size)
+{
+	snprintf(out, size, "%s.idx", path);
+}
 
-	return 0; /* OK' */
+/* Прочитать FILE.idx, если он построен для этой ленты. Возврат: 0 или -1 */
+static int tape_index_load(tape_reader_t *r, const char *path, const struct stat *st)
+{
+	char path_idx[PATH_MAX];
+	tape_index_hdr_t h;
+	tape_zone_t *zone;
+	FILE *f;
+	int res = -1;
+
+	tape_index_path(path, path_idx, sizeof(path_idx));
+	f = fopen(path_idx, "rb");
+	if (f == NULL)
+	{
+		return -1;
+	}
+	if ((fread(&h, sizeof(h), 1, f) == 1) && (memcmp(h.magic, TAPE_INDEX_MAGIC, 8) == 0) &&
+		(h.size == (uint64_t)st->st_size) && (h.mtime == (int64_t)st->st_mtime))
+	{
+		zone = malloc((h.zones > 0 ? h.zones : 1) * sizeof(tape_zone_t));
+		if ((zone != NULL) && (fread(zone, sizeof(tape_zone_t), h.zones, f) == h.zones))
+		{
+			free(r->zone);
+			r->zone = zone;
+			r->zones = h.zones;
+			res = 0;
+		}
+		else
+		{
+			free(zone);
+		}
+	}
+	fclose(f);
+	return res;
 }
 
 /**
- * Чтение символов с фотосчитывателя №1
+ * Указатель зон ленты path для фотосчитывателя r: из FILE.idx или,
+ * если scan != 0, проходом по ленте, отображённой в память. Лента из
+ * потока указателя не имеет. Возврат: 0 или -1.
  */
-uint8_t Read_Symbols_from_FT1(FILE *file, trs_t fa)
+int tape_index_open(tape_reader_t *r, const char *path, int scan)
 {
-	if (LOGGING > 0)
+	tape_reader_t src;
+	struct stat st;
+	void *p;
+	int fd;
+	int res;
+
+	if ((path == NULL) || r->stream || (stat(path, &st) != 0) || !S_ISREG(st.st_mode) || (st.st_size == 0))
 	{
-		printf("[ Read symbols from FT1 ]\r\n");
+		return -1;
 	}
-
-	uint8_t cnt = 0;
-
-	if (file == NULL)
-		return 1; /* Error #1 */
-
-	trs_t dst;
-	trs_t addr;
-	trs_t oper;
-	uint8_t cmd[20];
+	if (tape_index_load(r, path, &st) == 0)
+	{
+		return 0;
+	}
+	if (!scan)
+	{
+		return -1;
+	}
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+	{
+		return -1;
+	}
+	madvise(p, st.st_size, MADV_SEQUENTIAL);
+	tape_open_mem(&src, p, st.st_size);
+	res = tape_index_scan(r, &src);
+	munmap(p, st.st_size);
+	return res;
+}
+
+/* Записать указатель зон ленты path в FILE.idx. Возврат: 0 или -1 */
+int tape_index_save(const tape_reader_t *r, const char *path)
+{
+	char path_idx[PATH_MAX];
+	tape_index_hdr_t h = {TAPE_INDEX_MAGIC, 0, 0, 0, 0};
+	struct stat st;
+	FILE *f;
+	int res = 0;
+
+	if ((r->zone == NULL) || (stat(path, &st) != 0))
+	{
+		return -1;
+	}
+	h.size = st.st_size;
+	h.mtime = st.st_mtime;
+	h.zones = r->zones;
+	tape_index_path(path, path_idx, sizeof(path_idx));
+	f = fopen(path_idx, "wb");
+	if (f == NULL)
+	{
+		printf("ERR fopen %s\r\n", path_idx);
+		return -1;
+	}
+	if ((fwrite(&h, sizeof(h), 1, f) != 1) || (fwrite(r->zone, sizeof(tape_zone_t), r->zones, f) != r->zones))
+	{
+		res = -1;
+	}
+	if (fclose(f) != 0)
+	{
+		res = -1;
+	}
+	if (res != 0)
+	{
+		printf("ERR write %s\r\n", path_idx);
+	}
+	return res;
+}
+
+/* Печать указателя зон */
+void view_tape_index(const tape_reader_t *r)
+{
+	printf(" zone  offset     row    rows  sum\r\n");
+	for (uint32_t i = 0; i < r->zones; i++)
+	{
+		const tape_zone_t *z = &r->zone[i];
+
+		printf(" %4u  %-9llu  %-5u  %-4u  %08x\r\n", i, (unsigned long long)z->offset, z->row, z->rows, z->sum);
+	}
+}
+
+/**
+ * Поставить фотосчитыватель на начало зоны n. Строки декодированной
+ * ленты адресуются номером строки, файл и лента в памяти - смещением.
+ * Строки зоны в памяти сверяются с контрольной суммой указателя.
+ * Возврат: 0, -1 - нет зоны или лента из потока, -2 - указатель устарел.
+ */
+int tape_seek_zone(tape_reader_t *r, FILE *file, uint32_t n)
+{
+	const tape_zone_t *z;
+
+	if ((r->zone == NULL) || (n >= r->zones) || r->stream || r->pf)
+	{
+		return -1;
+	}
+	z = &r->zone[n];
+	if (r->data == NULL)
+	{
+		return ((file != NULL) && (fseek(file, (long)z->offset, SEEK_SET) == 0)) ? 0 : -1;
+	}
+	r->pos = (r->owned || (r->cache != NULL)) ? z->row : (size_t)z->offset;
+	if (r->pos > r->size)
+	{
+		r->pos = r->size;
+		return -2;
+	}
+	if (r->fmt == TAPE_BIN)
+	{
+		uint32_t sum = TAPE_FNV_BASIS;
+
+		if (r->pos + z->rows > r->size)
+		{
+			return -2;
+		}
+		for (uint32_t i = 0; i < z->rows; i++)
+		{
+			uint8_t c = r->data[r->pos + i];
+
+			/* Строка не распознана: код -1, как у tape_next_row() */
+			sum = tape_fnv(sum, (c < TAB_SIZE) ? c : 0xFF);
+		}
+		if (sum != z->sum)
+		{
+			return -2;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Знаки пишущей машинки в UTF-8: [код + 13][регистр русский, латинский]
+ * [буквенный, цифровой]. Пустая строка - нет знака (-1-11 в русском
+ * регистре переключает цвет ленты). Коды 11-1, 110 переключают регистр
+ * буквенный/цифровой и в таблице не нужны.
+ */
+typedef struct tty_sym
+{
+	const char *str;
+	uint8_t len;
+} tty_sym_t;
+
+#define TW(s) {s, sizeof(s) - 1}
+
+static const tty_sym_t tab_typewriter[27][2][2] = {
+	[-12 + 13] = {{TW("Б"), TW("-")}, {TW("F"), TW("-")}}, /* t = -1-10 */
+	[-11 + 13] = {{TW(""), TW("")}, {TW("?"), TW("?")}}, /* t = -1-11 */
+	[-10 + 13] = {{TW("\n"), TW("\n")}, {TW("\n"), TW("\n")}}, /* t = -10-1 */
+	[-9 + 13] = {{TW("Щ"), TW("Ю")}, {TW("G"), TW("/")}}, /* t = -100 */
+	[-8 + 13] = {{TW("Н"), TW(",")}, {TW("H"), TW(".")}}, /* t = -101 */
+	[-7 + 13] = {{TW("="), TW("х")}, {TW("="), TW("x")}}, /* t = -11-1 */
+	[-6 + 13] = {{TW("Л"), TW("+")}, {TW("I"), TW("+")}}, /* t = -110 */
+	[-5 + 13] = {{TW("Ы"), TW("Э")}, {TW("J"), TW("V")}}, /* t = -111 */
+	[-4 + 13] = {{TW("К"), TW("Ж")}, {TW("K"), TW("W")}}, /* t = 0-1-1 */
+	[-3 + 13] = {{TW("Г"), TW("Х")}, {TW("L"), TW("X")}}, /* t = 0-10 */
+	[-2 + 13] = {{TW("М"), TW("У")}, {TW("M"), TW("Y")}}, /* t = 0-11 */
+	[-1 + 13] = {{TW("И"), TW("Ц")}, {TW("N"), TW("Z")}}, /* t = 00-1 */
+	[0 + 13] = {{TW("Р"), TW("О")}, {TW("P"), TW("O")}}, /* t = 000 */
+	[1 + 13] = {{TW("Й"), TW("1")}, {TW("Q"), TW("1")}}, /* t = 001 */
+	[2 + 13] = {{TW("Я"), TW("2")}, {TW("R"), TW("2")}}, /* t = 01-1 */
+	[3 + 13] = {{TW("Ь"), TW("3")}, {TW("S"), TW("3")}}, /* t = 010 */
+	[4 + 13] = {{TW("Т"), TW("4")}, {TW("T"), TW("4")}}, /* t = 011 */
+	[5 + 13] = {{TW("П"), TW("5")}, {TW("U"), TW("5")}}, /* t = 1-1-1 */
+	[6 + 13] = {{TW("А"), TW("6")}, {TW("A"), TW("6")}}, /* t = 1-10 */
+	[7 + 13] = {{TW("В"), TW("7")}, {TW("B"), TW("7")}}, /* t = 1-11 */
+	[8 + 13] = {{TW("С"), TW("8")}, {TW("C"), TW("8")}}, /* t = 10-1 */
+	[9 + 13] = {{TW("Д"), TW("9")}, {TW("D"), TW("9")}}, /* t = 100 */
+	[10 + 13] = {{TW("Е"), TW(" ")}, {TW("E"), TW(" ")}}, /* t = 101 */
+	[13 + 13] = {{TW("Ш"), TW("Ф")}, {TW("("), TW(")")}}, /* t = 111 */
+};
+
+/* Дописать данные в буфер памяти устройства. Возврат: 0 или -1 - нет памяти */
+static int dev_mem_put(dev_out_t *dev, const char *data, size_t len)
+{
+	if (dev->len + len > dev->cap)
+	{
+		size_t cap = (dev->cap > 0) ? dev->cap : DEV_BUF_SIZE;
+		char *p;
+
+		while (cap < dev->len + len)
+		{
+			cap *= 2;
+		}
+		p = realloc(dev->data, cap);
+		if (p == NULL)
+		{
+			return -1;
+		}
+		dev->data = p;
+		dev->cap = cap;
+	}
+	memcpy(dev->data + dev->len, data, len);
+	dev->len += len;
+	return 0;
+}
+
+/* Записать данные на устройство: файл file, память, никуда или функции */
+static void dev_put(dev_out_t *dev, FILE *file, const char *data, size_t len)
+{
+	switch (dev->kind)
+	{
+	case DEV_FILE:
+		if (file != NULL)
+		{
+			fwrite(data, 1, len, file);
+		}
+		break;
+	case DEV_MEM:
+		if (dev_mem_put(dev, data, len) != 0)
+		{
+			return;
+		}
+		break;
+	case DEV_CALL:
+		if (dev->call != NULL)
+		{
+			dev->call(dev->ctx, data, len);
+		}
+		break;
+	}
+	dev->bytes += len;
+}
+
+/* Устройство готово к выводу: файл открыт или вывод не в файл */
+static inline uint8_t dev_ok(const dev_out_t *dev, FILE *file)
+{
+	return (dev->kind != DEV_FILE) || (file != NULL);
+}
+
+/* Выбрать вывод устройства. DEV_CALL - функция call с параметром ctx */
+void dev_set(dev_out_t *dev, uint8_t kind, dev_call_t call, void *ctx)
+{
+	dev->kind = kind;
+	dev->call = call;
+	dev->ctx = ctx;
+	dev->len = 0;
+	dev->bytes = 0;
+}
+
+/* Освободить буфер памяти устройства */
+void dev_free(dev_out_t *dev)
+{
+	free(dev->data);
+	dev->data = NULL;
+	dev->len = 0;
+	dev->cap = 0;
+}
+
+/* FNV-1a вывода в памяти: сравнение результатов без файлов */
+uint32_t dev_sum(const dev_out_t *dev)
+{
+	uint32_t h = 2166136261u;
+
+	for (size_t i = 0; i < dev->len; i++)
+	{
+		h = (h ^ (uint8_t)dev->data[i]) * 16777619u;
+	}
+	return h;
+}
+
+/* Вывод устройства по параметру: "mem", "null" или имя файла */
+uint8_t dev_kind(const char *arg)
+{
+	if (strcmp(arg, "mem") == 0)
+	{
+		return DEV_MEM;
+	}
+	if (strcmp(arg, "null") == 0)
+	{
+		return DEV_NULL;
+	}
+	return DEV_FILE;
+}
+
+static const char *dev_name(const dev_out_t *dev)
+{
+	static const char *name[] = {"file", "mem", "null", "call"};
+
+	return (dev->kind < 4) ? name[dev->kind] : "?";
+}
+
+/* Вывод ПМ и ПЛ: размер, для вывода в памяти - сумма */
+void view_dev_stat(setun_machine_t *m)
+{
+	dev_out_t *dev[2] = {&m->tty_dev, &m->ptp_dev};
+	char sum[2][16];
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (dev[i]->kind == DEV_MEM)
+			snprintf(sum[i], sizeof(sum[i]), " %08x", dev_sum(dev[i]));
+		else
+			sum[i][0] = '\0';
+	}
+	printf("[ Devices: tty %s %llu bytes%s, ptp %s %llu bytes%s ]\r\n",
+		   dev_name(dev[0]), (unsigned long long)dev[0]->bytes, sum[0],
+		   dev_name(dev[1]), (unsigned long long)dev[1]->bytes, sum[1]);
+}
+
+/* Записать буфер устройства и копию печати на консоль */
+static void dev_write(dev_out_t *dev, FILE *file, FILE *echo, const dev_buf_t *b)
+{
+	dev_put(dev, file, b->data, b->len);
+	if (echo != NULL)
+	{
+		/* Блок потока устройств - несколько строк печати */
+		const char *p = b->data;
+		const char *end = b->data + b->len;
+		const char *nl;
+
+		while ((nl = memchr(p, '\n', end - p)) != NULL)
+		{
+			fwrite(p, 1, nl - p, echo);
+			fputs("\r\n", echo);
+			p = nl + 1;
+		}
+		fwrite(p, 1, end - p, echo);
+	}
+}
+
+static void io_put(io_dev_t *io, dev_out_t *dev, FILE *file, FILE *echo, const dev_buf_t *b);
+
+/* Вывести буфер печати в файл ПМ и копию на консоль */
+void tty_flush(setun_machine_t *m)
+{
+	dev_buf_t *b = &m->tty_buf;
+
+	if (b->len == 0)
+	{
+		return;
+	}
+	if (m->io != NULL)
+	{
+		io_put(m->io, &m->tty_dev, m->tty1, m->tty_echo, b);
+	}
+	else
+	{
+		dev_write(&m->tty_dev, m->tty1, m->tty_echo, b);
+	}
+	b->len = 0;
+}
+
+/* Знак в буфер печати: сброс в конце строки и при заполнении */
+static inline void tty_put(setun_machine_t *m, const tty_sym_t *sym)
+{
+	dev_buf_t *b = &m->tty_buf;
+
+	if (b->len + sym->len > DEV_BUF_SIZE)
+	{
+		tty_flush(m);
+	}
+	memcpy(b->data + b->len, sym->str, sym->len);
+	b->len += sym->len;
+	if (sym->str[sym->len - 1] == '\n')
+	{
+		tty_flush(m);
+	}
+}
+
+/**
+ * Печать на электрифицированную пишущую машинку
+ * 'An electrified typewriter'
+ */
+void electrified_typewriter(setun_machine_t *m, trs_t t, uint8_t local)
+{
+	const tty_sym_t *sym;
+	int32_t code;
+
+	m->russian_latin_sw = local;
+	code = trs2digit(t);
+
+	switch (code)
+	{
+	case 11: /* t = 11-1, цифровой регистр */
+		m->letter_number_sw = 1;
+		return;
+	case 12: /* t = 110, буквенный регистр */
+		m->letter_number_sw = 0;
+		return;
+	}
+	if ((code < -13) || (code > 13))
+	{
+		return;
+	}
+	sym = &tab_typewriter[code + 13][m->russian_latin_sw != 0][m->letter_number_sw != 0];
+	if (sym->len > 0)
+	{
+		tty_put(m, sym);
+	}
+}
+
+uint8_t Begin_Read_Commands_from_FT1(setun_machine_t *m, FILE *file)
+{
+	trs_t fa;
+	/* zone 0 FRAM */
+	fa = smtr("0---0");
+	return (Read_Commands_from_FT1(m, file, fa));
+}
+
+/**
+ * Чтение команд с фотосчитывателя №1
+ */
+uint8_t Read_Commands_from_FT1(setun_machine_t *m, FILE *file, trs_t fa)
+{
+	if (LOGGING > 0)
+	{
+		printf("[ Read commands from FT1 ]\r\n");
+	}
+
+	uint8_t cnt = 0;
+
+	if (file == NULL)
+		return 1; /* Error #1 */
+
+	trs_t dst;
+	trs_t addr;
+	trs_t oper;
+	tape_reader_t local = {0};
+	tape_reader_t *rd = tape_reader_of(m, file);
+	int8_t holes;
 
 	/**
 	 * Загрузить
@@ -4630,7 +5779,7 @@ uint8_t Read_Symbols_from_FT1(FILE *file, trs_t fa)
 	sum.t0 = 0;
 	//
 	dst.l = 9;
-	MR.l = 18;
+	m->MR.l = 18;
 	int i = 0;
 
 	trs_t tcmd;
@@ -4639,37 +5788,36 @@ uint8_t Read_Symbols_from_FT1(FILE *file, trs_t fa)
 	tcmd.t1 = 0;
 	//
 	uint8_t cnt_cmd = 54;
-	uint8_t cnt_line = 3;
+	uint8_t cnt_line = 5;
 	//
-	while ((fscanf(file, "%s", cmd) != EOF) && (cnt_cmd != 0))
+	while ((tape_next_row((rd != NULL) ? rd : &local, file, &holes) != EOF) && (cnt_cmd != 0))
 	{
 		uint8_t err = 0;
 		trs_t res;
 
-		res = Decoder_Symbol_Paper_Line(cmd, &err);
+		res = Decoder_Command_Row(holes, &err);
 		if (err == 0)
 		{
-			/* Установить триты */
+
 			if (cnt_line > 0)
 			{
 				int8_t p1 = get_trit_setun(res, 1);
 				int8_t p2 = get_trit_setun(res, 2);
-				int8_t p3 = get_trit_setun(res, 3);
-				tcmd = set_trit_setun(tcmd, 7, p1);
-				tcmd = set_trit_setun(tcmd, 8, p2);
-				tcmd = set_trit_setun(tcmd, 9, p3);
-
+				tcmd = set_trit_setun(tcmd, 8, p1);
+				tcmd = set_trit_setun(tcmd, 9, p2);
 				cnt_line -= 1;
 			}
-
 			if (cnt_line == 0)
 			{
-				cnt_line = 3;
+				cnt_line = 5;
 				cnt_cmd -= 1;
-
+				// view_short_reg(&tcmd, "tcmd");
+				//
 				sum = add_trs(sum, tcmd);
+
 				dsun += trs2digit(tcmd);
 
+				// LOGGING_print("%s -> [", tcmd);
 				LOGGING_print(" -> [");
 
 				if (LOGGING > 0)
@@ -4689,24 +5837,17 @@ uint8_t Read_Symbols_from_FT1(FILE *file, trs_t fa)
 					}
 				}
 
-				st_fram(fa, tcmd);
+				st_fram(m, fa, tcmd);
 				fa = next_address(fa);
 				mod_3_n(&fa, 5);
 				tcmd.t0 = 0;
 				tcmd.t1 = 0;
-
-				int32_t dtres = trs2digit(res);
-				if (dtres == -13)
-				{
-					/* Символ 'ст' '_OO.O_' */
-					break; /* exit while(...) */
-				}
 				//
 				i += 1;
 			}
 			else
 			{
-				tcmd = shift_trs(tcmd, 3);
+				tcmd = shift_trs(tcmd, 2);
 			}
 		}
 	}
@@ -4725,11 +5866,15 @@ uint8_t Read_Symbols_from_FT1(FILE *file, trs_t fa)
 }
 
 /**
- * Чтение команд с фотосчитывателя №2
+ * Чтение символов с фотосчитывателя №1
  */
-uint8_t Read_Commands_from_FT2(FILE *file, trs_t fa)
+uint8_t Read_Symbols_from_FT1(setun_machine_t *m, FILE *file, trs_t fa)
 {
-	printf("[ Read commands from FT2 ]\r\n");
+	if (LOGGING > 0)
+	{
+		printf("[ Read symbols from FT1 ]\r\n");
+	}
+
 	uint8_t cnt = 0;
 
 	if (file == NULL)
@@ -4738,7 +5883,9 @@ uint8_t Read_Commands_from_FT2(FILE *file, trs_t fa)
 	trs_t dst;
 	trs_t addr;
 	trs_t oper;
-	uint8_t cmd[20];
+	tape_reader_t local = {0};
+	tape_reader_t *rd = tape_reader_of(m, file);
+	int8_t holes;
 
 	/**
 	 * Загрузить
@@ -4757,19 +5904,146 @@ uint8_t Read_Commands_from_FT2(FILE *file, trs_t fa)
 	sum.t0 = 0;
 	//
 	dst.l = 9;
-	MR.l = 18;
+	m->MR.l = 18;
 	int i = 0;
 
-	while (fscanf(file, "%s", cmd) != EOF)
+	trs_t tcmd;
+	tcmd.l = 9;
+	tcmd.t0 = 0;
+	tcmd.t1 = 0;
+	//
+	uint8_t cnt_cmd = 54;
+	uint8_t cnt_line = 3;
+	//
+	while ((tape_next_row((rd != NULL) ? rd : &local, file, &holes) != EOF) && (cnt_cmd != 0))
 	{
-		if (strlen(cmd) != 5)
-			continue;
-
-		cmd_str_2_trs(cmd, &dst);
-		sum = add_trs(sum, dst);
-		i += 1;
-
-		dsun += trs2digit(dst);
+		uint8_t err = 0;
+		trs_t res;
+
+		res = Decoder_Symbol_Row(holes, &err);
+		if (err == 0)
+		{
+			/* Установить триты */
+			if (cnt_line > 0)
+			{
+				int8_t p1 = get_trit_setun(res, 1);
+				int8_t p2 = get_trit_setun(res, 2);
+				int8_t p3 = get_trit_setun(res, 3);
+				tcmd = set_trit_setun(tcmd, 7, p1);
+				tcmd = set_trit_setun(tcmd, 8, p2);
+				tcmd = set_trit_setun(tcmd, 9, p3);
+
+				cnt_line -= 1;
+			}
+
+			if (cnt_line == 0)
+			{
+				cnt_line = 3;
+				cnt_cmd -= 1;
+
+				sum = add_trs(sum, tcmd);
+				dsun += trs2digit(tcmd);
+
+				LOGGING_print(" -> [");
+
+				if (LOGGING > 0)
+				{
+					trs2str(tcmd);
+				}
+				LOGGING_print("]");
+				if (LOGGING > 0)
+				{
+					view_short_reg(&fa, " addr");
+				}
+				else
+				{
+					if (LOGGING > 0)
+					{
+						printf("\r\n");
+					}
+				}
+
+				st_fram(m, fa, tcmd);
+				fa = next_address(fa);
+				mod_3_n(&fa, 5);
+				tcmd.t0 = 0;
+				tcmd.t1 = 0;
+
+				int32_t dtres = trs2digit(res);
+				if (dtres == -13)
+				{
+					/* Символ 'ст' '_OO.O_' */
+					break; /* exit while(...) */
+				}
+				//
+				i += 1;
+			}
+			else
+			{
+				tcmd = shift_trs(tcmd, 3);
+			}
+		}
+	}
+
+	if (LOGGING > 0)
+	{
+		printf("\r\ni=%i\r\n", i);
+		/* Печать контрольных сумм */
+		view_checksum_setun(sum);
+	}
+
+	if (cnt != SIZE_ZONE_TRIT_FRAM)
+		return 1; /* Error #2 */
+
+	return 0; /* OK' */
+}
+
+/**
+ * Чтение команд с фотосчитывателя №2
+ */
+uint8_t Read_Commands_from_FT2(setun_machine_t *m, FILE *file, trs_t fa)
+{
+	printf("[ Read commands from FT2 ]\r\n");
+	uint8_t cnt = 0;
+
+	if (file == NULL)
+		return 1; /* Error #1 */
+
+	trs_t dst;
+	trs_t addr;
+	trs_t oper;
+	uint8_t cmd[20];
+
+	/**
+	 * Загрузить
+	 */
+
+	trs_t sum;
+	trs_t tmp;
+
+	tmp.l = 18;
+	tmp.t1 = 0;
+	tmp.t0 = 0;
+
+	int64_t dsun = 0;
+	sum.l = 18;
+	sum.t1 = 0;
+	sum.t0 = 0;
+	//
+	dst.l = 9;
+	m->MR.l = 18;
+	int i = 0;
+
+	while (fscanf(file, "%s", cmd) != EOF)
+	{
+		if (strlen(cmd) != 5)
+			continue;
+
+		cmd_str_2_trs(cmd, &dst);
+		sum = add_trs(sum, dst);
+		i += 1;
+
+		dsun += trs2digit(dst);
 
 		LOGGING_print("%s -> [", cmd);
 
@@ -4790,7 +6064,7 @@ uint8_t Read_Commands_from_FT2(FILE *file, trs_t fa)
 			}
 		}
 
-		st_fram(fa, dst);
+		st_fram(m, fa, dst);
 		fa = next_address(fa);
 		mod_3_n(&fa, 5);
 
@@ -4811,7 +6085,7 @@ uint8_t Read_Commands_from_FT2(FILE *file, trs_t fa)
 /**
  * Чтение символов с фотосчитывателя №1
  */
-uint8_t Read_Symbols_from_FT2(FILE *file, trs_t fa)
+uint8_t Read_Symbols_from_FT2(setun_machine_t *m, FILE *file, trs_t fa)
 {
 	if (LOGGING > 0)
 	{
@@ -4826,7 +6100,9 @@ uint8_t Read_Symbols_from_FT2(FILE *file, trs_t fa)
 	trs_t dst;
 	trs_t addr;
 	trs_t oper;
-	uint8_t cmd[20];
+	tape_reader_t local = {0};
+	tape_reader_t *rd = tape_reader_of(m, file);
+	int8_t holes;
 
 	/**
 	 * Загрузить
@@ -4845,7 +6121,7 @@ uint8_t Read_Symbols_from_FT2(FILE *file, trs_t fa)
 	sum.t0 = 0;
 	//
 	dst.l = 9;
-	MR.l = 18;
+	m->MR.l = 18;
 	int i = 0;
 
 	trs_t tcmd;
@@ -4856,12 +6132,12 @@ uint8_t Read_Symbols_from_FT2(FILE *file, trs_t fa)
 	uint8_t cnt_cmd = 54;
 	uint8_t cnt_line = 3;
 	//
-	while ((fscanf(file, "%s", cmd) != EOF) && (cnt_cmd != 0))
+	while ((tape_next_row((rd != NULL) ? rd : &local, file, &holes) != EOF) && (cnt_cmd != 0))
 	{
 		uint8_t err = 0;
 		trs_t res;
 
-		res = Decoder_Symbol_Paper_Line(cmd, &err);
+		res = Decoder_Symbol_Row(holes, &err);
 		if (err == 0)
 		{
 			if (cnt_line > 0)
@@ -4908,7 +6184,7 @@ uint8_t Read_Symbols_from_FT2(FILE *file, trs_t fa)
 					}
 				}
 
-				st_fram(fa, tcmd);
+				st_fram(m, fa, tcmd);
 				fa = next_address(fa);
 				mod_3_n(&fa, 5);
 				tcmd.t0 = 0;
@@ -4939,14 +6215,14 @@ uint8_t Read_Symbols_from_FT2(FILE *file, trs_t fa)
 /**
  * Вывод на TTY1
  */
-uint8_t Write_Commands_to_TTY1(FILE *file, trs_t fa)
+uint8_t Write_Commands_to_TTY1(setun_machine_t *m, FILE *file, trs_t fa)
 {
 	uint8_t offset = 13;
 
-	if (file == NULL)
+	if (!dev_ok(&m->tty_dev, file))
 		return 1; /* Error */
 
-	electrified_typewriter(fa, russian_latin_sw);
+	electrified_typewriter(m, fa, m->russian_latin_sw);
 
 	return 0; /* OK' */
 }
@@ -4954,15 +6230,15 @@ uint8_t Write_Commands_to_TTY1(FILE *file, trs_t fa)
 /**
  * Вывод на TTY1
  */
-uint8_t Write_Symbols_to_TTY1(FILE *file, trs_t fa)
+uint8_t Write_Symbols_to_TTY1(setun_machine_t *m, FILE *file, trs_t fa)
 {
 
 	uint8_t offset = 13;
 
-	if (file == NULL)
+	if (!dev_ok(&m->tty_dev, file))
 		return 1; /* Error */
 
-	electrified_typewriter(fa, russian_latin_sw);
+	electrified_typewriter(m, fa, m->russian_latin_sw);
 
 	return 0; /* OK' */
 }
@@ -4999,992 +6275,1826 @@ uint8_t Perforation_Symbols_to_PTP1(FILE *file, trs_t fa)
 	return 0; /* OK' */
 }
 
-/** *******************************************
- *  Реалиазция виртуальной машины "Сетунь-1958"
- *  -------------------------------------------
- */
-
 /**
- * Аппаратный сброс.
- * Очистить память и регистры
- * виртуальной машины "Сетунь-1958"
+ * Строки перфоленты для перфоратора: [код + 13] - строка tab4_0 с CRLF
+ * и комбинация пробивок для двоичной ленты
  */
-void reset_setun_1958(void)
+static char tab_punch_row[27][8];
+static uint8_t tab_punch_holes[27];
+
+void init_tab_punch(void)
 {
-	clean_fram(); /* Очистить  FRAM */
-	clean_drum(); /* Очистить  DRUM */
+	for (uint8_t i = 0; i < 27; i++)
+	{
+		char line[STRING_PAPER_SIZE + 1];
+
+		memcpy(line, tab4_0[i], STRING_PAPER_SIZE);
+		line[STRING_PAPER_SIZE] = '\0';
+		memcpy(tab_punch_row[i], line, STRING_PAPER_SIZE);
+		tab_punch_row[i][6] = '\r';
+		tab_punch_row[i][7] = '\n';
+		tab_punch_holes[i] = (uint8_t)paper_line_holes(line);
+	}
 }
 
-/**
- * Вернуть модифицированное K(1:9) для выполнения операции "Сетунь-1958"
- */
-trs_t control_trs(trs_t a)
+/* Строка кода code в буфер перфоратора */
+static inline void ptp_row(setun_machine_t *m, int32_t code)
 {
-	int8_t k9;
-	trs_t k1_5;
-	trs_t cn;
+	dev_buf_t *b = &m->ptp_buf;
 
-	clear(&cn);
+	if (m->ptp_fmt == TAPE_BIN)
+	{
+		b->data[b->len++] = tab_punch_holes[code + 13];
+		m->ptp_rows++;
+	}
+	else
+	{
+		memcpy(b->data + b->len, tab_punch_row[code + 13], 8);
+		b->len += 8;
+	}
+}
 
-	/* Адресная часть K(9) */
-	k1_5 = slice_trs_setun(a, 1, 5);
+/**
+ * Перфорация зоны FRAM с адреса fa на ПЛ. Строки всей зоны собираются
+ * в буфере по таблице и записываются одним fwrite().
+ * symbols = 0: команды, пять строк на слово - трит 1 и пары тритов 2..9;
+ * symbols = 1: символы, три строки на слово до символа -13.
+ */
+uint8_t Perforation_Zone_to_PTP1(setun_machine_t *m, trs_t fa, uint8_t symbols)
+{
+	if (!dev_ok(&m->ptp_dev, m->ptp1))
+		return 1; /* Error #1 */
 
-	/* Признак модификации адремной части K(9) */
-	k9 = get_trit_setun(a, 9);
+	m->ptp_buf.len = 0;
+	for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
+	{
+		uint32_t u;
 
-	/* Модицикация адресной части K(1:5) */
-	if (k9 > 0)
-	{ /* A(1:5) = A(1:5) + F(1:5) */
-		k1_5 = add_trs(k1_5, F);
-		mod_3_n(&k1_5, 5);
+		m->MR = ld_fram(m, fa);
+		/* Слово в смещённом коде (3^9 - 1) / 2: цифры по основанию 3 - триты +1 */
+		u = (uint32_t)(trs2digit(m->MR) + 9841);
+		if (symbols)
+		{
+			ptp_row(m, (int32_t)(u / 729) - 13);
+			ptp_row(m, (int32_t)(u / 27 % 27) - 13);
+			if ((int32_t)(u % 27) - 13 == -13)
+				break;
+			ptp_row(m, (int32_t)(u % 27) - 13);
+		}
+		else
+		{
+			ptp_row(m, (int32_t)(u / 6561) - 1);
+			ptp_row(m, (int32_t)(u / 729 % 9) - 4);
+			ptp_row(m, (int32_t)(u / 81 % 9) - 4);
+			ptp_row(m, (int32_t)(u / 9 % 9) - 4);
+			ptp_row(m, (int32_t)(u % 9) - 4);
+		}
+		fa = next_address(fa);
 	}
-	else if (k9 < 0)
-	{ /* A(1:5) = A(1:5) - F(1:5) */
-		k1_5 = sub_trs(k1_5, F);
-		mod_3_n(&k1_5, 5);
+	if (m->io != NULL)
+	{
+		io_put(m->io, &m->ptp_dev, m->ptp1, NULL, &m->ptp_buf);
 	}
 	else
-	{	/*  A(1:5) = A(1:5) */
-		/* Без изменений    */
+	{
+		dev_write(&m->ptp_dev, m->ptp1, NULL, &m->ptp_buf);
 	}
+	m->ptp_buf.len = 0;
 
-	cn = shift_trs(k1_5, 4);
-	cn.l = 9;
+	return 0; /* OK' */
+}
 
-	a = slice_trs_setun(a, 6, 9);
+/* Заголовок двоичной перфоленты ПЛ */
+void ptp_begin(setun_machine_t *m)
+{
+	tape_bin_hdr_t h = {TAPE_BIN_MAGIC, 0, 0};
 
-	cn = add_trs(a, cn);
-	cn.l = 9;
+	m->ptp_rows = 0;
+	if ((m->ptp_fmt == TAPE_BIN) && dev_ok(&m->ptp_dev, m->ptp1))
+	{
+		dev_put(&m->ptp_dev, m->ptp1, (const char *)&h, sizeof(h));
+	}
+}
 
-	return cn;
+/* Число строк в заголовке двоичной перфоленты в памяти или в файле, если он позволяет fseek() */
+void ptp_end(setun_machine_t *m)
+{
+	tape_bin_hdr_t h = {TAPE_BIN_MAGIC, 0, 0};
+
+	h.rows = m->ptp_rows;
+	if ((m->ptp_fmt == TAPE_BIN) && (m->ptp_dev.kind == DEV_MEM) && (m->ptp_dev.len >= sizeof(h)))
+	{
+		memcpy(m->ptp_dev.data, &h, sizeof(h));
+	}
+	if ((m->ptp_fmt != TAPE_BIN) || (m->ptp_dev.kind != DEV_FILE) || (m->ptp1 == NULL))
+	{
+		return;
+	}
+	if (fseek(m->ptp1, 0, SEEK_SET) == 0)
+	{
+		fwrite(&h, sizeof(h), 1, m->ptp1);
+		fseek(m->ptp1, 0, SEEK_END);
+	}
 }
 
-/******************************************************************************************
-					Таблица операций машина "Сетунь-1958"
--------------------------------------------------------------------------------------------
-Код(троичный)	Код			Название операции			W		Содержание команды
--------------------------------------------------------------------------------------------
-+00	30			9			Посылка в S					w(S)	(A*)=>(S)
-+0+	33			10			Сложение в S				w(S)	(S)+(A*)=>(S)
-+0-	3X			8			Вычитание в S				w(S)	(S)-(A*)=>(S)
-++0	40			12			Умножение 0					w(S)	(S)=>(R); S=0; (A*)(R)=>(S)
-+++	43			13			Умножение +					w(S)	(S)+(A*)(R)=>(S)
-++-	4X			11			Умножение -					w(S)	(A*)+(S)(R)=>(S)
-+-0	20			6			Поразрядное умножение		w(S)	(A*)[x](S)=>(S)
-+-+	23			7			Посылка в R					w(R)	(A*)=>(R)
-+--	2X			5			Останов	Стоп;				w(R)	STOP; (A*)=>(C)
-0+0	10			3			Условный переход 0			-		A*=>(C) при w=0
-0++	13			4			Условный переход +			-		A*=>(C) при w=+
-0+-	1X			2			Условный переход -			-		A*=>(C) при w=-
-000	00			0			Безусловный переход			-		A*=>(C)
-00+	03			1			Запись из C					-		(C)=>(A*)
-00-	0X			-1			Запись из F					w(F)	(F)=>(A*)
-0-0	Z0			-3			Посылка в F					w(F)	(A*)=>(F)
-0--	ZX			-4			Сложение в F				w(F)	(F)+(A*)=>(F)
-0-+	Z3			-2			Сложение в F c (C)			w(F)	(C)+(A*)=>(F)
--+0	Y0			-6			Сдвиг (S) на S				w(S)	(A*)=>(S)
--++	Y3			-5			Запись из S					w(S)	(S)=>(A*)
--+-	YX			-7			Нормализация				w(S)	Норм.(S)=>(A*); (N)=>(S)
--00	X0			-9			Вывод-ввод Ввод в Фа*.		-		Вывод из Фа*
--0+ X3			-8			Запись на МБ				-		(Фа*)=>(Мд*)
--0- XX			-10			Считывание с МБ				-		(Мд*)=>(Фа*)
---0	W0			-12			Не задействована					Аварийный стоп
---+	W3			-11			Не задействована					Аварийный стоп
----	WX			-13			Не задействована					Аварийный стоп
------------------------------------------------------------------------------------------*/
+/** ------------------------------------------------------------
+ *  Поток устройств ввода-вывода (--io-thread)
+ *  ------------------------------------------------------------
+ *  Команда -00 не ждёт fwrite() печати ПМ, перфоратора ПЛ и копии
+ *  на консоль: готовый буфер устройства дописывается в блок кольца,
+ *  поток устройств записывает блоки в порядке команд. Блок ставится
+ *  в кольцо, когда заполнен, при смене устройства и между пакетами
+ *  команд - строки печати не будят поток устройств по одной. Место
+ *  в кольце ждёт только машина, опередившая вывод на IO_RING_SIZE блоков.
+ *
+ *  Перфолента из канала, FIFO или сокета читается заранее: поток
+ *  фотосчитывателя декодирует строки в запасной буфер, пока машина
+ *  читает свой. По исчерпании буфера фотосчитыватель машины меняет
+ *  буферы местами. Поток отдаёт буфер, как только данные канала
+ *  кончились, поэтому источник, который ждёт печати машины, не
+ *  ждёт заполнения буфера. Лента из файла уже декодирована в памяти.
+ *
+ *  Останов машины и закрытие файлов выводят кольцо полностью:
+ *  печать до останова видна, как и без потока устройств.
+ */
 
 /**
- * Выполнить операцию K(1:9) машины "Сетунь-1958"
+ * Поставить заполняемый блок в кольцо. Спящий поток устройств
+ * будится, когда в кольце четверть блоков, или сразу (wake).
  */
-int8_t execute_trs(trs_t addr, trs_t oper)
+static void io_post(io_dev_t *io, uint8_t wake)
 {
-	// TODO проверить выполнение команды
-	// для С(5) = -1 выполнить 2-раза старшей половине A(9:18) и сделать inc C
-
-	trs_t k1_5;		 /* K(1:5)	*/
-	trs_t k6_8;		 /* K(6:8)	*/
-	int8_t codeoper; /* Код операции */
-
-	/* Адресная часть */
-	k1_5 = slice_trs_setun(addr, 1, 5);
-	k1_5.l = 5;
+	pthread_mutex_lock(&io->lock);
+	if (io->open)
+	{
+		io->open = 0;
+		io->head++;
+	}
+	if (wake || (io->head - io->tail >= IO_RING_SIZE / 4))
+	{
+		pthread_cond_signal(&io->work);
+	}
+	pthread_mutex_unlock(&io->lock);
+}
 
-	/* Код операции */
-	k6_8 = oper;
-	k6_8.l = 3;
+/* Буфер устройства в блок кольца, место ждёт машина */
+static void io_put(io_dev_t *io, dev_out_t *dev, FILE *file, FILE *echo, const dev_buf_t *b)
+{
+	io_block_t *blk = &io->ring[io->head % IO_RING_SIZE];
 
-	codeoper = get_trit_setun(k6_8, 1) * 9 +
-			   get_trit_setun(k6_8, 2) * 3 +
-			   get_trit_setun(k6_8, 3);
-
-	/* ---------------------------------------
-	 *  Выполнить операцию машины "Сетунь-1958"
-	 *  ---------------------------------------
-	 */
-
-	/*
-	 * Описание реализации команд машины «Сетунь»
-	 *
-	 * 5-разрядный регистр управления С, в котором содержится адрес
-	 * выполняемой команды, после выполнения каждой команды в регистре С
-	 * формируется адрес следующей команды причём за командой являющейся первой
-	 * коротким кодом какой-либо ячейки, следует­ команда, являющаяся вторым
-	 * коротким кодом этой ячейки, а вслед за ней — ко­манда, являющаяся первым
-	 * коротким кодом следующей ячейки, и т. д.;
-	 * этот порядок может быть нарушен при выполнении команд
-	 * перехода.
-	 *
-	 * При выполнении команд, использую­щих регистры F и С, операции производятся
-	 * над 5-разрядными кодами, которые можно рассматривать как целые числа.
-	 * При выборке из памяти 5-разрядный код рассматривается как старшие пять разрядов
-	 * соответст­вующего короткого или длинного кода, при запоминании в ячейке
-	 * па­мяти 5-разрядный код записывается в старшие пять разрядов и допол­няется
-	 * до соответствующего короткого или длинного кода записью нулей в остальные разряды.
-	 *
-	 * При выполнении команд, использующих регистры S и R, выбираемые из памяти короткие коды
-	 * рассматриваются как длин­ные с добавлением нулей в девять младших разрядов, а в оперативную
-	 * память в качестве короткого кода записывается содержимое девяти старших разрядов регистра S
-	 * (запись в оперативную память непосред­ственно из регистра R невозможна).
-	 *
-	 * После выполнения каждой команды вырабатывается значение неко­торого признака W = W(X) {-1,0,1},
-	 * где X — обозначение какого-либо регистра, или сохраняется предыду­щее значение этого признака.
-	 *
-	 * Команды условного перехода выполняются по-разному в зависимости от значения этого признака W.
-	 *
-	 * При выполнении операций сложения, вычитания и умножения, использующих регистр S,
-	 * может произойти останов машины по переполнению, если результат выполнения
-	 * этой опе­рации, посылаемый в регистр S, окажется по модулю больше 4,5 .
-	 *
-	 * Операция сдвига производит сдвиг содержимого регистра S на |N|-разрядов, где N рассматривается
-	 * как 5-разрядный код, хранящийся в ячейке A*, т.е. N = (А*). Сдвиг производится влево при N > 0 и
-	 * вправо при N < 0. При N = 0 содержимое регистра S не изменяется.
-	 *
-	 * Операция нормализации производит сдвиг (S) при (S) != 0 в таком направлении и на такое число
-	 * разрядов |N|, чтобы результат, посылаемый в ячейку A*, был но модулю больше 1/2 , но меньше 3/2,
-	 * т.е. чтобы в двух старших разрядах результата была записана комбинация троичных цифр 01 или 0-1.
-	 * При этом в регистр S посылается число N (5-разрядный код), знак которого определяется
-	 * направлением сдвига, а именно: N > 0 при сдвиге вправо и N < 0 при сдвиге влево. При (S) = 0 или при
-	 * 1/2 <|(S)| < 3/2 в ячейку А* посылается (S), а в регистр S посылается N = 0.
-	 *
-	 * Остальные операции, содержащиеся в табл. 1, ясны без дополни­тельных пояснений.
-	 *
-	 */
-	if (LOGGING > 0)
+	if (b->len == 0)
 	{
-		view_step_new_addres(&k1_5, "A*");
+		return;
 	}
-
-	switch (codeoper)
+	if (io->open && (blk->dev == dev) && (blk->file == file) && (blk->echo == echo) &&
+		(blk->buf.len + b->len <= DEV_BUF_SIZE))
 	{
-	case (+1 * 9 + 0 * 3 + 0):
-	{ // +00 : Посылка в S	(A*)=>(S)
-		LOGGING_print(" k6..8[+00]: (A*)=>(S)\n");
-		MR = ld_fram(k1_5);
-		mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		if (MR.l != 18)
-		{
-			MR.l = 18;
-			MR = shift_trs(MR, 9);
-			mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		}
-		copy_trs_setun(&MR, &S);
-		W = set_trit_setun(W, 1, sgn_trs(S));
-		C = next_address(C);
+		memcpy(blk->buf.data + blk->buf.len, b->data, b->len);
+		blk->buf.len += b->len;
+		return;
 	}
-	break;
-	case (+1 * 9 + 0 * 3 + 1):
-	{ // +0+ : Сложение в S	(S)+(A*)=>(S)
-		LOGGING_print(" k6..8[+0+]: (S)+(A*)=>(S)\n");
-		MR = ld_fram(k1_5);
-		mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		if (MR.l != 18)
-		{
-			MR.l = 18;
-			MR = shift_trs(MR, 9);
-			mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		}
-		S = add_trs(S, MR);
-		mod_3_n(&S, S.l); /* очистить неиспользованные триты */
-		W = set_trit_setun(W, 1, sgn_trs(S));
-		if (over_check() > 0)
-		{
-			goto error_over;
-		}
-		C = next_address(C);
+	if (io->open)
+	{
+		io_post(io, 0);
 	}
-	break;
-	case (+1 * 9 + 0 * 3 - 1):
-	{ // +0- : Вычитание в S	(S)-(A*)=>(S)
-		LOGGING_print(" k6..8[+0-]: (S)-(A*)=>(S)\n");
-		MR = ld_fram(k1_5);
-		mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		if (MR.l != 18)
-		{
-			MR = shift_trs(MR, 9);
-			MR.l = 18;
-			mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		}
-		S = sub_trs(S, MR);
-		W = set_trit_setun(W, 1, sgn_trs(S));
-		if (over_check() > 0)
+
+	pthread_mutex_lock(&io->lock);
+	if (io->head - io->tail == IO_RING_SIZE)
+	{
+		io->waits++;
+		pthread_cond_signal(&io->work);
+		while (io->head - io->tail == IO_RING_SIZE)
 		{
-			goto error_over;
+			pthread_cond_wait(&io->space, &io->lock);
 		}
-		C = next_address(C);
 	}
-	break;
-	case (+1 * 9 + 1 * 3 + 0):
-	{ // ++0 : Умножение +	(S)=>(R); S=0; (A*)(R)=>(S)
-		LOGGING_print(" k6..8[++0]: (S)=>(R); S=0; (A*)(R)=>(S)\n");
-		copy_trs_setun(&S, &R);
-		S.t1 = 0;
-		S.t0 = 0;
-		MR = ld_fram(k1_5);
-		mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		if (MR.l != 18)
-		{
-			MR = shift_trs(MR, 9);
-			MR.l = 18;
-			mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		}
-		trs_t temp = mul_trs(MR, R);
-		mod_3_n(&temp, 18);
-		copy_trs_setun(&temp, &S);
-		W = set_trit_setun(W, 1, sgn_trs(S));
-		if (over_check() > 0)
-		{
-			goto error_over;
-		}
-		C = next_address(C);
+	pthread_mutex_unlock(&io->lock);
+
+	/* Блок head не читается потоком устройств до io->head++ */
+	blk = &io->ring[io->head % IO_RING_SIZE];
+	blk->dev = dev;
+	blk->file = file;
+	blk->echo = echo;
+	blk->buf.len = b->len;
+	memcpy(blk->buf.data, b->data, b->len);
+	io->open = 1;
+}
+
+/* Дождаться вывода всех блоков кольца */
+static void io_drain(io_dev_t *io)
+{
+	io_post(io, 1);
+	pthread_mutex_lock(&io->lock);
+	while (io->tail != io->head)
+	{
+		pthread_cond_wait(&io->space, &io->lock);
 	}
-	break;
-	case (+1 * 9 + 1 * 3 + 1):
-	{ // +++ : Умножение +	(S)+(A*)(R)=>(S)
-		LOGGING_print(" k6..8[+++]: (S)+(A*)(R)=>(S)\n");
-		MR = ld_fram(k1_5);
-		mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		if (MR.l != 18)
+	pthread_mutex_unlock(&io->lock);
+}
+
+/* Поток устройств: вывод блоков кольца */
+static void *io_thread(void *arg)
+{
+	io_dev_t *io = arg;
+
+	pthread_mutex_lock(&io->lock);
+	while (1)
+	{
+		io_block_t *blk;
+
+		while ((io->head == io->tail) && !io->stop)
 		{
-			MR = shift_trs(MR, 9);
-			MR.l = 18;
-			mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
+			pthread_cond_wait(&io->work, &io->lock);
 		}
-		trs_t temp = slice_trs(mul_trs(MR, R), 0, 17);
-		S = add_trs(temp, S);
-		W = set_trit_setun(W, 1, sgn_trs(S));
-		if (over_check() > 0)
+		if (io->head == io->tail)
 		{
-			goto error_over;
+			break;
 		}
-		C = next_address(C);
+		blk = &io->ring[io->tail % IO_RING_SIZE];
+		pthread_mutex_unlock(&io->lock);
+
+		dev_write(blk->dev, blk->file, blk->echo, &blk->buf);
+
+		pthread_mutex_lock(&io->lock);
+		io->tail++;
+		io->blocks++;
+		pthread_cond_broadcast(&io->space);
 	}
-	break;
-	case (+1 * 9 + 1 * 3 - 1):
-	{ // ++- : Умножение - (A*)+(S)(R)=>(S)
-		LOGGING_print(" k6..8[++-]: (A*)+(S)(R)=>(S)\n");
-		MR = ld_fram(k1_5);
-		mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		if (MR.l != 18)
+	pthread_mutex_unlock(&io->lock);
+	return NULL;
+}
+
+/**
+ * Поток фотосчитывателя: строки ленты в буфер back. read() пустого
+ * канала может ждать сколь угодно долго, поэтому только на время
+ * чтения разрешена отмена потока при закрытии файлов.
+ */
+static void *io_tape_thread(void *arg)
+{
+	io_tape_t *t = arg;
+	int8_t holes;
+
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+	while (1)
+	{
+		uint8_t *rows;
+		size_t n = 0;
+		uint8_t end = 0;
+
+		pthread_mutex_lock(&t->lock);
+		while (t->ready && !t->stop)
 		{
-			MR = shift_trs(MR, 9);
-			MR.l = 18;
-			mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
+			pthread_cond_wait(&t->cond, &t->lock);
 		}
-		trs_t temp = mul_trs(S, R);
-		S = add_trs(slice_trs(temp, 0, 17), MR);
-		W = set_trit_setun(W, 1, sgn_trs(S));
-		if (over_check() > 0)
+		if (t->stop)
 		{
-			goto error_over;
+			pthread_mutex_unlock(&t->lock);
+			break;
 		}
-		C = next_address(C);
-	}
-	break;
-	case (+1 * 9 - 1 * 3 + 0):
-	{ // +-0 : Поразрядное умножение	(A*)[x](S)=>(S)
-		LOGGING_print(" k6..8[+-0]: (A*)[x](S)=>(S)\n");
-		MR = ld_fram(k1_5);
+		rows = t->rows[t->back];
+		pthread_mutex_unlock(&t->lock);
 
-		if (MR.l != 18)
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+		while (n < IO_PREFETCH_ROWS)
 		{
-			MR = shift_trs(MR, 9);
-			MR.l = 18;
-			mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
+			if (tape_next_row(&t->src, t->file, &holes) == EOF)
+			{
+				end = 1;
+				break;
+			}
+			rows[n++] = (uint8_t)holes; /* -1 - 0xFF, строка не распознана */
+
+			/* Данные канала кончились: отдать прочитанное, не ждать read() */
+			if (t->src.pos >= t->src.size)
+			{
+				break;
+			}
 		}
-		S = and_trs(MR, S);
-		W = set_trit_setun(W, 1, sgn_trs(S));
-		C = next_address(C);
-	}
-	break;
-	case (+1 * 9 - 1 * 3 + 1):
-	{ // +-+ : Посылка в R	(A*)=>(R)
-		LOGGING_print(" k6..8[+-+]: (A*)=>(R)\n");
-		MR = ld_fram(k1_5);
-		mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		if (MR.l != 18)
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+		pthread_mutex_lock(&t->lock);
+		t->len[t->back] = n;
+		t->ready = (n > 0);
+		t->end = end;
+		pthread_cond_broadcast(&t->cond);
+		pthread_mutex_unlock(&t->lock);
+		if (end)
 		{
-			MR = shift_trs(MR, 9);
-			MR.l = 18;
-			mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
+			break;
 		}
-		copy_trs_setun(&MR, &R);
-		W = set_trit_setun(W, 1, sgn_trs(S));
-		C = next_address(C);
 	}
-	break;
-	case (+1 * 9 - 1 * 3 - 1):
-	{ // +-- : Останов	Стоп; (A*)=>(R)
-		LOGGING_print(" k6..8[+--]: STOP (A*)=>(R)\n");
-		MR = ld_fram(k1_5);
-		mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		if (MR.l != 18)
-		{
-			MR = shift_trs(MR, 9);
-			MR.l = 18;
-			mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		}
-		copy_trs_setun(&MR, &R);
+	return NULL;
+}
 
-		return STOP;
+/* Буфер фотосчитывателя прочитан: взять готовый. Возврат: строк, 0 - конец ленты */
+static size_t io_tape_swap(tape_reader_t *r)
+{
+	io_tape_t *t = r->pf;
+
+	r->base += r->size;
+	r->pos = 0;
+	r->size = 0;
+	pthread_mutex_lock(&t->lock);
+	t->stalls += !t->ready && !t->end;
+	while (!t->ready && !t->end)
+	{
+		pthread_cond_wait(&t->cond, &t->lock);
 	}
-	break;
-	case (+0 * 9 + 1 * 3 + 0):
-	{ // 0+0 : Условный переход -	A*=>(C) при w=0
-		LOGGING_print(" k6..8[0+0]: A*=>(C) при w=0\n");
-		int8_t w;
-		w = sgn_trs(W);
-		if (w == 0)
-		{
-			copy_trs_setun(&k1_5, &C);
-		}
-		else
-		{
-			C = next_address(C);
-		}
+	if (t->ready)
+	{
+		r->data = t->rows[t->back];
+		r->size = t->len[t->back];
+		t->back ^= 1;
+		t->ready = 0;
+		t->swaps++;
+		pthread_cond_signal(&t->cond);
+	}
+	pthread_mutex_unlock(&t->lock);
+	return r->size;
+}
+
+/**
+ * Запустить поток устройств машины. Перфоленты из потока передаются
+ * потокам фотосчитывателей с непрочитанным остатком буфера.
+ * Возврат: 0 или -1.
+ */
+int io_start(setun_machine_t *m)
+{
+	io_dev_t *io;
+
+	if (m->io != NULL)
+	{
+		return 0;
 	}
-	break;
-	case (+0 * 9 + 1 * 3 + 1):
-	{ // 0++ : Условный переход -	A*=>(C) при w=0
-		LOGGING_print(" k6..8[0++]: A*=>(C) при w=+1\n");
-		int8_t w;
-		w = sgn_trs(W);
-		if (w > 0)
-		{
-			copy_trs_setun(&k1_5, &C);
-		}
-		else
+	io = calloc(1, sizeof(io_dev_t));
+	if (io == NULL)
+	{
+		return -1;
+	}
+	pthread_mutex_init(&io->lock, NULL);
+	pthread_cond_init(&io->work, NULL);
+	pthread_cond_init(&io->space, NULL);
+	if (pthread_create(&io->th, NULL, io_thread, io) != 0)
+	{
+		pthread_mutex_destroy(&io->lock);
+		pthread_cond_destroy(&io->work);
+		pthread_cond_destroy(&io->space);
+		free(io);
+		return -1;
+	}
+
+	for (int k = 0; k < 2; k++)
+	{
+		tape_reader_t *r = (k == 0) ? &m->ft1 : &m->ft2;
+		io_tape_t *t;
+
+		if (!r->stream)
 		{
-			C = next_address(C);
+			continue;
 		}
-	}
-	break;
-	case (+0 * 9 + 1 * 3 - 1):
-	{ // 0+- : Условный переход -	A*=>(C) при w=-
-		LOGGING_print(" k6..8[0+-]: A*=>(C) при w=-1\n");
-		int8_t w;
-		w = sgn_trs(W);
-		if (w < 0)
+		t = calloc(1, sizeof(io_tape_t));
+		if (t == NULL)
 		{
-			copy_trs_setun(&k1_5, &C);
+			continue;
 		}
-		else
+		t->src = *r;
+		t->file = (k == 0) ? m->ptr1 : m->ptr2;
+		pthread_mutex_init(&t->lock, NULL);
+		pthread_cond_init(&t->cond, NULL);
+		io->tape[k] = t;
+
+		/* Фотосчитыватель машины: строки двоичной ленты из буферов потока */
+		memset(r, 0, sizeof(*r));
+		r->data = t->rows[1];
+		r->fmt = TAPE_BIN;
+		r->stream = 1;
+		r->pf = t;
+		if (pthread_create(&t->th, NULL, io_tape_thread, t) != 0)
 		{
-			C = next_address(C);
+			*r = t->src;
+			pthread_mutex_destroy(&t->lock);
+			pthread_cond_destroy(&t->cond);
+			io->tape[k] = NULL;
+			free(t);
 		}
 	}
-	break;
-	case (+0 * 9 + 0 * 3 + 0):
-	{ //  000 : Безусловный переход	A*=>(C)
-		LOGGING_print(" k6..8[000]: A*=>(C)\n");
-		copy_trs_setun(&k1_5, &C);
-		C.l = 5;
+	m->io = io;
+	return 0;
+}
+
+/* Остановить поток устройств: кольцо выводится, чтение ленты прекращается */
+void io_stop(setun_machine_t *m)
+{
+	io_dev_t *io = m->io;
+
+	if (io == NULL)
+	{
+		return;
 	}
-	break;
-	case (+0 * 9 + 0 * 3 + 1):
-	{ // 00+ : Запись из C	(C)=>(A*)
-		LOGGING_print(" k6..8[00+]: (C)=>(A*)\n");
-		if (get_trit_setun(k1_5, 5) < 0)
-		{
-			MR.l = 18;
-			copy_trs_setun(&C, &MR);
-		}
-		else
+	io_post(io, 1);
+	pthread_mutex_lock(&io->lock);
+	io->stop = 1;
+	pthread_cond_signal(&io->work);
+	pthread_mutex_unlock(&io->lock);
+	pthread_join(io->th, NULL);
+
+	for (int k = 0; k < 2; k++)
+	{
+		io_tape_t *t = io->tape[k];
+		tape_reader_t *r = (k == 0) ? &m->ft1 : &m->ft2;
+
+		if (t == NULL)
 		{
-			MR.l = 9;
-			copy_trs_setun(&C, &MR);
+			continue;
 		}
-		st_fram(k1_5, MR);
-		C = next_address(C);
+		pthread_mutex_lock(&t->lock);
+		t->stop = 1;
+		pthread_cond_signal(&t->cond);
+		pthread_mutex_unlock(&t->lock);
+		pthread_cancel(t->th);
+		pthread_join(t->th, NULL);
+
+		/* Буфер потока освобождается, фотосчитыватель машины - пустой */
+		tape_close(&t->src);
+		memset(r, 0, sizeof(*r));
+		pthread_mutex_destroy(&t->lock);
+		pthread_cond_destroy(&t->cond);
+		free(t);
+	}
+	pthread_mutex_destroy(&io->lock);
+	pthread_cond_destroy(&io->work);
+	pthread_cond_destroy(&io->space);
+	free(io);
+	m->io = NULL;
+}
+
+/* Заполняемый блок - потоку устройств, без ожидания: граница пакета команд */
+void dev_post(setun_machine_t *m)
+{
+	if (m->io != NULL)
+	{
+		io_post(m->io, 1);
 	}
-	break;
-	case (+0 * 9 + 0 * 3 - 1):
-	{ // 00- : Запись из F	(F)=>(A*)
-		LOGGING_print(" k6..8[00-]: (F)=>(A*)\n");
-		if (get_trit_setun(k1_5, 5) < 0)
-		{
-			MR.l = 18;
-			copy_trs_setun(&F, &MR);
-		}
-		else
+}
+
+/* Печать и перфорация выведены полностью: останов, пульт, закрытие файлов */
+void dev_sync(setun_machine_t *m)
+{
+	tty_flush(m);
+	if (m->io != NULL)
+	{
+		io_drain(m->io);
+	}
+}
+
+/* Строка счётчиков потока устройств, пустая - без потока */
+void io_stat_str(setun_machine_t *m, char *s, size_t size)
+{
+	io_dev_t *io = m->io;
+	int n;
+
+	s[0] = '\0';
+	if (io == NULL)
+	{
+		return;
+	}
+	n = snprintf(s, size, "[ IO thread: %llu blocks, %llu ring waits", (unsigned long long)io->blocks,
+				 (unsigned long long)io->waits);
+	for (int k = 0; k < 2; k++)
+	{
+		if ((io->tape[k] != NULL) && (n > 0) && ((size_t)n < size))
 		{
-			MR.l = 9;
-			copy_trs_setun(&F, &MR);
+			n += snprintf(s + n, size - n, ", FT%d %llu swaps, %llu stalls", k + 1,
+						  (unsigned long long)io->tape[k]->swaps, (unsigned long long)io->tape[k]->stalls);
 		}
-		st_fram(k1_5, MR);
-		W = set_trit_setun(W, 1, sgn_trs(F));
-		C = next_address(C);
 	}
-	break;
-	case (+0 * 9 - 1 * 3 + 0):
-	{ // 0-0 : Посылка в F	(A*)=>(F)
-		LOGGING_print(" k6..8[0-0]: (A*)=>(F)\n");
-		MR = ld_fram(k1_5);
-		mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		copy_trs_setun(&MR, &F);
-		F = slice_trs_setun(MR, 1, 5);
-		F.l = 5;
-		W = set_trit_setun(W, 1, sgn_trs(F));
-		C = next_address(C);
+	if ((n > 0) && ((size_t)n < size))
+	{
+		snprintf(s + n, size - n, " ]");
 	}
-	break;
-	case (+0 * 9 - 1 * 3 + 1):
-	{ // 0-+ : Сложение в F c (C)	(C)+(A*)=>F
-		LOGGING_print(" k6..8[0-+]: (C)+(A*)=>F\n");
-		MR = ld_fram(k1_5);
-		mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		MR = slice_trs_setun(MR, 1, 5);
-		mod_3_n(&MR, 5);
-		F = add_trs(C, MR);
-
-		mod_3_n(&F, 5); /* очистить неиспользованные триты */
-		W = set_trit_setun(W, 1, sgn_trs(F));
-		C = next_address(C);
-	}
-	break;
-	case (+0 * 9 - 1 * 3 - 1):
-	{ // 0-- : Сложение в F	(F)+(A*)=>(F)
-		LOGGING_print(" k6..8[0--]: (F)+(A*)=>(F)\n");
-		MR = ld_fram(k1_5);
-		mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		MR = slice_trs_setun(MR, 1, 5);
-		MR.l = 5;
-		F = add_trs(F, MR);
-		mod_3_n(&F, 5); /* очистить неиспользованные триты */
-		W = set_trit_setun(W, 1, sgn_trs(F));
-		C = next_address(C);
-	}
-	break;
-	case (-1 * 9 + 1 * 3 + 0):
-	{ // -+0 : Сдвиг	Сдвиг (S) на (A*)=>(S)
-		LOGGING_print(" k6..8[-+0]: Сдвиг (S) на (A*)=>(S)\n");
-		/*
-		 * Операция сдвига производит сдвиг содержимого регистра S на N
-		 * разрядов, где N рассматривается как 5-разрядный код, хранящийся в
-		 * ячейке А*, т. е. N = (А*). Сдвиг производится влево при N > 0 и вправо
-		 * при N < 0. При N = 0 содержимое регистра S не изменяется.
-		 */
-		MR = ld_fram(k1_5);
-		mod_3_n(&MR, MR.l); /* очистить неиспользованные триты */
-		S = shift_trs(S, trs2digit(slice_trs_setun(MR, 1, 5)));
-		mod_3_n(&S, 18); /* очистить неиспользованные триты */
-		W = set_trit_setun(W, 1, sgn_trs(S));
-		C = next_address(C);
-	}
-	break;
-	case (-1 * 9 + 1 * 3 + 1):
-	{ // -++ : Запись из S	(S)=>(A*)
-		LOGGING_print(" k6..8[-++]: (S)=>(A*)\n");
-		st_fram(k1_5, S);
-		W = set_trit_setun(W, 1, sgn_trs(S));
-		C = next_address(C);
-	}
-	break;
-	case (-1 * 9 + 1 * 3 - 1):
-	{ // -+- : Нормализация	Норм.(S)=>(A*); (N)=>(S)
-		LOGGING_print(" k6..8[-+-]: Норм.(S)=>(A*); (N)=>(S)\n");
-		/*
-		 * Операция нормализации производит сдвиг (S) при (S) != 0 в таком направлении и на такое число
-		 * разрядов |N|, чтобы результат, посылаемый в ячейку A*, был но модулю больше 1/2 , но меньше 3/2,
-		 * т.е. чтобы в двух старших разрядах результата была записана комбинация троичных цифр 01 или 0-1.
-		 * При этом в регистр S посылается число N (5-разрядный код), знак которого определяется
-		 * направлением сдвига, а именно: N > 0 при сдвиге вправо и N < 0 при сдвиге влево. При (S) = 0 или при
-		 * 1/2 <|(S)| < 3/2 в ячейку А* посылается (S), а в регистр S посылается N = 0.
-		 */
-		mod_3_n(&S, 18); /* очистить неиспользованные триты */
-		if (S.t0 != 0)
-		{
-			/* Сдвиг S */
-			if (get_trit_setun(S, 1) != 0)
-			{
-				S = shift_trs(S, -1); /* сдвиг вправо */
-				st_fram(k1_5, S);
-				S.t1 = 0;
-				S.t0 = 0;
-				inc_trs(&S);
-				S = shift_trs(S, 13);
-			}
-			else if (get_trit_setun(S, 2) == 0)
-			{
-				uint8_t n = 0;
-				for (uint8_t i = 0; i < 16; i++)
-				{
-					S = shift_trs(S, 1);
-					n++;
-					if (get_trit_setun(S, 2) != 0)
-					{
-						break;
-					}
-				}
-				st_fram(k1_5, S);
-				S.t1 = 0;
-				S.t0 = 0;
-				for (uint8_t i = 0; i < n; i++)
-				{
-					dec_trs(&S);
-				}
-				S = shift_trs(S, 13);
-			}
-			else
-			{
-				st_fram(k1_5, S);
-				S.t1 = 0;
-				S.t0 = 0;
-			}
-		}
-		else
-		{
-			/* S == 0 */
-			st_fram(k1_5, S);
-			S.t1 = 0;
-			S.t0 = 0;
-		}
-		/* Определить знак S */
-		W = set_trit_setun(W, 1, sgn_trs(S));
-		C = next_address(C);
-	}
-	break;
-	case (-1 * 9 + 0 * 3 + 0):
-	{ // -00 : Ввод в Фа* - Вывод из Фа*
-		LOGGING_print(" k6..8[-00]: Ввод в Фа* - Вывод из Фа*\n");
-
-		trs_t fa;
-		if (LOGGING > 0)
-		{
-			view_short_reg(&k1_5, "k1_5");
-		}
-
-		int8_t s = get_trit_setun(k1_5, 1);
-		if (s == -1)
-		{
-			fa = smtr("----0");
-		}
-		else if (s == 1)
-		{
-			fa = smtr("+---0");
-		}
-		else
-		{
-			fa = smtr("0---0");
-		}
-
-		int8_t codeio = get_trit_setun(k1_5, 2) * 27 +
-						get_trit_setun(k1_5, 3) * 9 +
-						get_trit_setun(k1_5, 4) * 3 +
-						get_trit_setun(k1_5, 5);
-
-		/* Тип устройства ввода/вывода */
-		switch (codeio)
-		{
-		case (+0 * 27 + 0 * 9 + 0 * 3 + 1): /* Ввод с ФТ-1 в виде команд */
-			LOGGING_print("   k2..5[000+]: Ввод с ФТ-1 в виде команд\n");
-			Read_Commands_from_FT1(ptr1, fa);
-			break;
-		case (+0 * 27 + 0 * 9 + 1 * 3 + 0): /* Ввод с ФТ-2 в виде команд */
-			LOGGING_print("   k2..5[00+0]: Ввод с ФТ-2 в виде команд\n");
-			Read_Commands_from_FT2(ptr2, fa);
-			break;
-		case (+0 * 27 + 0 * 9 + 0 * 3 - 1): /* Ввод с ФТ-1 в виде символов */
-			LOGGING_print("   k2..5[000-]: Ввод с ФТ-1 в виде символов\n");
-			Read_Symbols_from_FT1(ptr1, fa);
-			break;
-		case (+0 * 27 + 0 * 9 - 1 * 3 + 0): /* Ввод с ФТ-2 в виде символов */
-			LOGGING_print("   k2..5[00-0]: Ввод с ФТ-2 в виде символов\n");
-			Read_Symbols_from_FT2(ptr2, fa);
-			break;
-		case (+1 * 27 + 0 * 9 + 0 * 3 + 0): /* Перфорация троичных кодов на Перфоратор ПЛ (Телетайп ТП) */
-			LOGGING_print("   k2..5[+000]: Перфорация троичных кодов на Перфоратор ПЛ (Телетайп ТП)\n");
-
-			for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
-			{
-				int32_t symbcode;
-				trs_t symb;
-				symb.l = 2;
-				//
-				MR = ld_fram(fa);
-
-				symb = slice_trs_setun(MR, 1, 1);
-				Perforation_Commands_to_PTP1(ptp1, symb);
-
-				symb = slice_trs_setun(MR, 2, 3);
-				Perforation_Commands_to_PTP1(ptp1, symb);
+}
 
-				symb = slice_trs_setun(MR, 4, 5);
-				Perforation_Commands_to_PTP1(ptp1, symb);
+/** *******************************************
+ *  Реалиазция виртуальной машины "Сетунь-1958"
+ *  -------------------------------------------
+ */
 
-				symb = slice_trs_setun(MR, 6, 7);
-				Perforation_Commands_to_PTP1(ptp1, symb);
+/* Время в секундах по монотонным часам */
+double time_monotonic(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-				symb = slice_trs_setun(MR, 8, 9);
-				Perforation_Commands_to_PTP1(ptp1, symb);
+/* Поставить команду в очередь, 0 - очередь заполнена */
+int emu_queue_push(emu_queue_t *q, const emu_cmd_t *c)
+{
+	uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+	uint32_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
 
-				fa = next_address(fa);
-			}
-			break;
-		case (-1 * 27 + 0 * 9 + 0 * 3 + 0): /* Перфорация в виде троичных символов на Перфоратор ПЛ (Телетайп ТП) */
-			LOGGING_print("   k2..5[-000]: Перфорация троичных символов на Перфоратор ПЛ (Телетайп ТП)\n");
+	if (head - tail == EMU_QUEUE_SIZE)
+	{
+		return 0;
+	}
+	q->slot[head & (EMU_QUEUE_SIZE - 1)] = *c;
+	atomic_store_explicit(&q->head, head + 1, memory_order_release);
+	return 1;
+}
 
-			for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
-			{
-				int32_t symbcode;
-				trs_t symb;
-				symb.l = 3;
-				//
-				MR = ld_fram(fa);
-				symb = slice_trs_setun(MR, 1, 3);
-				Perforation_Symbols_to_PTP1(ptp1, symb);
+/* Взять команду из очереди, 0 - очередь пуста */
+int emu_queue_pop(emu_queue_t *q, emu_cmd_t *c)
+{
+	uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+	uint32_t head = atomic_load_explicit(&q->head, memory_order_acquire);
 
-				symb = slice_trs_setun(MR, 4, 6);
-				Perforation_Symbols_to_PTP1(ptp1, symb);
+	if (head == tail)
+	{
+		return 0;
+	}
+	*c = q->slot[tail & (EMU_QUEUE_SIZE - 1)];
+	atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+	return 1;
+}
 
-				symb = slice_trs_setun(MR, 7, 9);
-				if (trs2digit(symb) == -13)
-					break;
-				Perforation_Symbols_to_PTP1(ptp1, symb);
+/**
+ * Общие таблицы всех машин: коды ввода-вывода, 5-тритные адреса,
+ * адреса FRAM, строки перфоленты, целочисленный режим и темп.
+ * Вызывается до запуска потоков, машины их только читают.
+ */
+void init_tables(void)
+{
+	init_tab4();
+	init_tab_addr5();
+	init_tab_fram_addr();
+	init_tab_row_key();
+	init_tab_native();
+	init_tab_pace();
+}
 
-				fa = next_address(fa);
-			}
-			break;
-		case (+0 * 27 + 1 * 9 + 0 * 3 + 0): /* Печать в виде команд на Пишущей машинке ПМ (ЭУМ-46) */
-			LOGGING_print("   k2..5[0+00]: Печать в виде команд на Пишущей машинке ПМ (ЭУМ-46)\n");
+/**
+ * Включение питания.
+ * Установить длины регистров и переключатели пишущей машинки,
+ * отключить устройства и очистить память
+ * виртуальной машины "Сетунь-1958"
+ */
+void init_setun_machine(setun_machine_t *m)
+{
+	memset(m, 0, sizeof(*m));
+
+	m->K.l = 9;
+	m->F.l = 5;
+	m->C.l = 5;
+	m->W.l = 1;
+	m->ph1.l = 1;
+	m->ph2.l = 1;
+	m->S.l = 18;
+	m->R.l = 18;
+	m->MB.l = 4;
+	m->MR.l = 9;
+	m->TMP.l = 36;
+
+	m->russian_latin_sw = 1;
+	m->letter_number_sw = 0;
+	m->color_sw = 0;
+
+	m->path_ptr1 = "ptr1/paper.txt";
+	m->path_ptr2 = "ptr2/paper.txt";
+	m->path_ptp1 = "ptp1/paper.txt";
+	m->path_tty1 = "tty1/printout.txt";
+	m->tty_echo = stdout;
+	m->ptp_fmt = PTP_FORMAT;
+
+	init_tab_addr5();
+	init_tab_fram_addr();
+	reset_setun_1958(m);
+}
 
-			uint8_t current = letter_number_sw;
-			letter_number_sw = 1; /* цифровой регистр */
+/**
+ * Аппаратный сброс.
+ * Очистить память и регистры
+ * виртуальной машины "Сетунь-1958"
+ */
+void reset_setun_1958(setun_machine_t *m)
+{
+	clean_fram(m); /* Очистить  FRAM */
+	clean_drum(m); /* Очистить  DRUM */
+}
 
-			for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
-			{
-				int32_t symbcode;
-				trs_t symb;
-				symb.l = 3;
-				//
-				MR = ld_fram(fa);
+/**
+ * Вернуть модифицированное K(1:9) для выполнения операции "Сетунь-1958"
+ * (потритно, для проверки таблиц)
+ */
+trs_t control_trs_ref(setun_machine_t *m, trs_t a)
+{
+	int8_t k9;
+	trs_t k1_5;
+	trs_t cn;
 
-				symb = slice_trs_setun(MR, 1, 1);
-				Write_Commands_to_TTY1(tty1, symb);
+	clear(&cn);
 
-				symb = slice_trs_setun(MR, 2, 3);
-				Write_Commands_to_TTY1(tty1, symb);
+	/* Адресная часть K(9) */
+	k1_5 = slice_trs_setun(a, 1, 5);
 
-				symb = slice_trs_setun(MR, 4, 5);
-				Write_Commands_to_TTY1(tty1, symb);
+	/* Признак модификации адремной части K(9) */
+	k9 = get_trit_setun(a, 9);
 
-				symb = slice_trs_setun(MR, 6, 7);
-				Write_Commands_to_TTY1(tty1, symb);
+	/* Модицикация адресной части K(1:5) */
+	if (k9 > 0)
+	{ /* A(1:5) = A(1:5) + F(1:5) */
+		k1_5 = add_trs(k1_5, m->F);
+		mod_3_n(&k1_5, 5);
+	}
+	else if (k9 < 0)
+	{ /* A(1:5) = A(1:5) - F(1:5) */
+		k1_5 = sub_trs(k1_5, m->F);
+		mod_3_n(&k1_5, 5);
+	}
+	else
+	{	/*  A(1:5) = A(1:5) */
+		/* Без изменений    */
+	}
 
-				symb = slice_trs_setun(MR, 8, 9);
-				Write_Commands_to_TTY1(tty1, symb);
+	cn = shift_trs(k1_5, 4);
+	cn.l = 9;
 
-				symb = smtr("-0-");
-				Write_Commands_to_TTY1(tty1, symb);
+	a = slice_trs_setun(a, 6, 9);
 
-				fa = next_address(fa);
-			}
-			letter_number_sw = current; /* вернуть регистр */
-			break;
-		case (+0 * 27 - 1 * 9 + 0 * 3 + 0): /* Печать одним цветом в виде символов на пишущей машинке ПМ (ЭУМ-46) */
-			LOGGING_print("   k2..5[0-00]: Печать одним цветом в виде символов на пишущей машинке ПМ (ЭУМ-46)\n");
+	cn = add_trs(a, cn);
+	cn.l = 9;
 
-			for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
-			{
-				int32_t symbcode;
-				trs_t symb;
-				symb.l = 3;
-				//
-				MR = ld_fram(fa);
+	return cn;
+}
 
-				symb = slice_trs_setun(MR, 1, 3);
-				Write_Symbols_to_TTY1(tty1, symb);
+/**
+ * Вернуть модифицированное K(1:9) для выполнения операции "Сетунь-1958"
+ */
+trs_t control_trs(setun_machine_t *m, trs_t a)
+{
+	int8_t k9;
+	uint8_t ia;
+	trs_t k1_5;
+	trs_t cn;
 
-				symb = slice_trs_setun(MR, 4, 6);
-				Write_Symbols_to_TTY1(tty1, symb);
+	/* Адресная часть K(1:5) */
+	ia = TRS5_IND(slice_trs_setun(a, 1, 5));
 
-				symb = slice_trs_setun(MR, 7, 9);
-				if (trs2digit(symb) == -13)
-					break;
-				Write_Symbols_to_TTY1(tty1, symb);
+	/* Признак модификации адремной части K(9) */
+	k9 = get_trit_setun(a, 9);
 
-				fa = next_address(fa);
-			}
-			break;
-		case (+1 * 27 - 1 * 9 + 0 * 3 + 0): /* Печать в виде символов на Пишущей машинке ПМ (ЭУМ-46) */
-			LOGGING_print("   k2..5[+-00]: Печать в виде символов на пишущей машинке ПМ (ЭУМ-46)\n");
-			for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
-			{
-				int32_t symbcode;
-				trs_t symb;
-				symb.l = 3;
-				//
-				MR = ld_fram(fa);
+	/* Модицикация адресной части A(1:5) = A(1:5) +/- F(1:5) */
+	if (k9 > 0)
+	{
+		ia = add_ind5(ia, TRS5_IND(m->F));
+	}
+	else if (k9 < 0)
+	{
+		ia = add_ind5(ia, TRS5_NEG(TRS5_IND(m->F)));
+	}
+	k1_5 = tab_trs5[ia];
 
-				symb = slice_trs_setun(MR, 1, 3);
-				Write_Symbols_to_TTY1(tty1, symb);
+	/* K(1:5) и K(6:9) без изменений */
+	cn.l = 9;
+	cn.t1 = (k1_5.t1 << 4) | (a.t1 & a.t0 & 0xF);
+	cn.t0 = (k1_5.t0 << 4) | (a.t0 & 0xF);
 
-				symb = slice_trs_setun(MR, 4, 6);
-				Write_Symbols_to_TTY1(tty1, symb);
+	return cn;
+}
 
-				symb = slice_trs_setun(MR, 7, 9);
-				if (trs2digit(symb) == -13)
-					break;
-				Write_Symbols_to_TTY1(tty1, symb);
-				fa = next_address(fa);
-			}
-			break;
-		default: /* Ошибка: Не поддерживается устройвтво ввода/вывода */
-			return STOP_ERROR;
-			break;
+/******************************************************************************************
+					Таблица операций машина "Сетунь-1958"
+-------------------------------------------------------------------------------------------
+Код(троичный)	Код			Название операции			W		Содержание команды
+-------------------------------------------------------------------------------------------
++00	30			9			Посылка в S					w(S)	(A*)=>(S)
++0+	33			10			Сложение в S				w(S)	(S)+(A*)=>(S)
++0-	3X			8			Вычитание в S				w(S)	(S)-(A*)=>(S)
+++0	40			12			Умножение 0					w(S)	(S)=>(R); S=0; (A*)(R)=>(S)
++++	43			13			Умножение +					w(S)	(S)+(A*)(R)=>(S)
+++-	4X			11			Умножение -					w(S)	(A*)+(S)(R)=>(S)
++-0	20			6			Поразрядное умножение		w(S)	(A*)[x](S)=>(S)
++-+	23			7			Посылка в R					w(R)	(A*)=>(R)
++--	2X			5			Останов	Стоп;				w(R)	STOP; (A*)=>(C)
+0+0	10			3			Условный переход 0			-		A*=>(C) при w=0
+0++	13			4			Условный переход +			-		A*=>(C) при w=+
+0+-	1X			2			Условный переход -			-		A*=>(C) при w=-
+000	00			0			Безусловный переход			-		A*=>(C)
+00+	03			1			Запись из C					-		(C)=>(A*)
+00-	0X			-1			Запись из F					w(F)	(F)=>(A*)
+0-0	Z0			-3			Посылка в F					w(F)	(A*)=>(F)
+0--	ZX			-4			Сложение в F				w(F)	(F)+(A*)=>(F)
+0-+	Z3			-2			Сложение в F c (C)			w(F)	(C)+(A*)=>(F)
+-+0	Y0			-6			Сдвиг (S) на S				w(S)	(A*)=>(S)
+-++	Y3			-5			Запись из S					w(S)	(S)=>(A*)
+-+-	YX			-7			Нормализация				w(S)	Норм.(S)=>(A*); (N)=>(S)
+-00	X0			-9			Вывод-ввод Ввод в Фа*.		-		Вывод из Фа*
+-0+ X3			-8			Запись на МБ				-		(Фа*)=>(Мд*)
+-0- XX			-10			Считывание с МБ				-		(Мд*)=>(Фа*)
+--0	W0			-12			Не задействована					Аварийный стоп
+--+	W3			-11			Не задействована					Аварийный стоп
+---	WX			-13			Не задействована					Аварийный стоп
+-----------------------------------------------------------------------------------------*/
+
+/**
+ * Выполнить операцию K(1:9) машины "Сетунь-1958"
+ */
+int8_t execute_trs(setun_machine_t *m, trs_t addr, trs_t oper)
+{
+	// TODO проверить выполнение команды
+	// для С(5) = -1 выполнить 2-раза старшей половине A(9:18) и сделать inc C
+
+	trs_t k1_5;		 /* K(1:5)	*/
+	trs_t k6_8;		 /* K(6:8)	*/
+	trs_t opd;		 /* A* для команд S и R */
+	int8_t codeoper; /* Код операции */
+
+	/* Адресная часть */
+	k1_5 = slice_trs_setun(addr, 1, 5);
+	k1_5.l = 5;
+
+	/* Код операции */
+	k6_8 = oper;
+	k6_8.l = 3;
+
+	codeoper = get_trit_setun(k6_8, 1) * 9 +
+			   get_trit_setun(k6_8, 2) * 3 +
+			   get_trit_setun(k6_8, 3);
+
+	/* ---------------------------------------
+	 *  Выполнить операцию машины "Сетунь-1958"
+	 *  ---------------------------------------
+	 */
+
+	/*
+	 * Описание реализации команд машины «Сетунь»
+	 *
+	 * 5-разрядный регистр управления С, в котором содержится адрес
+	 * выполняемой команды, после выполнения каждой команды в регистре С
+	 * формируется адрес следующей команды причём за командой являющейся первой
+	 * коротким кодом какой-либо ячейки, следует­ команда, являющаяся вторым
+	 * коротким кодом этой ячейки, а вслед за ней — ко­манда, являющаяся первым
+	 * коротким кодом следующей ячейки, и т. д.;
+	 * этот порядок может быть нарушен при выполнении команд
+	 * перехода.
+	 *
+	 * При выполнении команд, использую­щих регистры F и С, операции производятся
+	 * над 5-разрядными кодами, которые можно рассматривать как целые числа.
+	 * При выборке из памяти 5-разрядный код рассматривается как старшие пять разрядов
+	 * соответст­вующего короткого или длинного кода, при запоминании в ячейке
+	 * па­мяти 5-разрядный код записывается в старшие пять разрядов и допол­няется
+	 * до соответствующего короткого или длинного кода записью нулей в остальные разряды.
+	 *
+	 * При выполнении команд, использующих регистры S и R, выбираемые из памяти короткие коды
+	 * рассматриваются как длин­ные с добавлением нулей в девять младших разрядов, а в оперативную
+	 * память в качестве короткого кода записывается содержимое девяти старших разрядов регистра S
+	 * (запись в оперативную память непосред­ственно из регистра R невозможна).
+	 *
+	 * После выполнения каждой команды вырабатывается значение неко­торого признака W = W(X) {-1,0,1},
+	 * где X — обозначение какого-либо регистра, или сохраняется предыду­щее значение этого признака.
+	 *
+	 * Команды условного перехода выполняются по-разному в зависимости от значения этого признака W.
+	 *
+	 * При выполнении операций сложения, вычитания и умножения, использующих регистр S,
+	 * может произойти останов машины по переполнению, если результат выполнения
+	 * этой опе­рации, посылаемый в регистр S, окажется по модулю больше 4,5 .
+	 *
+	 * Операция сдвига производит сдвиг содержимого регистра S на |N|-разрядов, где N рассматривается
+	 * как 5-разрядный код, хранящийся в ячейке A*, т.е. N = (А*). Сдвиг производится влево при N > 0 и
+	 * вправо при N < 0. При N = 0 содержимое регистра S не изменяется.
+	 *
+	 * Операция нормализации производит сдвиг (S) при (S) != 0 в таком направлении и на такое число
+	 * разрядов |N|, чтобы результат, посылаемый в ячейку A*, был но модулю больше 1/2 , но меньше 3/2,
+	 * т.е. чтобы в двух старших разрядах результата была записана комбинация троичных цифр 01 или 0-1.
+	 * При этом в регистр S посылается число N (5-разрядный код), знак которого определяется
+	 * направлением сдвига, а именно: N > 0 при сдвиге вправо и N < 0 при сдвиге влево. При (S) = 0 или при
+	 * 1/2 <|(S)| < 3/2 в ячейку А* посылается (S), а в регистр S посылается N = 0.
+	 *
+	 * Остальные операции, содержащиеся в табл. 1, ясны без дополни­тельных пояснений.
+	 *
+	 */
+	if (LOGGING > 0)
+	{
+		view_step_new_addres(m, &k1_5, "A*");
+	}
+
+	switch (codeoper)
+	{
+	case (+1 * 9 + 0 * 3 + 0):
+	{ // +00 : Посылка в S	(A*)=>(S)
+		LOGGING_print(" k6..8[+00]: (A*)=>(S)\n");
+		opd = fetch_operand(m, k1_5);
+		copy_trs_setun(&opd, &m->S);
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->S));
+		m->C = next_address(m->C);
+	}
+	break;
+	case (+1 * 9 + 0 * 3 + 1):
+	{ // +0+ : Сложение в S	(S)+(A*)=>(S)
+		LOGGING_print(" k6..8[+0+]: (S)+(A*)=>(S)\n");
+		opd = fetch_operand(m, k1_5);
+		m->S = add_trs(m->S, opd);
+		mod_3_n(&m->S, m->S.l); /* очистить неиспользованные триты */
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->S));
+		if (over_check(m) > 0)
+		{
+			goto error_over;
 		}
-		LOGGING_print("\n");
-		C = next_address(C);
+		m->C = next_address(m->C);
 	}
 	break;
-	case (-1 * 9 + 0 * 3 + 1):
-	{ // -0+ : Запись на МБ	(Фа*)=>(Мд*)
-		LOGGING_print(" k6..8[-0+]: (Фа*)=>(Мд*)\n");
-		int32_t zone = trs2digit(slice_trs_setun(k1_5, 2, 5));
-		if ((zone < ZONE_DRUM_BEG) || (zone > ZONE_DRUM_END))
+	case (+1 * 9 + 0 * 3 - 1):
+	{ // +0- : Вычитание в S	(S)-(A*)=>(S)
+		LOGGING_print(" k6..8[+0-]: (S)-(A*)=>(S)\n");
+		opd = fetch_operand(m, k1_5);
+		m->S = sub_trs(m->S, opd);
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->S));
+		if (over_check(m) > 0)
 		{
-			return STOP_ERROR_MB_NUMBER;
+			goto error_over;
 		}
-		else
+		m->C = next_address(m->C);
+	}
+	break;
+	case (+1 * 9 + 1 * 3 + 0):
+	{ // ++0 : Умножение +	(S)=>(R); S=0; (A*)(R)=>(S)
+		LOGGING_print(" k6..8[++0]: (S)=>(R); S=0; (A*)(R)=>(S)\n");
+		copy_trs_setun(&m->S, &m->R);
+		m->S.t1 = 0;
+		m->S.t0 = 0;
+		opd = fetch_operand(m, k1_5);
+		trs_t temp = mul_trs(opd, m->R);
+		mod_3_n(&temp, 18);
+		copy_trs_setun(&temp, &m->S);
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->S));
+		if (over_check(m) > 0)
 		{
-			fram_to_drum(slice_trs_setun(k1_5, 1, 5));
-			MB = slice_trs_setun(k1_5, 2, 5);
-			mod_3_n(&MB, 4); /* очистить неиспользованные триты */
+			goto error_over;
 		}
-		C = next_address(C);
+		m->C = next_address(m->C);
 	}
 	break;
-	case (-1 * 9 + 0 * 3 - 1):
-	{ // -0- : Считывание с МБ	(Мд*)=>(Фа*)
-		LOGGING_print(" k6..8[-0-]: (Мд*)=>(Фа*)\n");
-		int32_t zone = trs2digit(slice_trs_setun(k1_5, 2, 5));
-		if (zone == 0)
+	case (+1 * 9 + 1 * 3 + 1):
+	{ // +++ : Умножение +	(S)+(A*)(R)=>(S)
+		LOGGING_print(" k6..8[+++]: (S)+(A*)(R)=>(S)\n");
+		opd = fetch_operand(m, k1_5);
+		trs_t temp = slice_trs(mul_trs(opd, m->R), 0, 17);
+		m->S = add_trs(temp, m->S);
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->S));
+		if (over_check(m) > 0)
 		{
-			clean_fram_zone(slice_trs_setun(k1_5, 1, 1));
+			goto error_over;
 		}
-		else if ((zone < ZONE_DRUM_BEG) || (zone > ZONE_DRUM_END))
+		m->C = next_address(m->C);
+	}
+	break;
+	case (+1 * 9 + 1 * 3 - 1):
+	{ // ++- : Умножение - (A*)+(S)(R)=>(S)
+		LOGGING_print(" k6..8[++-]: (A*)+(S)(R)=>(S)\n");
+		opd = fetch_operand(m, k1_5);
+		trs_t temp = mul_trs(m->S, m->R);
+		m->S = add_trs(slice_trs(temp, 0, 17), opd);
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->S));
+		if (over_check(m) > 0)
 		{
-			return STOP_ERROR_MB_NUMBER;
+			goto error_over;
+		}
+		m->C = next_address(m->C);
+	}
+	break;
+	case (+1 * 9 - 1 * 3 + 0):
+	{ // +-0 : Поразрядное умножение	(A*)[x](S)=>(S)
+		LOGGING_print(" k6..8[+-0]: (A*)[x](S)=>(S)\n");
+		opd = fetch_operand(m, k1_5);
+		m->S = and_trs(opd, m->S);
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->S));
+		m->C = next_address(m->C);
+	}
+	break;
+	case (+1 * 9 - 1 * 3 + 1):
+	{ // +-+ : Посылка в R	(A*)=>(R)
+		LOGGING_print(" k6..8[+-+]: (A*)=>(R)\n");
+		opd = fetch_operand(m, k1_5);
+		copy_trs_setun(&opd, &m->R);
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->S));
+		m->C = next_address(m->C);
+	}
+	break;
+	case (+1 * 9 - 1 * 3 - 1):
+	{ // +-- : Останов	Стоп; (A*)=>(R)
+		LOGGING_print(" k6..8[+--]: STOP (A*)=>(R)\n");
+		opd = fetch_operand(m, k1_5);
+		copy_trs_setun(&opd, &m->R);
+
+		return STOP;
+	}
+	break;
+	case (+0 * 9 + 1 * 3 + 0):
+	{ // 0+0 : Условный переход -	A*=>(C) при w=0
+		LOGGING_print(" k6..8[0+0]: A*=>(C) при w=0\n");
+		int8_t w;
+		w = sgn_trs(m->W);
+		if (w == 0)
+		{
+			copy_trs_setun(&k1_5, &m->C);
 		}
 		else
 		{
-			drum_to_fram(slice_trs_setun(k1_5, 1, 5));
+			m->C = next_address(m->C);
 		}
-		MB = slice_trs_setun(k1_5, 2, 5);
-		mod_3_n(&MB, 4); /* очистить неиспользованные триты */
-		C = next_address(C);
 	}
 	break;
-	case (-1 * 9 - 1 * 3 + 0):
-	{ // --0 : Не задействована	Стоп
-		LOGGING_print(" k6..8[--0]: STOP BREAK\n");
-		view_short_reg(&k6_8, "k6..8=");
-		return STOP_ERROR;
+	case (+0 * 9 + 1 * 3 + 1):
+	{ // 0++ : Условный переход -	A*=>(C) при w=0
+		LOGGING_print(" k6..8[0++]: A*=>(C) при w=+1\n");
+		int8_t w;
+		w = sgn_trs(m->W);
+		if (w > 0)
+		{
+			copy_trs_setun(&k1_5, &m->C);
+		}
+		else
+		{
+			m->C = next_address(m->C);
+		}
 	}
 	break;
-	case (-1 * 9 - 1 * 3 + 1):
-	{ // --+ : Не задействована	Стоп
-		LOGGING_print(" k6..8[--+]: STOP BREAK\n");
-		view_short_reg(&k6_8, "k6..8=");
-		return STOP_ERROR;
+	case (+0 * 9 + 1 * 3 - 1):
+	{ // 0+- : Условный переход -	A*=>(C) при w=-
+		LOGGING_print(" k6..8[0+-]: A*=>(C) при w=-1\n");
+		int8_t w;
+		w = sgn_trs(m->W);
+		if (w < 0)
+		{
+			copy_trs_setun(&k1_5, &m->C);
+		}
+		else
+		{
+			m->C = next_address(m->C);
+		}
 	}
 	break;
-	case (-1 * 9 - 1 * 3 - 1):
-	{ // --- : Не задействована	Стоп
-		LOGGING_print(" k6..8[---]: STOP BREAK\n");
-		view_short_reg(&k6_8, "k6..8=");
-		return STOP_ERROR;
+	case (+0 * 9 + 0 * 3 + 0):
+	{ //  000 : Безусловный переход	A*=>(C)
+		LOGGING_print(" k6..8[000]: A*=>(C)\n");
+		copy_trs_setun(&k1_5, &m->C);
+		m->C.l = 5;
 	}
 	break;
-	default:
-	{ // Не допустимая команда машины
-		LOGGING_print("k6..8 =[]   : STOP! NO OPERATION\n");
-		view_short_reg(&k6_8, "k6..8=");
-		return STOP_ERROR;
+	case (+0 * 9 + 0 * 3 + 1):
+	{ // 00+ : Запись из C	(C)=>(A*)
+		LOGGING_print(" k6..8[00+]: (C)=>(A*)\n");
+		if (get_trit_setun(k1_5, 5) < 0)
+		{
+			m->MR.l = 18;
+			copy_trs_setun(&m->C, &m->MR);
+		}
+		else
+		{
+			m->MR.l = 9;
+			copy_trs_setun(&m->C, &m->MR);
+		}
+		st_fram(m, k1_5, m->MR);
+		m->C = next_address(m->C);
 	}
 	break;
+	case (+0 * 9 + 0 * 3 - 1):
+	{ // 00- : Запись из F	(F)=>(A*)
+		LOGGING_print(" k6..8[00-]: (F)=>(A*)\n");
+		if (get_trit_setun(k1_5, 5) < 0)
+		{
+			m->MR.l = 18;
+			copy_trs_setun(&m->F, &m->MR);
+		}
+		else
+		{
+			m->MR.l = 9;
+			copy_trs_setun(&m->F, &m->MR);
+		}
+		st_fram(m, k1_5, m->MR);
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->F));
+		m->C = next_address(m->C);
 	}
-
-	if (LOGGING > 0)
-	{
-		view_short_regs();
+	break;
+	case (+0 * 9 - 1 * 3 + 0):
+	{ // 0-0 : Посылка в F	(A*)=>(F)
+		LOGGING_print(" k6..8[0-0]: (A*)=>(F)\n");
+		m->MR = ld_fram(m, k1_5);
+		mod_3_n(&m->MR, m->MR.l); /* очистить неиспользованные триты */
+		copy_trs_setun(&m->MR, &m->F);
+		m->F = slice_trs_setun(m->MR, 1, 5);
+		m->F.l = 5;
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->F));
+		m->C = next_address(m->C);
 	}
+	break;
+	case (+0 * 9 - 1 * 3 + 1):
+	{ // 0-+ : Сложение в F c (C)	(C)+(A*)=>F
+		LOGGING_print(" k6..8[0-+]: (C)+(A*)=>F\n");
+		m->MR = ld_fram(m, k1_5);
+		mod_3_n(&m->MR, m->MR.l); /* очистить неиспользованные триты */
+		m->MR = slice_trs_setun(m->MR, 1, 5);
+		mod_3_n(&m->MR, 5);
+		m->F = add_trs(m->C, m->MR);
 
-	return OK;
-
-error_over:
-	return STOP_ERROR;
-}
-
-
-/* **********************************************************************************
- * Тестирование функций операций с тритами
- * ----------------------------------------------------------------------------------
- */
-void pl(int8_t a, int8_t c)
-{
-	printf(" a,c {% 2i}->% 2i\r\n", a, c);
-}
-void p(int8_t a, int8_t b, int8_t c)
-{
-	printf(" a,b,c {% 2i,% 2i}->% 2i\r\n", a, b, c);
-}
-void pp(int8_t a, int8_t b, int8_t c, int8_t p0, int8_t p1)
-{
-	printf(" a,b,p0,c,p1 {% 2i,% 2i,% 2i}->% 2i,% 2i\r\n", a, b, p0, c, p1);
-}
-
-void Test1_Ariphmetic_Ternary(void)
-{
-
-	int8_t a, b, c, p0, p1;
-
-	printf("\r\n --- TEST #1  Logic opertion trits  for VM SETUN-1958 --- \r\n\r\n");
-
-	printf(" 1.1. Логическая операция NOT\r\n");
-	printf(" C = NOT A \r\n");
-
-	for (a = -1; a < 2; a++)
-	{
-		not_t(&a, &c);
-		pl(a, c);
+		mod_3_n(&m->F, 5); /* очистить неиспользованные триты */
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->F));
+		m->C = next_address(m->C);
 	}
-
-	printf(" 1.2. Логическая операция AND\r\n");
-	printf(" C = A AND B \r\n");
-	for (a = -1; a < 2; a++)
-	{
-		for (b = -1; b < 2; b++)
+	break;
+	case (+0 * 9 - 1 * 3 - 1):
+	{ // 0-- : Сложение в F	(F)+(A*)=>(F)
+		LOGGING_print(" k6..8[0--]: (F)+(A*)=>(F)\n");
+		m->MR = ld_fram(m, k1_5);
+		mod_3_n(&m->MR, m->MR.l); /* очистить неиспользованные триты */
+		m->MR = slice_trs_setun(m->MR, 1, 5);
+		m->MR.l = 5;
+		m->F = add_trs(m->F, m->MR);
+		mod_3_n(&m->F, 5); /* очистить неиспользованные триты */
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->F));
+		m->C = next_address(m->C);
+	}
+	break;
+	case (-1 * 9 + 1 * 3 + 0):
+	{ // -+0 : Сдвиг	Сдвиг (S) на (A*)=>(S)
+		LOGGING_print(" k6..8[-+0]: Сдвиг (S) на (A*)=>(S)\n");
+		/*
+		 * Операция сдвига производит сдвиг содержимого регистра S на N
+		 * разрядов, где N рассматривается как 5-разрядный код, хранящийся в
+		 * ячейке А*, т. е. N = (А*). Сдвиг производится влево при N > 0 и вправо
+		 * при N < 0. При N = 0 содержимое регистра S не изменяется.
+		 */
+		m->MR = ld_fram(m, k1_5);
+		mod_3_n(&m->MR, m->MR.l); /* очистить неиспользованные триты */
+		m->S = shift_trs(m->S, trs2digit(slice_trs_setun(m->MR, 1, 5)));
+		mod_3_n(&m->S, 18); /* очистить неиспользованные триты */
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->S));
+		m->C = next_address(m->C);
+	}
+	break;
+	case (-1 * 9 + 1 * 3 + 1):
+	{ // -++ : Запись из S	(S)=>(A*)
+		LOGGING_print(" k6..8[-++]: (S)=>(A*)\n");
+		st_fram(m, k1_5, m->S);
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->S));
+		m->C = next_address(m->C);
+	}
+	break;
+	case (-1 * 9 + 1 * 3 - 1):
+	{ // -+- : Нормализация	Норм.(S)=>(A*); (N)=>(S)
+		LOGGING_print(" k6..8[-+-]: Норм.(S)=>(A*); (N)=>(S)\n");
+		/*
+		 * Операция нормализации производит сдвиг (S) при (S) != 0 в таком направлении и на такое число
+		 * разрядов |N|, чтобы результат, посылаемый в ячейку A*, был но модулю больше 1/2 , но меньше 3/2,
+		 * т.е. чтобы в двух старших разрядах результата была записана комбинация троичных цифр 01 или 0-1.
+		 * При этом в регистр S посылается число N (5-разрядный код), знак которого определяется
+		 * направлением сдвига, а именно: N > 0 при сдвиге вправо и N < 0 при сдвиге влево. При (S) = 0 или при
+		 * 1/2 <|(S)| < 3/2 в ячейку А* посылается (S), а в регистр S посылается N = 0.
+		 */
+		mod_3_n(&m->S, 18); /* очистить неиспользованные триты */
+		if (m->S.t0 != 0)
 		{
-			and_t(&a, &b, &c);
-			p(a, b, c);
+			/* Сдвиг S */
+			if (get_trit_setun(m->S, 1) != 0)
+			{
+				m->S = shift_trs(m->S, -1); /* сдвиг вправо */
+				st_fram(m, k1_5, m->S);
+				m->S.t1 = 0;
+				m->S.t0 = 0;
+				inc_trs(&m->S);
+				m->S = shift_trs(m->S, 13);
+			}
+			else if (get_trit_setun(m->S, 2) == 0)
+			{
+				uint8_t n = 0;
+				for (uint8_t i = 0; i < 16; i++)
+				{
+					m->S = shift_trs(m->S, 1);
+					n++;
+					if (get_trit_setun(m->S, 2) != 0)
+					{
+						break;
+					}
+				}
+				st_fram(m, k1_5, m->S);
+				m->S.t1 = 0;
+				m->S.t0 = 0;
+				for (uint8_t i = 0; i < n; i++)
+				{
+					dec_trs(&m->S);
+				}
+				m->S = shift_trs(m->S, 13);
+			}
+			else
+			{
+				st_fram(m, k1_5, m->S);
+				m->S.t1 = 0;
+				m->S.t0 = 0;
+			}
+		}
+		else
+		{
+			/* S == 0 */
+			st_fram(m, k1_5, m->S);
+			m->S.t1 = 0;
+			m->S.t0 = 0;
 		}
+		/* Определить знак S */
+		m->W = set_trit_setun(m->W, 1, sgn_trs(m->S));
+		m->C = next_address(m->C);
 	}
+	break;
+	case (-1 * 9 + 0 * 3 + 0):
+	{ // -00 : Ввод в Фа* - Вывод из Фа*
+		m->io_count++;
+		LOGGING_print(" k6..8[-00]: Ввод в Фа* - Вывод из Фа*\n");
 
-	printf(" 1.2. Логическая операция OR\r\n");
-	printf(" C = A OR B \r\n");
-	for (a = -1; a < 2; a++)
-	{
-		for (b = -1; b < 2; b++)
+		trs_t fa;
+		if (LOGGING > 0)
 		{
-			or_t(&a, &b, &c);
-			p(a, b, c);
+			view_short_reg(&k1_5, "k1_5");
 		}
-	}
 
-	printf(" 1.3. Логическая операция XOR\r\n");
-	printf(" C = A XOR B \r\n");
-	for (a = -1; a < 2; a++)
-	{
-		for (b = -1; b < 2; b++)
+		int8_t s = get_trit_setun(k1_5, 1);
+		if (s == -1)
 		{
-			xor_t(&a, &b, &c);
-			p(a, b, c);
+			fa = smtr("----0");
+		}
+		else if (s == 1)
+		{
+			fa = smtr("+---0");
+		}
+		else
+		{
+			fa = smtr("0---0");
 		}
-	}
 
-	printf(" 1.4. Логическая операция SUM FULL\r\n");
-	printf(" C, P1 = A + B + P0 \r\n");
-	for (a = -1; a < 2; a++)
-	{
-		for (b = -1; b < 2; b++)
+		int8_t codeio = get_trit_setun(k1_5, 2) * 27 +
+						get_trit_setun(k1_5, 3) * 9 +
+						get_trit_setun(k1_5, 4) * 3 +
+						get_trit_setun(k1_5, 5);
+
+		/* Тип устройства ввода/вывода */
+		switch (codeio)
 		{
-			for (p0 = -1; p0 < 2; p0++)
+		case (+0 * 27 + 0 * 9 + 0 * 3 + 1): /* Ввод с ФТ-1 в виде команд */
+			LOGGING_print("   k2..5[000+]: Ввод с ФТ-1 в виде команд\n");
+			Read_Commands_from_FT1(m, m->ptr1, fa);
+			break;
+		case (+0 * 27 + 0 * 9 + 1 * 3 + 0): /* Ввод с ФТ-2 в виде команд */
+			LOGGING_print("   k2..5[00+0]: Ввод с ФТ-2 в виде команд\n");
+			Read_Commands_from_FT2(m, m->ptr2, fa);
+			break;
+		case (+0 * 27 + 0 * 9 + 0 * 3 - 1): /* Ввод с ФТ-1 в виде символов */
+			LOGGING_print("   k2..5[000-]: Ввод с ФТ-1 в виде символов\n");
+			Read_Symbols_from_FT1(m, m->ptr1, fa);
+			break;
+		case (+0 * 27 + 0 * 9 - 1 * 3 + 0): /* Ввод с ФТ-2 в виде символов */
+			LOGGING_print("   k2..5[00-0]: Ввод с ФТ-2 в виде символов\n");
+			Read_Symbols_from_FT2(m, m->ptr2, fa);
+			break;
+		case (+1 * 27 + 0 * 9 + 0 * 3 + 0): /* Перфорация троичных кодов на Перфоратор ПЛ (Телетайп ТП) */
+			LOGGING_print("   k2..5[+000]: Перфорация троичных кодов на Перфоратор ПЛ (Телетайп ТП)\n");
+			Perforation_Zone_to_PTP1(m, fa, 0);
+			break;
+		case (-1 * 27 + 0 * 9 + 0 * 3 + 0): /* Перфорация в виде троичных символов на Перфоратор ПЛ (Телетайп ТП) */
+			LOGGING_print("   k2..5[-000]: Перфорация троичных символов на Перфоратор ПЛ (Телетайп ТП)\n");
+			Perforation_Zone_to_PTP1(m, fa, 1);
+			break;
+		case (+0 * 27 + 1 * 9 + 0 * 3 + 0): /* Печать в виде команд на Пишущей машинке ПМ (ЭУМ-46) */
+			LOGGING_print("   k2..5[0+00]: Печать в виде команд на Пишущей машинке ПМ (ЭУМ-46)\n");
+
+			uint8_t current = m->letter_number_sw;
+			m->letter_number_sw = 1; /* цифровой регистр */
+
+			for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
 			{
-				sum_t(&a, &b, &p0, &c, &p1);
-				pp(a, b, c, p0, p1);
-			}
-		}
-	}
-	printf("\n --- END TEST #1 --- \r\n");
-}
+				int32_t symbcode;
+				trs_t symb;
+				symb.l = 3;
+				//
+				m->MR = ld_fram(m, fa);
 
-/** *********************************************
- *  Тестирование функций операций с тритами
- *  ---------------------------------------------
- */
-void pt(int8_t t, uint8_t p)
-{
-	printf("t[% 2i]=% 2i\r\n", p, t);
-}
-void pln(int8_t l)
-{
-	printf("TRIT-%02i : ", l);
-}
-void Test2_Opers_TRITS_32(void)
-{
-	int8_t trit; // трит
-	trs_t tr1;	 // троичное число
-	trs_t tr2;	 // троичное число
+				symb = slice_trs_setun(m->MR, 1, 1);
+				Write_Commands_to_TTY1(m, m->tty1, symb);
 
-	printf("\r\n --- TEST #2  Operations TRITS-32 for VM SETUN-1958 --- \r\n");
+				symb = slice_trs_setun(m->MR, 2, 3);
+				Write_Commands_to_TTY1(m, m->tty1, symb);
 
-	// t2.1 POW3
-	printf("\r\nt2.1 --- POW3(...)\r\n");
-	printf("pow3(3)  = %d\r\n", (int32_t)pow3(3));
-	printf("pow3(18) = %d\r\n", (int32_t)pow3(18));
+				symb = slice_trs_setun(m->MR, 4, 5);
+				Write_Commands_to_TTY1(m, m->tty1, symb);
 
-	// t2.2 Point address
-	printf("\r\nt2.2 --- Point address\r\n");
-	addr pMem;
-	pMem = 0xffffffff;
-	printf("pMem = 0xffffffff [%ji]\r\n", pMem);
+				symb = slice_trs_setun(m->MR, 6, 7);
+				Write_Commands_to_TTY1(m, m->tty1, symb);
 
-	// t2.3
-	printf("\r\nt2.3 --- TRIT-32\r\n");
-	clear_full(&tr1);
-	tr1.l = 1;
-	tr1.t1 = ~0;
-	tr1.t0 = 1;
-	pln(1);
-	view_short_reg(&tr1, "tr1");
-	tr1.t0 = 1 << 4;
-	pln(5);
-	tr1.l = 5;
-	view_short_reg(&tr1, "tr1");
-	tr1.t0 = 1 << 8;
-	pln(9);
-	tr1.l = 9;
-	view_short_reg(&tr1, "tr1");
-	tr1.t0 = 1 << 17;
-	pln(18);
-	tr1.l = 18;
-	view_short_reg(&tr1, "tr1");
-	tr1.t0 = 1 << 31;
-	pln(32);
-	tr1.l = 32;
-	view_short_reg(&tr1, "tr1");
+				symb = slice_trs_setun(m->MR, 8, 9);
+				Write_Commands_to_TTY1(m, m->tty1, symb);
 
-	// t2.4
-	printf("\r\nt2.4 --- get_trit(...)\r\n");
-	tr1 = smtr("+0-0+0-0+");
-	view_short_reg(&tr1, "tr1");
-	trit = get_trit(tr1, 8);
-	pt(trit, 8);
-	trit = get_trit(tr1, 7);
-	pt(trit, 7);
-	trit = get_trit(tr1, 6);
-	pt(trit, 6);
-	trit = get_trit(tr1, 5);
+				symb = smtr("-0-");
+				Write_Commands_to_TTY1(m, m->tty1, symb);
+
+				fa = next_address(fa);
+			}
+			m->letter_number_sw = current; /* вернуть регистр */
+			break;
+		case (+0 * 27 - 1 * 9 + 0 * 3 + 0): /* Печать одним цветом в виде символов на пишущей машинке ПМ (ЭУМ-46) */
+			LOGGING_print("   k2..5[0-00]: Печать одним цветом в виде символов на пишущей машинке ПМ (ЭУМ-46)\n");
+
+			for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
+			{
+				int32_t symbcode;
+				trs_t symb;
+				symb.l = 3;
+				//
+				m->MR = ld_fram(m, fa);
+
+				symb = slice_trs_setun(m->MR, 1, 3);
+				Write_Symbols_to_TTY1(m, m->tty1, symb);
+
+				symb = slice_trs_setun(m->MR, 4, 6);
+				Write_Symbols_to_TTY1(m, m->tty1, symb);
+
+				symb = slice_trs_setun(m->MR, 7, 9);
+				if (trs2digit(symb) == -13)
+					break;
+				Write_Symbols_to_TTY1(m, m->tty1, symb);
+
+				fa = next_address(fa);
+			}
+			break;
+		case (+1 * 27 - 1 * 9 + 0 * 3 + 0): /* Печать в виде символов на Пишущей машинке ПМ (ЭУМ-46) */
+			LOGGING_print("   k2..5[+-00]: Печать в виде символов на пишущей машинке ПМ (ЭУМ-46)\n");
+			for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
+			{
+				int32_t symbcode;
+				trs_t symb;
+				symb.l = 3;
+				//
+				m->MR = ld_fram(m, fa);
+
+				symb = slice_trs_setun(m->MR, 1, 3);
+				Write_Symbols_to_TTY1(m, m->tty1, symb);
+
+				symb = slice_trs_setun(m->MR, 4, 6);
+				Write_Symbols_to_TTY1(m, m->tty1, symb);
+
+				symb = slice_trs_setun(m->MR, 7, 9);
+				if (trs2digit(symb) == -13)
+					break;
+				Write_Symbols_to_TTY1(m, m->tty1, symb);
+				fa = next_address(fa);
+			}
+			break;
+		default: /* Ошибка: Не поддерживается устройвтво ввода/вывода */
+			return STOP_ERROR;
+			break;
+		}
+		LOGGING_print("\n");
+		m->C = next_address(m->C);
+	}
+	break;
+	case (-1 * 9 + 0 * 3 + 1):
+	{ // -0+ : Запись на МБ	(Фа*)=>(Мд*)
+		m->io_count++;
+		LOGGING_print(" k6..8[-0+]: (Фа*)=>(Мд*)\n");
+		int32_t zone = trs2digit(slice_trs_setun(k1_5, 2, 5));
+		if ((zone < ZONE_DRUM_BEG) || (zone > ZONE_DRUM_END))
+		{
+			return STOP_ERROR_MB_NUMBER;
+		}
+		else
+		{
+			fram_to_drum(m, slice_trs_setun(k1_5, 1, 5));
+			m->MB = slice_trs_setun(k1_5, 2, 5);
+			mod_3_n(&m->MB, 4); /* очистить неиспользованные триты */
+		}
+		m->C = next_address(m->C);
+	}
+	break;
+	case (-1 * 9 + 0 * 3 - 1):
+	{ // -0- : Считывание с МБ	(Мд*)=>(Фа*)
+		m->io_count++;
+		LOGGING_print(" k6..8[-0-]: (Мд*)=>(Фа*)\n");
+		int32_t zone = trs2digit(slice_trs_setun(k1_5, 2, 5));
+		if (zone == 0)
+		{
+			clean_fram_zone(m, slice_trs_setun(k1_5, 1, 1));
+		}
+		else if ((zone < ZONE_DRUM_BEG) || (zone > ZONE_DRUM_END))
+		{
+			return STOP_ERROR_MB_NUMBER;
+		}
+		else
+		{
+			drum_to_fram(m, slice_trs_setun(k1_5, 1, 5));
+		}
+		m->MB = slice_trs_setun(k1_5, 2, 5);
+		mod_3_n(&m->MB, 4); /* очистить неиспользованные триты */
+		m->C = next_address(m->C);
+	}
+	break;
+	case (-1 * 9 - 1 * 3 + 0):
+	{ // --0 : Не задействована	Стоп
+		LOGGING_print(" k6..8[--0]: STOP BREAK\n");
+		view_short_reg(&k6_8, "k6..8=");
+		return STOP_ERROR;
+	}
+	break;
+	case (-1 * 9 - 1 * 3 + 1):
+	{ // --+ : Не задействована	Стоп
+		LOGGING_print(" k6..8[--+]: STOP BREAK\n");
+		view_short_reg(&k6_8, "k6..8=");
+		return STOP_ERROR;
+	}
+	break;
+	case (-1 * 9 - 1 * 3 - 1):
+	{ // --- : Не задействована	Стоп
+		LOGGING_print(" k6..8[---]: STOP BREAK\n");
+		view_short_reg(&k6_8, "k6..8=");
+		return STOP_ERROR;
+	}
+	break;
+	default:
+	{ // Не допустимая команда машины
+		LOGGING_print("k6..8 =[]   : STOP! NO OPERATION\n");
+		view_short_reg(&k6_8, "k6..8=");
+		return STOP_ERROR;
+	}
+	break;
+	}
+
+	if (LOGGING > 0)
+	{
+		view_short_regs(m);
+	}
+
+	return OK;
+
+error_over:
+	return STOP_ERROR;
+}
+
+/** ------------------------------------------------------------------
+ *  Режим целочисленных регистров S, R, F, W ("native")
+ *  ------------------------------------------------------------------
+ *
+ * Регистры S(1:18), R(1:18), F(1:5) хранятся как целые числа
+ * -(3^n-1)/2 .. +(3^n-1)/2, признак W - как знак -1, 0, +1.
+ * Пересылки, сложение и вычитание в S и F и условные переходы
+ * выполняются одной целочисленной операцией вместо потритного add_trs.
+ *
+ * Троичные регистры m->S, m->R, m->F, m->W материализуются лениво:
+ * перед командами с потритной семантикой (умножение, поразрядное
+ * умножение, сдвиг, нормализация, запись F, ввод-вывод)
+ * и перед просмотром регистров (native_sync). Запись из S
+ * материализует только S.
+ */
+#define POW3_5 (243)
+#define POW3_9 (19683)
+#define POW3_18 (387420489)
+#define HALF3_5 ((POW3_5 - 1) / 2)
+#define HALF3_18 ((POW3_18 - 1) / 2)
+
+static int32_t tab_mask_pow3[512];	 /* сумма 3^i по битам 9-битной маски */
+static uint16_t tab_tern_t1[POW3_9]; /* 9 тритов числа 0..3^9-1 в смещённом коде, биты t1 */
+static uint16_t tab_tern_t0[POW3_9]; /* 9 тритов числа 0..3^9-1 в смещённом коде, биты t0 */
+static pthread_once_t tab_native_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Таблицы преобразования троичных чисел в целые и обратно
+ */
+static void build_tab_native(void)
+{
+	uint32_t i, k, v;
+	uint16_t t1, t0;
+
+	for (i = 0; i < 512; i++)
+	{
+		v = 0;
+		for (k = 0; k < 9; k++)
+		{
+			if ((i >> k) & 1)
+			{
+				v += pow3(k);
+			}
+		}
+		tab_mask_pow3[i] = v;
+	}
+
+	/* Цифра 0,1,2 смещённого кода это трит -1,0,+1 */
+	for (i = 0; i < POW3_9; i++)
+	{
+		t1 = 0;
+		t0 = 0;
+		v = i;
+		for (k = 0; k < 9; k++)
+		{
+			if (v % 3 == 0)
+			{
+				t0 |= 1 << k;
+			}
+			else if (v % 3 == 2)
+			{
+				t1 |= 1 << k;
+				t0 |= 1 << k;
+			}
+			v /= 3;
+		}
+		tab_tern_t1[i] = t1;
+		tab_tern_t0[i] = t0;
+	}
+}
+
+void init_tab_native(void)
+{
+	pthread_once(&tab_native_once, build_tab_native);
+}
+
+/**
+ * Троичное число до 18 тритов в целое
+ */
+int32_t trs2int(trs_t t)
+{
+	uint32_t p = t.t1 & t.t0;
+	uint32_t n = t.t0 & ~t.t1;
+
+	return (tab_mask_pow3[p & 0x1FF] - tab_mask_pow3[n & 0x1FF]) +
+		   (tab_mask_pow3[(p >> 9) & 0x1FF] - tab_mask_pow3[(n >> 9) & 0x1FF]) * POW3_9;
+}
+
+/**
+ * Целое |v| <= (3^18-1)/2 в троичное число длиной l тритов
+ */
+trs_t int2trs(int32_t v, uint8_t l)
+{
+	trs_t r;
+	uint32_t u = (uint32_t)(v + HALF3_18);
+	uint32_t lo = u % POW3_9;
+	uint32_t hi = u / POW3_9;
+
+	r.l = l;
+	r.t1 = tab_tern_t1[lo] | ((uint32_t)tab_tern_t1[hi] << 9);
+	r.t0 = tab_tern_t0[lo] | ((uint32_t)tab_tern_t0[hi] << 9);
+	return r;
+}
+
+/* Результат сложения по модулю 3^18 */
+int32_t norm_int18(int32_t v)
+{
+	if (v > HALF3_18)
+	{
+		v -= POW3_18;
+	}
+	else if (v < -HALF3_18)
+	{
+		v += POW3_18;
+	}
+	return v;
+}
+
+/* Результат сложения по модулю 3^5 */
+int32_t norm_int5(int32_t v)
+{
+	if (v > HALF3_5)
+	{
+		v -= POW3_5;
+	}
+	else if (v < -HALF3_5)
+	{
+		v += POW3_5;
+	}
+	return v;
+}
+
+int8_t sgn_int(int32_t v)
+{
+	return (v > 0) - (v < 0);
+}
+
+/**
+ * Включить/выключить режим целочисленных регистров
+ */
+void set_native_mode(setun_machine_t *m, uint8_t on)
+{
+	init_tab_native();
+	native_sync(m);
+	m->native = on;
+	m->native_state = NATIVE_NONE;
+}
+
+/**
+ * Загрузить целые значения из тритов регистров S, R, F, W
+ */
+void native_load(setun_machine_t *m)
+{
+	if (m->native_state != NATIVE_NONE)
+	{
+		return;
+	}
+	m->nS = trs2int(m->S);
+	m->nR = trs2int(m->R);
+	m->nF = trs2int(m->F);
+	m->nW = sgn_trs(m->W);
+	m->native_state = NATIVE_CLEAN;
+}
+
+/**
+ * Материализовать триты регистров S, R, F, W из целых значений
+ */
+void native_sync(setun_machine_t *m)
+{
+	if (m->native_state != NATIVE_DIRTY)
+	{
+		return;
+	}
+	m->S = int2trs(m->nS, 18);
+	m->R = int2trs(m->nR, 18);
+	m->F = int2trs(m->nF, 5);
+	m->W = set_trit_setun(m->W, 1, m->nW);
+	m->native_state = NATIVE_CLEAN;
+}
+
+/**
+ * Выборка A* для команд S и R: короткий код дополняется
+ * нулями в девяти младших разрядах до длинного
+ */
+int32_t native_fetch(setun_machine_t *m, trs_t k1_5)
+{
+	return trs2int(fetch_operand(m, k1_5));
+}
+
+/**
+ * Выборка A* для команд F: старшие пять разрядов кода
+ */
+int32_t native_fetch5(setun_machine_t *m, trs_t k1_5)
+{
+	m->MR = ld_fram(m, k1_5);
+	mod_3_n(&m->MR, m->MR.l); /* очистить неиспользованные триты */
+	m->MR = slice_trs_setun(m->MR, 1, 5);
+	return trs2int(m->MR);
+}
+
+/**
+ * Выполнить операцию K(1:9) в режиме целочисленных регистров.
+ * Результат совпадает с execute_trs (см. Test12_Setun_Native).
+ */
+int8_t execute_native(setun_machine_t *m, trs_t addr, trs_t oper)
+{
+	trs_t k1_5;		 /* K(1:5)	*/
+	int8_t codeoper; /* Код операции */
+	int8_t ret;
+
+	/* Потритная отладочная печать только в execute_trs */
+	if (LOGGING > 0)
+	{
+		native_sync(m);
+		ret = execute_trs(m, addr, oper);
+		m->native_state = NATIVE_NONE;
+		return ret;
+	}
+
+	/* Адресная часть */
+	k1_5 = slice_trs_setun(addr, 1, 5);
+	k1_5.l = 5;
+
+	/* Код операции */
+	codeoper = get_trit_setun(oper, 1) * 9 +
+			   get_trit_setun(oper, 2) * 3 +
+			   get_trit_setun(oper, 3);
+
+	native_load(m);
+
+	switch (codeoper)
+	{
+	case (+1 * 9 + 0 * 3 + 0): /* +00 : (A*)=>(S) */
+		m->nS = native_fetch(m, k1_5);
+		m->nW = sgn_int(m->nS);
+		break;
+	case (+1 * 9 + 0 * 3 + 1): /* +0+ : (S)+(A*)=>(S) */
+		m->nS = norm_int18(m->nS + native_fetch(m, k1_5));
+		m->nW = sgn_int(m->nS);
+		if (over_check(m) > 0)
+		{
+			m->native_state = NATIVE_DIRTY;
+			return STOP_ERROR;
+		}
+		break;
+	case (+1 * 9 + 0 * 3 - 1): /* +0- : (S)-(A*)=>(S) */
+		m->nS = norm_int18(m->nS - native_fetch(m, k1_5));
+		m->nW = sgn_int(m->nS);
+		if (over_check(m) > 0)
+		{
+			m->native_state = NATIVE_DIRTY;
+			return STOP_ERROR;
+		}
+		break;
+	case (+1 * 9 - 1 * 3 + 1): /* +-+ : (A*)=>(R) */
+		m->nR = native_fetch(m, k1_5);
+		m->nW = sgn_int(m->nS);
+		break;
+	case (+1 * 9 - 1 * 3 - 1): /* +-- : STOP (A*)=>(R) */
+		m->nR = native_fetch(m, k1_5);
+		m->native_state = NATIVE_DIRTY;
+		return STOP;
+	case (+0 * 9 - 1 * 3 + 0): /* 0-0 : (A*)=>(F) */
+		m->MR = ld_fram(m, k1_5);
+		mod_3_n(&m->MR, m->MR.l); /* очистить неиспользованные триты */
+		m->nF = trs2int(slice_trs_setun(m->MR, 1, 5));
+		m->nW = sgn_int(m->nF);
+		break;
+	case (+0 * 9 - 1 * 3 + 1): /* 0-+ : (C)+(A*)=>F */
+		m->nF = norm_int5(trs2int(m->C) + native_fetch5(m, k1_5));
+		m->nW = sgn_int(m->nF);
+		break;
+	case (+0 * 9 - 1 * 3 - 1): /* 0-- : (F)+(A*)=>(F) */
+		m->nF = norm_int5(m->nF + native_fetch5(m, k1_5));
+		m->nW = sgn_int(m->nF);
+		break;
+	case (-1 * 9 + 1 * 3 + 1): /* -++ : (S)=>(A*) */
+		m->S = int2trs(m->nS, 18);
+		st_fram(m, k1_5, m->S);
+		m->nW = sgn_int(m->nS);
+		break;
+	case (+0 * 9 + 1 * 3 + 0): /* 0+0 : A*=>(C) при w=0 */
+	case (+0 * 9 + 1 * 3 + 1): /* 0++ : A*=>(C) при w=+1 */
+	case (+0 * 9 + 1 * 3 - 1): /* 0+- : A*=>(C) при w=-1 */
+		if (m->nW == get_trit_setun(oper, 3))
+		{
+			copy_trs_setun(&k1_5, &m->C);
+		}
+		else
+		{
+			m->C = next_address(m->C);
+		}
+		return OK;
+	case (+0 * 9 + 0 * 3 + 0):	/* 000 : A*=>(C) */
+	case (+0 * 9 + 0 * 3 + 1):	/* 00+ : (C)=>(A*) */
+	case (-1 * 9 + 0 * 3 + 1):	/* -0+ : (Фа*)=>(Мд*) */
+	case (-1 * 9 + 0 * 3 - 1):	/* -0- : (Мд*)=>(Фа*) */
+		/* Регистры S, R, F, W не используются */
+		return execute_trs(m, addr, oper);
+	default:
+		/* Команды с потритной семантикой регистров */
+		native_sync(m);
+		ret = execute_trs(m, addr, oper);
+		m->native_state = NATIVE_NONE;
+		return ret;
+	}
+
+	m->native_state = NATIVE_DIRTY;
+	m->C = next_address(m->C);
+	return OK;
+}
+
+
+/* **********************************************************************************
+ * Тестирование функций операций с тритами
+ * ----------------------------------------------------------------------------------
+ */
+void pl(int8_t a, int8_t c)
+{
+	printf(" a,c {% 2i}->% 2i\r\n", a, c);
+}
+void p(int8_t a, int8_t b, int8_t c)
+{
+	printf(" a,b,c {% 2i,% 2i}->% 2i\r\n", a, b, c);
+}
+void pp(int8_t a, int8_t b, int8_t c, int8_t p0, int8_t p1)
+{
+	printf(" a,b,p0,c,p1 {% 2i,% 2i,% 2i}->% 2i,% 2i\r\n", a, b, p0, c, p1);
+}
+
+void Test1_Ariphmetic_Ternary(void)
+{
+
+	int8_t a, b, c, p0, p1;
+
+	printf("\r\n --- TEST #1  Logic opertion trits  for VM SETUN-1958 --- \r\n\r\n");
+
+	printf(" 1.1. Логическая операция NOT\r\n");
+	printf(" C = NOT A \r\n");
+
+	for (a = -1; a < 2; a++)
+	{
+		not_t(&a, &c);
+		pl(a, c);
+	}
+
+	printf(" 1.2. Логическая операция AND\r\n");
+	printf(" C = A AND B \r\n");
+	for (a = -1; a < 2; a++)
+	{
+		for (b = -1; b < 2; b++)
+		{
+			and_t(&a, &b, &c);
+			p(a, b, c);
+		}
+	}
+
+	printf(" 1.2. Логическая операция OR\r\n");
+	printf(" C = A OR B \r\n");
+	for (a = -1; a < 2; a++)
+	{
+		for (b = -1; b < 2; b++)
+		{
+			or_t(&a, &b, &c);
+			p(a, b, c);
+		}
+	}
+
+	printf(" 1.3. Логическая операция XOR\r\n");
+	printf(" C = A XOR B \r\n");
+	for (a = -1; a < 2; a++)
+	{
+		for (b = -1; b < 2; b++)
+		{
+			xor_t(&a, &b, &c);
+			p(a, b, c);
+		}
+	}
+
+	printf(" 1.4. Логическая операция SUM FULL\r\n");
+	printf(" C, P1 = A + B + P0 \r\n");
+	for (a = -1; a < 2; a++)
+	{
+		for (b = -1; b < 2; b++)
+		{
+			for (p0 = -1; p0 < 2; p0++)
+			{
+				sum_t(&a, &b, &p0, &c, &p1);
+				pp(a, b, c, p0, p1);
+			}
+		}
+	}
+	printf("\n --- END TEST #1 --- \r\n");
+}
+
+/** *********************************************
+ *  Тестирование функций операций с тритами
+ *  ---------------------------------------------
+ */
+void pt(int8_t t, uint8_t p)
+{
+	printf("t[% 2i]=% 2i\r\n", p, t);
+}
+void pln(int8_t l)
+{
+	printf("TRIT-%02i : ", l);
+}
+void Test2_Opers_TRITS_32(void)
+{
+	int8_t trit; // трит
+	trs_t tr1;	 // троичное число
+	trs_t tr2;	 // троичное число
+
+	printf("\r\n --- TEST #2  Operations TRITS-32 for VM SETUN-1958 --- \r\n");
+
+	// t2.1 POW3
+	printf("\r\nt2.1 --- POW3(...)\r\n");
+	printf("pow3(3)  = %d\r\n", (int32_t)pow3(3));
+	printf("pow3(18) = %d\r\n", (int32_t)pow3(18));
+
+	// t2.2 Point address
+	printf("\r\nt2.2 --- Point address\r\n");
+	addr pMem;
+	pMem = 0xffffffff;
+	printf("pMem = 0xffffffff [%ji]\r\n", pMem);
+
+	// t2.3
+	printf("\r\nt2.3 --- TRIT-32\r\n");
+	clear_full(&tr1);
+	tr1.l = 1;
+	tr1.t1 = ~0;
+	tr1.t0 = 1;
+	pln(1);
+	view_short_reg(&tr1, "tr1");
+	tr1.t0 = 1 << 4;
+	pln(5);
+	tr1.l = 5;
+	view_short_reg(&tr1, "tr1");
+	tr1.t0 = 1 << 8;
+	pln(9);
+	tr1.l = 9;
+	view_short_reg(&tr1, "tr1");
+	tr1.t0 = 1 << 17;
+	pln(18);
+	tr1.l = 18;
+	view_short_reg(&tr1, "tr1");
+	tr1.t0 = 1 << 31;
+	pln(32);
+	tr1.l = 32;
+	view_short_reg(&tr1, "tr1");
+
+	// t2.4
+	printf("\r\nt2.4 --- get_trit(...)\r\n");
+	tr1 = smtr("+0-0+0-0+");
+	view_short_reg(&tr1, "tr1");
+	trit = get_trit(tr1, 8);
+	pt(trit, 8);
+	trit = get_trit(tr1, 7);
+	pt(trit, 7);
+	trit = get_trit(tr1, 6);
+	pt(trit, 6);
+	trit = get_trit(tr1, 5);
 	pt(trit, 5);
 	trit = get_trit(tr1, 4);
 	pt(trit, 4);
@@ -5997,3390 +8107,9385 @@ void Test2_Opers_TRITS_32(void)
 	trit = get_trit(tr1, 0);
 	pt(trit, 0);
 
-	// t2.4
-	printf("\r\nt2.4 --- set_trit(...)\r\n");
-	tr1 = set_trit(tr1, 8, 0);
-	pt(0, 8);
-	tr1 = set_trit(tr1, 7, 1);
-	pt(1, 7);
-	tr1 = set_trit(tr1, 6, 0);
-	pt(0, 6);
-	tr1 = set_trit(tr1, 5, -1);
-	pt(-1, 5);
-	tr1 = set_trit(tr1, 4, 0);
-	pt(0, 4);
-	tr1 = set_trit(tr1, 3, 1);
-	pt(1, 3);
-	tr1 = set_trit(tr1, 2, 0);
-	pt(0, 2);
-	tr1 = set_trit(tr1, 1, -1);
-	pt(-1, 1);
-	tr1 = set_trit(tr1, 0, 0);
-	pt(0, 0);
-	view_short_reg(&tr1, "tr1");
+	// t2.4
+	printf("\r\nt2.4 --- set_trit(...)\r\n");
+	tr1 = set_trit(tr1, 8, 0);
+	pt(0, 8);
+	tr1 = set_trit(tr1, 7, 1);
+	pt(1, 7);
+	tr1 = set_trit(tr1, 6, 0);
+	pt(0, 6);
+	tr1 = set_trit(tr1, 5, -1);
+	pt(-1, 5);
+	tr1 = set_trit(tr1, 4, 0);
+	pt(0, 4);
+	tr1 = set_trit(tr1, 3, 1);
+	pt(1, 3);
+	tr1 = set_trit(tr1, 2, 0);
+	pt(0, 2);
+	tr1 = set_trit(tr1, 1, -1);
+	pt(-1, 1);
+	tr1 = set_trit(tr1, 0, 0);
+	pt(0, 0);
+	view_short_reg(&tr1, "tr1");
+
+	// t2.5
+	printf("\r\nt2.5 --- input TRITS-32s\r\n");
+	printf("input tr1=[+000000000000000000000000000000-] \r\n");
+	tr1 = smtr("+000000000000000000000000000000-");
+	view_short_reg(&tr1, "tr1=");
+	printf("input tr2=[-000000000+] \r\n");
+	tr2 = smtr("-000000000+");
+	view_short_reg(&tr2, "tr2=");
+
+	// t2.6
+	printf("\nt2.6 --- trit2int(...)\r\n");
+	tr1 = smtr("00-");
+	printf("tr1=[00-]\r\n");
+	printf("trit2int(tr1) = % 2i\r\n", trit2int(tr1));
+	tr1 = smtr("000");
+	printf("tr1=[000]\r\n");
+	printf("trit2int(tr1) = % 2i\r\n", trit2int(tr1));
+	tr1 = smtr("00+");
+	printf("tr1=[00+]\r\n");
+	printf("trit2int(tr1) = % 2i\r\n", trit2int(tr1));
+
+	// t2.7
+	printf("\r\nt2.7 --- printf long int\r\n");
+	long int ll = 0x00000001lu;
+	printf("long int ll = 0x00000001lu\r\n");
+	printf("ll = %lu\r\n", ll);
+	ll <<= 1;
+	printf("ll <<= 1; ll = %lu\r\n", ll);
+	ll <<= 1;
+	printf("ll <<= 1; ll = %lu\r\n", ll);
+	printf("\r\n");
+
+	// t2.8
+	printf("\r\nt2.8 --- sgn_trs(...)\r\n");
+	tr1 = smtr("+0000");
+	printf("tr1=[+0000]\r\n");
+	printf("sgn_trs(tr1) = % 2i\r\n", sgn_trs(tr1));
+	tr1 = smtr("00000");
+	printf("tr1=[00000]\r\n");
+	printf("sgn_trs(tr1) = % 2i\r\n", sgn_trs(tr1));
+	tr1 = smtr("-0000");
+	printf("tr1=[-0000]\r\n");
+	printf("sgn_trs(tr1) = % 2i\r\n", sgn_trs(tr1));
+
+	trs_t w1;
+	w1.l = 1;
+	w1 = smtr("-");
+	printf("w1=[-]\r\n");
+	printf("sgn_trs(w1) = % 2i\r\n", sgn_trs(w1));
+	w1 = smtr("0");
+	printf("w1=[0]\r\n");
+	printf("sgn_trs(w1) = % 2i\r\n", sgn_trs(w1));
+	w1 = smtr("+");
+	printf("w1=[+]\r\n");
+	printf("sgn_trs(w1) = % 2i\r\n", sgn_trs(w1));
+
+	// t2.9
+	printf("\r\nt2.9 --- view_short_reg()\r\n");
+	tr1 = smtr("+-0+-0+-0");
+	view_short_reg(&tr1, "tr1 =");
+
+	// t2.10
+	printf("\r\nt2.10 --- slice_trs(...)\r\n");
+	tr1 = smtr("+000000000000000000000000000000-");
+	printf("tr1 := [+000000000000000000000000000000-]\r\n");
+	tr2 = slice_trs(tr1, 0, 15);
+	view_short_reg(&tr2, "tr2[15,0] =");
+	printf("tr1 := [+000000000000000000000000000000-]\r\n");
+	tr2 = slice_trs(tr1, 16, 31);
+	view_short_reg(&tr2, "tr2[31,16] =");
+
+	// t2.11
+	printf("\nt2.11 --- copy_trs(...)\r\n");
+	tr1 = smtr("+000000000000000000000000000000-");
+	printf("tr1 := [+000000000000000000000000000000-]\r\n");
+	tr2 = smtr("00000000000000000000000000000000");
+	printf("tr2 := [00000000000000000000000000000000]\r\n");
+	copy_trs(&tr1, &tr2);
+	view_short_reg(&tr2, "tr2 =");
+	tr1 = smtr("+00-00+00");
+	printf("tr1 := [+00-00+00]\r\n");
+	tr2 = smtr("00000000000000000000000000000000");
+	printf("tr2 := [00000000000000000000000000000000]\r\n");
+	copy_trs(&tr1, &tr2);
+	view_short_reg(&tr2, "tr2 =");
+
+	// t2.12
+	printf("\r\nt2.12 --- inc_trs(...)\r\n");
+	tr1 = smtr("+0-0+---");
+	view_short_reg(&tr1, "tr1 =");
+	inc_trs(&tr1);
+	printf("inc_trs(&tr1)\r\n");
+	view_short_reg(&tr1, "tr1 =");
+
+	// t2.13
+	printf("\r\nt2.13 --- dec_trs(...)\r\n");
+	tr1 = smtr("+0-0-+0-");
+	view_short_reg(&tr1, "tr1 =");
+	dec_trs(&tr1);
+	printf("dec_trs(&tr1)\r\n");
+	view_short_reg(&tr1, "tr1 =");
+
+	// t2.14
+	printf("\r\nt2.14 --- add_trs(...)\r\n");
+	tr1 = smtr("+---+");
+	view_short_reg(&tr1, "tr1 =");
+	tr2 = smtr("+0-+0");
+	view_short_reg(&tr2, "tr2 =");
+	tr1 = add_trs(tr1, tr2);
+	printf("tr1 = add_trs(tr1,tr2)\r\n");
+	view_short_reg(&tr1, "tr1 =");
+
+	// t2.14.1
+	printf("\r\nt2.14.1 --- add_trs(...)\r\n");
+	tr1 = smtr("-+0000000++++++++");
+	view_short_reg(&tr1, "tr1 =");
+	tr2 = smtr("0+0000000");
+	view_short_reg(&tr2, "tr2 =");
+	tr1 = add_trs(tr1, tr2);
+	printf("tr1 = add_trs(tr1,tr2)\r\n");
+	view_short_reg(&tr1, "tr1 =");
+
+	// t2.14.2
+	printf("\r\nt2.14.2 --- add_trs(...)\r\n");
+	tr1 = smtr("0+0000000+++++++++");
+	view_short_reg(&tr1, "tr1 =");
+	tr2 = smtr("0+0000000000000000");
+	view_short_reg(&tr2, "tr2 =");
+	tr1 = add_trs(tr1, tr2);
+	printf("tr1 = add_trs(tr1,tr2)\n");
+	view_short_reg(&tr1, "tr1 =");
+
+	// t2.15
+	printf("\r\nt2.15 --- sub_trs(...)\r\n");
+	tr1 = smtr("+0-+00--");
+	view_short_reg(&tr1, "tr1 =");
+	tr2 = smtr("+0-0+--+");
+	view_short_reg(&tr2, "tr2 =");
+	tr1 = sub_trs(tr1, tr2);
+	printf("tr1 = sub_trs(tr1,tr2)\r\n");
+	view_short_reg(&tr1, "tr1 =");
+
+	// t2.15
+	printf("\r\nt2.15 --- shift_trs(...)\r\n");
+	tr1 = smtr("0000+0000");
+	view_short_reg(&tr1, "tr1 =");
+	tr1 = shift_trs(tr1, -2);
+	printf("tr1 = shift_trs(tr1,-2)\r\n");
+	view_short_reg(&tr1, "tr1 =");
+	tr1 = shift_trs(tr1, -2);
+	printf("tr1 = shift_trs(tr1,-2)\r\n");
+	view_short_reg(&tr1, "tr1 =");
+
+	// t2.16
+	printf("\r\nt2.16 --- mul_trs(...)\r\n");
+	tr1 = smtr("+0000000000000000+");
+	tr1.l = 18;
+	view_short_reg(&tr1, "tr1 =");
+	tr2 = smtr("0-0000000000000000");
+	tr2.l = 18;
+	view_short_reg(&tr2, "tr2 =");
+
+	tr2 = mul_trs(tr1, tr2);
+	view_short_reg(&tr2, "tr2 =");
+
+	// t2.17
+	printf("\r\nt2.17 --- mul_trs(...)\r\n");
+	tr1 = smtr("0000000++");
+	view_short_reg(&tr1, "tr1 =");
+	tr2 = smtr("000000000000000---");
+	view_short_reg(&tr2, "tr2 =");
+	tr2 = mul_trs(tr1, tr2);
+	view_short_reg(&tr2, "tr2 =");
+
+	// t2.18
+	printf("\r\nt2.18 --- shift_long_trs(...)\r\n");
+	long_trs_t ltr1;
+	ltr1.l = 64;
+	tr1 = smtr("0-00+0000");
+	ltr1.t1 = tr1.t1;
+	ltr1.t0 = tr1.t0;
+
+	// printf("ltr1.t1=%p\r\n",(long int)ltr1.t1);
+	// printf("ltr1.t0=%p\r\n",(long int)ltr1.t0);
+
+	view_short_long_reg(&ltr1, "ltr1 =");
+	ltr1 = shift_long_trs(ltr1, -2);
+	printf("ltr1 = shift_long_trs(ltr1,-2)\r\n");
+	view_short_long_reg(&ltr1, "ltr1 =");
+	ltr1 = shift_long_trs(ltr1, -2);
+	printf("ltr1 = shift_long_trs(ltr1,-2)\r\n");
+	view_short_long_reg(&ltr1, "ltr1 =");
+
+	printf("\r\n --- END TEST #2 --- \r\n");
+}
+
+/** *********************************************
+ *  Тестирование виртуальной машины "Сетунь-1958"
+ *  типов данных, функции
+ *  ---------------------------------------------
+ */
+void ps(int8_t t, uint8_t p)
+{
+	printf("S[% 3i]=% 2i\r\n", p, t);
+}
+
+void Test3_Setun_Opers(void)
+{
+	int8_t trit;
+	trs_t aa;
+	trs_t ad1;
+	trs_t ad2;
+	trs_t addr;
+	trs_t oper;
+	trs_t exK;
+	trs_t m0;
+	trs_t m1;
+	int8_t ret_exec;
+
+	printf("\r\n --- TEST #3  Operations for VM SETUN-1958 --- \r\n\r\n");
+
+	reset_setun_1958(&setun);
+
+	// t3.1
+	printf("\r\nt3.1 --- get_trit_setun(...)\r\n");
+	setun.S = smtr("+000000-000000000-");
+	view_short_reg(&setun.S, "S");
+	trit = get_trit_setun(setun.S, 1);
+	ps(trit, 1);
+	trit = get_trit_setun(setun.S, 8);
+	ps(trit, 8);
+	trit = get_trit_setun(setun.S, 18);
+	ps(trit, 18);
+
+	// t3.2
+	printf("\r\nt3.2 --- set_trit_setun(...)\r\n");
+	setun.S = smtr("000000000000000000");
+	setun.S = set_trit_setun(setun.S, 2, -1);
+	ps(-1, 2);
+	setun.S = set_trit_setun(setun.S, 5, 1);
+	ps(1, 5);
+	setun.S = set_trit_setun(setun.S, 18, -1);
+	ps(-1, 18);
+	view_short_reg(&setun.S, "S");
+
+	// t3.3
+	printf("\r\nt3.3 --- sgn_trs(...)\r\n");
+	setun.S = smtr("+00000000000000000");
+	printf("S=[+00000000000000000]\r\n");
+	printf("sgn_trs(S) = % 2i\n", sgn_trs(setun.S));
+	setun.S = smtr("000000000000000000");
+	printf("S=[000000000000000000]\r\n");
+	printf("sgn_trs(S) = % 2i\n", sgn_trs(setun.S));
+	setun.S = smtr("-00000000000000000");
+	printf("S=[-00000000000000000]\r\n");
+	printf("sgn_trs(S) = % 2i\n", sgn_trs(setun.S));
+
+	// t3.4
+	printf("\r\nt3.4 --- slice_trs_setun(...)\r\n");
+	setun.S = smtr("+0000000000000000-000000");
+	setun.K = slice_trs_setun(setun.S, 1, 9);
+	view_short_reg(&setun.S, "S");
+	view_short_reg(&setun.K, "K[1,9] =");
+	setun.K = slice_trs_setun(setun.S, 10, 18);
+	view_short_reg(&setun.S, "S");
+	view_short_reg(&setun.K, "K[10,18] =");
+
+	// t3.5
+	printf("\r\nt3.5 --- copy_trs_setun(...)\r\n");
+	setun.S = smtr("+0000000000000000-000000");
+	copy_trs_setun(&setun.S, &setun.K);
+	view_short_reg(&setun.S, "S");
+	view_short_reg(&setun.K, "K");
+	setun.K = smtr("---------");
+	copy_trs_setun(&setun.K, &setun.S);
+	view_short_reg(&setun.S, "S");
+	view_short_reg(&setun.K, "K");
+
+	printf("\r\nt3.6 --- S = S + R\r\n");
+	setun.S = smtr("0000000000000+---+");
+	setun.R = smtr("0000000000000+0-+0");
+	view_short_reg(&setun.S, "S");
+	view_short_reg(&setun.R, "R");
+	setun.S = add_trs(setun.S, setun.R);
+	view_short_reg(&setun.S, "S=S+R");
+
+	// t3.7
+	printf("\r\nt3.7 --- next_address(...)\r\n");
+	setun.C = smtr("000--");
+	view_short_reg(&setun.C, "beg  C");
+	for (int8_t i = 0; i < 10; i++)
+	{
+		setun.C = next_address(setun.C);
+		view_short_reg(&setun.C, "next C");
+	}
+
+	// t3.8
+	printf("\r\nt3.8 --- control_trs(...)\r\n");
+	trs_t Mem;
+	Mem.l = 9;
+	Mem = smtr("00000000+");
+	view_short_reg(&Mem, "Mem");
+	setun.F = smtr("0000+");
+	view_short_reg(&setun.F, "F");
+	setun.K = control_trs(&setun, Mem);
+	view_short_reg(&setun.K, "K");
+
+	Mem = smtr("000000000");
+	view_short_reg(&Mem, "Mem");
+	setun.F = smtr("000++");
+	view_short_reg(&setun.F, "F");
+	setun.K = control_trs(&setun, Mem);
+	view_short_reg(&setun.K, "K");
+
+	Mem = smtr("00000000-");
+	view_short_reg(&Mem, "Mem");
+	setun.F = smtr("000++");
+	view_short_reg(&setun.F, "F");
+	setun.K = control_trs(&setun, Mem);
+	view_short_reg(&setun.K, "K");
+
+	// t3.8
+	printf("\r\nt3.8 --- st_fram(...)\r\n");
+	//
+	aa = smtr("00000");
+	setun.K = smtr("+0000000-");
+	st_fram(&setun, aa, setun.K);
+	view_short_reg(&aa, "aa");
+	view_short_reg(&setun.K, "K");
+	//
+	aa = smtr("0000+");
+	setun.K = smtr("-0000000+");
+	st_fram(&setun, aa, setun.K);
+	view_short_reg(&aa, "aa");
+	view_short_reg(&setun.K, "K");
+	//
+	ad1 = smtr("000--");
+	ad2 = smtr("000++");
+	view_fram(&setun, ad1, ad2);
+
+	// t3.9
+	printf("\r\nt3.9 --- ld_fram(...)\r\n");
+	aa = smtr("000++");
+	setun.K = smtr("+000-000+");
+	printf("st_fram(aa, K)\r\n");
+	st_fram(&setun, aa, setun.K);
+	view_short_reg(&aa, "aa");
+	view_short_reg(&setun.K, "K");
+	printf("ld_fram(aa)\r\n");
+	setun.K = ld_fram(&setun, aa);
+	view_short_reg(&aa, "aa");
+	view_short_reg(&setun.K, "K");
+
+	// t3.10 test Oper=k6..8[+00]: (A*)=>(S)
+	printf("\r\nt3.10:  Oper=k6..8[+00]: (A*)=>(S)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	addr = smtr("00000");
+	m0 = smtr("+0-0+0-00");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	addr = smtr("0000+");
+	m1 = smtr("00000+000");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	//
+	view_short_regs(&setun);
+
+	// t3.11 test Oper=k6..8[-++]: (S)=>(A*)
+	printf("\r\nt3.11:  Oper=k6..8[-++]: (S)=>(A*)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	setun.S = smtr("-0000000+000-+0000");
+	//
+	addr = smtr("0000+");
+	m1 = smtr("0000--++0");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]r\\n", ret_exec);
+	printf("\r\n");
+	//
+	view_short_regs(&setun);
+	//
+	ad1 = smtr("000--");
+	ad2 = smtr("000++");
+	view_fram(&setun, ad1, ad2);
+
+	// t3.12 test Oper=k6..8[+-+]: (A*)=>(R)
+	printf("\r\nt3.12:  Oper=k6..8[+-+]: (A*)=>(R)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	addr = smtr("00000");
+	m0 = smtr("+0-0+0-00");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	addr = smtr("0000+");
+	m1 = smtr("00000+-+0");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	//
+	view_short_regs(&setun);
+
+	// t3.13 test Oper=k6..8[0-0]: (A*)=>(F)
+	printf("\r\nt3.12:  Oper=k6..8[0-0]: (A*)=>(F)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	addr = smtr("00000");
+	m0 = smtr("+0-0+0-00");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	addr = smtr("0000+");
+	m1 = smtr("000000-00");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	//
+	view_short_regs(&setun);
+
+	// t3.14 test Oper=k6..8[00-]: (F)=>(A*)
+	printf("\r\nt3.14:  Oper=k6..8[00-]: (F)=>(A*)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	setun.F = smtr("-000+");
+	//
+	addr = smtr("0000+");
+	m1 = smtr("0000000-0");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	//
+	view_short_regs(&setun);
+	//
+	ad1 = smtr("000--");
+	ad2 = smtr("000++");
+	view_fram(&setun, ad1, ad2);
+
+	// t3.15 test Oper=k6..8[00+]: (C)=>(A*)
+	printf("\r\nt3.15:  Oper=k6..8[00+]: (C)=>(A*)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	setun.F = smtr("-000+");
+	//
+	addr = smtr("0000+");
+	m1 = smtr("0000000+0");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	//
+	view_short_regs(&setun);
+	//
+	ad1 = smtr("000--");
+	ad2 = smtr("000++");
+	view_fram(&setun, ad1, ad2);
+
+	// t3.16 test Oper=k6..8[+0+]: (S)+(A*)=>(S)
+	printf("\r\nt3.16:  Oper=k6..8[+0+]: (S)+(A*)=>(S)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	addr = smtr("00000");
+	m0 = smtr("0000000+0");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	setun.S = smtr("00000000000000000+");
+	//
+	addr = smtr("0000+");
+	m1 = smtr("00000+0+0");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	//
+	view_short_regs(&setun);
+
+	// t3.17 test Oper=k6..8[+0-]: (S)-(A*)=>(S)
+	printf("\r\nt3.17:  Oper=k6..8[+0-]: (S)-(A*)=>(S)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	addr = smtr("00000");
+	m0 = smtr("0000000++");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	setun.S = smtr("000000000000000+0+");
+	view_short_reg(&setun.S, "S=");
+	//
+	addr = smtr("0000+");
+	m1 = smtr("00000+0-0");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	//
+	view_short_regs(&setun);
+
+	// t3.18 test Oper=k6..8[++0]: (S)=>(R); (A*)(R)=>(S)
+	printf("\r\nt3.18:  Oper=k6..8[++0]: (S)=>(R); (A*)(R)=>(S)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	addr = smtr("00000");
+	m0 = smtr("0+0000000");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	setun.S = smtr("00000000+++0000000");
+	view_short_reg(&setun.S, "S=");
+	//
+	addr = smtr("0000+");
+	m1 = smtr("00000++00");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	//
+	view_short_regs(&setun);
+
+	// t3.19 test Oper=k6..8[+++]: (S)+(A*)(R)=>(S)
+	printf("\r\nt3.19:  Oper=k6..8[+++]: (S)+(A*)(R)=>(S)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	addr = smtr("00000");
+	m0 = smtr("000000--0");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	setun.S = smtr("000000000000000+00");
+	view_short_reg(&setun.S, "S=");
+	//
+	setun.R = smtr("0000000000000000+0");
+	view_short_reg(&setun.R, "R=");
+	//
+	addr = smtr("0000+");
+	m1 = smtr("00000+++0");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	//
+	view_short_regs(&setun);
+
+	// t3.21 test Oper=k6..8[++-]: (A*)+(S)(R)=>(S)=>(S)
+	printf("\r\nt3.21:  Oper=k6..8[++-]: (A*)+(S)(R)=>(S)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	addr = smtr("00000");
+	m0 = smtr("000000--0");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	setun.S = smtr("000000000000000+00");
+	view_short_reg(&setun.S, "S=");
+	//
+	setun.R = smtr("0000000000000000+0");
+	view_short_reg(&setun.R, "R=");
+	//
+	addr = smtr("0000+");
+	m1 = smtr("00000++-0");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	//
+	view_short_regs(&setun);
+
+	printf("   \r\n");
+
+	// t3.22 test Oper=k6..8[+-0]: (A*)[x](S)=>(S)
+	printf("\r\nt3.22:  Oper=k6..8[+-0]: (A*)[x](S)=>(S)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	addr = smtr("00000");
+	m0 = smtr("000000--0");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	setun.S = smtr("000000000000000+00");
+	view_short_reg(&setun.S, "S=");
+	//
+	setun.R = smtr("0000000000000000+0");
+	view_short_reg(&setun.R, "R=");
+	//
+	addr = smtr("0000+");
+	m1 = smtr("00000+-00");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	// view_short_regs();
+
+	// t3.23 test Oper=k6..8[-+0]: S сд. (A*)=>(S)
+	printf("\r\nt3.23:  Oper=k6..8[-+0]: S сд. (A*)=>(S)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	addr = smtr("-000-");
+	m0 = smtr("+0000000-+000-000-");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	setun.S = smtr("000000000000000+00");
+	view_short_reg(&setun.S, "S=");
+	//
+	// R = smtr("0000000000000000+0");
+	// view_short_reg(&R, "R=");
+	//
+	addr = smtr("0000+");
+	m1 = smtr("-000-0-+00");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	view_short_reg(&setun.S, "S=");
+	// view_short_regs();
+
+	// t3.24 test Oper=k6..8[-+-]: Норм.(S)=>(A*); (N)=>(S)
+	printf("\r\nt3.24:  Oper=k6..8[-+-]:  Норм.(S)=>(A*); (N)=>(S)\r\n");
+	//
+	reset_setun_1958(&setun);
+	//
+	addr = smtr("00000");
+	m0 = smtr("00000000-");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	setun.S = smtr("000000000000000+00");
+	view_short_reg(&setun.S, "S=");
+	//
+	// R = smtr("0000000000000000+0");
+	// view_short_reg(&R, "R=");
+	//
+	addr = smtr("0000+");
+	m1 = smtr("00000-+-0");
+	st_fram(&setun, addr, m1);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "K=");
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	printf("S.l=%d\r\n", setun.S.l);
+	view_short_reg(&setun.S, "S=");
+
+	addr = smtr("00000");
+	view_elem_fram(&setun, addr);
+
+	// view_short_regs();
+
+	// t3.25 test Oper=k6..8[-00]:
+	printf("\r\nt3.25:  Oper=k6..8[-00]: \r\n");
+
+	printf("\r\n --- END TEST #3 --- \r\n\r\n");
+}
+
+void Test4_Setun_Opers(void)
+{
+	int8_t trit;
+	trs_t aa;
+	trs_t ad1;
+	trs_t ad2;
+	trs_t addr;
+	trs_t oper;
+	trs_t exK;
+	trs_t m0;
+	trs_t m1;
+	int8_t ret_exec;
+
+	printf("\r\n --- TEST #4  Operations for VM SETUN-1958 --- \r\n\r\n");
+
+	// t4.1 test Oper=k6..8[+00]: (A*)=>(S)
+	printf("\r\nt4.1:  Oper=k6..8[+00]: (A*)=>(S)\r\n");
+	//
+	reset_setun_1958(&setun);
+
+	printf("\r\n");
+	// FRAM(-1) test
+	addr = smtr("-0000");
+	m0 = smtr("00000000+");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	addr = smtr("-000+");
+	m0 = smtr("-0000000+");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+	addr = smtr("-00+-");
+	m0 = smtr("0000000+0");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+
+	/* Begin address fram */
+	addr = smtr("0000+");
+	m1 = smtr("-000-+000");
+	st_fram(&setun, addr, m1);
+	view_short_reg(&m1, "m1");
+	view_elem_fram(&setun, addr);
+
+	printf("\r\n");
+
+	// work VM Setun-1958
+	setun.C = smtr("0000+");
+	setun.K = ld_fram(&setun, setun.C);
+	view_short_reg(&setun.K, "C(0000+)");
+
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("\r\n [status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("\r\n [status: ERR#%d]\r\n", ret_exec);
+
+	printf("\r\n --- END TEST #4 --- \r\n");
+}
+
+void Test5_Setun_Load(void)
+{
+	printf("\r\n --- TEST #5  Load program FT1,FT2 for VM SETUN-1958 --- \r\n\r\n");
+
+	FILE *file_lst;
+
+	/* Переменная, в которую поочередно будут помещаться считываемые строки */
+	char str[80] = {0};
+
+	/* Указатель, в который будет помещен адрес массива, в который считана */
+	/* строка, или NULL если достигнут коней файла или произошла ошибка */
+	char *estr;
+
+	file_lst = fopen("ur1/00_ip5.lst", "r");
+	if (file_lst == NULL)
+	{
+		printf("ERR fopen ur1/00_ip5.lst\r\n");
+		return;
+	}
+	else
+	{
+		printf("fopen: ur1/00_ip5.lst\r\n");
+
+		/* Чтение (построчно) данных из файла в бесконечном цикле */
+		while (1)
+		{
+			/* Чтение одной строки  из файла */
+			estr = fgets(str, sizeof(str), file_lst);
+
+			/* Проверка на конец файла или ошибку чтения */
+			if (estr == NULL)
+			{
+				/* Проверяем, что именно произошло: кончился файл */
+				/* или это ошибка чтения */
+				if (feof(file_lst) != 0)
+				{
+					/* Если файл закончился, выводим сообщение о завершении */
+					/* чтения и выходим из бесконечного цикла */
+					printf("\r\nЧтение файла закончено\r\n");
+					break;
+				}
+				else
+				{
+					/* Если при чтении произошла ошибка, выводим сообщение */
+					/* об ошибке и выходим из бесконечного цикла */
+					printf("\r\nОшибка чтения из файла\r\n");
+					break;
+				}
+			}
+
+			/* ---------------------------------
+			 * Загрузить из файла тест-программу
+			 * ---------------------------------
+			 */
+			printf("\r\n --- Load ur1/%s --- \r\n", str);
+
+			FILE *file;
+			char path_str[160] = {0};
+			uint8_t cmd[20];
+			trs_t inr;
+			trs_t dst;
+
+			inr = smtr("0---0"); /* cчетчик адреса коротких слов */
+			trs_t sum;
+			trs_t tmp;
+
+			tmp.l = 18;
+			tmp.t1 = 0;
+			tmp.t0 = 0;
+
+			int64_t dsun = 0;
+			sum.l = 18;
+			sum.t1 = 0;
+			sum.t0 = 0;
+			//
+			dst.l = 9;
+			setun.MR.l = 18;
+			int i = 0;
+
+			strcat(path_str, "ur1/");
+			if (str[strlen(str) - 1] == 0x0A)
+			{
+				str[strlen(str) - 1] = 0;
+			}
+			str[strlen(str)] = 0;
+			strcat(path_str, str);
+
+			file = fopen(path_str, "r");
+			if (file == NULL)
+			{
+				printf("ERR fopen %s\r\n", path_str);
+				return;
+			}
+
+			while (fscanf(file, "%s", cmd) != EOF)
+			{
+				cmd_str_2_trs(cmd, &dst);
+				sum = add_trs(sum, dst);
+				i += 1;
+
+				dsun += trs2digit(dst);
+
+				LOGGING_print("%s -> [", cmd);
+				trs2str(dst);
+				LOGGING_print("]");
+				if (LOGGING > 0)
+				{
+					view_short_reg(&inr, " addr");
+				}
+				else
+				{
+					printf("\r\n");
+				}
+
+				st_fram(&setun, inr, dst);
+				inr = next_address(inr);
+			}
+			fclose(file);
+
+			printf("\r\n i=%i\n", i);
+
+			/* Печать контрольных сумм */
+			printf("\r\n");
+			view_checksum_setun(sum);
+			//
+		}
+	}
+	fclose(file_lst);
+	printf("fclose: ur1/00_ip5.lst\r\n");
+
+	printf("\r\n --- END TEST #5 --- \r\n");
+}
+
+void Test6_Setun_Load(void)
+{
+	printf("\r\n --- TEST #6  Load program FT1,FT2 for VM SETUN-1958 --- \r\n\r\n");
+
+	FILE *file_lst;
+
+	/* Переменная, в которую поочередно будут помещаться считываемые строки */
+	char str[80] = {0};
+
+	/* Указатель, в который будет помещен адрес массива, в который считана */
+	/* строка, или NULL если достигнут коней файла или произошла ошибка */
+	char *estr;
+
+	file_lst = fopen("software/ip5_in_out_10_3/00_ip5_in_out_10_3.lst", "r");
+	if (file_lst == NULL)
+	{
+		printf("ERR fopen software/ip5_in_out_10_3/00_ip5_in_out_10_3.lst\r\n");
+		return;
+	}
+	else
+	{
+		printf("fopen: software/ip5_in_out_10_3/00_ip5_in_out_10_3.lst\r\n");
+
+		/* Чтение (построчно) данных из файла в бесконечном цикле */
+		while (1)
+		{
+			/* Чтение одной строки  из файла */
+			estr = fgets(str, sizeof(str), file_lst);
+
+			/* Проверка на конец файла или ошибку чтения */
+			if (estr == NULL)
+			{
+				/* Проверяем, что именно произошло: кончился файл */
+				/* или это ошибка чтения */
+				if (feof(file_lst) != 0)
+				{
+					/* Если файл закончился, выводим сообщение о завершении */
+					/* чтения и выходим из бесконечного цикла */
+					printf("\r\nЧтение файла закончено\r\n");
+					break;
+				}
+				else
+				{
+					/* Если при чтении произошла ошибка, выводим сообщение */
+					/* об ошибке и выходим из бесконечного цикла */
+					printf("\r\nОшибка чтения из файла\r\n");
+					break;
+				}
+			}
+
+			/* ---------------------------------
+			 * Загрузить из файла тест-программу
+			 * ---------------------------------
+			 */
+			printf("\r\n --- Load software/ip5_in_out_10_3/%s --- \r\n", str);
+
+			FILE *file;
+			char path_str[160] = {0};
+			uint8_t cmd[20];
+			trs_t inr;
+			trs_t dst;
+
+			inr = smtr("0---0"); /* cчетчик адреса коротких слов */
+			trs_t sum;
+			trs_t tmp;
+
+			tmp.l = 18;
+			tmp.t1 = 0;
+			tmp.t0 = 0;
+
+			int64_t dsun = 0;
+			sum.l = 18;
+			sum.t1 = 0;
+			sum.t0 = 0;
+			//
+			dst.l = 9;
+			setun.MR.l = 18;
+			int i = 0;
+
+			strcat(path_str, "software/ip5_in_out_10_3/");
+			if (str[strlen(str) - 1] == 0x0A)
+			{
+				str[strlen(str) - 1] = 0;
+			}
+			str[strlen(str)] = 0;
+			strcat(path_str, str);
+
+			file = fopen(path_str, "r");
+			if (file == NULL)
+			{
+				printf("ERR fopen %s\r\n", path_str);
+				return;
+			}
+
+			while (fscanf(file, "%s", cmd) != EOF)
+			{
+				cmd_str_2_trs(cmd, &dst);
+				sum = add_trs(sum, dst);
+				i += 1;
+
+				dsun += trs2digit(dst);
+
+				LOGGING_print("%s -> [", cmd);
+				trs2str(dst);
+				LOGGING_print("]");
+				if (LOGGING > 0)
+				{
+					view_short_reg(&inr, " addr");
+				}
+				else
+				{
+					printf("\r\n");
+				}
+
+				st_fram(&setun, inr, dst);
+				inr = next_address(inr);
+			}
+			fclose(file);
+
+			printf("\r\n i=%i\r\n", i);
+
+			/* Печать контрольных сумм */
+			printf("\r\n");
+			view_checksum_setun(sum);
+			//
+		}
+	}
+	fclose(file_lst);
+	printf("fclose: software/ip5_in_out_10_3/00_ip5_in_out.lst\r\n");
+
+	printf("\r\n --- END TEST #6 --- \r\n");
+}
+
+void Test7_Setun_Load(void)
+{
+	printf("\r\n --- TEST #7  Load program FT1,FT2 for VM SETUN-1958 --- \r\n\r\n");
+
+	FILE *file_lst;
+
+	/* Переменная, в которую поочередно будут помещаться считываемые строки */
+	char str[80] = {0};
+
+	/* Указатель, в который будет помещен адрес массива, в который считана */
+	/* строка, или NULL если достигнут коней файла или произошла ошибка */
+	char *estr;
+
+	file_lst = fopen("software/ip5_in_out_3_10/00_ip5_in_out_3_10.lst", "r");
+	if (file_lst == NULL)
+	{
+		printf("ERR fopen software/ip5_in_out_3_10/00_ip5_in_out_3_10.lst\r\n");
+		return;
+	}
+	else
+	{
+		printf("fopen: software/ip5_in_out_3_10/00_ip5_in_out_3_10.lst\r\n");
+
+		/* Чтение (построчно) данных из файла в бесконечном цикле */
+		while (1)
+		{
+			/* Чтение одной строки  из файла */
+			estr = fgets(str, sizeof(str), file_lst);
+
+			/* Проверка на конец файла или ошибку чтения */
+			if (estr == NULL)
+			{
+				/* Проверяем, что именно произошло: кончился файл */
+				/* или это ошибка чтения */
+				if (feof(file_lst) != 0)
+				{
+					/* Если файл закончился, выводим сообщение о завершении */
+					/* чтения и выходим из бесконечного цикла */
+					printf("\r\nЧтение файла закончено\r\n");
+					break;
+				}
+				else
+				{
+					/* Если при чтении произошла ошибка, выводим сообщение */
+					/* об ошибке и выходим из бесконечного цикла */
+					printf("\r\nОшибка чтения из файла\r\n");
+					break;
+				}
+			}
+
+			/* ---------------------------------
+			 * Загрузить из файла тест-программу
+			 * ---------------------------------
+			 */
+			printf("\r\n --- Load software/ip5_in_out_3_10/%s --- \r\n", str);
+
+			FILE *file;
+			char path_str[160] = {0};
+			uint8_t cmd[20];
+			trs_t inr;
+			trs_t dst;
+
+			inr = smtr("0---0"); /* cчетчик адреса коротких слов */
+			trs_t sum;
+			trs_t tmp;
+
+			tmp.l = 18;
+			tmp.t1 = 0;
+			tmp.t0 = 0;
+
+			int64_t dsun = 0;
+			sum.l = 18;
+			sum.t1 = 0;
+			sum.t0 = 0;
+			//
+			dst.l = 9;
+			setun.MR.l = 18;
+			int i = 0;
+
+			strcat(path_str, "software/ip5_in_out_3_10/");
+			if (str[strlen(str) - 1] == 0x0A)
+			{
+				str[strlen(str) - 1] = 0;
+			}
+			str[strlen(str)] = 0;
+			strcat(path_str, str);
+
+			file = fopen(path_str, "r");
+			if (file == NULL)
+			{
+				printf("ERR fopen %s\r\n", path_str);
+				return;
+			}
+
+			cmd_str_2_trs(cmd, &dst);
+			sum = add_trs(sum, dst);
+			i += 1;
+
+			LOGGING_print("%s -> [", cmd);
+			trs2str(dst);
+			LOGGING_print("]");
+			if (LOGGING > 0)
+			{
+				view_short_reg(&inr, " addr");
+			}
+			else
+			{
+				printf("\r\n");
+			}
+
+			st_fram(&setun, inr, dst);
+			inr = next_address(inr);
+			fclose(file);
+
+			/* Печать контрольных сумм */
+			printf("\r\n");
+			view_checksum_setun(sum);
+		}
+		// printf("\r\n i=%i\r\n", i);
+		//
+	}
+
+	fclose(file_lst);
+	printf("fclose: software/ip5_in_out_3_10/00_ip5_in_out_3_10.lst\r\n");
+	printf("\r\n --- END TEST #7 --- \r\n");
+}
+
+void Test8_Setun_Electrified_Typewriter(void)
+{
+	printf("\r\n --- TEST #8 electrified_typewriter() and dump --- \r\n");
+
+	trs_t inr;
+	trs_t cp;
+	clear(&cp);
+	cp.l = 3;
+	cp = set_trit_setun(cp, 1, -1);
+	cp = set_trit_setun(cp, 2, -1);
+	cp = set_trit_setun(cp, 3, -1);
+
+	uint8_t cc;
+
+	cp = set_trit_setun(cp, 1, 1);
+	cp = set_trit_setun(cp, 2, 1);
+	cp = set_trit_setun(cp, 3, 0);
+	electrified_typewriter(&setun, cp, 0);
+
+	cp = set_trit_setun(cp, 1, -1);
+	cp = set_trit_setun(cp, 2, -1);
+	cp = set_trit_setun(cp, 3, -1);
+	for (cc = 0; cc < 27; cc++)
+	{
+		if (trs2digit(cp) != 12 || trs2digit(cp) != 11)
+		{
+			electrified_typewriter(&setun, cp, 0);
+		}
+		inc_trs(&cp);
+	}
+
+	cp = set_trit_setun(cp, 1, 1);
+	cp = set_trit_setun(cp, 2, 1);
+	cp = set_trit_setun(cp, 3, -1);
+	electrified_typewriter(&setun, cp, 0);
+
+	cp = set_trit_setun(cp, 1, -1);
+	cp = set_trit_setun(cp, 2, -1);
+	cp = set_trit_setun(cp, 3, -1);
+	for (cc = 0; cc < 27; cc++)
+	{
+		if (trs2digit(cp) != 12 || trs2digit(cp) != 11)
+		{
+			electrified_typewriter(&setun, cp, 0);
+		}
+		inc_trs(&cp);
+	}
+
+	cp = set_trit_setun(cp, 1, 1);
+	cp = set_trit_setun(cp, 2, 1);
+	cp = set_trit_setun(cp, 3, 0);
+	electrified_typewriter(&setun, cp, 1);
+
+	cp = set_trit_setun(cp, 1, -1);
+	cp = set_trit_setun(cp, 2, -1);
+	cp = set_trit_setun(cp, 3, -1);
+	for (cc = 0; cc < 27; cc++)
+	{
+		if (trs2digit(cp) != 12 || trs2digit(cp) != 11)
+		{
+			electrified_typewriter(&setun, cp, 1);
+		}
+		inc_trs(&cp);
+	}
+
+	cp = set_trit_setun(cp, 1, 1);
+	cp = set_trit_setun(cp, 2, 1);
+	cp = set_trit_setun(cp, 3, -1);
+	electrified_typewriter(&setun, cp, 1);
+
+	cp = set_trit_setun(cp, 1, -1);
+	cp = set_trit_setun(cp, 2, -1);
+	cp = set_trit_setun(cp, 3, -1);
+	for (cc = 0; cc < 27; cc++)
+	{
+		if (trs2digit(cp) != 12 || trs2digit(cp) != 11)
+		{
+			electrified_typewriter(&setun, cp, 1);
+		}
+		inc_trs(&cp);
+	}
+	tty_flush(&setun);
+
+	printf("\r\n --- smtr() --- \r\n");
+	setun.R = smtr("-+0+-");
+	view_short_reg(&setun.R, "R");
+
+	setun.R = smtr("---------");
+	view_short_reg(&setun.R, "R");
+
+	setun.R = smtr("+++++++++");
+	view_short_reg(&setun.R, "R");
+
+	// -----------------------------------------------
+	trs_t exK;
+	trs_t oper;
+	trs_t m0;
+	trs_t m1;
+	trs_t addr;
+	trs_t ad1;
+	trs_t ad2;
+	uint8_t ret_exec;
+
+	// t19 test Oper=k6..8[+00]: (A*)=>(S)
+	printf("\r\nt19: test Oper=k6..8[+00]: (A*)=>(S)\r\n");
+
+	reset_setun_1958(&setun);
+
+	setun.F = smtr("000++");
+
+	addr = smtr("000++");
+	view_short_reg(&addr, "addr=");
+	m0 = smtr("0++++++++");
+	st_fram(&setun, addr, m0);
+
+	addr = smtr("-000-");
+	view_short_reg(&addr, "addr=");
+	m0 = smtr("0++++++++0-------");
+	st_fram(&setun, addr, m0);
+
+	addr = smtr("000-0");
+	view_short_reg(&addr, "addr=");
+	m0 = smtr("0--------");
+	st_fram(&setun, addr, m0);
+
+	addr = smtr("00000");
+	view_short_reg(&addr, "addr=");
+	m0 = smtr("+0-0+0-00");
+	st_fram(&setun, addr, m0);
+
+	addr = smtr("0000+");
+	m1 = smtr("-000-0+000");
+	st_fram(&setun, addr, m1);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+
+	printf("\r\nreg C = 00001\r\n");
+
+	/**
+	 * work VM Setun-1958
+	 */
+	setun.K = ld_fram(&setun, setun.C);
+	exK = control_trs(&setun, setun.K);
+	view_short_reg(&setun.K, "K=");
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	printf("ret_exec = %i\r\n", ret_exec);
+	printf("\r\n");
+
+	addr = smtr("0000+");
+	m1 = smtr("-000-+000");
+	st_fram(&setun, addr, m1);
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+
+	printf("\r\nreg C = 00001\r\n");
+
+	/**
+	 * work VM Setun-1958
+	 */
+	setun.K = ld_fram(&setun, setun.C);
+	exK = control_trs(&setun, setun.K);
+	view_short_reg(&setun.K, "K=");
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	printf("ret_exec = %i\r\n", ret_exec);
+	printf("\r\n");
+
+	view_short_regs(&setun);
+
+	/* Begin address fram */
+	setun.C = smtr("000+0");
+	printf("\r\nreg C = 00010\r\n");
+
+	addr = smtr("000+0");
+	m1 = smtr("00000+0--");
+	st_fram(&setun, addr, m1);
+
+	/**
+	 * work VM Setun-1958
+	 */
+	setun.K = ld_fram(&setun, setun.C);
+	exK = control_trs(&setun, setun.K);
+	view_short_reg(&setun.K, "K=");
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	printf("ret_exec = %i\r\n", ret_exec);
+	printf("\r\n");
+
+	ad1 = smtr("000-0");
+	ad2 = smtr("00+-0");
+	view_fram(&setun, ad1, ad2);
+
+	view_short_regs(&setun);
+
+	/* Begin address fram */
+	setun.C = smtr("000++");
+	printf("\r\nreg C = 00011\r\n");
+
+	addr = smtr("000++");
+	m1 = smtr("00000++00");
+	st_fram(&setun, addr, m1);
+
+	/**
+	 * work VM Setun-1958
+	 */
+	setun.K = ld_fram(&setun, setun.C);
+	exK = control_trs(&setun, setun.K);
+	view_short_reg(&setun.K, "K=");
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	printf("ret_exec = %i\r\n", ret_exec);
+	printf("\r\n");
+
+	ad1 = smtr("000-0");
+	ad2 = smtr("00+-0");
+	view_fram(&setun, ad1, ad2);
+
+	view_short_regs(&setun);
+
+	// t20 test mul_trs()
+
+	trs_t res;
+	res.l = 18;
+	res.t1 = 0;
+	res.t0 = 0;
+
+	setun.S = smtr("0000000-0000000+++");
+	setun.R = smtr("000000000-00+000-");
+	res = mul_trs(setun.S, setun.R);
+
+	view_short_reg(&setun.S, " S");
+	view_short_reg(&setun.R, " R");
+	view_short_reg(&res, "res = S*R");
+
+	// t21 test Oper=k6..8[+00]: (A*)=>(S)
+	printf("\r\nt19: test Oper=k6..8[+00]: (A*)=>(S)\r\n");
+
+	reset_setun_1958(&setun);
+
+	setun.F = smtr("000++");
+
+	addr = smtr("000++");
+	view_short_reg(&addr, "addr=");
+	m0 = smtr("0++++++++");
+	st_fram(&setun, addr, m0);
+
+	addr = smtr("000--");
+	view_short_reg(&addr, "addr=");
+	m0 = smtr("0++++++++");
+	st_fram(&setun, addr, m0);
+
+	addr = smtr("000-0");
+	view_short_reg(&addr, "addr=");
+	m0 = smtr("0--------");
+	st_fram(&setun, addr, m0);
+
+	addr = smtr("00000");
+	view_short_reg(&addr, "addr=");
+	m0 = smtr("+0-0+0-00");
+	st_fram(&setun, addr, m0);
+
+	addr = smtr("0000+");
+	m1 = smtr("00000++00");
+	st_fram(&setun, addr, m1);
+
+	setun.S = smtr("000000000-00+000-+");
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+
+	printf("\r\nreg C = 00001\r\n");
+
+	/**
+	 * work VM Setun-1958
+	 */
+	setun.K = ld_fram(&setun, setun.C);
+	exK = control_trs(&setun, setun.K);
+	view_short_reg(&setun.K, "K=");
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	printf("ret_exec = %i\r\n", ret_exec);
+	printf("\r\n");
+
+	// views
+	ad1 = smtr("000-0");
+	ad2 = smtr("00+-0");
+	view_fram(&setun, ad1, ad2);
+
+	view_short_regs(&setun);
+
+	printf("\r\nt22: test Oper=k6..8[-+-]: Норм.(S)=>(A*); (N)=>(S)\r\n");
+
+	reset_setun_1958(&setun);
+
+	setun.F = smtr("000++");
+
+	addr = smtr("000++");
+	view_short_reg(&addr, "addr=");
+	m0 = smtr("0++++++++");
+	st_fram(&setun, addr, m0);
+
+	addr = smtr("000--");
+	view_short_reg(&addr, "addr=");
+	m0 = smtr("0++++++++");
+	st_fram(&setun, addr, m0);
+
+	addr = smtr("000-0");
+	view_short_reg(&addr, "addr=");
+	m0 = smtr("0--------");
+	st_fram(&setun, addr, m0);
+
+	addr = smtr("00000");
+	view_short_reg(&addr, "addr=");
+	m0 = smtr("+0-0+0-00");
+	st_fram(&setun, addr, m0);
+
+	addr = smtr("0000+");
+	m1 = smtr("00000-+-0");
+	st_fram(&setun, addr, m1);
+
+	setun.S = smtr("000000000-00+000-+");
+	view_short_reg(&setun.S, "S=");
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+
+	printf("\r\nreg C = 00001\r\n");
+
+	/**
+	 * work VM Setun-1958
+	 */
+	setun.K = ld_fram(&setun, setun.C);
+	exK = control_trs(&setun, setun.K);
+	view_short_reg(&setun.K, "K=");
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	printf("ret_exec = %i\r\n", ret_exec);
+	printf("\r\n");
+
+	// views
+	ad1 = smtr("000-0");
+	ad2 = smtr("00+-0");
+	// view_fram(ad1, ad2);
+
+	view_short_regs(&setun);
+
+	// t22 test DRUM
+	printf("t22 test zone for drum()\r\n");
+	uint32_t nz;
+
+	printf(" ad1 ='000+'");
+	ad1 = smtr("000+");
+	nz = zone_drum_to_index(ad1);
+	printf(" nz = %i\r\n", nz);
+
+	printf(" ad1 ='00+-2'");
+	ad1 = smtr("00+-");
+	nz = zone_drum_to_index(ad1);
+	printf(" nz = %i\r\n", nz);
+
+	printf(" ad1 ='00+0'");
+	ad1 = smtr("00+0");
+	nz = zone_drum_to_index(ad1);
+	printf(" nz = %i\r\n", nz);
+
+	printf("t23 test zone for view_drum()\r\n");
+
+	printf(" z ='0+--'");
+	ad1 = smtr("0+--");
+	view_drum_zone(&setun, ad1);
+
+	printf(" z ='++++'");
+	ad1 = smtr("++++");
+	view_drum_zone(&setun, ad1);
+
+	printf("\r\nt24 test DRUN fill index and view \r\n");
+
+	inr.l = 9;
+	inr = smtr("000000000");
+
+	trs_t zi;
+	zi.l = 4;
+	zi = smtr("000+"); //-17
+
+	for (uint8_t zz = 0; zz < NUMBER_ZONE_DRUM; zz++)
+	{
+		for (uint8_t mm = 0; mm < SIZE_ZONE_TRIT_FRAM; mm++)
+		{
+			st_drum(&setun, zi, mm, inr);
+			inc_trs(&inr);
+		}
+		inc_trs(&zi);
+	}
+
+	printf("\r\nt25 test oper='-0-' (Мд*)=>(Фа*) \r\n");
+
+	addr = smtr("0000+");
+	m1 = smtr("00+---0-0"); //-0-
+	st_fram(&setun, addr, m1);
+
+	setun.S = smtr("000000000-00+000-+");
+	view_short_reg(&setun.S, "S=");
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+
+	printf("\r\nreg C = 00001\r\n");
+
+	/**
+	 * work VM Setun-1958
+	 */
+	setun.K = ld_fram(&setun, setun.C);
+	exK = control_trs(&setun, setun.K);
+	view_short_reg(&setun.K, "K=");
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	printf("ret_exec = %i\r\n", ret_exec);
+
+	setun.C = smtr("0000+");
+	addr = smtr("0000+");
+	m1 = smtr("000+--0+0"); //-0+
+	st_fram(&setun, addr, m1);
+
+	setun.K = ld_fram(&setun, setun.C);
+	exK = control_trs(&setun, setun.K);
+	view_short_reg(&setun.K, "K=");
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	printf("ret_exec = %i\r\n", ret_exec);
+
+	printf("DRUM zone='0+--'");
+	ad1 = smtr("0+--");
+	view_drum_zone(&setun, ad1);
+	printf("\r\n");
+	//
+	printf("DRUM zone='0+--'");
+	ad1 = smtr("0+--");
+	view_drum_zone(&setun, ad1);
+	printf("\r\n");
+
+	printf("\r\n --- END TEST #8 --- \r\n");
+}
+
+// Вывод "бумажной ленты.
+void Test9_Perforatin_Paper_Line(void)
+{
+	int8_t trit;
+	trs_t aa;
+	trs_t ad1;
+	trs_t ad2;
+	trs_t addr;
+	trs_t oper;
+	trs_t exK;
+	trs_t m0;
+	trs_t m1;
+	int8_t ret_exec;
+
+	printf("\r\n --- TEST #9 Perforatin paper line --- \r\n");
+
+	// t11.1 test Oper=k6..8[+00]: (A*)=>(S)
+	printf("\r\nt11.1:  Oper=k6..8[+00]: (A*)=>(S)\r\n");
+	//
+	reset_setun_1958(&setun);
+
+	/* Инициализация таблиц символов ввода и вывода "Сетунь-1958" */
+	init_tab4();
+
+	/* ---------------------------------------
+	 *  Открыть файлы для виртуальных устройств
+	 */
+	setun.ptr1 = fopen("ptr1/paper.txt", "r");
+	if (setun.ptr1 == NULL)
+	{
+		printf("Error fopen 'ptr1/paper.txt'\r\n");
+		return;
+	}
+
+	setun.ptr2 = fopen("ptr2/paper.txt", "r");
+	if (setun.ptr2 == NULL)
+	{
+		printf("Error fopen 'ptr1/paper.txt'\r\n");
+		return;
+	}
+
+	setun.ptp1 = fopen("ptp1/paper.txt", "w");
+	if (setun.ptp1 == NULL)
+	{
+		printf("Error fopen 'ptp1/paper.txt'\r\n");
+		return;
+	}
+
+	setun.tty1 = fopen("tty1/printout.txt", "w");
+	if (setun.tty1 == NULL)
+	{
+		printf("Error fopen 'tty1/printout.txt'\r\n");
+		return;
+	}
+
+	/* ----------------------------------
+	 *  Выполнить первый код "Сетунь-1958"
+	 */
+	printf("\r\n[ Start Setun-1958 ]\r\n");
+
+	/**
+	 * Выполение программы в ферритовой памяти "Сетунь-1958"
+	 */
+	Begin_Read_Commands_from_FT1(&setun, setun.ptr1);
+
+	//
+	addr = smtr("0000+");
+	m0 = smtr("00+00-000");
+	st_fram(&setun, addr, m0);
+	view_elem_fram(&setun, addr);
+	//
+
+	/* Begin address fram */
+	setun.C = smtr("0000+");
+	printf("\r\nreg C = 00001\r\n");
+
+	// work VM Setun-1958
+	setun.K = ld_fram(&setun, setun.C);
+
+	exK = control_trs(&setun, setun.K);
+	oper = slice_trs_setun(setun.K, 6, 8);
+	ret_exec = execute_trs(&setun, exK, oper);
+	//
+	if (ret_exec == 0)
+		printf("[status: OK']\r\n");
+	if (ret_exec != 0)
+		printf("[status: ERR#%d]\r\n", ret_exec);
+	printf("\r\n");
+	//
+	view_short_regs(&setun);
+
+	trs_t fa;
+	fa = smtr("0---0");
+
+	dump_fram_zone(&setun, smtr("0"));
+
+	printf("\r\n --- END TEST #9 --- \r\n");
+}
+
+void Test10_LoadSWSetun(void)
+{
+	printf("\r\n --- Load software anf DUMP FRAM  for VM SETUN-1958 --- \r\n\r\n");
+
+	FILE *file_lst;
+
+	/* Переменная, в которую поочередно будут помещаться считываемые строки */
+	char str[80] = {0};
+
+	/* Указатель, в который будет помещен адрес массива, в который считана */
+	/* строка, или NULL если достигнут коней файла или произошла ошибка */
+	char *estr;
+
+	file_lst = fopen("software/tests/01-test-fram.lst", "r");
+	if (file_lst == NULL)
+	{
+		printf("ERR fopen software/tests/01-test-fram.lst\r\n");
+		return;
+	}
+	else
+	{
+		printf("fopen: software/tests/01-test-fram.lst\r\n");
+
+		/* Чтение (построчно) данных из файла в бесконечном цикле */
+		while (1)
+		{
+			/* Чтение одной строки  из файла */
+			estr = fgets(str, sizeof(str), file_lst);
+
+			/* Проверка на конец файла или ошибку чтения */
+			if (estr == NULL)
+			{
+				/* Проверяем, что именно произошло: кончился файл */
+				/* или это ошибка чтения */
+				if (feof(file_lst) != 0)
+				{
+					/* Если файл закончился, выводим сообщение о завершении */
+					/* чтения и выходим из бесконечного цикла */
+					printf("\r\nЧтение файла закончено\r\n");
+					break;
+				}
+				else
+				{
+					/* Если при чтении произошла ошибка, выводим сообщение */
+					/* об ошибке и выходим из бесконечного цикла */
+					printf("\r\nОшибка чтения из файла\r\n");
+					break;
+				}
+			}
+
+			/* ---------------------------------
+			 * Загрузить из файла тест-программу
+			 * ---------------------------------
+			 */
+			printf("\r\n Load software/tests/%s\r\n", str);
+
+			FILE *file;
+			char path_str[160] = {0};
+			uint8_t cmd[20];
+			trs_t inr;
+			trs_t dst;
+
+			inr = smtr("0---0"); /* cчетчик адреса коротких слов */
+			trs_t sum;
+			trs_t tmp;
+
+			tmp.l = 18;
+			tmp.t1 = 0;
+			tmp.t0 = 0;
+
+			int64_t dsun = 0;
+			sum.l = 18;
+			sum.t1 = 0;
+			sum.t0 = 0;
+			//
+			dst.l = 9;
+			setun.MR.l = 18;
+			int i = 0;
+
+			strcat(path_str, "software/tests/");
+			if (str[strlen(str) - 1] == 0x0A)
+			{
+				str[strlen(str) - 1] = 0;
+			}
+			str[strlen(str)] = 0;
+			strcat(path_str, str);
+
+			file = fopen(path_str, "r");
+			if (file == NULL)
+			{
+				printf("ERR fopen %s\r\n", path_str);
+				return;
+			}
+
+			while (fscanf(file, "%s", cmd) != EOF)
+			{
+				cmd_str_2_trs(cmd, &dst);
+				sum = add_trs(sum, dst);
+				i += 1;
+
+				dsun += trs2digit(dst);
+
+				LOGGING_print("%s -> [", cmd);
+				trs2str(dst);
+				LOGGING_print("]");
+				if (LOGGING > 0)
+				{
+					view_short_reg(&inr, " addr");
+				}
+				else
+				{
+					printf("\r\n");
+				}
+
+				st_fram(&setun, inr, dst);
+				inr = next_address(inr);
+			}
+			fclose(file);
+
+			printf("\r\n i=%i\r\n", i);
+
+			/* Печать контрольных сумм */
+			printf("\r\n");
+			view_checksum_setun(sum);
+		}
+	}
+	fclose(file_lst);
+
+	// dump_fram_zone(smtr("0"));
+	// dump_fram_zone(smtr("+"));
+	// dump_fram_zone(smtr("-"));
+
+	printf("\r\n END TEST#10 Load software\r\n");
+}
+
+/**
+ * Тестовая программа для замеров скорости работы ядра.
+ * Цикл из арифметических операций S, R, F и безусловного перехода
+ * в зоне 0 FRAM, данные в зоне +. Переполнения не возникает,
+ * программа работает бесконечно.
+ */
+static const char *bench_prog[][2] = {
+	{"0000+", "+0000+000"}, /* +00 : (A*)=>(S)             */
+	{"000+0", "+000++0+0"}, /* +0+ : (S)+(A*)=>(S)         */
+	{"000++", "+000++0-0"}, /* +0- : (S)-(A*)=>(S)         */
+	{"00+-0", "+00+0+-+0"}, /* +-+ : (A*)=>(R)             */
+	{"00+-+", "+0000++00"}, /* ++0 : (S)=>(R); (A*)(R)=>(S) */
+	{"00+00", "+00++-++0"}, /* -++ : (S)=>(A*)             */
+	{"00+0+", "+0+-00--0"}, /* 0-- : (F)+(A*)=>(F)         */
+	{"00++0", "+0000+-00"}, /* +-0 : (A*)[x](S)=>(S)       */
+	{"00+++", "0000+0000"}	/* 000 : A*=>(C)               */
+};
+
+static const char *bench_data[][2] = {
+	{"+0000", "000+0-+00"},
+	{"+000+", "0000+-0+0"},
+	{"+00+0", "00+-00+00"},
+	{"+0+-0", "0000+0000"}};
+
+void Load_Bench_Program(setun_machine_t *m)
+{
+	reset_setun_1958(m);
+
+	for (uint8_t i = 0; i < sizeof(bench_prog) / sizeof(bench_prog[0]); i++)
+	{
+		st_fram(m, smtr((uint8_t *)bench_prog[i][0]), smtr((uint8_t *)bench_prog[i][1]));
+	}
+	for (uint8_t i = 0; i < sizeof(bench_data) / sizeof(bench_data[0]); i++)
+	{
+		st_fram(m, smtr((uint8_t *)bench_data[i][0]), smtr((uint8_t *)bench_data[i][1]));
+	}
+
+	m->C = smtr("0000+");
+}
+
+#define BENCH_STEPS (2000000)
+
+/* Скорость выполнения Emu_Step() и run_for() на одном экземпляре машины */
+void Test11_Setun_Bench_Step(void)
+{
+	uint32_t n;
+	uint64_t done;
+	double t;
+
+	printf("\r\n --- TEST #11 Bench Emu_Step(), run_for() for VM SETUN-1958 --- \r\n\r\n");
+
+	Load_Bench_Program(&setun);
+
+	t = time_monotonic();
+	for (n = 0; n < BENCH_STEPS; n++)
+	{
+		if (Emu_Step(&setun) != OK)
+		{
+			break;
+		}
+	}
+	t = time_monotonic() - t;
+
+	printf(" Emu_Step: steps = %u, time = %.3f s, %.0f instr/s\r\n", n, t, n / t);
+	view_short_regs(&setun);
+
+	Load_Bench_Program(&setun);
+
+	/* Цикл тестовой программы периодичен, без обнаружения холостого цикла */
+	uint8_t idle = IDLE_DETECT;
+	IDLE_DETECT = IDLE_OFF;
+	t = time_monotonic();
+	run_for(&setun, BENCH_STEPS, &done);
+	t = time_monotonic() - t;
+	IDLE_DETECT = idle;
+
+	printf("\r\n run_for:  steps = %llu, time = %.3f s, %.0f instr/s\r\n",
+		   (unsigned long long)done, t, done / t);
+	view_short_regs(&setun);
+
+	printf("\r\n --- END TEST #11 --- \r\n");
+}
+
+#define NATIVE_PROGRAMS (4000)	 /* число случайных программ */
+#define NATIVE_PROG_STEPS (2000) /* команд на одну программу */
+
+static uint32_t native_rnd_state = 2463534242;
+
+/* Псевдослучайное число xorshift32 */
+uint32_t native_rnd(void)
+{
+	native_rnd_state ^= native_rnd_state << 13;
+	native_rnd_state ^= native_rnd_state >> 17;
+	native_rnd_state ^= native_rnd_state << 5;
+	return native_rnd_state;
+}
+
+/* Случайное троичное число длиной l тритов */
+trs_t native_rnd_trs(uint8_t l)
+{
+	trs_t r;
+	r.l = l;
+	r.t0 = native_rnd() & (0xFFFFFFFF >> (SIZE_TRITS_MAX - l));
+	r.t1 = native_rnd() & r.t0;
+	return r;
+}
+
+/* Равенство значений тритов двух регистров */
+uint8_t native_trs_equal(trs_t a, trs_t b)
+{
+	uint32_t mask = 0xFFFFFFFF >> (SIZE_TRITS_MAX - min(a.l, SIZE_WORD_LONG));
+	return (a.l == b.l) &&
+		   ((a.t0 & mask) == (b.t0 & mask)) &&
+		   ((a.t1 & a.t0 & mask) == (b.t1 & b.t0 & mask));
+}
+
+/* Имя первого различающегося регистра или NULL */
+const char *native_diff(setun_machine_t *a, setun_machine_t *b)
+{
+	if (!native_trs_equal(a->K, b->K)) return "K";
+	if (!native_trs_equal(a->F, b->F)) return "F";
+	if (!native_trs_equal(a->C, b->C)) return "C";
+	if (!native_trs_equal(a->W, b->W)) return "W";
+	if (!native_trs_equal(a->ph1, b->ph1)) return "ph1";
+	if (!native_trs_equal(a->ph2, b->ph2)) return "ph2";
+	if (!native_trs_equal(a->S, b->S)) return "S";
+	if (!native_trs_equal(a->R, b->R)) return "R";
+	if (!native_trs_equal(a->MB, b->MB)) return "MB";
+	if (!native_trs_equal(a->MR, b->MR)) return "MR";
+	for (uint8_t r = 0; r < SIZE_GR_TRIT_FRAM; r++)
+	{
+		for (uint8_t h = 0; h < SIZE_GRFRAM; h++)
+		{
+			if (!native_trs_equal(a->mem_fram[r][h], b->mem_fram[r][h])) return "FRAM";
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Режим целочисленных регистров против потритного выполнения.
+ * Случайные программы выполняются на двух машинах, состояние регистров
+ * и FRAM сравнивается после каждой команды (чётные программы) или
+ * только после останова (нечётные, проверка ленивой материализации).
+ */
+void Test12_Setun_Native(void)
+{
+	static setun_machine_t ma;
+	static setun_machine_t mb;
+	uint32_t prog, n;
+	uint32_t errors = 0;
+	uint64_t steps = 0;
+	uint64_t done;
+	int ra, rb;
+	const char *diff;
+	double t, tn;
+
+	printf("\r\n --- TEST #12 Native registers S, R, F for VM SETUN-1958 --- \r\n\r\n");
+
+	for (prog = 0; prog < NATIVE_PROGRAMS; prog++)
+	{
+		init_setun_machine(&ma);
+		for (uint8_t r = 0; r < SIZE_GR_TRIT_FRAM; r++)
+		{
+			for (uint8_t h = 0; h < SIZE_GRFRAM; h++)
+			{
+				/* Без незадействованных кодов --0, --+, --- */
+				do
+				{
+					ma.mem_fram[r][h] = native_rnd_trs(SIZE_WORD_SHORT);
+				} while ((get_trit_setun(ma.mem_fram[r][h], 6) < 0) &&
+						 (get_trit_setun(ma.mem_fram[r][h], 7) < 0));
+			}
+		}
+		ma.S = native_rnd_trs(18);
+		ma.R = native_rnd_trs(18);
+		ma.F = native_rnd_trs(5);
+		ma.W = native_rnd_trs(1);
+		ma.C = native_rnd_trs(5);
+
+		mb = ma;
+		set_native_mode(&mb, 1);
+
+		diff = NULL;
+		for (n = 0; n < NATIVE_PROG_STEPS; n++)
+		{
+			ra = Emu_Step(&ma);
+			rb = Emu_Step(&mb);
+			if (ra != rb)
+			{
+				diff = "status";
+				break;
+			}
+			if (((prog & 1) == 0) || (ra != OK) || (n == NATIVE_PROG_STEPS - 1))
+			{
+				native_sync(&mb);
+				diff = native_diff(&ma, &mb);
+				if (diff != NULL)
+				{
+					break;
+				}
+			}
+			if (ra != OK)
+			{
+				break;
+			}
+		}
+		steps += n;
+
+		if (diff != NULL)
+		{
+			errors++;
+			if (errors <= 5)
+			{
+				printf(" ERR prog=%u step=%u reg=%s status %i/%i\r\n", prog, n, diff, ra, rb);
+				view_short_regs(&ma);
+				view_short_regs(&mb);
+				printf("\r\n");
+			}
+		}
+	}
+
+	printf(" programs = %u, instructions = %llu, errors = %u\r\n",
+		   NATIVE_PROGRAMS, (unsigned long long)steps, errors);
+
+	/* Скорость на тестовой программе */
+	uint8_t idle = IDLE_DETECT;
+	IDLE_DETECT = IDLE_OFF;
+	init_setun_machine(&ma);
+	Load_Bench_Program(&ma);
+	t = time_monotonic();
+	run_for(&ma, BENCH_STEPS, &done);
+	t = time_monotonic() - t;
+	printf("\r\n trits:  steps = %llu, %.0f instr/s\r\n", (unsigned long long)done, done / t);
+
+	init_setun_machine(&mb);
+	set_native_mode(&mb, 1);
+	Load_Bench_Program(&mb);
+	tn = time_monotonic();
+	run_for(&mb, BENCH_STEPS, &done);
+	tn = time_monotonic() - tn;
+	printf(" native: steps = %llu, %.0f instr/s (x%.2f)\r\n", (unsigned long long)done, done / tn, t / tn);
+	IDLE_DETECT = idle;
+
+	native_sync(&mb);
+	printf(" bench registers %s\r\n", native_diff(&ma, &mb) == NULL ? "equal" : "DIFFER");
+
+	printf("\r\n --- END TEST #12 --- \r\n");
+}
+
+#define OPER_BENCH_STEPS (1000000)
+
+/* Выборка A* через ld_fram() с расширением до 18 тритов */
+trs_t fetch_operand_ref(setun_machine_t *m, trs_t ea)
+{
+	trs_t r = ld_fram(m, ea);
+	mod_3_n(&r, r.l);
+	if (r.l != 18)
+	{
+		r.l = 18;
+		r = shift_trs(r, 9);
+		mod_3_n(&r, r.l);
+	}
+	return r;
+}
+
+/**
+ * Выборка операнда fetch_operand() для всех адресов A(1:5)
+ * и время выполнения команд S и R в execute_trs()
+ */
+void Test13_Setun_Oper_Cost(void)
+{
+	static const char *opers[] = {"+00", "+0+", "+0-", "++0", "+++", "++-", "+-0", "+-+", "+--"};
+	static const char *addrs[] = {"000+00000", "000+-0000"}; /* короткое и длинное слово */
+	trs_t ea, a, b, oper, addr, c0;
+	uint32_t i, n;
+	uint32_t errors = 0;
+	double t;
+
+	printf("\r\n --- TEST #13 Operand fetch and S/R opcode cost for VM SETUN-1958 --- \r\n\r\n");
+
+	init_setun_machine(&setun);
+	for (uint8_t r = 0; r < SIZE_GR_TRIT_FRAM; r++)
+	{
+		for (uint8_t h = 0; h < SIZE_GRFRAM; h++)
+		{
+			setun.mem_fram[r][h] = native_rnd_trs(SIZE_WORD_SHORT);
+		}
+	}
+
+	for (i = 0; i < POW3_5; i++)
+	{
+		ea = int2trs((int32_t)i - HALF3_5, 5);
+		a = fetch_operand(&setun, ea);
+		b = fetch_operand_ref(&setun, ea);
+		if (!native_trs_equal(a, b))
+		{
+			errors++;
+			view_short_reg(&ea, "ERR A*");
+		}
+	}
+	printf(" fetch_operand: addresses = %u, errors = %u\r\n\r\n", POW3_5, errors);
+
+	c0 = smtr("0000+");
+	printf(" oper   short(ns)   long(ns)\r\n");
+	for (i = 0; i < sizeof(opers) / sizeof(opers[0]); i++)
+	{
+		oper = smtr((uint8_t *)opers[i]);
+		printf(" %s ", opers[i]);
+		for (uint8_t k = 0; k < 2; k++)
+		{
+			addr = smtr((uint8_t *)addrs[k]);
+			t = time_monotonic();
+			for (n = 0; n < OPER_BENCH_STEPS; n++)
+			{
+				setun.C = c0;
+				execute_trs(&setun, addr, oper);
+			}
+			t = time_monotonic() - t;
+			printf(" %10.1f", t * 1e9 / OPER_BENCH_STEPS);
+		}
+		printf("\r\n");
+	}
+
+	printf("\r\n --- END TEST #13 --- \r\n");
+}
+
+#define ADDR5_BENCH_STEPS (10000000)
+
+/**
+ * Таблицы next_address(), next_ind(), control_trs() против потритных
+ * реализаций для всех кодов A(1:5), F(1:5) и признака K(9)
+ */
+void Test14_Setun_Addr5_Tables(void)
+{
+	trs_t c, a, b, k;
+	uint32_t i, j, n;
+	int8_t k9;
+	uint32_t errors = 0;
+	uint32_t checks = 0;
+	double t, tr;
+
+	printf("\r\n --- TEST #14 Successor and index tables for VM SETUN-1958 --- \r\n\r\n");
+
+	init_setun_machine(&setun);
+
+	for (i = 0; i < TRS5_SIZE; i++)
+	{
+		c = tab_trs5[i];
+		if (!native_trs_equal(next_address(c), next_address_ref(c)))
+		{
+			errors++;
+			view_short_reg(&c, "ERR next_address");
+		}
+		if (!native_trs_equal(next_ind(c), next_ind_ref(c)))
+		{
+			errors++;
+			view_short_reg(&c, "ERR next_ind");
+		}
+		checks += 2;
+	}
+
+	for (i = 0; i < TRS5_SIZE; i++)
+	{
+		for (j = 0; j < TRS5_SIZE; j++)
+		{
+			setun.F = tab_trs5[j];
+			for (k9 = -1; k9 <= 1; k9++)
+			{
+				/* K(1:5) = A, K(6:8) и K(9) */
+				k = native_rnd_trs(9);
+				k.t1 = (tab_trs5[i].t1 << 4) | (k.t1 & 0xF);
+				k.t0 = (tab_trs5[i].t0 << 4) | (k.t0 & 0xF);
+				k = set_trit_setun(k, 9, k9);
+				a = control_trs(&setun, k);
+				b = control_trs_ref(&setun, k);
+				if (!native_trs_equal(a, b))
+				{
+					errors++;
+					if (errors < 10)
+					{
+						view_short_reg(&k, "ERR control K");
+						view_short_reg(&setun.F, "              F");
+					}
+				}
+				checks++;
+			}
+		}
+	}
+	printf(" checks = %u, errors = %u\r\n\r\n", checks, errors);
+
+	/* Время next_address() и control_trs() */
+	c = smtr("0000+");
+	t = time_monotonic();
+	for (n = 0; n < ADDR5_BENCH_STEPS; n++)
+	{
+		c = next_address(c);
+	}
+	t = time_monotonic() - t;
+	c = smtr("0000+");
+	tr = time_monotonic();
+	for (n = 0; n < ADDR5_BENCH_STEPS; n++)
+	{
+		c = next_address_ref(c);
+	}
+	tr = time_monotonic() - tr;
+	printf(" next_address: table %.1f ns, trits %.1f ns\r\n",
+		   t * 1e9 / ADDR5_BENCH_STEPS, tr * 1e9 / ADDR5_BENCH_STEPS);
+
+	setun.F = smtr("+0-0+");
+	k = smtr("000+00-0+");
+	t = time_monotonic();
+	for (n = 0; n < ADDR5_BENCH_STEPS; n++)
+	{
+		a = control_trs(&setun, k);
+	}
+	t = time_monotonic() - t;
+	tr = time_monotonic();
+	for (n = 0; n < ADDR5_BENCH_STEPS; n++)
+	{
+		a = control_trs_ref(&setun, k);
+	}
+	tr = time_monotonic() - tr;
+	printf(" control_trs:  table %.1f ns, trits %.1f ns\r\n",
+		   t * 1e9 / ADDR5_BENCH_STEPS, tr * 1e9 / ADDR5_BENCH_STEPS);
+
+	printf("\r\n --- END TEST #14 --- \r\n");
+}
+
+/* Программа: переход на себя */
+static const char *idle_self_prog[][2] = {
+	{"0000+", "0000+0000"}}; /* 000 : A*=>(C)  0000+ */
+
+/* Программа: цикл ожидания по признаку W */
+static const char *idle_wait_prog[][2] = {
+	{"0000+", "0+000+000"}, /* +00 : (A*)=>(S)          */
+	{"000+0", "0000+0++0"}, /* 0++ : A*=>(C) при w=+1   */
+	{"0+000", "+00000000"}};
+
+/* Программа: счёт в S до смены знака, затем переход на себя */
+static const char *idle_count_prog[][2] = {
+	{"0000+", "0+000+0+0"}, /* +0+ : (S)+(A*)=>(S)      */
+	{"000+0", "0000+0++0"}, /* 0++ : A*=>(C) при w=+1   */
+	{"000++", "000++0000"}, /* 000 : A*=>(C)  000++     */
+	{"0+000", "0000000+0"}};
+
+void Load_Idle_Program(setun_machine_t *m, const char *prog[][2], uint8_t n)
+{
+	init_setun_machine(m);
+	for (uint8_t i = 0; i < n; i++)
+	{
+		st_fram(m, smtr((uint8_t *)prog[i][0]), smtr((uint8_t *)prog[i][1]));
+	}
+	m->C = smtr("0000+");
+}
+
+#define IDLE_BENCH_STEPS (1000000)
+
+/**
+ * Обнаружение холостого цикла: переход на себя, цикл ожидания,
+ * периодический цикл тестовой программы и цикл счёта, который
+ * не повторяет состояние и останавливается только на переходе на себя
+ */
+void Test15_Setun_Idle_Loop(void)
+{
+	uint64_t done;
+	int ret;
+	uint8_t idle = IDLE_DETECT;
+
+	printf("\r\n --- TEST #15 Idle loop detection for VM SETUN-1958 --- \r\n\r\n");
+
+	IDLE_DETECT = IDLE_STOP;
+
+	Load_Idle_Program(&setun, idle_self_prog, sizeof(idle_self_prog) / sizeof(idle_self_prog[0]));
+	ret = run_for(&setun, IDLE_BENCH_STEPS, &done);
+	printf(" self jump:  status = %i (STOP_IDLE = %i), steps = %llu\r\n", ret, STOP_IDLE, (unsigned long long)done);
+
+	Load_Idle_Program(&setun, idle_wait_prog, sizeof(idle_wait_prog) / sizeof(idle_wait_prog[0]));
+	ret = run_for(&setun, IDLE_BENCH_STEPS, &done);
+	printf(" wait loop:  status = %i, steps = %llu\r\n", ret, (unsigned long long)done);
+
+	Load_Bench_Program(&setun);
+	ret = run_for(&setun, IDLE_BENCH_STEPS, &done);
+	printf(" bench loop: status = %i, steps = %llu\r\n", ret, (unsigned long long)done);
+
+	Load_Idle_Program(&setun, idle_count_prog, sizeof(idle_count_prog) / sizeof(idle_count_prog[0]));
+	ret = run_for(&setun, IDLE_BENCH_STEPS, &done);
+	printf(" count loop: status = %i, steps = %llu, C = %i\r\n", ret, (unsigned long long)done, trs2digit(setun.C));
+
+	IDLE_DETECT = IDLE_SKIP;
+
+	Load_Idle_Program(&setun, idle_wait_prog, sizeof(idle_wait_prog) / sizeof(idle_wait_prog[0]));
+	ret = run_for(&setun, IDLE_BENCH_STEPS, &done);
+	printf("\r\n skip mode:  status = %i, steps = %llu, skipped = %llu\r\n",
+		   ret, (unsigned long long)done, (unsigned long long)setun.idle_skipped);
+
+	IDLE_DETECT = idle;
+
+	printf("\r\n --- END TEST #15 --- \r\n");
+}
+
+#define PACE_TEST_SEC (0.5)
+
+/**
+ * Работа в реальном времени: тестовая программа в темпе "Сетунь-1958"
+ * и в десять раз быстрее, отношение эмулируемого времени к реальному
+ * и опоздание пробуждения после clock_nanosleep()
+ */
+void Test17_Setun_Pace(void)
+{
+	static const uint32_t ops[] = {PACE_SETUN_OPS, PACE_SETUN_OPS * 10};
+	uint8_t idle = IDLE_DETECT;
+	uint32_t pace = PACE_OPS;
+
+	printf("\r\n --- TEST #17 Real-time pace for VM SETUN-1958 --- \r\n\r\n");
+
+	IDLE_DETECT = IDLE_OFF;
+	for (int k = 0; k < 2; k++)
+	{
+		uint64_t steps = 0;
+		uint64_t done;
+		double t;
+
+		PACE_OPS = ops[k];
+		Load_Bench_Program(&setun);
+		setun.pace.valid = 0;
+		t = time_monotonic();
+		while (time_monotonic() - t < PACE_TEST_SEC)
+		{
+			run_paced(&setun, RUN_BATCH_MAX, &done);
+			steps += done;
+		}
+		t = time_monotonic() - t;
+		printf(" pace %u: %llu instr, %.0f instr/s, emulated/wall = %.4f\r\n", PACE_OPS,
+			   (unsigned long long)steps, steps / t, (setun.pace.total_us + setun.pace.emu_us) / 1e6 / t);
+		view_pace_stat(&setun);
+	}
+
+	IDLE_DETECT = idle;
+	PACE_OPS = pace;
+
+	printf("\r\n --- END TEST #17 --- \r\n");
+}
+
+#define JOBS_TEST_COUNT (32)
+#define JOBS_TEST_STEPS (100000)
+
+/**
+ * Параллельный запуск: одинаковые задания на 1, 2, 4 и всех процессорах
+ * дают одинаковые регистры, суммарная скорость в instr/s
+ */
+void Test18_Setun_Parallel_Jobs(void)
+{
+	static setun_job_t jobs[JOBS_TEST_COUNT];
+	static const int sweep[] = {1, 2, 4, 0};
+	uint8_t idle = IDLE_DETECT;
+	uint32_t errors = 0;
+	trs_t C, S, R;
+
+	printf("\r\n --- TEST #18 Parallel jobs for VM SETUN-1958 --- \r\n\r\n");
+
+	IDLE_DETECT = IDLE_OFF;
+	for (int k = 0; k < 4; k++)
+	{
+		int n = (sweep[k] > 0) ? sweep[k] : host_cores();
+		uint64_t total = 0;
+		double t;
+
+		memset(jobs, 0, sizeof(jobs));
+		for (int i = 0; i < JOBS_TEST_COUNT; i++)
+		{
+			jobs[i].path_tape = "bench";
+			jobs[i].load = Load_Bench_Program;
+			jobs[i].steps = JOBS_TEST_STEPS;
+		}
+
+		t = time_monotonic();
+		run_jobs(jobs, JOBS_TEST_COUNT, n, JOB_SCHED_SHARED);
+		t = time_monotonic() - t;
+
+		for (int i = 0; i < JOBS_TEST_COUNT; i++)
+		{
+			total += jobs[i].done;
+			if ((k == 0) && (i == 0))
+			{
+				C = jobs[0].C;
+				S = jobs[0].S;
+				R = jobs[0].R;
+			}
+			if ((jobs[i].done != JOBS_TEST_STEPS) ||
+				(trs2digit(jobs[i].C) != trs2digit(C)) ||
+				(trs2digit(jobs[i].S) != trs2digit(S)) ||
+				(trs2digit(jobs[i].R) != trs2digit(R)))
+			{
+				errors++;
+			}
+		}
+		printf(" threads %3i: %llu instr, %.3f s, %.0f instr/s\r\n",
+			   n, (unsigned long long)total, t, total / t);
+	}
+	printf("\r\n cores: %i, errors: %u\r\n", host_cores(), errors);
+
+	IDLE_DETECT = idle;
+
+	printf("\r\n --- END TEST #18 --- \r\n");
+}
+
+#define SCHED_TEST_COUNT (32)
+#define SCHED_TEST_LONG (2)
+#define SCHED_TEST_LONG_STEPS (5000000)
+#define SCHED_TEST_SHORT_STEPS (200000)
+
+/**
+ * Планировщики заданий на смешанном наборе: несколько длинных заданий
+ * в начале списка и много коротких. Время завершения заданий
+ * (среднее и наибольшее для коротких) и общее время для общего
+ * счётчика и для кражи заданий, регистры после останова совпадают.
+ */
+void Test19_Setun_Job_Scheduler(void)
+{
+	static setun_job_t jobs[2][SCHED_TEST_COUNT];
+	static const char *name[2] = {"shared", "steal"};
+	uint8_t idle = IDLE_DETECT;
+	uint32_t errors = 0;
+	int n = host_cores();
+
+	printf("\r\n --- TEST #19 Job scheduler for VM SETUN-1958 --- \r\n\r\n");
+
+	IDLE_DETECT = IDLE_OFF;
+	for (int k = 0; k < 2; k++)
+	{
+		uint64_t total = 0;
+		double mean = 0;
+		double tail = 0;
+		double t;
+
+		memset(jobs[k], 0, sizeof(jobs[k]));
+		for (int i = 0; i < SCHED_TEST_COUNT; i++)
+		{
+			jobs[k][i].path_tape = "bench";
+			jobs[k][i].load = Load_Bench_Program;
+			jobs[k][i].steps = (i < SCHED_TEST_LONG) ? SCHED_TEST_LONG_STEPS : SCHED_TEST_SHORT_STEPS;
+		}
+
+		t = time_monotonic();
+		run_jobs(jobs[k], SCHED_TEST_COUNT, n, (k == 0) ? JOB_SCHED_SHARED : JOB_SCHED_STEAL);
+		t = time_monotonic() - t;
+
+		for (int i = 0; i < SCHED_TEST_COUNT; i++)
+		{
+			total += jobs[k][i].done;
+			if (jobs[k][i].done != jobs[k][i].steps)
+			{
+				errors++;
+			}
+			if (i >= SCHED_TEST_LONG)
+			{
+				mean += jobs[k][i].t_done;
+				if (jobs[k][i].t_done > tail)
+				{
+					tail = jobs[k][i].t_done;
+				}
+			}
+		}
+		mean /= SCHED_TEST_COUNT - SCHED_TEST_LONG;
+		printf(" %-6s: %llu instr, %.3f s, %.0f instr/s, short jobs done mean %.3f s, max %.3f s\r\n",
+			   name[k], (unsigned long long)total, t, total / t, mean, tail);
+		if (k == JOB_SCHED_STEAL)
+		{
+			printf("         steals: %llu\r\n", (unsigned long long)job_steals);
+		}
+	}
+
+	/* Кванты не меняют результат задания */
+	for (int i = 0; i < SCHED_TEST_COUNT; i++)
+	{
+		if ((trs2digit(jobs[0][i].C) != trs2digit(jobs[1][i].C)) ||
+			(trs2digit(jobs[0][i].S) != trs2digit(jobs[1][i].S)) ||
+			(trs2digit(jobs[0][i].R) != trs2digit(jobs[1][i].R)))
+		{
+			errors++;
+		}
+	}
+	printf("\r\n threads: %i, errors: %u\r\n", n, errors);
+
+	IDLE_DETECT = idle;
+
+	printf("\r\n --- END TEST #19 --- \r\n");
+}
+
+#define SWEEP_TEST_COUNT (2000)
+#define SWEEP_TEST_STEPS (1000)
+
+/**
+ * Перебор вариантов: программа теста #11 с разными данными в ячейках
+ * +0000, +000+ и в регистре F на копиях одной машины, результат
+ * сравнивается с загрузкой программы заново для каждого варианта
+ */
+void Test20_Setun_Sweep(void)
+{
+	setun_machine_t *base = malloc(sizeof(setun_machine_t));
+	setun_machine_t *m = malloc(sizeof(setun_machine_t));
+	setun_job_t *jobs = NULL;
+	sweep_set_t set[SWEEP_SET_MAX];
+	trs_t cells[SWEEP_CELLS_MAX];
+	char path[64];
+	char line[128];
+	uint8_t idle = IDLE_DETECT;
+	uint32_t errors = 0;
+	int cells_count = 0;
+	int count;
+	double t;
+	FILE *f;
+
+	printf("\r\n --- TEST #20 Sweep variants for VM SETUN-1958 --- \r\n\r\n");
+
+	snprintf(path, sizeof(path), "/tmp/setun1958emu-sweep-%i.txt", (int)getpid());
+	f = fopen(path, "w");
+	if ((f == NULL) || (base == NULL) || (m == NULL))
+	{
+		printf("ERR fopen %s\r\n", path);
+		free(base);
+		free(m);
+		return;
+	}
+	fprintf(f, "# +0000, +000+ and F\n");
+	for (int i = 0; i < SWEEP_TEST_COUNT; i++)
+	{
+		fprintf(f, "+0000=%i +000+=%i F=%i\n", i - SWEEP_TEST_COUNT / 2, 3 * i % 1000, i % 121 - 60);
+	}
+	fclose(f);
+
+	IDLE_DETECT = IDLE_OFF;
+	init_setun_machine(base);
+	Load_Bench_Program(base);
+
+	count = sweep_jobs(base, path, "+00++,+0000", SWEEP_TEST_STEPS, 0, &jobs, cells, &cells_count);
+	if (count != SWEEP_TEST_COUNT)
+	{
+		errors++;
+	}
+	t = time_monotonic();
+	run_jobs(jobs, count, 0, JOB_SCHED_SHARED);
+	t = time_monotonic() - t;
+	printf(" sweep : %i variants, %.3f s, %.0f variants/s\r\n", count, t, count / t);
+
+	/* Загрузка заново и те же замены */
+	f = fopen(path, "r");
+	t = time_monotonic();
+	for (int i = 0; (f != NULL) && (i < count); i++)
+	{
+		uint64_t done = 0;
+		int n;
+
+		do
+		{
+			if (fgets(line, sizeof(line), f) == NULL)
+			{
+				line[0] = '\0';
+				break;
+			}
+		} while (line[0] == '#');
+		n = sweep_parse(line, set, SWEEP_SET_MAX);
+
+		init_setun_machine(m);
+		Load_Bench_Program(m);
+		sweep_apply(m, set, n);
+		run_for(m, SWEEP_TEST_STEPS, &done);
+		native_sync(m);
+
+		if ((n != 3) || (done != jobs[i].done) ||
+			(trs2digit(m->C) != trs2digit(jobs[i].C)) ||
+			(trs2digit(m->S) != trs2digit(jobs[i].S)) ||
+			(trs2digit(m->R) != trs2digit(jobs[i].R)) ||
+			(trs2digit(ld_fram(m, cells[0])) != jobs[i].cell_val[0]) ||
+			(trs2digit(ld_fram(m, cells[1])) != jobs[i].cell_val[1]))
+		{
+			errors++;
+		}
+	}
+	t = time_monotonic() - t;
+	printf(" reload: %i variants, %.3f s, %.0f variants/s\r\n", count, t, count / t);
+	if (f != NULL)
+	{
+		fclose(f);
+	}
+	unlink(path);
+
+	/* Ошибки разбора строк вариантов */
+	strcpy(line, "X=0");
+	errors += (sweep_parse(line, set, SWEEP_SET_MAX) >= 0);
+	strcpy(line, "S=99999999999");
+	errors += (sweep_parse(line, set, SWEEP_SET_MAX) >= 0);
+	strcpy(line, "0000+=+-+-+-+-+-+");
+	errors += (sweep_parse(line, set, SWEEP_SET_MAX) >= 0);
+	strcpy(line, "000+-=+-+-+-+-+-+- R=-1");
+	errors += (sweep_parse(line, set, SWEEP_SET_MAX) != 2);
+
+	printf("\r\n errors: %u\r\n", errors);
+
+	sweep_free(jobs, (count > 0) ? count : 0);
+	free(base);
+	free(m);
+	IDLE_DETECT = idle;
+
+	printf("\r\n --- END TEST #20 --- \r\n");
+}
+
+#define FORK_TEST_COUNT (200)
+#define FORK_TEST_STEPS (1000)
+
+/**
+ * Сервер заданий на fork(): задания в секунду против холодного
+ * запуска процесса эмулятора на каждое задание
+ */
+void Test21_Setun_Fork_Server(void)
+{
+	setun_machine_t *base = malloc(sizeof(setun_machine_t));
+	char path[64];
+	char line[64];
+	char reply[128];
+	char steps[32];
+	uint8_t idle = IDLE_DETECT;
+	uint32_t errors = 0;
+	pid_t server;
+	int fd = -1;
+	double t;
+
+	printf("\r\n --- TEST #21 Fork server for VM SETUN-1958 --- \r\n\r\n");
+
+	if (base == NULL)
+	{
+		return;
+	}
+	snprintf(path, sizeof(path), "/tmp/setun1958emu-fork-%i.sock", (int)getpid());
+	snprintf(steps, sizeof(steps), "%i", FORK_TEST_STEPS);
+
+	/* Базовая машина: пустая перфолента, как у холодного запуска */
+	IDLE_DETECT = IDLE_OFF;
+	init_tab4();
+	init_setun_machine(base);
+	base->path_ptr1 = "/dev/null";
+	base->path_ptr2 = "/dev/null";
+	base->path_ptp1 = "/dev/null";
+	base->path_tty1 = "/dev/null";
+	Emu_Open_Files(base);
+	Begin_Read_Commands_from_FT1(base, base->ptr1);
+	base->C = smtr("0000+");
+
+	fflush(NULL);
+	server = fork();
+	if (server == 0)
+	{
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO);
+		_exit(Emu_Fork_Server(base, path, FORK_TEST_STEPS, 0));
+	}
+
+	/* Сервер готов, когда принимает соединение */
+	for (int i = 0; (fd < 0) && (i < 1000); i++)
+	{
+		fd = fork_client_request(-1, path, "\n", reply, sizeof(reply));
+		if (fd < 0)
+		{
+			usleep(1000);
+		}
+	}
+
+	t = time_monotonic();
+	for (int i = 0; (fd >= 0) && (i < FORK_TEST_COUNT); i++)
+	{
+		int ret;
+		unsigned long long done;
+
+		snprintf(line, sizeof(line), "S=%i\n", i);
+		fd = fork_client_request(fd, path, line, reply, sizeof(reply));
+		if ((fd < 0) || (sscanf(reply, "%i %llu", &ret, &done) != 2) ||
+			(ret != OK) || (done != FORK_TEST_STEPS))
+		{
+			errors++;
+		}
+	}
+	t = time_monotonic() - t;
+	printf(" fork server: %i jobs, %.3f s, %.0f jobs/s\r\n", FORK_TEST_COUNT, t, FORK_TEST_COUNT / t);
+
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+	kill(server, SIGTERM);
+	waitpid(server, NULL, 0);
+
+	/* Холодный запуск: новый процесс на каждое задание */
+	t = time_monotonic();
+	for (int i = 0; i < FORK_TEST_COUNT; i++)
+	{
+		int status = 0;
+		pid_t pid = fork();
+
+		if (pid == 0)
+		{
+			int null = open("/dev/null", O_WRONLY);
+			dup2(null, STDOUT_FILENO);
+			execl("/proc/self/exe", "setun1958emu", "--tape", "/dev/null", "--steps", steps,
+				  "--idle", "off", "--tty", "/dev/null", "--ptp", "/dev/null", (char *)NULL);
+			_exit(127);
+		}
+		waitpid(pid, &status, 0);
+		if (!WIFEXITED(status) || (WEXITSTATUS(status) != BATCH_EXIT_BUDGET))
+		{
+			errors++;
+		}
+	}
+	t = time_monotonic() - t;
+	printf(" cold start : %i jobs, %.3f s, %.0f jobs/s\r\n", FORK_TEST_COUNT, t, FORK_TEST_COUNT / t);
+
+	printf("\r\n errors: %u\r\n", errors);
+
+	Emu_Close_Files(base);
+	free(base);
+	IDLE_DETECT = idle;
+
+	printf("\r\n --- END TEST #21 --- \r\n");
+}
+
+#define DAEMON_TEST_JOBS (400)
+#define DAEMON_TEST_STEPS (2000)
+#define DAEMON_TEST_CLIENTS_MAX (8)
+
+typedef struct daemon_test_client
+{
+	const char *path;
+	int jobs;
+	int window; /* заданий в полёте */
+	double *lat;
+	uint32_t errors;
+} daemon_test_client_t;
+
+/* Клиент теста службы: задания с пустой перфолентой, задержка до DAEMON_DONE */
+static void *daemon_test_client(void *arg)
+{
+	daemon_test_client_t *cl = arg;
+	daemon_job_req_t req = {DAEMON_TEST_STEPS, 0, 0};
+	double *t_send = calloc(cl->jobs, sizeof(double));
+	int fd = daemon_connect(cl->path);
+	int sent = 0;
+	int recv = 0;
+
+	if ((fd < 0) || (t_send == NULL))
+	{
+		cl->errors += cl->jobs;
+		free(t_send);
+		return NULL;
+	}
+	while (recv < cl->jobs)
+	{
+		daemon_hdr_t h;
+		daemon_done_t *d;
+		char *buf;
+
+		while ((sent < cl->jobs) && (sent - recv < cl->window))
+		{
+			t_send[sent] = time_monotonic();
+			daemon_send(fd, DAEMON_JOB, DAEMON_OUT_TTY, sent, &req, sizeof(req), NULL, 0);
+			sent++;
+		}
+		if (daemon_recv(fd, &h, &buf) != 0)
+		{
+			cl->errors += cl->jobs - recv;
+			break;
+		}
+		if (h.type == DAEMON_DONE)
+		{
+			d = (daemon_done_t *)buf;
+			if ((h.len != sizeof(daemon_done_t)) || (h.id >= (uint32_t)cl->jobs) ||
+				(d->ret != OK) || (d->done != DAEMON_TEST_STEPS))
+			{
+				cl->errors++;
+			}
+			else
+			{
+				cl->lat[recv] = time_monotonic() - t_send[h.id];
+			}
+			recv++;
+		}
+		else if (h.type == DAEMON_ERR)
+		{
+			cl->errors++;
+			recv++;
+		}
+		free(buf);
+	}
+	close(fd);
+	free(t_send);
+	return NULL;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * Служба заданий: пропускная способность и задержка задания
+ * при 1, 2, 4, 8 клиентах по одному заданию в полёте и одном
+ * клиенте со всеми заданиями сразу (пакеты малых заданий)
+ */
+void Test22_Setun_Daemon(void)
+{
+	static const int clients[] = {1, 2, 4, 8, 1};
+	daemon_test_client_t cl[DAEMON_TEST_CLIENTS_MAX];
+	pthread_t tid[DAEMON_TEST_CLIENTS_MAX];
+	double *lat = malloc(DAEMON_TEST_JOBS * sizeof(double));
+	uint8_t idle = IDLE_DETECT;
+	uint32_t errors = 0;
+	char path[64];
+	pid_t server;
+	int fd = -1;
+
+	printf("\r\n --- TEST #22 Job daemon for VM SETUN-1958 --- \r\n\r\n");
+
+	if (lat == NULL)
+	{
+		return;
+	}
+	snprintf(path, sizeof(path), "/tmp/setun1958emu-daemon-%i.sock", (int)getpid());
+
+	IDLE_DETECT = IDLE_OFF;
+	fflush(NULL);
+	server = fork();
+	if (server == 0)
+	{
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO);
+		_exit(Emu_Daemon(path, 0));
+	}
+	for (int i = 0; (fd < 0) && (i < 1000); i++)
+	{
+		fd = daemon_connect(path);
+		if (fd < 0)
+		{
+			usleep(1000);
+		}
+	}
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+
+	for (int k = 0; k < (int)(sizeof(clients) / sizeof(clients[0])); k++)
+	{
+		int n = clients[k];
+		int window = (k == 4) ? DAEMON_TEST_JOBS : 1;
+		int per = DAEMON_TEST_JOBS / n;
+		int total = 0;
+		double mean = 0;
+		double t;
+
+		t = time_monotonic();
+		for (int i = 0; i < n; i++)
+		{
+			cl[i].path = path;
+			cl[i].jobs = per;
+			cl[i].window = window;
+			cl[i].lat = lat + i * per;
+			cl[i].errors = 0;
+			memset(cl[i].lat, 0, per * sizeof(double));
+			pthread_create(&tid[i], NULL, daemon_test_client, &cl[i]);
+		}
+		for (int i = 0; i < n; i++)
+		{
+			pthread_join(tid[i], NULL);
+			errors += cl[i].errors;
+			total += per;
+		}
+		t = time_monotonic() - t;
+
+		for (int i = 0; i < total; i++)
+		{
+			mean += lat[i];
+		}
+		qsort(lat, total, sizeof(double), cmp_double);
+		printf(" clients %i, window %3i: %.0f jobs/s, latency mean %.3f ms, p99 %.3f ms\r\n",
+			   n, window, total / t, mean / total * 1e3, lat[total * 99 / 100] * 1e3);
+	}
+
+	kill(server, SIGTERM);
+	waitpid(server, NULL, 0);
+
+	printf("\r\n errors: %u\r\n", errors);
+
+	free(lat);
+	IDLE_DETECT = idle;
+
+	printf("\r\n --- END TEST #22 --- \r\n");
+}
+
+#define TAPE_TEST_LOADS (200)
+
+/* Загрузить всю перфоленту зонами по 54 команды, count раз */
+static double tape_test_load(setun_machine_t *m, const char *path, int count)
+{
+	double t = time_monotonic();
+
+	for (int k = 0; k < count; k++)
+	{
+		m->ptr1 = fopen(path, "r");
+		if (m->ptr1 == NULL)
+		{
+			return -1;
+		}
+		tape_open(&m->ft1, m->ptr1);
+		while (!tape_eof(&m->ft1, m->ptr1))
+		{
+			Read_Commands_from_FT1(m, m->ptr1, smtr("0---0"));
+		}
+		tape_close(&m->ft1);
+		fclose(m->ptr1);
+		m->ptr1 = NULL;
+	}
+	return time_monotonic() - t;
+}
+
+/**
+ * Двоичная перфолента: преобразование перфоленты программы ИП-5
+ * (software/ip5) в двоичную и обратно, одинаковая FRAM после
+ * загрузки обеих, время загрузки всей перфоленты в обоих форматах
+ */
+void Test23_Setun_Tape_Bin(void)
+{
+	setun_machine_t *m[2] = {malloc(sizeof(setun_machine_t)), malloc(sizeof(setun_machine_t))};
+	char dir[] = "/tmp/setun1958emu-tape-XXXXXX";
+	char path_txt[64];
+	char path_bin[64];
+	char path_back[64];
+	uint32_t errors = 0;
+	double t_txt, t_bin;
+	long size_txt = 0, size_bin = 0;
+	FILE *f;
+
+	printf("\r\n --- TEST #23 Binary paper tape for VM SETUN-1958 --- \r\n\r\n");
+
+	if ((m[0] == NULL) || (m[1] == NULL) || (mkdtemp(dir) == NULL))
+	{
+		free(m[0]);
+		free(m[1]);
+		return;
+	}
+	snprintf(path_txt, sizeof(path_txt), "%s/paper.txt", dir);
+	snprintf(path_bin, sizeof(path_bin), "%s/paper.bin", dir);
+	snprintf(path_back, sizeof(path_back), "%s/back.txt", dir);
+
+	init_tab4();
+	if ((ConvertSWtoPaper("software/ip5", dir) != 0) ||
+		(tape_text_to_bin(path_txt, path_bin) != 0) ||
+		(tape_bin_to_text(path_bin, path_back) != 0))
+	{
+		errors++;
+	}
+
+	/* Текст -> двоичный -> текст без изменения строк */
+	f = fopen(path_txt, "r");
+	if (f != NULL)
+	{
+		FILE *g = fopen(path_back, "r");
+		int8_t a, b;
+
+		while ((g != NULL) && (tape_read_row(f, TAPE_TEXT, &a) != EOF))
+		{
+			if (a < 0)
+			{
+				continue;
+			}
+			if ((tape_read_row(g, TAPE_TEXT, &b) == EOF) || (a != b))
+			{
+				errors++;
+				break;
+			}
+		}
+		fseek(f, 0, SEEK_END);
+		size_txt = ftell(f);
+		fclose(f);
+		if (g != NULL)
+		{
+			fclose(g);
+		}
+	}
+	f = fopen(path_bin, "r");
+	if (f != NULL)
+	{
+		fseek(f, 0, SEEK_END);
+		size_bin = ftell(f);
+		fclose(f);
+	}
+
+	init_setun_machine(m[0]);
+	init_setun_machine(m[1]);
+	m[0]->tty_echo = NULL;
+	m[1]->tty_echo = NULL;
+	t_txt = tape_test_load(m[0], path_txt, TAPE_TEST_LOADS);
+	t_bin = tape_test_load(m[1], path_bin, TAPE_TEST_LOADS);
+	if ((t_txt < 0) || (t_bin < 0))
+	{
+		errors++;
+	}
+	/* Ячейки сравниваются по значению: байты выравнивания trs_t не определены */
+	for (uint32_t i = 0; i < SIZE_GR_TRIT_FRAM * SIZE_GRFRAM; i++)
+	{
+		trs_t *a = &m[0]->mem_fram[0][0] + i;
+		trs_t *b = &m[1]->mem_fram[0][0] + i;
+
+		if ((a->l != b->l) || (a->t1 != b->t1) || (a->t0 != b->t0))
+		{
+			errors++;
+			break;
+		}
+	}
+
+	printf(" text  : %6li bytes, %i loads %.3f s, %.3f ms/load\r\n",
+		   size_txt, TAPE_TEST_LOADS, t_txt, t_txt / TAPE_TEST_LOADS * 1e3);
+	printf(" binary: %6li bytes, %i loads %.3f s, %.3f ms/load\r\n",
+		   size_bin, TAPE_TEST_LOADS, t_bin, t_bin / TAPE_TEST_LOADS * 1e3);
+	printf("\r\n errors: %u\r\n", errors);
+
+	unlink(path_txt);
+	unlink(path_bin);
+	unlink(path_back);
+	rmdir(dir);
+	free(m[0]);
+	free(m[1]);
+
+	printf("\r\n --- END TEST #23 --- \r\n");
+}
+
+#define TAPE_ROWS_TEST_PASSES (200)
+
+/**
+ * Строки перфоленты в секунду: fscanf() и paper_line_holes(),
+ * отображение в память с таблицей ключей строк, двоичная перфолента.
+ * Последовательности пробивок совпадают.
+ */
+void Test24_Setun_Tape_Rows(void)
+{
+	static const char *name[3] = {"fscanf", "mmap text", "mmap binary"};
+	char dir[] = "/tmp/setun1958emu-rows-XXXXXX";
+	char path[2][64];
+	uint64_t sum[3] = {0, 0, 0};
+	uint64_t rows[3] = {0, 0, 0};
+	uint32_t errors = 0;
+
+	printf("\r\n --- TEST #24 Paper tape rows decoding for VM SETUN-1958 --- \r\n\r\n");
+
+	if (mkdtemp(dir) == NULL)
+	{
+		return;
+	}
+	snprintf(path[0], sizeof(path[0]), "%s/paper.txt", dir);
+	snprintf(path[1], sizeof(path[1]), "%s/paper.bin", dir);
+
+	init_tab4();
+	if ((ConvertSWtoPaper("software/ip5", dir) != 0) || (tape_text_to_bin(path[0], path[1]) != 0))
+	{
+		errors++;
+	}
+
+	for (int k = 0; k < 3; k++)
+	{
+		double t = time_monotonic();
+
+		for (int n = 0; n < TAPE_ROWS_TEST_PASSES; n++)
+		{
+			FILE *f = fopen(path[(k == 2) ? 1 : 0], "r");
+			tape_reader_t r;
+			int8_t holes;
+
+			if (f == NULL)
+			{
+				errors++;
+				break;
+			}
+			if (k == 0)
+			{
+				/* Прежнее чтение через FILE */
+				memset(&r, 0, sizeof(r));
+				r.fmt = tape_format(f);
+			}
+			else
+			{
+				tape_open(&r, f);
+			}
+			while (tape_next_row(&r, f, &holes) != EOF)
+			{
+				rows[k]++;
+				sum[k] = sum[k] * 31 + (uint8_t)holes;
+			}
+			tape_close(&r);
+			fclose(f);
+		}
+		t = time_monotonic() - t;
+		printf(" %-11s: %llu rows, %.3f s, %.0f rows/s\r\n", name[k], (unsigned long long)rows[k], t, rows[k] / t);
+	}
+	/* Двоичная лента без строк, не распознанных в тексте */
+	if ((rows[0] != rows[1]) || (sum[0] != sum[1]) || (rows[2] == 0) || (rows[2] > rows[0]))
+	{
+		errors++;
+	}
+	printf("\r\n errors: %u\r\n", errors);
+
+	unlink(path[0]);
+	unlink(path[1]);
+	rmdir(dir);
+
+	printf("\r\n --- END TEST #24 --- \r\n");
+}
+
+#define TAPE_SIMD_TEST_PASSES (2000)
+
+/* Начало строки row (с 1) текстовой перфоленты */
+static uint8_t *Test25_Row(uint8_t *text, size_t size, size_t row)
+{
+	size_t pos = 0;
+
+	while ((row > 1) && (pos < size))
+	{
+		if (text[pos++] == '\n')
+		{
+			row--;
+		}
+	}
+	return text + pos;
+}
+
+/**
+ * Декодирование текстовой перфоленты целиком: построчно по таблице
+ * ключей, SSE2 и AVX2. Коды строк совпадают для концов строк CRLF и LF,
+ * первая ошибочная строка находится всеми декодерами.
+ */
+void Test25_Setun_Tape_Simd(void)
+{
+	static const char *name[3] = {"scalar", "sse2", "avx2"};
+	static const char *eol[2] = {"CRLF", "LF"};
+	char dir[] = "/tmp/setun1958emu-simd-XXXXXX";
+	char path[64];
+	uint8_t *text[2] = {NULL, NULL};
+	uint8_t *codes[3] = {NULL, NULL, NULL};
+	size_t size[2] = {0, 0};
+	size_t rows[3];
+	size_t bad;
+	uint8_t level = tape_simd_level();
+	uint32_t errors = 0;
+	FILE *f;
+
+	printf("\r\n --- TEST #25 Paper tape SIMD decoding for VM SETUN-1958 --- \r\n\r\n");
+
+	if (mkdtemp(dir) == NULL)
+	{
+		return;
+	}
+	snprintf(path, sizeof(path), "%s/paper.txt", dir);
+
+	init_tab4();
+	f = (ConvertSWtoPaper("software/ip5", dir) == 0) ? fopen(path, "rb") : NULL;
+	if (f != NULL)
+	{
+		fseek(f, 0, SEEK_END);
+		size[0] = ftell(f);
+		rewind(f);
+		text[0] = malloc(size[0] + 1);
+		text[1] = malloc(size[0] + 1);
+		if ((text[0] != NULL) && (fread(text[0], 1, size[0], f) != size[0]))
+		{
+			size[0] = 0;
+		}
+		fclose(f);
+	}
+	for (int k = 0; k < 3; k++)
+	{
+		codes[k] = malloc(size[0] / 2 + 1);
+	}
+	if ((size[0] == 0) || (text[1] == NULL) || (codes[0] == NULL) || (codes[1] == NULL) || (codes[2] == NULL))
+	{
+		printf(" ERR software/ip5\r\n");
+		errors++;
+		goto done;
+	}
+	/* Та же лента с концом строки LF */
+	for (size_t i = 0; i < size[0]; i++)
+	{
+		if (text[0][i] != '\r')
+		{
+			text[1][size[1]++] = text[0][i];
+		}
+	}
+
+	printf(" simd level: %s\r\n\r\n", name[level]);
+	for (int e = 0; e < 2; e++)
+	{
+		double rate[3] = {0, 0, 0};
+
+		for (int k = 0; k <= level; k++)
+		{
+			double t = time_monotonic();
+
+			for (int n = 0; n < TAPE_SIMD_TEST_PASSES; n++)
+			{
+				rows[k] = tape_decode_text(text[e], size[e], codes[k], size[0] / 2 + 1, &bad, k);
+			}
+			t = time_monotonic() - t;
+			rate[k] = rows[k] * (double)TAPE_SIMD_TEST_PASSES / t;
+			if ((bad != 0) || (rows[k] != rows[0]) || (memcmp(codes[k], codes[0], rows[0]) != 0))
+			{
+				errors++;
+			}
+			printf(" %-4s %-6s: %zu rows, %.3f s, %.0f rows/s, %.0f MB/s, x%.1f\r\n", eol[e], name[k], rows[k], t,
+				   rate[k], size[e] * (double)TAPE_SIMD_TEST_PASSES / t / 1e6, rate[k] / rate[0]);
+		}
+	}
+
+	/* Нет транспортной дорожки в строке 100, недопустимая комбинация в строке 200 */
+	Test25_Row(text[0], size[0], 100)[3] = 'x';
+	memcpy(Test25_Row(text[1], size[1], 200), "OOO.O_", 6);
+	for (int k = 0; k <= level; k++)
+	{
+		size_t bad_lf;
+
+		tape_decode_text(text[0], size[0], codes[k], size[0] / 2 + 1, &bad, k);
+		tape_decode_text(text[1], size[1], codes[k], size[0] / 2 + 1, &bad_lf, k);
+		printf(" %-6s: bad row %zu (CRLF), %zu (LF)\r\n", name[k], bad, bad_lf);
+		if ((bad != 100) || (bad_lf != 200))
+		{
+			errors++;
+		}
+	}
+
+done:
+	printf("\r\n errors: %u\r\n", errors);
+
+	for (int k = 0; k < 3; k++)
+	{
+		free(codes[k]);
+	}
+	free(text[0]);
+	free(text[1]);
+	unlink(path);
+	rmdir(dir);
+
+	printf("\r\n --- END TEST #25 --- \r\n");
+}
+
+#define TTY_TEST_ZONES (20000)
+
+/**
+ * Печать зоны FRAM командами -00 с адресами 0-00 и +-00:
+ * знаки UTF-8 совпадают с таблицей, зон и знаков в секунду.
+ */
+void Test26_Setun_Typewriter(void)
+{
+	static const char *name[2] = {"0-00", "+-00"};
+	static const int8_t codes[3] = {6, 7, 8}; /* А В С */
+	setun_machine_t *m = malloc(sizeof(setun_machine_t));
+	char path[] = "/tmp/setun1958emu-tty-XXXXXX";
+	char expect[SIZE_ZONE_TRIT_FRAM * 6 + 8] = "";
+	char text[sizeof(expect)];
+	uint32_t errors = 0;
+	trs_t fa;
+	int fd;
+
+	printf("\r\n --- TEST #26 Electrified typewriter print for VM SETUN-1958 --- \r\n\r\n");
+
+	fd = mkstemp(path);
+	if ((m == NULL) || (fd < 0))
+	{
+		free(m);
+		return;
+	}
+	close(fd);
+
+	init_tab4();
+	init_tab_native();
+	init_setun_machine(m);
+	reset_setun_1958(m);
+	m->tty_echo = NULL;
+	m->russian_latin_sw = 0;
+	m->letter_number_sw = 0;
+
+	/* Зона 0---0: "АВС" в каждой ячейке, в последней "АВ" и перевод строки */
+	fa = smtr("0---0");
+	for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
+	{
+		int32_t c3 = (i == SIZE_ZONE_TRIT_FRAM - 1) ? -10 : codes[2];
+
+		st_fram(m, fa, int2trs(codes[0] * 729 + codes[1] * 27 + c3, 9));
+		strcat(expect, (c3 == -10) ? "АВ\n" : "АВС");
+		fa = next_address(fa);
+	}
+
+	for (int k = 0; k < 2; k++)
+	{
+		trs_t addr = smtr((k == 0) ? "00-00" : "0+-00");
+		size_t len;
+		double t;
+
+		/* Проверка знаков в файле */
+		m->tty1 = fopen(path, "w");
+		if (m->tty1 == NULL)
+		{
+			errors++;
+			break;
+		}
+		execute_trs(m, addr, smtr("-00"));
+		tty_flush(m);
+		fclose(m->tty1);
+		m->tty1 = fopen(path, "r");
+		len = (m->tty1 != NULL) ? fread(text, 1, sizeof(text) - 1, m->tty1) : 0;
+		if (m->tty1 != NULL)
+		{
+			fclose(m->tty1);
+		}
+		text[len] = '\0';
+		if (strcmp(text, expect) != 0)
+		{
+			errors++;
+		}
+
+		m->tty1 = fopen("/dev/null", "w");
+		if (m->tty1 == NULL)
+		{
+			errors++;
+			break;
+		}
+		t = time_monotonic();
+		for (int n = 0; n < TTY_TEST_ZONES; n++)
+		{
+			execute_trs(m, addr, smtr("-00"));
+		}
+		tty_flush(m);
+		t = time_monotonic() - t;
+		fclose(m->tty1);
+		m->tty1 = NULL;
+
+		printf(" %s: %d zones, %.3f s, %.0f zones/s, %.0f chars/s, %zu bytes/zone\r\n", name[k], TTY_TEST_ZONES, t,
+			   TTY_TEST_ZONES / t, TTY_TEST_ZONES * (SIZE_ZONE_TRIT_FRAM * 3.0 - 1) / t, len);
+	}
+	printf("\r\n errors: %u\r\n", errors);
+
+	unlink(path);
+	free(m);
+
+	printf("\r\n --- END TEST #26 --- \r\n");
+}
+
+#define PTP_TEST_ZONES (20000)
+
+/* Прежняя перфорация зоны: строка на fprintf() */
+static void Test27_Punch_Rows(setun_machine_t *m, FILE *file, trs_t fa, uint8_t symbols)
+{
+	for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
+	{
+		m->MR = ld_fram(m, fa);
+		if (symbols)
+		{
+			Perforation_Symbols_to_PTP1(file, slice_trs_setun(m->MR, 1, 3));
+			Perforation_Symbols_to_PTP1(file, slice_trs_setun(m->MR, 4, 6));
+			if (trs2digit(slice_trs_setun(m->MR, 7, 9)) == -13)
+				break;
+			Perforation_Symbols_to_PTP1(file, slice_trs_setun(m->MR, 7, 9));
+		}
+		else
+		{
+			Perforation_Commands_to_PTP1(file, slice_trs_setun(m->MR, 1, 1));
+			Perforation_Commands_to_PTP1(file, slice_trs_setun(m->MR, 2, 3));
+			Perforation_Commands_to_PTP1(file, slice_trs_setun(m->MR, 4, 5));
+			Perforation_Commands_to_PTP1(file, slice_trs_setun(m->MR, 6, 7));
+			Perforation_Commands_to_PTP1(file, slice_trs_setun(m->MR, 8, 9));
+		}
+		fa = next_address(fa);
+	}
+}
+
+/**
+ * Перфорация зоны +000 и -000: строки зоны из буфера совпадают
+ * с прежней построчной записью, двоичная лента - с её пробивками.
+ * Время перфорации зоны.
+ */
+void Test27_Setun_Punch(void)
+{
+	static const char *name[2] = {"+000 commands", "-000 symbols"};
+	setun_machine_t *m = malloc(sizeof(setun_machine_t));
+	char *text[2] = {NULL, NULL};
+	size_t len[2] = {0, 0};
+	uint8_t codes[SIZE_ZONE_TRIT_FRAM * 5];
+	size_t rows;
+	size_t bad;
+	uint32_t errors = 0;
+	uint32_t seed = 1958;
+	trs_t fa;
+
+	printf("\r\n --- TEST #27 Paper tape punch for VM SETUN-1958 --- \r\n\r\n");
+
+	if (m == NULL)
+	{
+		return;
+	}
+	init_tab4();
+	init_tab_native();
+	init_setun_machine(m);
+	reset_setun_1958(m);
+
+	/* Зона 0---0: случайные слова, в ячейке 40 символ -13 останавливает перфорацию символов */
+	fa = smtr("0---0");
+	for (uint8_t i = 0; i < SIZE_ZONE_TRIT_FRAM; i++)
+	{
+		int32_t v;
+
+		seed = seed * 1103515245 + 12345;
+		v = (int32_t)((seed >> 8) % POW3_9) - (POW3_9 - 1) / 2;
+		if (i == 40)
+		{
+			v = 5 * 729 + 7 * 27 - 13;
+		}
+		else if ((v + (POW3_9 - 1) / 2) % 27 == 0)
+		{
+			v++;
+		}
+		st_fram(m, fa, int2trs(v, 9));
+		fa = next_address(fa);
+	}
+	fa = smtr("0---0");
+
+	for (int k = 0; k < 2; k++)
+	{
+		FILE *f;
+		double t[3];
+
+		/* Строки совпадают */
+		f = open_memstream(&text[0], &len[0]);
+		Test27_Punch_Rows(m, f, fa, k);
+		fclose(f);
+		m->ptp_fmt = TAPE_TEXT;
+		m->ptp1 = open_memstream(&text[1], &len[1]);
+		Perforation_Zone_to_PTP1(m, fa, k);
+		fclose(m->ptp1);
+		if ((len[0] != len[1]) || (memcmp(text[0], text[1], len[0]) != 0))
+		{
+			errors++;
+		}
+
+		/* Двоичная лента: пробивки тех же строк */
+		free(text[1]);
+		m->ptp_fmt = TAPE_BIN;
+		m->ptp_rows = 0;
+		m->ptp1 = open_memstream(&text[1], &len[1]);
+		Perforation_Zone_to_PTP1(m, fa, k);
+		fclose(m->ptp1);
+		rows = tape_decode_text((uint8_t *)text[0], len[0], codes, sizeof(codes), &bad, TAPE_SIMD_NONE);
+		if ((rows != m->ptp_rows) || (len[1] != rows) || (memcmp(text[1], codes, rows) != 0))
+		{
+			errors++;
+		}
+		printf(" %s: %zu rows, %zu bytes\r\n", name[k], (size_t)m->ptp_rows, len[0]);
+		free(text[0]);
+		free(text[1]);
+		text[0] = NULL;
+		text[1] = NULL;
+
+		/* Время зоны: fprintf() на строку, буфер зоны, двоичная лента */
+		for (int w = 0; w < 3; w++)
+		{
+			f = fopen("/dev/null", "w");
+			if (f == NULL)
+			{
+				errors++;
+				break;
+			}
+			m->ptp1 = f;
+			m->ptp_fmt = (w == 2) ? TAPE_BIN : TAPE_TEXT;
+			t[w] = time_monotonic();
+			for (int n = 0; n < PTP_TEST_ZONES; n++)
+			{
+				if (w == 0)
+				{
+					Test27_Punch_Rows(m, f, fa, k);
+				}
+				else
+				{
+					Perforation_Zone_to_PTP1(m, fa, k);
+				}
+			}
+			t[w] = (time_monotonic() - t[w]) / PTP_TEST_ZONES * 1e6;
+			fclose(f);
+			m->ptp1 = NULL;
+		}
+		printf("   zone: fprintf %.2f us, buffer %.2f us, binary %.2f us, x%.1f\r\n\r\n", t[0], t[1], t[2],
+			   t[0] / t[1]);
+	}
+	printf(" errors: %u\r\n", errors);
+
+	free(m);
+
+	printf("\r\n --- END TEST #27 --- \r\n");
+}
+
+#define STREAM_TEST_REPEAT (200)
+#define STREAM_TEST_CHUNK (4096)
+#define STREAM_TEST_PAUSE_MS (200)
+
+/* Генератор перфоленты теста #28 */
+typedef struct stream_gen
+{
+	int fd;
+	const char *path; /* FIFO, открывается генератором */
+	const uint8_t *data; /* лента, повторяемая repeat раз */
+	size_t size;
+	size_t skip; /* заголовок двоичной ленты пишется один раз */
+	int pause_ms; /* пауза посреди ленты */
+} stream_gen_t;
+
+static void *Test28_Generator(void *arg)
+{
+	stream_gen_t *g = arg;
+
+	if (g->path != NULL)
+	{
+		g->fd = open(g->path, O_WRONLY);
+	}
+	for (int k = 0; (k < STREAM_TEST_REPEAT) && (g->fd >= 0); k++)
+	{
+		size_t pos = (k == 0) ? 0 : g->skip;
+
+		if ((g->pause_ms > 0) && (k == STREAM_TEST_REPEAT / 2))
+		{
+			struct timespec ts = {0, g->pause_ms * 1000000L};
+			nanosleep(&ts, NULL);
+		}
+		while (pos < g->size)
+		{
+			size_t n = (g->size - pos < STREAM_TEST_CHUNK) ? g->size - pos : STREAM_TEST_CHUNK;
+			ssize_t w = write(g->fd, g->data + pos, n);
+
+			if (w <= 0)
+			{
+				k = STREAM_TEST_REPEAT;
+				break;
+			}
+			pos += w;
+		}
+	}
+	if (g->fd >= 0)
+	{
+		close(g->fd);
+	}
+	return NULL;
+}
+
+/* Время процессора потока, с */
+static double Test28_Cpu(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Перфолента из потока: генератор пишет ленту ИП-5 в канал pipe(),
+ * сокет socketpair() и FIFO, фотосчитыватель читает строки по мере
+ * поступления. Строки совпадают с лентой из файла, в паузе генератора
+ * чтение ждёт без расхода процессора.
+ */
+void Test28_Setun_Tape_Stream(void)
+{
+	static const char *name[3] = {"pipe text", "socketpair binary", "fifo text, pause"};
+	char dir[] = "/tmp/setun1958emu-stream-XXXXXX";
+	char path[3][64];
+	uint8_t *data[2] = {NULL, NULL};
+	size_t size[2] = {0, 0};
+	uint8_t *codes = NULL;
+	size_t rows_ref = 0;
+	size_t bad;
+	uint64_t sum_ref = 0;
+	uint32_t errors = 0;
+
+	printf("\r\n --- TEST #28 Paper tape from pipes and sockets for VM SETUN-1958 --- \r\n\r\n");
+
+	if (mkdtemp(dir) == NULL)
+	{
+		return;
+	}
+	snprintf(path[0], sizeof(path[0]), "%s/paper.txt", dir);
+	snprintf(path[1], sizeof(path[1]), "%s/paper.bin", dir);
+	snprintf(path[2], sizeof(path[2]), "%s/fifo", dir);
+
+	init_tab4();
+	if ((ConvertSWtoPaper("software/ip5", dir) != 0) || (tape_text_to_bin(path[0], path[1]) != 0) ||
+		(mkfifo(path[2], 0600) != 0))
+	{
+		errors++;
+	}
+	for (int k = 0; (k < 2) && (errors == 0); k++)
+	{
+		FILE *f = fopen(path[k], "rb");
+
+		if (f == NULL)
+		{
+			errors++;
+			break;
+		}
+		fseek(f, 0, SEEK_END);
+		size[k] = ftell(f);
+		rewind(f);
+		data[k] = malloc(size[k]);
+		if ((data[k] == NULL) || (fread(data[k], 1, size[k], f) != size[k]))
+		{
+			errors++;
+		}
+		fclose(f);
+	}
+	if (errors == 0)
+	{
+		/* Образец: строки ленты, повторённой STREAM_TEST_REPEAT раз */
+		codes = malloc(size[0] / 2 + 1);
+		rows_ref = (codes != NULL) ? tape_decode_text(data[0], size[0], codes, size[0] / 2 + 1, &bad, TAPE_SIMD_NONE) : 0;
+		for (int n = 0; n < STREAM_TEST_REPEAT; n++)
+		{
+			for (size_t i = 0; i < rows_ref; i++)
+			{
+				sum_ref = sum_ref * 31 + codes[i];
+			}
+		}
+		rows_ref *= STREAM_TEST_REPEAT;
+	}
+
+	for (int k = 0; (k < 3) && (errors == 0); k++)
+	{
+		stream_gen_t g = {.fd = -1, .data = data[k == 1], .size = size[k == 1]};
+		char src[64];
+		int fd[2] = {-1, -1};
+		pthread_t th;
+		tape_reader_t r;
+		FILE *f;
+		uint64_t rows = 0;
+		uint64_t sum = 0;
+		uint8_t stream;
+		int8_t holes;
+		double t, cpu;
+
+		g.skip = (k == 1) ? sizeof(tape_bin_hdr_t) : 0;
+		g.pause_ms = (k == 2) ? STREAM_TEST_PAUSE_MS : 0;
+		if (((k == 0) && (pipe(fd) != 0)) || ((k == 1) && (socketpair(AF_UNIX, SOCK_STREAM, 0, fd) != 0)))
+		{
+			errors++;
+			break;
+		}
+		if (k == 2)
+		{
+			g.path = path[2];
+			snprintf(src, sizeof(src), "%s", path[2]);
+		}
+		else
+		{
+			g.fd = fd[1];
+			snprintf(src, sizeof(src), "fd:%d", fd[0]);
+		}
+
+		t = time_monotonic();
+		cpu = Test28_Cpu();
+		pthread_create(&th, NULL, Test28_Generator, &g);
+		f = tape_fopen(src);
+		if (fd[0] >= 0)
+		{
+			close(fd[0]);
+		}
+		if (f == NULL)
+		{
+			errors++;
+			pthread_join(th, NULL);
+			break;
+		}
+		tape_open(&r, f);
+		stream = r.stream;
+		while (tape_next_row(&r, f, &holes) != EOF)
+		{
+			rows++;
+			sum = sum * 31 + (uint8_t)holes;
+		}
+		tape_close(&r);
+		fclose(f);
+		pthread_join(th, NULL);
+		t = time_monotonic() - t;
+		cpu = Test28_Cpu() - cpu;
 
-	// t2.5
-	printf("\r\nt2.5 --- input TRITS-32s\r\n");
-	printf("input tr1=[+000000000000000000000000000000-] \r\n");
-	tr1 = smtr("+000000000000000000000000000000-");
-	view_short_reg(&tr1, "tr1=");
-	printf("input tr2=[-000000000+] \r\n");
-	tr2 = smtr("-000000000+");
-	view_short_reg(&tr2, "tr2=");
+		if ((rows != rows_ref) || (sum != sum_ref) || !stream)
+		{
+			errors++;
+		}
+		/* Пауза генератора - ожидание в poll()/read(), не опрос */
+		if ((k == 2) && (cpu > t - STREAM_TEST_PAUSE_MS / 1000.0 * 0.75))
+		{
+			errors++;
+		}
+		printf(" %-18s: %llu rows, %.3f s, cpu %.3f s, %.0f rows/s, %.1f MB/s\r\n", name[k],
+			   (unsigned long long)rows, t, cpu, rows / t, (double)size[k == 1] * STREAM_TEST_REPEAT / t / 1e6);
+	}
+	printf("\r\n errors: %u\r\n", errors);
 
-	// t2.6
-	printf("\nt2.6 --- trit2int(...)\r\n");
-	tr1 = smtr("00-");
-	printf("tr1=[00-]\r\n");
-	printf("trit2int(tr1) = % 2i\r\n", trit2int(tr1));
-	tr1 = smtr("000");
-	printf("tr1=[000]\r\n");
-	printf("trit2int(tr1) = % 2i\r\n", trit2int(tr1));
-	tr1 = smtr("00+");
-	printf("tr1=[00+]\r\n");
-	printf("trit2int(tr1) = % 2i\r\n", trit2int(tr1));
+	free(codes);
+	free(data[0]);
+	free(data[1]);
+	unlink(path[0]);
+	unlink(path[1]);
+	unlink(path[2]);
+	rmdir(dir);
 
-	// t2.7
-	printf("\r\nt2.7 --- printf long int\r\n");
-	long int ll = 0x00000001lu;
-	printf("long int ll = 0x00000001lu\r\n");
-	printf("ll = %lu\r\n", ll);
-	ll <<= 1;
-	printf("ll <<= 1; ll = %lu\r\n", ll);
-	ll <<= 1;
-	printf("ll <<= 1; ll = %lu\r\n", ll);
-	printf("\r\n");
+	printf("\r\n --- END TEST #28 --- \r\n");
+}
 
-	// t2.8
-	printf("\r\nt2.8 --- sgn_trs(...)\r\n");
-	tr1 = smtr("+0000");
-	printf("tr1=[+0000]\r\n");
-	printf("sgn_trs(tr1) = % 2i\r\n", sgn_trs(tr1));
-	tr1 = smtr("00000");
-	printf("tr1=[00000]\r\n");
-	printf("sgn_trs(tr1) = % 2i\r\n", sgn_trs(tr1));
-	tr1 = smtr("-0000");
-	printf("tr1=[-0000]\r\n");
-	printf("sgn_trs(tr1) = % 2i\r\n", sgn_trs(tr1));
+#define IO_TEST_ZONE_ROWS (270) /* строк зоны команд: 54 слова по 5 строк */
+#define IO_TEST_CONSOLE_CHUNK (65536)
+#define IO_TEST_CONSOLE_PAUSE_MS (10)
 
-	trs_t w1;
-	w1.l = 1;
-	w1 = smtr("-");
-	printf("w1=[-]\r\n");
-	printf("sgn_trs(w1) = % 2i\r\n", sgn_trs(w1));
-	w1 = smtr("0");
-	printf("w1=[0]\r\n");
-	printf("sgn_trs(w1) = % 2i\r\n", sgn_trs(w1));
-	w1 = smtr("+");
-	printf("w1=[+]\r\n");
-	printf("sgn_trs(w1) = % 2i\r\n", sgn_trs(w1));
+/* Программа теста #29: ввод зоны, печать и перфорация зоны, переход */
+static const char *io_test_prog[] = {
+	"-000+-000",  /* -00 : ввод с ФТ-1 в виде команд в зону - */
+	"-0+00-000",  /* -00 : печать зоны - в виде команд на ПМ  */
+	"-+000-000",  /* -00 : перфорация зоны - на ПЛ           */
+	"0000+0000"}; /* 000 : A*=>(C)  0000+                    */
 
-	// t2.9
-	printf("\r\nt2.9 --- view_short_reg()\r\n");
-	tr1 = smtr("+-0+-0+-0");
-	view_short_reg(&tr1, "tr1 =");
+/* Консоль теста #29: читает копию печати порциями, после порции - пауза вывода на экран */
+static void *Test29_Console(void *arg)
+{
+	int fd = *(int *)arg;
+	char *buf = malloc(IO_TEST_CONSOLE_CHUNK);
+	struct timespec ts = {0, IO_TEST_CONSOLE_PAUSE_MS * 1000000L};
 
-	// t2.10
-	printf("\r\nt2.10 --- slice_trs(...)\r\n");
-	tr1 = smtr("+000000000000000000000000000000-");
-	printf("tr1 := [+000000000000000000000000000000-]\r\n");
-	tr2 = slice_trs(tr1, 0, 15);
-	view_short_reg(&tr2, "tr2[15,0] =");
-	printf("tr1 := [+000000000000000000000000000000-]\r\n");
-	tr2 = slice_trs(tr1, 16, 31);
-	view_short_reg(&tr2, "tr2[31,16] =");
+	while ((buf != NULL) && (read(fd, buf, IO_TEST_CONSOLE_CHUNK) > 0))
+	{
+		nanosleep(&ts, NULL);
+	}
+	free(buf);
+	close(fd);
+	return NULL;
+}
 
-	// t2.11
-	printf("\nt2.11 --- copy_trs(...)\r\n");
-	tr1 = smtr("+000000000000000000000000000000-");
-	printf("tr1 := [+000000000000000000000000000000-]\r\n");
-	tr2 = smtr("00000000000000000000000000000000");
-	printf("tr2 := [00000000000000000000000000000000]\r\n");
-	copy_trs(&tr1, &tr2);
-	view_short_reg(&tr2, "tr2 =");
-	tr1 = smtr("+00-00+00");
-	printf("tr1 := [+00-00+00]\r\n");
-	tr2 = smtr("00000000000000000000000000000000");
-	printf("tr2 := [00000000000000000000000000000000]\r\n");
-	copy_trs(&tr1, &tr2);
-	view_short_reg(&tr2, "tr2 =");
+/**
+ * Прогон теста #29: лента ИП-5 из канала, steps команд программы
+ * io_test_prog, печать в path_tty, перфорация в path_ptp, копия печати
+ * в /dev/null или на консоль с паузами (console). Возврат: время
+ * от открытия ленты до вывода всех блоков, с.
+ */
+static double Test29_Run(setun_machine_t *m, uint8_t io, uint8_t console, const uint8_t *tape, size_t size,
+						 uint64_t steps, const char *path_tty, const char *path_ptp)
+{
+	stream_gen_t g = {.fd = -1, .data = tape, .size = size};
+	char src[32];
+	int fd[2];
+	int con[2] = {-1, -1};
+	pthread_t th, th_con;
+	uint64_t done = 0;
+	char stat[256];
+	trs_t a;
+	double t;
+
+	if ((pipe(fd) != 0) || (console && (pipe(con) != 0)))
+	{
+		return -1;
+	}
+	init_setun_machine(m);
+	a = smtr("0000+");
+	for (uint8_t i = 0; i < sizeof(io_test_prog) / sizeof(io_test_prog[0]); i++)
+	{
+		st_fram(m, a, smtr((uint8_t *)io_test_prog[i]));
+		a = next_address(a);
+	}
+	m->C = smtr("0000+");
+	m->tty_echo = console ? fdopen(con[1], "w") : fopen("/dev/null", "w");
+	m->tty1 = fopen(path_tty, "w");
+	m->ptp1 = fopen(path_ptp, "w");
+	g.fd = fd[1];
+	snprintf(src, sizeof(src), "fd:%d", fd[0]);
+
+	t = time_monotonic();
+	pthread_create(&th, NULL, Test28_Generator, &g);
+	if (console)
+	{
+		pthread_create(&th_con, NULL, Test29_Console, &con[0]);
+	}
+	m->ptr1 = tape_fopen(src);
+	close(fd[0]);
+	tape_open(&m->ft1, m->ptr1);
+	if (io)
+	{
+		io_start(m);
+	}
+	run_for(m, steps, &done);
+	dev_sync(m);
+	if (m->tty_echo != NULL)
+	{
+		fflush(m->tty_echo);
+	}
+	t = time_monotonic() - t;
+
+	io_stat_str(m, stat, sizeof(stat));
+	if (stat[0] != '\0')
+	{
+		printf(" %s\r\n", stat);
+	}
+	io_stop(m);
+	tape_close(&m->ft1);
+	if (m->ptr1 != NULL)
+	{
+		fclose(m->ptr1);
+	}
+	if (m->tty1 != NULL)
+	{
+		fclose(m->tty1);
+	}
+	if (m->ptp1 != NULL)
+	{
+		fclose(m->ptp1);
+	}
+	if (m->tty_echo != NULL)
+	{
+		fclose(m->tty_echo);
+	}
+	m->ptr1 = NULL;
+	m->tty1 = NULL;
+	m->ptp1 = NULL;
+	m->tty_echo = NULL;
+	pthread_join(th, NULL);
+	if (console)
+	{
+		pthread_join(th_con, NULL);
+	}
+
+	return (done == steps) ? t : -1;
+}
+
+/* Файлы совпадают. Возврат: размер файла a, -1 - различаются */
+static long Test29_Cmp(const char *path_a, const char *path_b)
+{
+	FILE *f[2] = {fopen(path_a, "rb"), fopen(path_b, "rb")};
+	long n = 0;
+	int a, b;
+
+	if ((f[0] != NULL) && (f[1] != NULL))
+	{
+		do
+		{
+			a = getc(f[0]);
+			b = getc(f[1]);
+			n += (a != EOF);
+		} while ((a == b) && (a != EOF));
+		if (a != b)
+		{
+			n = -1;
+		}
+	}
+	else
+	{
+		n = -1;
+	}
+	for (int k = 0; k < 2; k++)
+	{
+		if (f[k] != NULL)
+		{
+			fclose(f[k]);
+		}
+	}
+	return n;
+}
+
+/**
+ * Поток устройств: программа читает ленту из канала, печатает
+ * и перфорирует каждую зону. Файлы ПМ и ПЛ совпадают с выполнением
+ * без потока устройств, время работы - с потоком и без, копия печати
+ * в /dev/null и на консоль, которая после каждых 64 КБ занята
+ * IO_TEST_CONSOLE_PAUSE_MS.
+ */
+void Test29_Setun_Io_Thread(void)
+{
+	setun_machine_t *m = malloc(sizeof(setun_machine_t));
+	char dir[] = "/tmp/setun1958emu-io-XXXXXX";
+	char path_txt[64];
+	char path_tty[2][64];
+	char path_ptp[2][64];
+	uint8_t *tape = NULL;
+	size_t size = 0;
+	size_t rows = 0;
+	size_t bad;
+	uint64_t steps;
+	uint32_t errors = 0;
+	double t[2][2] = {{0, 0}, {0, 0}};
+	long len_tty = 0, len_ptp = 0;
+	void (*sigpipe)(int);
+	FILE *f;
+
+	printf("\r\n --- TEST #29 I/O device thread for VM SETUN-1958 --- \r\n\r\n");
+
+	if ((m == NULL) || (mkdtemp(dir) == NULL))
+	{
+		free(m);
+		return;
+	}
+	snprintf(path_txt, sizeof(path_txt), "%s/paper.txt", dir);
+	for (int k = 0; k < 2; k++)
+	{
+		snprintf(path_tty[k], sizeof(path_tty[k]), "%s/tty%d.txt", dir, k);
+		snprintf(path_ptp[k], sizeof(path_ptp[k]), "%s/ptp%d.txt", dir, k);
+	}
+
+	init_tab4();
+	init_tab_native();
+	if (ConvertSWtoPaper("software/ip5", dir) != 0)
+	{
+		errors++;
+	}
+	f = fopen(path_txt, "rb");
+	if (f != NULL)
+	{
+		fseek(f, 0, SEEK_END);
+		size = ftell(f);
+		rewind(f);
+		tape = malloc(size);
+		if ((tape == NULL) || (fread(tape, 1, size, f) != size))
+		{
+			errors++;
+		}
+		fclose(f);
+	}
+	if ((tape == NULL) || (errors != 0))
+	{
+		free(tape);
+		free(m);
+		rmdir(dir);
+		printf(" errors: %u\r\n", errors + 1);
+		return;
+	}
+
+	/* Зона читается не меньше чем из IO_TEST_ZONE_ROWS строк: лента прочитана до конца */
+	{
+		uint8_t *codes = malloc(size / 2 + 1);
+
+		rows = (codes != NULL) ? tape_decode_text(tape, size, codes, size / 2 + 1, &bad, TAPE_SIMD_NONE) : 0;
+		free(codes);
+	}
+	steps = (rows * STREAM_TEST_REPEAT / IO_TEST_ZONE_ROWS + 2) * (sizeof(io_test_prog) / sizeof(io_test_prog[0]));
+
+	sigpipe = signal(SIGPIPE, SIG_IGN);
+	for (int c = 0; c < 2; c++)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			t[c][k] = Test29_Run(m, k, c, tape, size, steps, path_tty[k], path_ptp[k]);
+			if (t[c][k] < 0)
+			{
+				errors++;
+			}
+		}
+		len_tty = Test29_Cmp(path_tty[0], path_tty[1]);
+		len_ptp = Test29_Cmp(path_ptp[0], path_ptp[1]);
+		if ((len_tty <= 0) || (len_ptp <= 0))
+		{
+			errors++;
+		}
+	}
+	signal(SIGPIPE, sigpipe);
+
+	printf("\r\n tape: %llu rows from pipe, %llu steps, tty %li bytes, ptp %li bytes\r\n\r\n",
+		   (unsigned long long)rows * STREAM_TEST_REPEAT, (unsigned long long)steps, len_tty, len_ptp);
+	for (int c = 0; c < 2; c++)
+	{
+		printf(" %-14s: synchronous %.3f s, io thread %.3f s, %.2fx\r\n", c ? "console echo" : "/dev/null echo",
+			   t[c][0], t[c][1], (t[c][1] > 0) ? t[c][0] / t[c][1] : 0);
+	}
+	printf("\r\n errors: %u\r\n", errors);
+
+	for (int k = 0; k < 2; k++)
+	{
+		unlink(path_tty[k]);
+		unlink(path_ptp[k]);
+	}
+	unlink(path_txt);
+	rmdir(dir);
+	free(tape);
+	free(m);
+
+	printf("\r\n --- END TEST #29 --- \r\n");
+}
+
+/* Текстовая перфолента из copies копий ленты path_in. Возврат: 0 или -1 */
+static int tape_test_copies(const char *path_in, const char *path_out, int copies)
+{
+	FILE *f = fopen(path_in, "rb");
+	FILE *g = fopen(path_out, "wb");
+	int res = -1;
+
+	if ((f != NULL) && (g != NULL))
+	{
+		char buf[4096];
+		size_t n;
+
+		for (int k = 0; k < copies; k++)
+		{
+			rewind(f);
+			while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+			{
+				fwrite(buf, 1, n, g);
+			}
+			fputs("\r\n", g);
+		}
+		res = 0;
+	}
+	if (f != NULL)
+	{
+		fclose(f);
+	}
+	if ((g != NULL) && (fclose(g) != 0))
+	{
+		res = -1;
+	}
+	return res;
+}
+
+#define ZONE_TEST_ZONES (22)
+#define ZONE_TEST_ROWS (324)
+#define ZONE_TEST_COPIES (200)
+
+/**
+ * Загрузить зону n перфоленты path в FRAM count раз: указателем зон
+ * из FILE.idx или чтением всех предыдущих зон
+ */
+static double Test30_Load(setun_machine_t *m, const char *path, uint32_t n, uint8_t seek, int count)
+{
+	double t = time_monotonic();
+
+	for (int k = 0; k < count; k++)
+	{
+		int res = 0;
+
+		m->ptr1 = fopen(path, "r");
+		if (m->ptr1 == NULL)
+		{
+			return -1;
+		}
+		tape_open(&m->ft1, m->ptr1);
+		if (seek)
+		{
+			res = tape_index_open(&m->ft1, path, 0);
+			if (res == 0)
+			{
+				res = tape_seek_zone(&m->ft1, m->ptr1, n);
+			}
+		}
+		else
+		{
+			for (uint32_t i = 0; i < n; i++)
+			{
+				Read_Commands_from_FT1(m, m->ptr1, smtr("0---0"));
+			}
+		}
+		if (res == 0)
+		{
+			Read_Commands_from_FT1(m, m->ptr1, smtr("0---0"));
+		}
+		tape_close(&m->ft1);
+		fclose(m->ptr1);
+		m->ptr1 = NULL;
+		if (res != 0)
+		{
+			return -1;
+		}
+	}
+	return time_monotonic() - t;
+}
+
+/* Ячейки FRAM равны по значению */
+static uint8_t Test30_Fram_Eq(setun_machine_t *a, setun_machine_t *b)
+{
+	for (uint32_t i = 0; i < SIZE_GR_TRIT_FRAM * SIZE_GRFRAM; i++)
+	{
+		trs_t *x = &a->mem_fram[0][0] + i;
+		trs_t *y = &b->mem_fram[0][0] + i;
+
+		if ((x->l != y->l) || (x->t1 != y->t1) || (x->t0 != y->t0))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
 
-	// t2.12
-	printf("\r\nt2.12 --- inc_trs(...)\r\n");
-	tr1 = smtr("+0-0+---");
-	view_short_reg(&tr1, "tr1 =");
-	inc_trs(&tr1);
-	printf("inc_trs(&tr1)\r\n");
-	view_short_reg(&tr1, "tr1 =");
+/**
+ * Указатель зон перфоленты: 22 зоны по 324 строки на текстовой и
+ * двоичной перфоленте ИП-5, FILE.idx без изменения зон, устаревший
+ * указатель, одинаковая FRAM после загрузки каждой зоны указателем и
+ * чтением ленты, время загрузки последней зоны на ИП-5 и на ленте
+ * из ZONE_TEST_COPIES копий ИП-5
+ */
+void Test30_Setun_Tape_Zones(void)
+{
+	static const char *name[2] = {"text", "binary"};
+	setun_machine_t *m[2] = {malloc(sizeof(setun_machine_t)), malloc(sizeof(setun_machine_t))};
+	char dir[] = "/tmp/setun1958emu-zone-XXXXXX";
+	char path[4][64];
+	uint32_t errors = 0;
+	tape_reader_t r[2];
+	FILE *f;
 
-	// t2.13
-	printf("\r\nt2.13 --- dec_trs(...)\r\n");
-	tr1 = smtr("+0-0-+0-");
-	view_short_reg(&tr1, "tr1 =");
-	dec_trs(&tr1);
-	printf("dec_trs(&tr1)\r\n");
-	view_short_reg(&tr1, "tr1 =");
+	printf("\r\n --- TEST #30 Paper tape zone index for VM SETUN-1958 --- \r\n\r\n");
 
-	// t2.14
-	printf("\r\nt2.14 --- add_trs(...)\r\n");
-	tr1 = smtr("+---+");
-	view_short_reg(&tr1, "tr1 =");
-	tr2 = smtr("+0-+0");
-	view_short_reg(&tr2, "tr2 =");
-	tr1 = add_trs(tr1, tr2);
-	printf("tr1 = add_trs(tr1,tr2)\r\n");
-	view_short_reg(&tr1, "tr1 =");
+	if ((m[0] == NULL) || (m[1] == NULL) || (mkdtemp(dir) == NULL))
+	{
+		free(m[0]);
+		free(m[1]);
+		return;
+	}
+	snprintf(path[0], sizeof(path[0]), "%s/paper.txt", dir);
+	snprintf(path[1], sizeof(path[1]), "%s/paper.bin", dir);
+	snprintf(path[2], sizeof(path[2]), "%s/long.txt", dir);
+	snprintf(path[3], sizeof(path[3]), "%s/long.bin", dir);
 
-	// t2.14.1
-	printf("\r\nt2.14.1 --- add_trs(...)\r\n");
-	tr1 = smtr("-+0000000++++++++");
-	view_short_reg(&tr1, "tr1 =");
-	tr2 = smtr("0+0000000");
-	view_short_reg(&tr2, "tr2 =");
-	tr1 = add_trs(tr1, tr2);
-	printf("tr1 = add_trs(tr1,tr2)\r\n");
-	view_short_reg(&tr1, "tr1 =");
+	init_tab4();
+	if ((ConvertSWtoPaper("software/ip5", dir) != 0) || (tape_text_to_bin(path[0], path[1]) != 0))
+	{
+		errors++;
+	}
 
-	// t2.14.2
-	printf("\r\nt2.14.2 --- add_trs(...)\r\n");
-	tr1 = smtr("0+0000000+++++++++");
-	view_short_reg(&tr1, "tr1 =");
-	tr2 = smtr("0+0000000000000000");
-	view_short_reg(&tr2, "tr2 =");
-	tr1 = add_trs(tr1, tr2);
-	printf("tr1 = add_trs(tr1,tr2)\n");
-	view_short_reg(&tr1, "tr1 =");
+	/* Длинная лента: копии ИП-5 одна за другой */
+	if ((tape_test_copies(path[0], path[2], ZONE_TEST_COPIES) != 0) || (tape_text_to_bin(path[2], path[3]) != 0))
+	{
+		errors++;
+	}
 
-	// t2.15
-	printf("\r\nt2.15 --- sub_trs(...)\r\n");
-	tr1 = smtr("+0-+00--");
-	view_short_reg(&tr1, "tr1 =");
-	tr2 = smtr("+0-0+--+");
-	view_short_reg(&tr2, "tr2 =");
-	tr1 = sub_trs(tr1, tr2);
-	printf("tr1 = sub_trs(tr1,tr2)\r\n");
-	view_short_reg(&tr1, "tr1 =");
+	/* Зоны текстовой и двоичной ленты, запись и чтение FILE.idx */
+	for (int k = 0; k < 2; k++)
+	{
+		tape_reader_t back = {0};
 
-	// t2.15
-	printf("\r\nt2.15 --- shift_trs(...)\r\n");
-	tr1 = smtr("0000+0000");
-	view_short_reg(&tr1, "tr1 =");
-	tr1 = shift_trs(tr1, -2);
-	printf("tr1 = shift_trs(tr1,-2)\r\n");
-	view_short_reg(&tr1, "tr1 =");
-	tr1 = shift_trs(tr1, -2);
-	printf("tr1 = shift_trs(tr1,-2)\r\n");
-	view_short_reg(&tr1, "tr1 =");
+		memset(&r[k], 0, sizeof(r[k]));
+		if ((tape_index_open(&r[k], path[k], 1) != 0) || (r[k].zones != ZONE_TEST_ZONES))
+		{
+			errors++;
+		}
+		for (uint32_t i = 0; i < r[k].zones; i++)
+		{
+			if ((r[k].zone[i].rows != ZONE_TEST_ROWS) ||
+				((k == 1) && (r[1].zone[i].sum != r[0].zone[i].sum)))
+			{
+				errors++;
+				break;
+			}
+		}
+		if ((tape_index_save(&r[k], path[k]) != 0) || (tape_index_open(&back, path[k], 0) != 0) ||
+			(back.zones != r[k].zones) ||
+			(memcmp(back.zone, r[k].zone, r[k].zones * sizeof(tape_zone_t)) != 0))
+		{
+			errors++;
+		}
+		free(back.zone);
+	}
 
-	// t2.16
-	printf("\r\nt2.16 --- mul_trs(...)\r\n");
-	tr1 = smtr("+0000000000000000+");
-	tr1.l = 18;
-	view_short_reg(&tr1, "tr1 =");
-	tr2 = smtr("0-0000000000000000");
-	tr2.l = 18;
-	view_short_reg(&tr2, "tr2 =");
+	/* Каждая зона: указатель и чтение ленты дают одинаковую FRAM */
+	init_setun_machine(m[0]);
+	init_setun_machine(m[1]);
+	m[0]->tty_echo = NULL;
+	m[1]->tty_echo = NULL;
+	for (int k = 0; k < 2; k++)
+	{
+		for (uint32_t i = 0; i < ZONE_TEST_ZONES; i++)
+		{
+			if ((Test30_Load(m[0], path[k], i, 0, 1) < 0) || (Test30_Load(m[1], path[k], i, 1, 1) < 0) ||
+				!Test30_Fram_Eq(m[0], m[1]))
+			{
+				printf(" %s zone %u: FRAM differs\r\n", name[k], i);
+				errors++;
+				break;
+			}
+		}
+	}
 
-	tr2 = mul_trs(tr1, tr2);
-	view_short_reg(&tr2, "tr2 =");
+	/* Время загрузки последней зоны */
+	for (int k = 0; k < 4; k++)
+	{
+		tape_reader_t idx = {0};
+		int count = (k < 2) ? TAPE_TEST_LOADS : TAPE_TEST_LOADS / 40;
+		double t_idx, t_seq, t_seek;
+		uint32_t last;
 
-	// t2.17
-	printf("\r\nt2.17 --- mul_trs(...)\r\n");
-	tr1 = smtr("0000000++");
-	view_short_reg(&tr1, "tr1 =");
-	tr2 = smtr("000000000000000---");
-	view_short_reg(&tr2, "tr2 =");
-	tr2 = mul_trs(tr1, tr2);
-	view_short_reg(&tr2, "tr2 =");
+		t_idx = time_monotonic();
+		if ((k >= 2) && ((tape_index_open(&idx, path[k], 1) != 0) || (tape_index_save(&idx, path[k]) != 0)))
+		{
+			errors++;
+		}
+		t_idx = time_monotonic() - t_idx;
+		last = ((k < 2) ? r[k].zones : idx.zones) - 1;
+		if ((k >= 2) && (idx.zones != ZONE_TEST_ZONES * ZONE_TEST_COPIES))
+		{
+			errors++;
+		}
+		free(idx.zone);
+		t_seq = Test30_Load(m[0], path[k], last, 0, count);
+		t_seek = Test30_Load(m[1], path[k], last, 1, count);
+		if ((t_seq < 0) || (t_seek < 0) || !Test30_Fram_Eq(m[0], m[1]))
+		{
+			errors++;
+			continue;
+		}
+		printf(" %-6s %5u zones: sequential %8.3f ms, seek %7.3f ms, %6.1fx",
+			   name[k & 1], last + 1, t_seq / count * 1e3, t_seek / count * 1e3, t_seq / t_seek);
+		if (k >= 2)
+		{
+			printf(", index %.3f ms", t_idx * 1e3);
+		}
+		printf("\r\n");
+	}
 
-	// t2.18
-	printf("\r\nt2.18 --- shift_long_trs(...)\r\n");
-	long_trs_t ltr1;
-	ltr1.l = 64;
-	tr1 = smtr("0-00+0000");
-	ltr1.t1 = tr1.t1;
-	ltr1.t0 = tr1.t0;
+	/* Лента изменена: другое время - FILE.idx не читается, то же время - зона не сходится */
+	f = fopen(path[1], "r+b");
+	if (f != NULL)
+	{
+		struct stat st;
+		struct timespec ts[2];
+		tape_reader_t idx = {0};
+		uint8_t c = 0;
+		long pos = (long)r[1].zone[ZONE_TEST_ZONES - 1].offset + 1;
+
+		fstat(fileno(f), &st);
+		fseek(f, pos, SEEK_SET);
+		c = (uint8_t)fgetc(f);
+		fseek(f, pos, SEEK_SET);
+		fputc(c ^ 1, f);
+		fclose(f);
+		ts[0] = st.st_atim;
+		ts[1] = st.st_mtim;
+		if ((utimensat(AT_FDCWD, path[1], ts, 0) != 0) || (tape_index_open(&idx, path[1], 0) != 0) ||
+			(Test30_Load(m[1], path[1], ZONE_TEST_ZONES - 1, 1, 1) >= 0))
+		{
+			errors++;
+		}
+		free(idx.zone);
+		idx.zone = NULL;
+		ts[1].tv_sec += 1;
+		if ((utimensat(AT_FDCWD, path[1], ts, 0) != 0) || (tape_index_open(&idx, path[1], 0) == 0))
+		{
+			errors++;
+		}
+		free(idx.zone);
+	}
+	else
+	{
+		errors++;
+	}
+	printf("\r\n errors: %u\r\n", errors);
 
-	// printf("ltr1.t1=%p\r\n",(long int)ltr1.t1);
-	// printf("ltr1.t0=%p\r\n",(long int)ltr1.t0);
+	free(r[0].zone);
+	free(r[1].zone);
+	for (int k = 0; k < 4; k++)
+	{
+		char path_idx[PATH_MAX];
 
-	view_short_long_reg(&ltr1, "ltr1 =");
-	ltr1 = shift_long_trs(ltr1, -2);
-	printf("ltr1 = shift_long_trs(ltr1,-2)\r\n");
-	view_short_long_reg(&ltr1, "ltr1 =");
-	ltr1 = shift_long_trs(ltr1, -2);
-	printf("ltr1 = shift_long_trs(ltr1,-2)\r\n");
-	view_short_long_reg(&ltr1, "ltr1 =");
+		snprintf(path_idx, sizeof(path_idx), "%s.idx", path[k]);
+		unlink(path_idx);
+		unlink(path[k]);
+	}
+	rmdir(dir);
+	free(m[0]);
+	free(m[1]);
 
-	printf("\r\n --- END TEST #2 --- \r\n");
+	printf("\r\n --- END TEST #30 --- \r\n");
 }
 
-/** *********************************************
- *  Тестирование виртуальной машины "Сетунь-1958"
- *  типов данных, функции
- *  ---------------------------------------------
- */
-void ps(int8_t t, uint8_t p)
+#define CACHE_TEST_MACHINES (8)
+#define CACHE_TEST_RUNS (20)
+
+/* Открыть перфоленту path в ФТ1 машины. Возврат: 0 или -1 */
+static int Test31_Open(setun_machine_t *m, const char *path)
 {
-	printf("S[% 3i]=% 2i\r\n", p, t);
+	m->ptr1 = fopen(path, "r");
+	if (m->ptr1 == NULL)
+	{
+		return -1;
+	}
+	tape_open(&m->ft1, m->ptr1);
+	return 0;
 }
 
-void Test3_Setun_Opers(void)
+static void Test31_Close(setun_machine_t *m)
 {
-	int8_t trit;
-	trs_t aa;
-	trs_t ad1;
-	trs_t ad2;
-	trs_t addr;
-	trs_t oper;
-	trs_t exK;
-	trs_t m0;
-	trs_t m1;
-	int8_t ret_exec;
+	tape_close(&m->ft1);
+	if (m->ptr1 != NULL)
+	{
+		fclose(m->ptr1);
+	}
+	m->ptr1 = NULL;
+}
 
-	printf("\r\n --- TEST #3  Operations for VM SETUN-1958 --- \r\n\r\n");
+/* Открыть ленту и загрузить первую зону count раз */
+static double Test31_Runs(setun_machine_t *m, const char *path, int count)
+{
+	double t = time_monotonic();
 
-	reset_setun_1958();
+	for (int k = 0; k < count; k++)
+	{
+		if (Test31_Open(m, path) != 0)
+		{
+			return -1;
+		}
+		Read_Commands_from_FT1(m, m->ptr1, smtr("0---0"));
+		Test31_Close(m);
+	}
+	return time_monotonic() - t;
+}
 
-	// t3.1
-	printf("\r\nt3.1 --- get_trit_setun(...)\r\n");
-	S = smtr("+000000-000000000-");
-	view_short_reg(&S, "S");
-	trit = get_trit_setun(S, 1);
-	ps(trit, 1);
-	trit = get_trit_setun(S, 8);
-	ps(trit, 8);
-	trit = get_trit_setun(S, 18);
-	ps(trit, 18);
+/**
+ * Кэш декодированных перфолент: CACHE_TEST_MACHINES машин читают одни
+ * строки ИП-5 своими курсорами и получают ту же FRAM, что без кэша;
+ * повторное открытие - попадание, изменённая лента - промах, ленты со
+ * ссылками не вытесняются, без ссылок - вытесняются; время открытия
+ * ленты из ZONE_TEST_COPIES копий ИП-5 и загрузки первой зоны
+ */
+void Test31_Setun_Tape_Cache(void)
+{
+	setun_machine_t *m = malloc((CACHE_TEST_MACHINES + 1) * sizeof(setun_machine_t));
+	setun_machine_t *ref = m + CACHE_TEST_MACHINES;
+	uint64_t cache_max = TAPE_CACHE_MAX;
+	char dir[] = "/tmp/setun1958emu-cache-XXXXXX";
+	char path[3][64];
+	uint32_t errors = 0;
+	tape_cache_stat_t st0, st;
+	double t_off, t_on;
+	uint8_t more = 1;
+	FILE *f;
+
+	printf("\r\n --- TEST #31 Decoded paper tape cache for VM SETUN-1958 --- \r\n\r\n");
+
+	if ((m == NULL) || (mkdtemp(dir) == NULL))
+	{
+		free(m);
+		return;
+	}
+	snprintf(path[0], sizeof(path[0]), "%s/paper.txt", dir);
+	snprintf(path[1], sizeof(path[1]), "%s/other.txt", dir);
+	snprintf(path[2], sizeof(path[2]), "%s/long.txt", dir);
 
-	// t3.2
-	printf("\r\nt3.2 --- set_trit_setun(...)\r\n");
-	S = smtr("000000000000000000");
-	S = set_trit_setun(S, 2, -1);
-	ps(-1, 2);
-	S = set_trit_setun(S, 5, 1);
-	ps(1, 5);
-	S = set_trit_setun(S, 18, -1);
-	ps(-1, 18);
-	view_short_reg(&S, "S");
+	init_tab4();
+	if ((ConvertSWtoPaper("software/ip5", dir) != 0) || (tape_test_copies(path[0], path[1], 2) != 0) ||
+		(tape_test_copies(path[0], path[2], ZONE_TEST_COPIES) != 0))
+	{
+		errors++;
+	}
+	for (int i = 0; i <= CACHE_TEST_MACHINES; i++)
+	{
+		init_setun_machine(&m[i]);
+		m[i].tty_echo = NULL;
+	}
 
-	// t3.3
-	printf("\r\nt3.3 --- sgn_trs(...)\r\n");
-	S = smtr("+00000000000000000");
-	printf("S=[+00000000000000000]\r\n");
-	printf("sgn_trs(S) = % 2i\n", sgn_trs(S));
-	S = smtr("000000000000000000");
-	printf("S=[000000000000000000]\r\n");
-	printf("sgn_trs(S) = % 2i\n", sgn_trs(S));
-	S = smtr("-00000000000000000");
-	printf("S=[-00000000000000000]\r\n");
-	printf("sgn_trs(S) = % 2i\n", sgn_trs(S));
+	/* Образец без кэша */
+	TAPE_CACHE_MAX = 0;
+	if (tape_test_load(ref, path[0], 1) < 0)
+	{
+		errors++;
+	}
+	TAPE_CACHE_MAX = cache_max;
 
-	// t3.4
-	printf("\r\nt3.4 --- slice_trs_setun(...)\r\n");
-	S = smtr("+0000000000000000-000000");
-	K = slice_trs_setun(S, 1, 9);
-	view_short_reg(&S, "S");
-	view_short_reg(&K, "K[1,9] =");
-	K = slice_trs_setun(S, 10, 18);
-	view_short_reg(&S, "S");
-	view_short_reg(&K, "K[10,18] =");
+	/* Машины открывают ленту одновременно: один промах, строки общие */
+	tape_cache_stat(&st0);
+	for (int i = 0; i < CACHE_TEST_MACHINES; i++)
+	{
+		if ((Test31_Open(&m[i], path[0]) != 0) || (m[i].ft1.cache == NULL) || (m[i].ft1.data != m[0].ft1.data))
+		{
+			errors++;
+		}
+	}
+	tape_cache_stat(&st);
+	if ((st.misses - st0.misses != 1) || (st.hits - st0.hits != CACHE_TEST_MACHINES - 1))
+	{
+		errors++;
+	}
 
-	// t3.5
-	printf("\r\nt3.5 --- copy_trs_setun(...)\r\n");
-	S = smtr("+0000000000000000-000000");
-	copy_trs_setun(&S, &K);
-	view_short_reg(&S, "S");
-	view_short_reg(&K, "K");
-	K = smtr("---------");
-	copy_trs_setun(&K, &S);
-	view_short_reg(&S, "S");
-	view_short_reg(&K, "K");
+	/* Зоны по очереди: у каждой машины свой курсор */
+	while (more)
+	{
+		more = 0;
+		for (int i = 0; i < CACHE_TEST_MACHINES; i++)
+		{
+			if ((m[i].ptr1 != NULL) && !tape_eof(&m[i].ft1, m[i].ptr1))
+			{
+				Read_Commands_from_FT1(&m[i], m[i].ptr1, smtr("0---0"));
+				more = 1;
+			}
+		}
+	}
+	for (int i = 0; i < CACHE_TEST_MACHINES; i++)
+	{
+		if (!Test30_Fram_Eq(&m[i], ref))
+		{
+			errors++;
+		}
+		Test31_Close(&m[i]);
+	}
 
-	printf("\r\nt3.6 --- S = S + R\r\n");
-	S = smtr("0000000000000+---+");
-	R = smtr("0000000000000+0-+0");
-	view_short_reg(&S, "S");
-	view_short_reg(&R, "R");
-	S = add_trs(S, R);
-	view_short_reg(&S, "S=S+R");
+	/* Повторный запуск - попадание, изменённая лента - промах */
+	tape_cache_stat(&st0);
+	if (Test31_Runs(&m[0], path[0], 1) < 0)
+	{
+		errors++;
+	}
+	f = fopen(path[0], "r+b");
+	if (f != NULL)
+	{
+		int c = fgetc(f);
 
-	// t3.7
-	printf("\r\nt3.7 --- next_address(...)\r\n");
-	C = smtr("000--");
-	view_short_reg(&C, "beg  C");
-	for (int8_t i = 0; i < 10; i++)
+		rewind(f);
+		fputc((c == 'O') ? '_' : 'O', f);
+		fclose(f);
+	}
+	if ((f == NULL) || (Test31_Runs(&m[0], path[0], 1) < 0))
+	{
+		errors++;
+	}
+	tape_cache_stat(&st);
+	if ((st.hits - st0.hits != 1) || (st.misses - st0.misses != 1))
+	{
+		errors++;
+	}
+
+	/* Ленты со ссылками остаются в кэше сверх предела */
+	tape_cache_stat(&st0);
+	TAPE_CACHE_MAX = 1;
+	if ((Test31_Open(&m[0], path[0]) != 0) || (Test31_Open(&m[1], path[1]) != 0))
+	{
+		errors++;
+	}
+	tape_cache_stat(&st);
+	if ((m[0].ft1.cache == NULL) || (m[1].ft1.cache == NULL) || (st.entries < 2))
+	{
+		errors++;
+	}
+	Test31_Close(&m[0]);
+	Test31_Close(&m[1]);
+	tape_cache_stat(&st);
+	if ((st.entries != 0) || (st.evictions - st0.evictions < 2))
+	{
+		errors++;
+	}
+	TAPE_CACHE_MAX = cache_max;
+
+	/* Повторные запуски длинной ленты без кэша и с кэшем */
+	TAPE_CACHE_MAX = 0;
+	t_off = Test31_Runs(&m[0], path[2], CACHE_TEST_RUNS);
+	TAPE_CACHE_MAX = cache_max;
+	t_on = Test31_Runs(&m[1], path[2], CACHE_TEST_RUNS);
+	if ((t_off < 0) || (t_on < 0) || !Test30_Fram_Eq(&m[0], &m[1]))
+	{
+		errors++;
+	}
+	else
+	{
+		printf(" %i runs, %i copies of IP-5: no cache %.3f ms/run, cache %.3f ms/run, %.1fx\r\n",
+			   CACHE_TEST_RUNS, ZONE_TEST_COPIES, t_off / CACHE_TEST_RUNS * 1e3, t_on / CACHE_TEST_RUNS * 1e3,
+			   t_off / t_on);
+	}
+	view_tape_cache_stat();
+	printf("\r\n errors: %u\r\n", errors);
+
+	for (int k = 0; k < 3; k++)
 	{
-		C = next_address(C);
-		view_short_reg(&C, "next C");
+		unlink(path[k]);
 	}
+	rmdir(dir);
+	free(m);
 
-	// t3.8
-	printf("\r\nt3.8 --- control_trs(...)\r\n");
-	trs_t Mem;
-	Mem.l = 9;
-	Mem = smtr("00000000+");
-	view_short_reg(&Mem, "Mem");
-	F = smtr("0000+");
-	view_short_reg(&F, "F");
-	K = control_trs(Mem);
-	view_short_reg(&K, "K");
-
-	Mem = smtr("000000000");
-	view_short_reg(&Mem, "Mem");
-	F = smtr("000++");
-	view_short_reg(&F, "F");
-	K = control_trs(Mem);
-	view_short_reg(&K, "K");
+	printf("\r\n --- END TEST #31 --- \r\n");
+}
 
-	Mem = smtr("00000000-");
-	view_short_reg(&Mem, "Mem");
-	F = smtr("000++");
-	view_short_reg(&F, "F");
-	K = control_trs(Mem);
-	view_short_reg(&K, "K");
+#define DEV_TEST_JOBS (200)
+#define DEV_TEST_STEPS (4 * ZONE_TEST_ZONES) /* ввод, печать, перфорация зоны и переход */
 
-	// t3.8
-	printf("\r\nt3.8 --- st_fram(...)\r\n");
-	//
-	aa = smtr("00000");
-	K = smtr("+0000000-");
-	st_fram(aa, K);
-	view_short_reg(&aa, "aa");
-	view_short_reg(&K, "K");
-	//
-	aa = smtr("0000+");
-	K = smtr("-0000000+");
-	st_fram(aa, K);
-	view_short_reg(&aa, "aa");
-	view_short_reg(&K, "K");
-	//
-	ad1 = smtr("000--");
-	ad2 = smtr("000++");
-	view_fram(ad1, ad2);
+/* Вывод в функцию: копия в буфер памяти ctx */
+static void Test32_Call(void *ctx, const char *data, size_t len)
+{
+	dev_mem_put((dev_out_t *)ctx, data, len);
+}
 
-	// t3.9
-	printf("\r\nt3.9 --- ld_fram(...)\r\n");
-	aa = smtr("000++");
-	K = smtr("+000-000+");
-	printf("st_fram(aa, K)\r\n");
-	st_fram(aa, K);
-	view_short_reg(&aa, "aa");
-	view_short_reg(&K, "K");
-	printf("ld_fram(aa)\r\n");
-	K = ld_fram(aa);
-	view_short_reg(&aa, "aa");
-	view_short_reg(&K, "K");
+/* FNV-1a файла, как dev_sum(). Возврат: размер или -1 */
+static long Test32_File_Sum(const char *path, uint32_t *sum)
+{
+	FILE *f = fopen(path, "rb");
+	long n = 0;
+	int c;
 
-	// t3.10 test Oper=k6..8[+00]: (A*)=>(S)
-	printf("\r\nt3.10:  Oper=k6..8[+00]: (A*)=>(S)\r\n");
-	//
-	reset_setun_1958();
-	//
-	addr = smtr("00000");
-	m0 = smtr("+0-0+0-00");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
-	addr = smtr("0000+");
-	m1 = smtr("00000+000");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+	*sum = 2166136261u;
+	if (f == NULL)
+	{
+		return -1;
+	}
+	while ((c = getc(f)) != EOF)
+	{
+		*sum = (*sum ^ (uint8_t)c) * 16777619u;
+		n++;
+	}
+	fclose(f);
+	return n;
+}
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+/**
+ * Устройства вывода: DEV_TEST_JOBS заданий программы io_test_prog на
+ * перфоленте ИП-5 с выводом ПМ и ПЛ в файлы, в /dev/null, в память,
+ * никуда и в функцию. Вывод в файл, в память и в функцию одинаков,
+ * время задания и доля ввода-вывода по сравнению с выводом никуда.
+ */
+void Test32_Setun_Devices(void)
+{
+	static const char *name[5] = {"file", "file /dev/null", "mem", "null", "call"};
+	static const uint8_t kind[5] = {DEV_FILE, DEV_FILE, DEV_MEM, DEV_NULL, DEV_CALL};
+	setun_machine_t *tmpl = malloc(2 * sizeof(setun_machine_t));
+	setun_machine_t *m = tmpl + 1;
+	char dir[] = "/tmp/setun1958emu-dev-XXXXXX";
+	char path[3][64];
+	dev_out_t acc = {0};
+	uint64_t bytes[5][2] = {{0}};
+	uint32_t sum[5][2] = {{0}};
+	double t[5];
+	uint32_t errors = 0;
+	trs_t a;
+
+	printf("\r\n --- TEST #32 Output device backends for VM SETUN-1958 --- \r\n\r\n");
+
+	if ((tmpl == NULL) || (mkdtemp(dir) == NULL))
+	{
+		free(tmpl);
+		return;
+	}
+	snprintf(path[0], sizeof(path[0]), "%s/paper.txt", dir);
+	snprintf(path[1], sizeof(path[1]), "%s/tty.txt", dir);
+	snprintf(path[2], sizeof(path[2]), "%s/ptp.txt", dir);
 
-	// work VM Setun-1958
-	K = ld_fram(C);
+	init_tab4();
+	if (ConvertSWtoPaper("software/ip5", dir) != 0)
+	{
+		errors++;
+	}
 
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	//
-	view_short_regs();
+	/* Машина задания: программа в FRAM, ленты и устройства открывает задание */
+	init_setun_machine(tmpl);
+	a = smtr("0000+");
+	for (uint8_t i = 0; i < sizeof(io_test_prog) / sizeof(io_test_prog[0]); i++)
+	{
+		st_fram(tmpl, a, smtr((uint8_t *)io_test_prog[i]));
+		a = next_address(a);
+	}
+	tmpl->C = smtr("0000+");
+	tmpl->tty_echo = NULL;
+	tmpl->path_ptr1 = path[0];
+	tmpl->path_ptr2 = "/dev/null";
 
-	// t3.11 test Oper=k6..8[-++]: (S)=>(A*)
-	printf("\r\nt3.11:  Oper=k6..8[-++]: (S)=>(A*)\r\n");
-	//
-	reset_setun_1958();
-	//
-	S = smtr("-0000000+000-+0000");
-	//
-	addr = smtr("0000+");
-	m1 = smtr("0000--++0");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+	for (int k = 0; k < 5; k++)
+	{
+		double t0 = time_monotonic();
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+		for (int j = 0; j < DEV_TEST_JOBS; j++)
+		{
+			uint64_t done = 0;
+
+			memcpy(m, tmpl, sizeof(setun_machine_t));
+			m->path_tty1 = (k == 1) ? "/dev/null" : path[1];
+			m->path_ptp1 = (k == 1) ? "/dev/null" : path[2];
+			acc.len = 0;
+			dev_set(&m->tty_dev, kind[k], Test32_Call, &acc);
+			dev_set(&m->ptp_dev, kind[k], NULL, NULL);
+			Emu_Open_Files(m);
+			run_for(m, DEV_TEST_STEPS, &done);
+			Emu_Close_Files(m);
+			if (done != DEV_TEST_STEPS)
+			{
+				errors++;
+			}
+			bytes[k][0] = m->tty_dev.bytes;
+			bytes[k][1] = m->ptp_dev.bytes;
+			sum[k][0] = (k == 4) ? dev_sum(&acc) : dev_sum(&m->tty_dev);
+			sum[k][1] = dev_sum(&m->ptp_dev);
+			dev_free(&m->tty_dev);
+			dev_free(&m->ptp_dev);
+		}
+		t[k] = time_monotonic() - t0;
+		if (k == 0)
+		{
+			/* Вывод в файлы последнего задания */
+			for (int i = 0; i < 2; i++)
+			{
+				if (Test32_File_Sum(path[1 + i], &sum[0][i]) != (long)bytes[0][i])
+				{
+					errors++;
+				}
+			}
+		}
+	}
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]r\\n", ret_exec);
-	printf("\r\n");
-	//
-	view_short_regs();
-	//
-	ad1 = smtr("000--");
-	ad2 = smtr("000++");
-	view_fram(ad1, ad2);
+	/* Печать и перфорация одинаковы на всех устройствах */
+	for (int k = 1; k < 5; k++)
+	{
+		if ((bytes[k][0] != bytes[0][0]) || (bytes[k][1] != bytes[0][1]) ||
+			((kind[k] != DEV_FILE) && (kind[k] != DEV_NULL) && (sum[k][0] != sum[0][0])) ||
+			((kind[k] == DEV_MEM) && (sum[k][1] != sum[0][1])))
+		{
+			printf(" %s: output differs\r\n", name[k]);
+			errors++;
+		}
+	}
+	if ((bytes[0][0] == 0) || (bytes[0][1] == 0))
+	{
+		errors++;
+	}
 
-	// t3.12 test Oper=k6..8[+-+]: (A*)=>(R)
-	printf("\r\nt3.12:  Oper=k6..8[+-+]: (A*)=>(R)\r\n");
-	//
-	reset_setun_1958();
-	//
-	addr = smtr("00000");
-	m0 = smtr("+0-0+0-00");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
-	addr = smtr("0000+");
-	m1 = smtr("00000+-+0");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+	for (int k = 0; k < 5; k++)
+	{
+		printf(" %-14s: %i jobs, %.3f s, %7.1f us/job, I/O %+7.1f us/job\r\n", name[k], DEV_TEST_JOBS, t[k],
+			   t[k] / DEV_TEST_JOBS * 1e6, (t[k] - t[3]) / DEV_TEST_JOBS * 1e6);
+	}
+	printf(" output per job: tty %llu bytes, ptp %llu bytes\r\n",
+		   (unsigned long long)bytes[0][0], (unsigned long long)bytes[0][1]);
+	printf("\r\n errors: %u\r\n", errors);
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+	dev_free(&acc);
+	for (int k = 0; k < 3; k++)
+	{
+		unlink(path[k]);
+	}
+	rmdir(dir);
+	free(tmpl);
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	//
-	view_short_regs();
+	printf("\r\n --- END TEST #32 --- \r\n");
+}
 
-	// t3.13 test Oper=k6..8[0-0]: (A*)=>(F)
-	printf("\r\nt3.12:  Oper=k6..8[0-0]: (A*)=>(F)\r\n");
-	//
-	reset_setun_1958();
-	//
-	addr = smtr("00000");
-	m0 = smtr("+0-0+0-00");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
-	addr = smtr("0000+");
-	m1 = smtr("000000-00");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+#define QUEUE_TEST_COUNT (1000000)
+#define QUEUE_TEST_PING (10000)
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\nreg C = 00001\r\n");
+static emu_queue_t test_queue;
+static _Atomic uint32_t test_ack;
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	//
-	view_short_regs();
+/* Производитель теста #16: поток команд, затем запрос-подтверждение */
+static void *Test16_Producer(void *arg)
+{
+	double *ping = (double *)arg;
+	emu_cmd_t c = {.code = EMU_CMD_RUN};
+	uint32_t i;
 
-	// t3.14 test Oper=k6..8[00-]: (F)=>(A*)
-	printf("\r\nt3.14:  Oper=k6..8[00-]: (F)=>(A*)\r\n");
-	//
-	reset_setun_1958();
-	//
-	F = smtr("-000+");
-	//
-	addr = smtr("0000+");
-	m1 = smtr("0000000-0");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+	for (i = 1; i <= QUEUE_TEST_COUNT; i++)
+	{
+		c.seq = i;
+		c.val = (int32_t)(i * 3);
+		while (!emu_queue_push(&test_queue, &c))
+		{
+			sched_yield();
+		}
+	}
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+	*ping = time_monotonic();
+	for (i = 1; i <= QUEUE_TEST_PING; i++)
+	{
+		c.seq = QUEUE_TEST_COUNT + i;
+		while (!emu_queue_push(&test_queue, &c))
+		{
+			sched_yield();
+		}
+		while (atomic_load_explicit(&test_ack, memory_order_acquire) != c.seq)
+		{
+			sched_yield();
+		}
+	}
+	*ping = time_monotonic() - *ping;
+	return NULL;
+}
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	//
-	view_short_regs();
-	//
-	ad1 = smtr("000--");
-	ad2 = smtr("000++");
-	view_fram(ad1, ad2);
+/**
+ * Очередь команд пульта управления: порядок и целостность команд
+ * между двумя потоками, пропускная способность и время
+ * подтверждения команды
+ */
+void Test16_Setun_Cmd_Queue(void)
+{
+	pthread_t tid;
+	emu_cmd_t c;
+	uint32_t expect = 1;
+	uint32_t errors = 0;
+	double ping = 0;
+	double t;
 
-	// t3.15 test Oper=k6..8[00+]: (C)=>(A*)
-	printf("\r\nt3.15:  Oper=k6..8[00+]: (C)=>(A*)\r\n");
-	//
-	reset_setun_1958();
-	//
-	F = smtr("-000+");
-	//
-	addr = smtr("0000+");
-	m1 = smtr("0000000+0");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+	printf("\r\n --- TEST #16 SPSC command queue for VM SETUN-1958 --- \r\n\r\n");
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+	atomic_store(&test_queue.head, 0);
+	atomic_store(&test_queue.tail, 0);
+	atomic_store(&test_ack, 0);
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	//
-	view_short_regs();
-	//
-	ad1 = smtr("000--");
-	ad2 = smtr("000++");
-	view_fram(ad1, ad2);
+	t = time_monotonic();
+	if (pthread_create(&tid, NULL, Test16_Producer, &ping) != 0)
+	{
+		printf(" ERR#: pthread_create\r\n");
+		return;
+	}
+	while (expect <= QUEUE_TEST_COUNT + QUEUE_TEST_PING)
+	{
+		if (!emu_queue_pop(&test_queue, &c))
+		{
+			sched_yield();
+			continue;
+		}
+		if ((c.seq != expect) || ((expect <= QUEUE_TEST_COUNT) && (c.val != (int32_t)(expect * 3))))
+		{
+			errors++;
+		}
+		if (expect > QUEUE_TEST_COUNT)
+		{
+			atomic_store_explicit(&test_ack, c.seq, memory_order_release);
+		}
+		expect++;
+	}
+	pthread_join(tid, NULL);
+	t = time_monotonic() - t;
 
-	// t3.16 test Oper=k6..8[+0+]: (S)+(A*)=>(S)
-	printf("\r\nt3.16:  Oper=k6..8[+0+]: (S)+(A*)=>(S)\r\n");
-	//
-	reset_setun_1958();
-	//
-	addr = smtr("00000");
-	m0 = smtr("0000000+0");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
-	S = smtr("00000000000000000+");
-	//
-	addr = smtr("0000+");
-	m1 = smtr("00000+0+0");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+	printf(" commands: %u, errors: %u, time = %.3f s, %.0f cmd/s\r\n",
+		   QUEUE_TEST_COUNT + QUEUE_TEST_PING, errors, t, (QUEUE_TEST_COUNT + QUEUE_TEST_PING) / t);
+	printf(" round trip: %.2f us\r\n", ping / QUEUE_TEST_PING * 1e6);
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+	printf("\r\n --- END TEST #16 --- \r\n");
+}
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	//
-	view_short_regs();
+/*----------------- END TESTS ---------------*/
 
-	// t3.17 test Oper=k6..8[+0-]: (S)-(A*)=>(S)
-	printf("\r\nt3.17:  Oper=k6..8[+0-]: (S)-(A*)=>(S)\r\n");
-	//
-	reset_setun_1958();
-	//
-	addr = smtr("00000");
-	m0 = smtr("0000000++");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
-	S = smtr("000000000000000+0+");
-	view_short_reg(&S, "S=");
-	//
-	addr = smtr("0000+");
-	m1 = smtr("00000+0-0");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+const char *get_file_ext(const char *filename)
+{
+	const char *dot = strrchr(filename, '.');
+	if (!dot || dot == filename)
+		return "";
+	return dot + 1;
+}
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\nreg C = 00001\r\n");
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	//
-	view_short_regs();
+void LoadFileListToPaperTxt(char *pathcataloglst, char *pathfilelst, char *pathfiletxt)
+{
+	FILE *file_lst;
+	FILE *file_txt;
 
-	// t3.18 test Oper=k6..8[++0]: (S)=>(R); (A*)(R)=>(S)
-	printf("\r\nt3.18:  Oper=k6..8[++0]: (S)=>(R); (A*)(R)=>(S)\r\n");
-	//
-	reset_setun_1958();
-	//
-	addr = smtr("00000");
-	m0 = smtr("0+0000000");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
-	S = smtr("00000000+++0000000");
-	view_short_reg(&S, "S=");
-	//
-	addr = smtr("0000+");
-	m1 = smtr("00000++00");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+	/* Переменная, в которую поочередно будут помещаться считываемые строки */
+	char str[80] = {0};
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+	/* Указатель, в который будет помещен адрес массива, в который считана */
+	/* строка, или NULL если достигнут коней файла или произошла ошибка */
+	char *estr;
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	//
-	view_short_regs();
+	file_txt = fopen(pathfiletxt, "w");
+	if (file_txt == NULL)
+	{
+		printf("ERR fopen %s\r\n", pathfiletxt);
+		return;
+	}
 
-	// t3.19 test Oper=k6..8[+++]: (S)+(A*)(R)=>(S)
-	printf("\r\nt3.19:  Oper=k6..8[+++]: (S)+(A*)(R)=>(S)\r\n");
-	//
-	reset_setun_1958();
-	//
-	addr = smtr("00000");
-	m0 = smtr("000000--0");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
-	S = smtr("000000000000000+00");
-	view_short_reg(&S, "S=");
-	//
-	R = smtr("0000000000000000+0");
-	view_short_reg(&R, "R=");
-	//
-	addr = smtr("0000+");
-	m1 = smtr("00000+++0");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+	file_lst = fopen(pathfilelst, "r");
+	if (file_lst == NULL)
+	{
+		printf("ERR fopen %s\r\n", pathfilelst);
+		return;
+	}
+	else
+	{
+		printf("Read file list: %s\r\n", pathfilelst);
+                printf("\r\n");
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+		/* Чтение (построчно) данных из файла в бесконечном цикле */
+		while (1)
+		{
+			/* Чтение одной строки  из файла */
+			estr = fgets(str, sizeof(str), file_lst);
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	//
-	view_short_regs();
+			/* Проверка на конец файла или ошибку чтения */
+			if (estr == NULL)
+			{
+				/* Проверяем, что именно произошло: кончился файл */
+				/* или это ошибка чтения */
+				if (feof(file_lst) != 0)
+				{
+					/* Если файл закончился, выводим сообщение о завершении */
+					/* чтения и выходим из бесконечного цикла */
+					// printf("\r\nЧтение файла закончено\r\n");
+					break;
+				}
+				else
+				{
+					/* Если при чтении произошла ошибка, выводим сообщение */
+					/* об ошибке и выходим из бесконечного цикла */
+					// printf("\nОшибка чтения из файла\r\n");
+					break;
+				}
+			}
 
-	// t3.21 test Oper=k6..8[++-]: (A*)+(S)(R)=>(S)=>(S)
-	printf("\r\nt3.21:  Oper=k6..8[++-]: (A*)+(S)(R)=>(S)\r\n");
-	//
-	reset_setun_1958();
-	//
-	addr = smtr("00000");
-	m0 = smtr("000000--0");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
-	S = smtr("000000000000000+00");
-	view_short_reg(&S, "S=");
-	//
-	R = smtr("0000000000000000+0");
-	view_short_reg(&R, "R=");
-	//
-	addr = smtr("0000+");
-	m1 = smtr("00000++-0");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+			/* ---------------------------------
+			 * Загрузить из файла тест-программу
+			 * ---------------------------------
+			 */
+			printf("Read file: %s\r\n", str);
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+			FILE *file;
+			char path_str[160] = {0};
+			uint8_t cmd[20];
+			trs_t inr;
+			trs_t dst;
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	//
-	view_short_regs();
+			inr = smtr("0---0"); /* cчетчик адреса коротких слов */
+			trs_t sum;
+			trs_t tmp;
 
-	printf("   \r\n");
+			tmp.l = 18;
+			tmp.t1 = 0;
+			tmp.t0 = 0;
 
-	// t3.22 test Oper=k6..8[+-0]: (A*)[x](S)=>(S)
-	printf("\r\nt3.22:  Oper=k6..8[+-0]: (A*)[x](S)=>(S)\r\n");
-	//
-	reset_setun_1958();
-	//
-	addr = smtr("00000");
-	m0 = smtr("000000--0");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
-	S = smtr("000000000000000+00");
-	view_short_reg(&S, "S=");
-	//
-	R = smtr("0000000000000000+0");
-	view_short_reg(&R, "R=");
-	//
-	addr = smtr("0000+");
-	m1 = smtr("00000+-00");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+			int64_t dsun = 0;
+			sum.l = 18;
+			sum.t1 = 0;
+			sum.t0 = 0;
+			//
+			dst.l = 9;
+			setun.MR.l = 18;
+			int i = 0;
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+			strcat(path_str, pathcataloglst);
+			strcat(path_str, "/");
+			if (str[strlen(str) - 1] == 0x0A)
+			{
+				str[strlen(str) - 1] = 0;
+			}
+			str[strlen(str)] = 0;
+			strcat(path_str, str);
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	// view_short_regs();
+			file = fopen(path_str, "r");
+			if (file == NULL)
+			{
+				printf("ERR fopen %s\r\n", path_str);
+				return;
+			}
 
-	// t3.23 test Oper=k6..8[-+0]: S сд. (A*)=>(S)
-	printf("\r\nt3.23:  Oper=k6..8[-+0]: S сд. (A*)=>(S)\r\n");
-	//
-	reset_setun_1958();
-	//
-	addr = smtr("-000-");
-	m0 = smtr("+0000000-+000-000-");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
-	S = smtr("000000000000000+00");
-	view_short_reg(&S, "S=");
-	//
-	// R = smtr("0000000000000000+0");
-	// view_short_reg(&R, "R=");
-	//
-	addr = smtr("0000+");
-	m1 = smtr("-000-0-+00");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+			while (fscanf(file, "%s", cmd) != EOF)
+			{
+				uint8_t offset4_7 = 4;
+				uint8_t prlile[7];
+				trs_t dst;
+				trs_t trit2;
+				//
+				cmd_str_2_trs(cmd, &dst);
+				trit2.l = 2;
+				trit2.t1 = 0;
+				trit2.t0 = 0;
+				//
+				trit2 = set_trit_setun(trit2, 1, 0);
+				trit2 = set_trit_setun(trit2, 2, get_trit_setun(dst, 1));
+				memset(prlile, 0, sizeof(prlile));
+				memmove(prlile, tab4_7[trs2digit(trit2) + offset4_7], sizeof(prlile));
+				fwrite(prlile, 1, strlen(prlile), file_txt);
+				fwrite("\r\n", 1, strlen("\r\n"), file_txt);
+				//
+				trit2 = set_trit_setun(trit2, 1, get_trit_setun(dst, 2));
+				trit2 = set_trit_setun(trit2, 2, get_trit_setun(dst, 3));
+				memset(prlile, 0, sizeof(prlile));
+				memmove(prlile, tab4_7[trs2digit(trit2) + offset4_7], sizeof(prlile));
+				fwrite(prlile, 1, strlen(prlile), file_txt);
+				fwrite("\r\n", 1, strlen("\r\n"), file_txt);
+				//
+				trit2 = set_trit_setun(trit2, 1, get_trit_setun(dst, 4));
+				trit2 = set_trit_setun(trit2, 2, get_trit_setun(dst, 5));
+				memset(prlile, 0, sizeof(prlile));
+				memmove(prlile, tab4_7[trs2digit(trit2) + offset4_7], sizeof(prlile));
+				fwrite(prlile, 1, strlen(prlile), file_txt);
+				fwrite("\r\n", 1, strlen("\r\n"), file_txt);
+				//
+				trit2 = set_trit_setun(trit2, 1, get_trit_setun(dst, 6));
+				trit2 = set_trit_setun(trit2, 2, get_trit_setun(dst, 7));
+				memset(prlile, 0, sizeof(prlile));
+				memmove(prlile, tab4_7[trs2digit(trit2) + offset4_7], sizeof(prlile));
+				fwrite(prlile, 1, strlen(prlile), file_txt);
+				fwrite("\r\n", 1, strlen("\r\n"), file_txt);
+				//
+				trit2 = set_trit_setun(trit2, 1, get_trit_setun(dst, 8));
+				trit2 = set_trit_setun(trit2, 2, get_trit_setun(dst, 9));
+				memset(prlile, 0, sizeof(prlile));
+				memmove(prlile, tab4_7[trs2digit(trit2) + offset4_7], sizeof(prlile));
+				fwrite(prlile, 1, strlen(prlile), file_txt);
+				fwrite("\r\n", 1, strlen("\r\n"), file_txt);
+				//
+				memset(prlile, 0, sizeof(prlile));
+				memmove(prlile, "O__._O", sizeof(prlile));
+				fwrite(prlile, 1, strlen(prlile), file_txt);
+				fwrite("\r\n", 1, strlen("\r\n"), file_txt);
+			}
+			fclose(file);
+
+			/* Промежуток между зонами на перфоленте */
+			for (int j = 0; j < 5; j++)
+			{
+				fwrite("___.__\r\n", 1, strlen("___.__\r\n"), file_txt);
+			}
+		}
+	}
+
+	/* Закрыть файлы */
+	fclose(file_lst);
+	fclose(file_txt);
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+	printf("\r\nWrite file: %s\r\n", pathfiletxt);
+}
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	view_short_reg(&S, "S=");
-	// view_short_regs();
+int ConvertSWtoPaper(char *path_lst, char *path_txt)
+{
 
-	// t3.24 test Oper=k6..8[-+-]: Норм.(S)=>(A*); (N)=>(S)
-	printf("\r\nt3.24:  Oper=k6..8[-+-]:  Норм.(S)=>(A*); (N)=>(S)\r\n");
-	//
-	reset_setun_1958();
-	//
-	addr = smtr("00000");
-	m0 = smtr("00000000-");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
-	S = smtr("000000000000000+00");
-	view_short_reg(&S, "S=");
-	//
-	// R = smtr("0000000000000000+0");
-	// view_short_reg(&R, "R=");
-	//
-	addr = smtr("0000+");
-	m1 = smtr("00000-+-0");
-	st_fram(addr, m1);
-	view_elem_fram(addr);
+	int res = 0;
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+	char a_fileName[80];
 
-	// work VM Setun-1958
-	K = ld_fram(C);
-	view_short_reg(&K, "K=");
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	printf("S.l=%d\r\n", S.l);
-	view_short_reg(&S, "S=");
+	printf("[ Convert software files to file paper.txt ]\r\n");
+        printf("\r\n");
 
-	addr = smtr("00000");
-	view_elem_fram(addr);
+	DIR *dir;
+	struct dirent *ent;
+	if ((dir = opendir(path_lst)) != NULL)
+	{
+		/* print all the files and directories within directory */
+		while ((ent = readdir(dir)) != NULL)
+		{
+			char file_ext[10];
+			strcpy(file_ext, get_file_ext(ent->d_name));
+			/* Найти список файлов */
+			if (strcmp(file_ext, "lst") == 0)
+			{
+				strcpy(a_fileName, ent->d_name);
+				res = 0; /* Ok' */
+				break;
+			}
+		}
+		closedir(dir);
+	}
+	else
+	{
+		/* could not open directory */
+		perror("Could not open directory");
+		res = 1; /* Error#1 */
+		return EXIT_FAILURE;
+	}
 
-	// view_short_regs();
+	/* Прочитать файлы из каталога и преобразовать в папер */
+	if (res == 0)
+	{
+		/* Проверить каталог */
+		if ((dir = opendir(path_txt)) != NULL)
+		{
+			res = 0; /* Ok' */
+		}
+		else
+		{
+			res = 2; /* Error#2 */
+		}
+	}
 
-	// t3.25 test Oper=k6..8[-00]:
-	printf("\r\nt3.25:  Oper=k6..8[-00]: \r\n");
+	/* Прочитать файлы программы из каталога и преобразовать в paper.txt */
+	if (res == 0)
+	{
+		char pathfile1[255];
+		char pathfile2[255];
+		// clear
+		memset(pathfile1, 0, sizeof(pathfile1));
+		memset(pathfile2, 0, sizeof(pathfile2));
+		// path file1
+		strcat(pathfile1, path_lst);
+		strcat(pathfile1, "/");
+		strcat(pathfile1, a_fileName);
+		// path file2
+		strcat(pathfile2, path_txt);
+		strcat(pathfile2, "/");
+		strcat(pathfile2, "paper.txt");
 
-	printf("\r\n --- END TEST #3 --- \r\n\r\n");
+		LoadFileListToPaperTxt(path_lst, pathfile1, pathfile2);
+	}
+
+	return res; /* Ok' */
 }
 
-void Test4_Setun_Opers(void)
+int DumpFileTxs(char *pathfiletxs)
 {
-	int8_t trit;
-	trs_t aa;
-	trs_t ad1;
-	trs_t ad2;
-	trs_t addr;
-	trs_t oper;
-	trs_t exK;
-	trs_t m0;
-	trs_t m1;
-	int8_t ret_exec;
+	FILE *file_txs;
 
-	printf("\r\n --- TEST #4  Operations for VM SETUN-1958 --- \r\n\r\n");
+	file_txs = fopen(pathfiletxs, "r");
+	if (file_txs == NULL)
+	{
+		printf("ERR fopen %s\r\n", pathfiletxs);
+		return 1;
+	}
 
-	// t4.1 test Oper=k6..8[+00]: (A*)=>(S)
-	printf("\r\nt4.1:  Oper=k6..8[+00]: (A*)=>(S)\r\n");
-	//
-	reset_setun_1958();
+	printf("Read commands from file.txs: %s\r\n", pathfiletxs);
 
-	printf("\r\n");
-	// FRAM(-1) test
-	addr = smtr("-0000");
-	m0 = smtr("00000000+");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
-	addr = smtr("-000+");
-	m0 = smtr("-0000000+");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
+	uint8_t cmd[20];
+	trs_t inr;
+	trs_t dst;
+
+	inr = smtr("0---0"); /* cчетчик адреса коротких слов */
+	trs_t sum;
+	trs_t tmp;
+
+	tmp.l = 18;
+	tmp.t1 = 0;
+	tmp.t0 = 0;
+
+	int64_t dsun = 0;
+	sum.l = 18;
+	sum.t1 = 0;
+	sum.t0 = 0;
 	//
-	addr = smtr("-00+-");
-	m0 = smtr("0000000+0");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
+	dst.l = 9;
+	setun.MR.l = 18;
+	int i = 0;
 
-	/* Begin address fram */
-	addr = smtr("0000+");
-	m1 = smtr("-000-+000");
-	st_fram(addr, m1);
-	view_short_reg(&m1, "m1");
-	view_elem_fram(addr);
+	while (fscanf(file_txs, "%s", cmd) != EOF)
+	{
+		cmd_str_2_trs(cmd, &dst);
+		sum = add_trs(sum, dst);
+		i += 1;
+
+		dsun += trs2digit(dst);
+
+		st_fram(&setun, inr, dst);
+		inr = next_address(inr);
+	}
+	/* Закрыть файл */
+	fclose(file_txs);
 
+	dump_fram_zone(&setun, smtr("0"));
+
+	printf("\r\n i=%i\r\n", i);
+
+	/* Печать контрольных сумм */
 	printf("\r\n");
+	view_checksum_setun(sum);
 
-	// work VM Setun-1958
-	C = smtr("0000+");
-	K = ld_fram(C);
-	view_short_reg(&K, "C(0000+)");
+	return 0; /* Ok' */
+}
 
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("\r\n [status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("\r\n [status: ERR#%d]\r\n", ret_exec);
 
-	printf("\r\n --- END TEST #4 --- \r\n");
+void print_version(void) {
+        printf(" Emulator ternary computer 'Setun-1958':\r\n");
+        printf(" Version: %s\r\n",Version);
+		printf(" Author:  Vladimir V.\r\n");
+        printf(" E-mail:  askfind@ya.ru\r\n");
+        printf("\r\n");
 }
 
-void Test5_Setun_Load(void)
+int version(const char *argv0)
 {
-	printf("\r\n --- TEST #5  Load program FT1,FT2 for VM SETUN-1958 --- \r\n\r\n");
+    printf(" Emulator ternary computer 'Setun-1958': ver.%s\r\n", Version);
+    printf(" Author: Vladimir V.\r\n");
+    printf(" E-mail: askfind@ya.ru\r\n");
+    printf("\r\n");
 
-	FILE *file_lst;
+	exit(0);
+}
 
-	/* Переменная, в которую поочередно будут помещаться считываемые строки */
-	char str[80] = {0};
+/* Справка по параметрам в поток f */
+int usage(FILE *f, const char *argv0)
+{
+    fprintf(f, "usage: %s [options]\r\n", argv0);
+	fprintf(f, "\t--version : version software setun1958emu\r\n");
+	fprintf(f, "\t--help : this help\r\n");
+	fprintf(f, "\t--tape FILE : paper tape for FT1 (ptr1/paper.txt), text or binary; - stdin, fd:N descriptor, FIFO\r\n");
+	fprintf(f, "\t--tape2bin FILE : convert text paper tape to binary --out FILE and exit\r\n");
+	fprintf(f, "\t--bin2tape FILE : convert binary paper tape to text --out FILE and exit\r\n");
+	fprintf(f, "\t--tape-index FILE : build the zone index of paper tape FILE, write FILE.idx and exit\r\n");
+	fprintf(f, "\t--zone N : start from zone N of the FT1 paper tape\r\n");
+	fprintf(f, "\t--tape-cache MB : decoded text paper tapes shared in the process, 0 - off (64)\r\n");
+	fprintf(f, "\t--load DIR : convert software DIR/file.lst to ptr1/paper.txt and run it\r\n");
+	fprintf(f, "\t--convert DIR : convert software DIR/file.lst to ptr1/paper.txt and exit\r\n");
+	fprintf(f, "\t--drum FILE : preload DRUM from file.txs, zones 01-- ...\r\n");
+	fprintf(f, "\t--steps N : instruction budget\r\n");
+	fprintf(f, "\t--seconds T : time budget\r\n");
+	fprintf(f, "\t--tty FILE|mem|null : typewriter output, memory by default\r\n");
+	fprintf(f, "\t--ptp FILE|mem|null : paper tape punch output, memory by default\r\n");
+	fprintf(f, "\t--ptp-bin : punch a binary paper tape (SETUNPL1)\r\n");
+	fprintf(f, "\t--io-thread : typewriter, punch and streamed tape I/O in a device thread\r\n");
+	fprintf(f, "\t--regs FILE : final registers dump\r\n");
+	fprintf(f, "\t--native : native integer registers S, R, F\r\n");
+	fprintf(f, "\t--idle off|stop|skip : idle loop detection, stop by default in batch mode\r\n");
+	fprintf(f, "\t--pace N|setun : real-time pace, short operations per second\r\n");
+	fprintf(f, "\t--jobs FILE : run the tapes listed in FILE, one per line, in parallel\r\n");
+	fprintf(f, "\t--threads N : worker threads for --jobs, 0 - report 1, 2, 4 and all cores\r\n");
+	fprintf(f, "\t--sched shared|steal : --jobs scheduler, shared queue or work stealing\r\n");
+	fprintf(f, "\t--out DIR : per job DIR/NNNN.tty, .ptp, .regs for --jobs; output FILE for --tape2bin, --bin2tape\r\n");
+	fprintf(f, "\t--sweep FILE : run variants of the loaded program, one line of NAME=VALUE per variant\r\n");
+	fprintf(f, "\t--cells LIST : FRAM cells A(1:5) in the sweep results, comma separated\r\n");
+	fprintf(f, "\t--result FILE : sweep results, CSV\r\n");
+	fprintf(f, "\t--binary : sweep results in binary records\r\n");
+	fprintf(f, "\t--fork-server SOCKET : load once, fork a process per request line on a Unix socket\r\n");
+	fprintf(f, "\t--daemon SOCKET : job service, framed tape jobs on a Unix socket, --threads workers\r\n");
+	fprintf(f, "\t--dump FILE : dump zone from file.txs setun1958emu\r\n");
+	fprintf(f, "\t--LOGGING : view step  setun1958emu\r\n");
+	fprintf(f, "\t--breakpoint C : stop at address C(1:5)\r\n");
+	fprintf(f, "\t--test N : number test setun1958emu\r\n");
+	fprintf(f, "\r\n");
+	fprintf(f, " exit status: %i STOP, %i budget, %i STOP_OVER, %i STOP_ERROR,\r\n",
+		   BATCH_EXIT_STOP, BATCH_EXIT_BUDGET, BATCH_EXIT_OVER, BATCH_EXIT_ERROR);
+	fprintf(f, "              %i breakpoint or idle loop, %i bad options or files\r\n",
+		   BATCH_EXIT_BREAK, BATCH_EXIT_USAGE);
+    fprintf(f, "\r\n");
 
-	/* Указатель, в который будет помещен адрес массива, в который считана */
-	/* строка, или NULL если достигнут коней файла или произошла ошибка */
-	char *estr;
+	return 0;
+}
 
-	file_lst = fopen("ur1/00_ip5.lst", "r");
-	if (file_lst == NULL)
-	{
-		printf("ERR fopen ur1/00_ip5.lst\r\n");
-		return;
-	}
-	else
-	{
-		printf("fopen: ur1/00_ip5.lst\r\n");
 
-		/* Чтение (построчно) данных из файла в бесконечном цикле */
-		while (1)
+void Emu_Open_Files_ptr1_ptr2(setun_machine_t *m) {		
+		/* Открыть файлы для виртуальных устройств	*/
+		m->ptr1 = fopen("ptr1/paper.txt", "w");
+		if (m->ptr1 == NULL)
+		{	
+			printf("Error fopen 'ptr1/paper.txt'\r\n");
+			//viv~ TODO
+			//return 0; 
+		}
+
+		m->ptr2 = fopen("ptr2/paper.txt", "w");
+		if (m->ptr2 == NULL)
 		{
-			/* Чтение одной строки  из файла */
-			estr = fgets(str, sizeof(str), file_lst);
+			printf("Error fopen 'ptr1/paper.txt'\r\n");
+			//viv~ TODO
+			//return 0;
+		}
+}
 
-			/* Проверка на конец файла или ошибку чтения */
-			if (estr == NULL)
-			{
-				/* Проверяем, что именно произошло: кончился файл */
-				/* или это ошибка чтения */
-				if (feof(file_lst) != 0)
-				{
-					/* Если файл закончился, выводим сообщение о завершении */
-					/* чтения и выходим из бесконечного цикла */
-					printf("\r\nЧтение файла закончено\r\n");
-					break;
-				}
-				else
-				{
-					/* Если при чтении произошла ошибка, выводим сообщение */
-					/* об ошибке и выходим из бесконечного цикла */
-					printf("\r\nОшибка чтения из файла\r\n");
-					break;
-				}
-			}
+void Emu_Close_Files_ptr1_ptr2(setun_machine_t *m)
+{
+			/* Закрыть файлы виртуальных устройств */
+			fclose(m->ptr1);
+			fclose(m->ptr2);
+}
 
-			/* ---------------------------------
-			 * Загрузить из файла тест-программу
-			 * ---------------------------------
-			 */
-			printf("\r\n --- Load ur1/%s --- \r\n", str);
+void Emu_Open_Files(setun_machine_t *m) {
 
-			FILE *file;
-			char path_str[160] = {0};
-			uint8_t cmd[20];
-			trs_t inr;
-			trs_t dst;
+		/* Открыть файлы для виртуальных устройств	*/
+		m->ptr1 = tape_fopen(m->path_ptr1);
+		if (m->ptr1 == NULL)
+		{	
+			printf("Error fopen '%s'\r\n", m->path_ptr1);
+			//viv~ TODO
+			//return 0; 
+		}
 
-			inr = smtr("0---0"); /* cчетчик адреса коротких слов */
-			trs_t sum;
-			trs_t tmp;
+		m->ptr2 = tape_fopen(m->path_ptr2);
+		if (m->ptr2 == NULL)
+		{
+			printf("Error fopen '%s'\r\n", m->path_ptr2);
+			//viv~ TODO
+			//return 0;
+		}
 
-			tmp.l = 18;
-			tmp.t1 = 0;
-			tmp.t0 = 0;
+		/* Текстовая или двоичная перфолента в памяти */
+		tape_open(&m->ft1, m->ptr1);
+		tape_open(&m->ft2, m->ptr2);
 
-			int64_t dsun = 0;
-			sum.l = 18;
-			sum.t1 = 0;
-			sum.t0 = 0;
-			//
-			dst.l = 9;
-			MR.l = 18;
-			int i = 0;
+		/* Указатель зон из FILE.idx, если он построен заранее */
+		tape_index_open(&m->ft1, m->path_ptr1, 0);
+		tape_index_open(&m->ft2, m->path_ptr2, 0);
 
-			strcat(path_str, "ur1/");
-			if (str[strlen(str) - 1] == 0x0A)
+		/* Печать и перфорация в память, никуда или функции - без файлов */
+		dev_set(&m->ptp_dev, m->ptp_dev.kind, m->ptp_dev.call, m->ptp_dev.ctx);
+		dev_set(&m->tty_dev, m->tty_dev.kind, m->tty_dev.call, m->tty_dev.ctx);
+
+		if (m->ptp_dev.kind == DEV_FILE)
+		{
+			m->ptp1 = fopen(m->path_ptp1, "w");
+			if (m->ptp1 == NULL)
 			{
-				str[strlen(str) - 1] = 0;
+				printf("Error fopen '%s'\r\n", m->path_ptp1);
+				//viv~ TODO
+				//return 0;
 			}
-			str[strlen(str)] = 0;
-			strcat(path_str, str);
+		}
+		ptp_begin(m);
 
-			file = fopen(path_str, "r");
-			if (file == NULL)
+		if (m->tty_dev.kind == DEV_FILE)
+		{
+			m->tty1 = fopen(m->path_tty1, "w");
+			if (m->tty1 == NULL)
 			{
-				printf("ERR fopen %s\r\n", path_str);
-				return;
+				printf("Error fopen '%s'\r\n", m->path_tty1);
+				//viv~ TODO
+				//return 0;
 			}
+		}
+}
 
-			while (fscanf(file, "%s", cmd) != EOF)
-			{
-				cmd_str_2_trs(cmd, &dst);
-				sum = add_trs(sum, dst);
-				i += 1;
+void Emu_Close_Files(setun_machine_t *m)
+{
+			/* Закрыть файлы виртуальных устройств */
+			tty_flush(m);
+			io_stop(m);
+			ptp_end(m);
+			tape_close(&m->ft1);
+			tape_close(&m->ft2);
+			if (m->ptr1 != NULL) fclose(m->ptr1);
+			if (m->ptr2 != NULL) fclose(m->ptr2);
+			if (m->ptp1 != NULL) fclose(m->ptp1);
+			if (m->tty1 != NULL) fclose(m->tty1);
+			m->ptr1 = NULL;
+			m->ptr2 = NULL;
+			m->ptp1 = NULL;
+			m->tty1 = NULL;
+}
 
-				dsun += trs2digit(dst);
+void Emu_Begin(setun_machine_t *m) {
 
-				LOGGING_print("%s -> [", cmd);
-				trs2str(dst);
-				LOGGING_print("]");
-				if (LOGGING > 0)
-				{
-					view_short_reg(&inr, " addr");
-				}
-				else
-				{
-					printf("\r\n");
-				}
+		/* Инициализация таблиц символов ввода и вывода "Сетунь-1958" */
+		init_tab4();
 
-				st_fram(inr, dst);
-				inr = next_address(inr);
-			}
-			fclose(file);
+		/* Сброс виртуальной машины "Сетунь-1958" */
+		reset_setun_1958(m);
 
-			printf("\r\n i=%i\n", i);
+		/* В режиме отладки вывод регистров */
+		if (LOGGING > 0)
+		{
+			view_short_regs(m);
+		}		
+		
+		Emu_Open_Files(m);
 
-			/* Печать контрольных сумм */
-			printf("\r\n");
-			view_checksum_setun(sum);
-			//
-		}
-	}
-	fclose(file_lst);
-	printf("fclose: ur1/00_ip5.lst\r\n");
+		/*  Выполнить первый код "Сетунь-1958" */
+		printf("\r\n[ Start Setun-1958 ]\r\n");
+
+		/* Выполение программы в ферритовой памяти "Сетунь-1958" */
+		Begin_Read_Commands_from_FT1(m, m->ptr1);
+
+		/* Begin address fram */
+		m->C = smtr("0000+");
 
-	printf("\r\n --- END TEST #5 --- \r\n");
 }
 
-void Test6_Setun_Load(void)
-{
-	printf("\r\n --- TEST #6  Load program FT1,FT2 for VM SETUN-1958 --- \r\n\r\n");
+int Emu_Step(setun_machine_t *m) {
 
-	FILE *file_lst;
+	trs_t addr;
+	trs_t C_cur;
+	trs_t oper;
+	int ret;
 
-	/* Переменная, в которую поочередно будут помещаться считываемые строки */
-	char str[80] = {0};
+	C_cur = m->C;
+	m->K = ld_fram(m, m->C);
+	m->K = slice_trs_setun(m->K, 1, 9);
 
-	/* Указатель, в который будет помещен адрес массива, в который считана */
-	/* строка, или NULL если достигнут коней файла или произошла ошибка */
-	char *estr;
+	if (LOGGING > 0)
+	{
+		view_step_short_reg(m, &m->C, "\n С");
+	}
 
-	file_lst = fopen("software/ip5_in_out_10_3/00_ip5_in_out_10_3.lst", "r");
-	if (file_lst == NULL)
+	if (m->native)
 	{
-		printf("ERR fopen software/ip5_in_out_10_3/00_ip5_in_out_10_3.lst\r\n");
-		return;
+		/* Модификация адреса читает F(1:5) */
+		if ((m->native_state == NATIVE_DIRTY) && (get_trit_setun(m->K, 9) != 0))
+		{
+			m->F = int2trs(m->nF, 5);
+		}
+		addr = control_trs(m, m->K);
+		oper = slice_trs_setun(m->K, 6, 8);
+		ret = execute_native(m, addr, oper);
 	}
 	else
 	{
-		printf("fopen: software/ip5_in_out_10_3/00_ip5_in_out_10_3.lst\r\n");
+		addr = control_trs(m, m->K);
+		oper = slice_trs_setun(m->K, 6, 8);
+		ret = execute_trs(m, addr, oper);
+	}
 
-		/* Чтение (построчно) данных из файла в бесконечном цикле */
-		while (1)
-		{
-			/* Чтение одной строки  из файла */
-			estr = fgets(str, sizeof(str), file_lst);
+	/* Печать до останова видна полностью */
+	if (ret != OK)
+	{
+		dev_sync(m);
+	}
+	return ret;
+}
 
-			/* Проверка на конец файла или ошибку чтения */
-			if (estr == NULL)
+/**
+ * Выполнить не более n команд без возврата в пульт управления.
+ * Возврат: OK - исчерпан бюджет команд, иначе статус останова
+ * (STOP, STOP_OVER, STOP_ERROR, STOP_ERROR_MB_NUMBER, STOP_BREAKPOINT).
+ * В done записывается число выполненных команд.
+ */
+int run_for(setun_machine_t *m, uint64_t n, uint64_t *done)
+{
+	uint64_t i;
+	int ret = OK;
+	uint8_t check_bp = (BREAKPOINT != INT32_MAX);
+	uint8_t c_prev, c_next;
+
+	/* Состояние могло измениться вне run_for() */
+	m->idle.valid = 0;
+
+	for (i = 0; i < n; i++)
+	{
+		c_prev = TRS5_IND(m->C);
+		ret = Emu_Step(m);
+		if (ret != OK)
+		{
+			i++;
+			break;
+		}
+		/* Точка останова проверяется для следующей команды */
+		if (check_bp && (trs2digit(m->C) == BREAKPOINT))
+		{
+			ret = STOP_BREAKPOINT;
+			i++;
+			break;
+		}
+		/*
+		 * Холостой цикл проверяется при переходе назад. C не меняется
+		 * только при переходе на себя, который не меняет состояние.
+		 */
+		c_next = TRS5_IND(m->C);
+		if ((IDLE_DETECT != IDLE_OFF) && (c_next <= c_prev) &&
+			((c_next == c_prev) || idle_check(m)))
+		{
+			i++;
+			if (IDLE_DETECT == IDLE_SKIP)
 			{
-				/* Проверяем, что именно произошло: кончился файл */
-				/* или это ошибка чтения */
-				if (feof(file_lst) != 0)
-				{
-					/* Если файл закончился, выводим сообщение о завершении */
-					/* чтения и выходим из бесконечного цикла */
-					printf("\r\nЧтение файла закончено\r\n");
-					break;
-				}
-				else
-				{
-					/* Если при чтении произошла ошибка, выводим сообщение */
-					/* об ошибке и выходим из бесконечного цикла */
-					printf("\r\nОшибка чтения из файла\r\n");
-					break;
-				}
+				/* Остаток пакета выполнен циклом без изменения состояния */
+				m->idle_skipped += n - i;
+				i = n;
 			}
+			else
+			{
+				ret = STOP_IDLE;
+			}
+			break;
+		}
+	}
 
-			/* ---------------------------------
-			 * Загрузить из файла тест-программу
-			 * ---------------------------------
-			 */
-			printf("\r\n --- Load software/ip5_in_out_10_3/%s --- \r\n", str);
-
-			FILE *file;
-			char path_str[160] = {0};
-			uint8_t cmd[20];
-			trs_t inr;
-			trs_t dst;
+	if (done != NULL)
+	{
+		*done = i;
+	}
+	return ret;
+}
 
-			inr = smtr("0---0"); /* cчетчик адреса коротких слов */
-			trs_t sum;
-			trs_t tmp;
+/* Сделать снимок состояния для idle_check() */
+void idle_snap(setun_machine_t *m)
+{
+	idle_snap_t *p = &m->idle;
+
+	p->io_count = m->io_count;
+	p->C = m->C;
+	p->F = m->F;
+	p->W = m->W;
+	p->ph1 = m->ph1;
+	p->ph2 = m->ph2;
+	p->S = m->S;
+	p->R = m->R;
+	p->MB = m->MB;
+	for (uint8_t r = 0; r < SIZE_GR_TRIT_FRAM; r++)
+	{
+		p->mem_fram[r][0] = m->mem_fram[r][0];
+		p->mem_fram[r][1] = m->mem_fram[r][1];
+	}
+	p->valid = 1;
+}
 
-			tmp.l = 18;
-			tmp.t1 = 0;
-			tmp.t0 = 0;
+/* Равенство троичных чисел с одинаковыми битами */
+uint8_t idle_trs_eq(trs_t *a, trs_t *b)
+{
+	return (a->l == b->l) && (a->t1 == b->t1) && (a->t0 == b->t0);
+}
 
-			int64_t dsun = 0;
-			sum.l = 18;
-			sum.t1 = 0;
-			sum.t0 = 0;
-			//
-			dst.l = 9;
-			MR.l = 18;
-			int i = 0;
+/* Совпадает ли состояние машины со снимком */
+uint8_t idle_same(setun_machine_t *m)
+{
+	idle_snap_t *p = &m->idle;
 
-			strcat(path_str, "software/ip5_in_out_10_3/");
-			if (str[strlen(str) - 1] == 0x0A)
-			{
-				str[strlen(str) - 1] = 0;
-			}
-			str[strlen(str)] = 0;
-			strcat(path_str, str);
+	if (!idle_trs_eq(&p->C, &m->C) || !idle_trs_eq(&p->S, &m->S) ||
+		!idle_trs_eq(&p->R, &m->R) || !idle_trs_eq(&p->F, &m->F) ||
+		!idle_trs_eq(&p->W, &m->W) || !idle_trs_eq(&p->ph1, &m->ph1) ||
+		!idle_trs_eq(&p->ph2, &m->ph2) || !idle_trs_eq(&p->MB, &m->MB))
+	{
+		return 0;
+	}
+	for (uint8_t r = 0; r < SIZE_GR_TRIT_FRAM; r++)
+	{
+		if (!idle_trs_eq(&p->mem_fram[r][0], &m->mem_fram[r][0]) ||
+			!idle_trs_eq(&p->mem_fram[r][1], &m->mem_fram[r][1]))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
 
-			file = fopen(path_str, "r");
-			if (file == NULL)
-			{
-				printf("ERR fopen %s\r\n", path_str);
-				return;
-			}
+/**
+ * Проверка холостого цикла после перехода назад по адресу C(1:5).
+ * Снимок регистров и FRAM сравнивается по алгоритму
+ * Брента: снимок обновляется через 1, 2, 4, ... переходов назад,
+ * поэтому цикл с повторяющимся состоянием обнаруживается не позже
+ * чем через два его периода. Ввод-вывод и обмен с МБ сбрасывают снимок.
+ */
+uint8_t idle_check(setun_machine_t *m)
+{
+	native_sync(m);
 
-			while (fscanf(file, "%s", cmd) != EOF)
-			{
-				cmd_str_2_trs(cmd, &dst);
-				sum = add_trs(sum, dst);
-				i += 1;
+	if (!m->idle.valid || (m->idle.io_count != m->io_count))
+	{
+		idle_snap(m);
+		m->idle.power = 1;
+		m->idle.lam = 0;
+		return 0;
+	}
 
-				dsun += trs2digit(dst);
+	if (idle_same(m))
+	{
+		return 1;
+	}
 
-				LOGGING_print("%s -> [", cmd);
-				trs2str(dst);
-				LOGGING_print("]");
-				if (LOGGING > 0)
-				{
-					view_short_reg(&inr, " addr");
-				}
-				else
-				{
-					printf("\r\n");
-				}
+	m->idle.lam++;
+	if (m->idle.lam == m->idle.power)
+	{
+		idle_snap(m);
+		m->idle.power *= 2;
+		m->idle.lam = 0;
+	}
+	return 0;
+}
 
-				st_fram(inr, dst);
-				inr = next_address(inr);
-			}
-			fclose(file);
+/**
+ * Выполнять команды до останова машины.
+ */
+int run_until_stop(setun_machine_t *m, uint64_t *done)
+{
+	uint64_t n;
+	uint64_t all = 0;
+	int ret;
 
-			printf("\r\n i=%i\r\n", i);
+	do
+	{
+		ret = run_for(m, RUN_BATCH_STEPS, &n);
+		all += n;
+	} while (ret == OK);
 
-			/* Печать контрольных сумм */
-			printf("\r\n");
-			view_checksum_setun(sum);
-			//
-		}
+	if (done != NULL)
+	{
+		*done = all;
 	}
-	fclose(file_lst);
-	printf("fclose: software/ip5_in_out_10_3/00_ip5_in_out.lst\r\n");
+	return ret;
+}
 
-	printf("\r\n --- END TEST #6 --- \r\n");
+/* Печать производительности непрерывной работы */
+void view_run_stat(uint64_t steps, double t)
+{
+	if (t > 0)
+	{
+		printf("\r\n[ Run: %llu instr, %.3f s, %.0f instr/s ]\r\n",
+			   (unsigned long long)steps, t, steps / t);
+	}
+	else
+	{
+		printf("\r\n[ Run: %llu instr ]\r\n", (unsigned long long)steps);
+	}
 }
 
-void Test7_Setun_Load(void)
+/* Печать числа команд, пропущенных в холостом цикле */
+void view_idle_stat(setun_machine_t *m)
 {
-	printf("\r\n --- TEST #7  Load program FT1,FT2 for VM SETUN-1958 --- \r\n\r\n");
+	if (m->idle_skipped > 0)
+	{
+		printf("[ Idle loop: %llu instr skipped ]\r\n", (unsigned long long)m->idle_skipped);
+	}
+}
 
-	FILE *file_lst;
+/**
+ * Время операций "Сетунь-1958" по коду операции K(6:8), мкс
+ */
+static double tab_pace_us[27];
+static pthread_once_t tab_pace_once = PTHREAD_ONCE_INIT;
 
-	/* Переменная, в которую поочередно будут помещаться считываемые строки */
-	char str[80] = {0};
+static void build_tab_pace(void)
+{
+	for (int i = 0; i < 27; i++)
+	{
+		tab_pace_us[i] = PACE_SHORT_US;
+	}
+	tab_pace_us[trs2digit(smtr("++0")) + 13] = PACE_MUL_US;
+	tab_pace_us[trs2digit(smtr("+++")) + 13] = PACE_MUL_US;
+	tab_pace_us[trs2digit(smtr("++-")) + 13] = PACE_MUL_US;
+	tab_pace_us[trs2digit(smtr("-0+")) + 13] = PACE_DRUM_US;
+	tab_pace_us[trs2digit(smtr("-0-")) + 13] = PACE_DRUM_US;
+	tab_pace_us[trs2digit(smtr("-00")) + 13] = PACE_IO_US;
+}
 
-	/* Указатель, в который будет помещен адрес массива, в который считана */
-	/* строка, или NULL если достигнут коней файла или произошла ошибка */
-	char *estr;
+void init_tab_pace(void)
+{
+	pthread_once(&tab_pace_once, build_tab_pace);
+}
 
-	file_lst = fopen("software/ip5_in_out_3_10/00_ip5_in_out_3_10.lst", "r");
-	if (file_lst == NULL)
+/* Время до момента t по монотонным часам без активного ожидания */
+static void sleep_until(double t)
+{
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)t;
+	ts.tv_nsec = (long)((t - ts.tv_sec) * 1e9);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
 	{
-		printf("ERR fopen software/ip5_in_out_3_10/00_ip5_in_out_3_10.lst\r\n");
-		return;
 	}
-	else
+}
+
+/**
+ * Выполнить квант PACE_SLICE_US эмулируемого времени, но не более n команд,
+ * и ждать, пока реальное время догонит эмулируемое.
+ * Возврат как у run_for(). Холостой цикл в режиме IDLE_SKIP не пропускается:
+ * в реальном времени он и так не загружает процессор.
+ */
+int run_paced(setun_machine_t *m, uint64_t n, uint64_t *done)
+{
+	pace_stat_t *p = &m->pace;
+	double scale = (double)PACE_SETUN_OPS / PACE_OPS;
+	double slice_end;
+	double target;
+	double now;
+	uint64_t i;
+	int ret = OK;
+	uint8_t check_bp = (BREAKPOINT != INT32_MAX);
+	uint8_t c_prev, c_next;
+
+	if (!p->valid)
 	{
-		printf("fopen: software/ip5_in_out_3_10/00_ip5_in_out_3_10.lst\r\n");
+		init_tab_pace();
+		memset(p, 0, sizeof(*p));
+		p->t_start = time_monotonic();
+		p->t0 = p->t_start;
+		p->valid = 1;
+		m->idle.valid = 0;
+	}
 
-		/* Чтение (построчно) данных из файла в бесконечном цикле */
-		while (1)
+	slice_end = p->emu_us + PACE_SLICE_US;
+	for (i = 0; (i < n) && (p->emu_us < slice_end); i++)
+	{
+		c_prev = TRS5_IND(m->C);
+		ret = Emu_Step(m);
+		p->emu_us += tab_pace_us[trs2digit(slice_trs_setun(m->K, 6, 8)) + 13] * scale;
+		if (ret != OK)
 		{
-			/* Чтение одной строки  из файла */
-			estr = fgets(str, sizeof(str), file_lst);
-
-			/* Проверка на конец файла или ошибку чтения */
-			if (estr == NULL)
-			{
-				/* Проверяем, что именно произошло: кончился файл */
-				/* или это ошибка чтения */
-				if (feof(file_lst) != 0)
-				{
-					/* Если файл закончился, выводим сообщение о завершении */
-					/* чтения и выходим из бесконечного цикла */
-					printf("\r\nЧтение файла закончено\r\n");
-					break;
-				}
-				else
-				{
-					/* Если при чтении произошла ошибка, выводим сообщение */
-					/* об ошибке и выходим из бесконечного цикла */
-					printf("\r\nОшибка чтения из файла\r\n");
-					break;
-				}
-			}
+			i++;
+			break;
+		}
+		if (check_bp && (trs2digit(m->C) == BREAKPOINT))
+		{
+			ret = STOP_BREAKPOINT;
+			i++;
+			break;
+		}
+		c_next = TRS5_IND(m->C);
+		if ((IDLE_DETECT == IDLE_STOP) && (c_next <= c_prev) &&
+			((c_next == c_prev) || idle_check(m)))
+		{
+			ret = STOP_IDLE;
+			i++;
+			break;
+		}
+	}
+	if (done != NULL)
+	{
+		*done = i;
+	}
 
-			/* ---------------------------------
-			 * Загрузить из файла тест-программу
-			 * ---------------------------------
-			 */
-			printf("\r\n --- Load software/ip5_in_out_3_10/%s --- \r\n", str);
+	/* Ждать момента окончания кванта по реальному времени */
+	target = p->t0 + p->emu_us / 1e6;
+	now = time_monotonic();
+	if (now < target)
+	{
+		sleep_until(target);
+		now = time_monotonic();
+		p->drift_sum += (now - target) * 1e6;
+		if ((now - target) * 1e6 > p->drift_max)
+		{
+			p->drift_max = (now - target) * 1e6;
+		}
+	}
+	else
+	{
+		p->late++;
+		if ((now - target) * 1e6 > PACE_RESYNC_US)
+		{
+			/* Пауза хоста: не догонять рывком */
+			p->total_us += p->emu_us;
+			p->emu_us = 0;
+			p->t0 = now;
+			p->resync++;
+		}
+	}
+	p->slices++;
 
-			FILE *file;
-			char path_str[160] = {0};
-			uint8_t cmd[20];
-			trs_t inr;
-			trs_t dst;
+	return ret;
+}
 
-			inr = smtr("0---0"); /* cчетчик адреса коротких слов */
-			trs_t sum;
-			trs_t tmp;
+/* Печать счётчиков работы в реальном времени и сброс отсчёта */
+void view_pace_stat(setun_machine_t *m)
+{
+	pace_stat_t *p = &m->pace;
 
-			tmp.l = 18;
-			tmp.t1 = 0;
-			tmp.t0 = 0;
+	if (!p->valid)
+	{
+		return;
+	}
+	p->valid = 0;
 
-			int64_t dsun = 0;
-			sum.l = 18;
-			sum.t1 = 0;
-			sum.t0 = 0;
-			//
-			dst.l = 9;
-			MR.l = 18;
-			int i = 0;
+	printf("[ Pace: %u ops/s, emulated %.3f s, wall %.3f s, slices %llu, late %llu, resync %llu, drift avg %.0f us, max %.0f us ]\r\n",
+		   PACE_OPS, (p->total_us + p->emu_us) / 1e6, time_monotonic() - p->t_start,
+		   (unsigned long long)p->slices, (unsigned long long)p->late, (unsigned long long)p->resync,
+		   (p->slices > p->late) ? p->drift_sum / (p->slices - p->late) : 0, p->drift_max);
+}
 
-			strcat(path_str, "software/ip5_in_out_3_10/");
-			if (str[strlen(str) - 1] == 0x0A)
-			{
-				str[strlen(str) - 1] = 0;
-			}
-			str[strlen(str)] = 0;
-			strcat(path_str, str);
+void Emu_Stop(setun_machine_t *m) {
+			
+			//dump_fram_zone(smtr("-"));
+		    //dump_fram_zone(smtr("0"));
+		    //dump_fram_zone(smtr("+"));
+            
+			/* Prints REGS */
+			view_short_regs(m);
+			printf("\r\n");
 
-			file = fopen(path_str, "r");
-			if (file == NULL)
+			/* Prints REGS and FRAM */
+			if (LOGGING > 0)
 			{
-				printf("ERR fopen %s\r\n", path_str);
-				return;
+				// dump_fram_zone(smtr("-"));
+				// dump_fram_zone(smtr("0"));
+				// dump_fram_zone(smtr("+"));
 			}
 
-			cmd_str_2_trs(cmd, &dst);
-			sum = add_trs(sum, dst);
-			i += 1;
-
-			LOGGING_print("%s -> [", cmd);
-			trs2str(dst);
-			LOGGING_print("]");
-			if (LOGGING > 0)
+			/* Печать завершения работы "Setun-1958" */
+			if (STEP == 0)
 			{
-				view_short_reg(&inr, " addr");
+				printf("\r\n[ Stop Setun-1958 ]\r\n");
 			}
 			else
 			{
-				printf("\r\n");
+				printf("\r\n[ Step = %d : Break work Setun-1958 ]\r\n", STEP);
 			}
 
-			st_fram(inr, dst);
-			inr = next_address(inr);
-			fclose(file);
+			/* Закрыть файлы виртуальных устройств */
+			Emu_Close_Files(m);
+}
 
-			/* Печать контрольных сумм */
-			printf("\r\n");
-			view_checksum_setun(sum);
-		}
-		// printf("\r\n i=%i\r\n", i);
-		//
-	}
 
-	fclose(file_lst);
-	printf("fclose: software/ip5_in_out_3_10/00_ip5_in_out_3_10.lst\r\n");
-	printf("\r\n --- END TEST #7 --- \r\n");
-}
 
-void Test8_Setun_Electrified_Typewriter(void)
-{
-	printf("\r\n --- TEST #8 electrified_typewriter() and dump --- \r\n");
+/** -------------------------------
+ *  
+ *  -------------------------------
+ */
+int Process_Work_Emulation(void)
+{	
+	int test = 0;
+	int convert = 0;
+	int dump = 0;
+	char *output = "-";
+	int ret = 0;	
 
-	trs_t inr;
-	trs_t cp;
-	clear(&cp);
-	cp.l = 3;
-	cp = set_trit_setun(cp, 1, -1);
-	cp = set_trit_setun(cp, 2, -1);
-	cp = set_trit_setun(cp, 3, -1);
+	/* ------------------------------
+	*  Переменные emulator Setun-1958
+	*/
+	uint8_t cmd[20] = {0};
+	uint8_t ret_exec = 0;
+	static uint64_t counter_step = 0;
+	static uint64_t run_steps = 0; /* команд в текущем непрерывном выполнении */
+	static double run_time = 0;	   /* время текущего непрерывного выполнения */
+	static uint64_t run_batch = RUN_BATCH_STEPS; /* команд между проверками ввода */
+	
+	LOGGING = 0; /* Вывод отладочной информации  */
 
-	uint8_t cc;
+	/* Состояние после включения питания */
+	if( emu_stat == NOREADY_EMU_ST ) {		
+		
+		Emu_Open_Files(&setun);
 
-	cp = set_trit_setun(cp, 1, 1);
-	cp = set_trit_setun(cp, 2, 1);
-	cp = set_trit_setun(cp, 3, 0);
-	electrified_typewriter(cp, 0);
+		/* Инициализация таблиц символов ввода и вывода "Сетунь-1958" */
+		init_tab4();
 
-	cp = set_trit_setun(cp, 1, -1);
-	cp = set_trit_setun(cp, 2, -1);
-	cp = set_trit_setun(cp, 3, -1);
-	for (cc = 0; cc < 27; cc++)
-	{
-		if (trs2digit(cp) != 12 || trs2digit(cp) != 11)
+		/* Сброс виртуальной машины "Сетунь-1958" */
+		reset_setun_1958(&setun);
+		
+		/* Новое состоняие */
+		emu_stat = WAIT_EMU_ST;
+	}
+
+	if( emu_stat == BEGIN_EMU_ST ) {	
+		/* Начальный старт */
+		Emu_Begin(&setun);
+
+		/* Новое состоняие */
+		emu_stat = LOOP_WORK_EMU_ST;
+	}
+
+	
+	if( emu_stat == STEP_EMU_ST ) {		
+		ret_exec = Emu_Step(&setun);
+		tty_flush(&setun);
+		
+		if ((ret_exec == STOP))
+		{
+			printf("\r\n<STOP>\r\n");
+			emu_stat = STOP_EMU_ST;
+			//break;
+		}
+		else if (ret_exec == STOP_OVER)
+		{
+			printf("\r\n<STOP_OVER>\r\n");			
+			emu_stat = STOP_EMU_ST;
+			//break;
+		}
+		else if (ret_exec == STOP_ERROR)
+		{
+			printf("\r\nERR#:%i<STOP_ERROR>\r\n", ret_exec);			
+			emu_stat = ERROR_EMU_ST;
+			//break;
+		}
+		else if (ret_exec == STOP_ERROR_MB_NUMBER)
 		{
-			electrified_typewriter(cp, 0);
+			printf("\r\nERR#:%i<STOP_ERROR_MB_NUMBER>\r\n", ret_exec);
+			cli_ascii();
+			emu_stat = ERROR_MB_NUMBER_EMU_ST;
+			//break;
 		}
-		inc_trs(&cp);
-	}
 
-	cp = set_trit_setun(cp, 1, 1);
-	cp = set_trit_setun(cp, 2, 1);
-	cp = set_trit_setun(cp, 3, -1);
-	electrified_typewriter(cp, 0);
+		/**/
+		counter_step++;		
 
-	cp = set_trit_setun(cp, 1, -1);
-	cp = set_trit_setun(cp, 2, -1);
-	cp = set_trit_setun(cp, 3, -1);
-	for (cc = 0; cc < 27; cc++)
-	{
-		if (trs2digit(cp) != 12 || trs2digit(cp) != 11)
+		if (STEP == counter_step)
 		{
-			electrified_typewriter(cp, 0);
+				//break; // STEP break
 		}
-		inc_trs(&cp);
-	}
 
-	cp = set_trit_setun(cp, 1, 1);
-	cp = set_trit_setun(cp, 2, 1);
-	cp = set_trit_setun(cp, 3, 0);
-	electrified_typewriter(cp, 1);
+		//viv- old code
+		//if (BREAKPOINT == trs2digit(C_cur) && (BREAKPOINT != INT32_MAX))
+		//{
+		//	//break; // BREAKPOINT break
+		//}	
+		
+		view_short_regs(&setun);
 
-	cp = set_trit_setun(cp, 1, -1);
-	cp = set_trit_setun(cp, 2, -1);
-	cp = set_trit_setun(cp, 3, -1);
-	for (cc = 0; cc < 27; cc++)
-	{
-		if (trs2digit(cp) != 12 || trs2digit(cp) != 11)
+		/* Новое состояние */
+		emu_stat = WAIT_EMU_ST;
+	}
+	
+	if( emu_stat == PAUSE_EMU_ST ) {		
+		if (run_steps > 0)
 		{
-			electrified_typewriter(cp, 1);
+			view_run_stat(run_steps, run_time);
+			view_idle_stat(&setun);
+			view_pace_stat(&setun);
+			run_steps = 0;
+			run_time = 0;
 		}
-		inc_trs(&cp);
+		emu_stat = WAIT_EMU_ST;
 	}
+	
+	/* Состояние готов к работе */
+	if( emu_stat == LOOP_WORK_EMU_ST ) {
+		uint64_t done = 0;
+		double t = time_monotonic();
 
-	cp = set_trit_setun(cp, 1, 1);
-	cp = set_trit_setun(cp, 2, 1);
-	cp = set_trit_setun(cp, 3, -1);
-	electrified_typewriter(cp, 1);
-
-	cp = set_trit_setun(cp, 1, -1);
-	cp = set_trit_setun(cp, 2, -1);
-	cp = set_trit_setun(cp, 3, -1);
-	for (cc = 0; cc < 27; cc++)
-	{
-		if (trs2digit(cp) != 12 || trs2digit(cp) != 11)
+		/* Пакет команд без возврата в цикл пульта управления */
+		if (PACE_OPS > 0)
 		{
-			electrified_typewriter(cp, 1);
+			ret_exec = run_paced(&setun, run_batch, &done);
+		}
+		else
+		{
+			ret_exec = run_for(&setun, run_batch, &done);
 		}
-		inc_trs(&cp);
-	}
-
-	printf("\r\n --- smtr() --- \r\n");
-	R = smtr("-+0+-");
-	view_short_reg(&R, "R");
-
-	R = smtr("---------");
-	view_short_reg(&R, "R");
-
-	R = smtr("+++++++++");
-	view_short_reg(&R, "R");
-
-	// -----------------------------------------------
-	trs_t exK;
-	trs_t oper;
-	trs_t m0;
-	trs_t m1;
-	trs_t addr;
-	trs_t ad1;
-	trs_t ad2;
-	uint8_t ret_exec;
-
-	// t19 test Oper=k6..8[+00]: (A*)=>(S)
-	printf("\r\nt19: test Oper=k6..8[+00]: (A*)=>(S)\r\n");
-
-	reset_setun_1958();
-
-	F = smtr("000++");
-
-	addr = smtr("000++");
-	view_short_reg(&addr, "addr=");
-	m0 = smtr("0++++++++");
-	st_fram(addr, m0);
-
-	addr = smtr("-000-");
-	view_short_reg(&addr, "addr=");
-	m0 = smtr("0++++++++0-------");
-	st_fram(addr, m0);
-
-	addr = smtr("000-0");
-	view_short_reg(&addr, "addr=");
-	m0 = smtr("0--------");
-	st_fram(addr, m0);
-
-	addr = smtr("00000");
-	view_short_reg(&addr, "addr=");
-	m0 = smtr("+0-0+0-00");
-	st_fram(addr, m0);
-
-	addr = smtr("0000+");
-	m1 = smtr("-000-0+000");
-	st_fram(addr, m1);
-
-	/* Begin address fram */
-	C = smtr("0000+");
-
-	printf("\r\nreg C = 00001\r\n");
 
-	/**
-	 * work VM Setun-1958
-	 */
-	K = ld_fram(C);
-	exK = control_trs(K);
-	view_short_reg(&K, "K=");
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	printf("ret_exec = %i\r\n", ret_exec);
-	printf("\r\n");
+		t = time_monotonic() - t;
+		run_time += t;
+		run_steps += done;
+		counter_step += done;
 
-	addr = smtr("0000+");
-	m1 = smtr("-000-+000");
-	st_fram(addr, m1);
+		/* Следующий пакет выполняется примерно за RUN_BATCH_MS */
+		if ((ret_exec == OK) && (t > 0) && (PACE_OPS == 0))
+		{
+			double n = done / t * RUN_BATCH_MS / 1000;
+			run_batch = (n < RUN_BATCH_MIN) ? RUN_BATCH_MIN : (n > RUN_BATCH_MAX) ? RUN_BATCH_MAX : (uint64_t)n;
+		}
 
-	/* Begin address fram */
-	C = smtr("0000+");
+		if ((ret_exec == STOP))
+		{
+			printf("\r\n<STOP>\r\n");
+			emu_stat = STOP_EMU_ST;
+		}
+		else if (ret_exec == STOP_OVER)
+		{
+			printf("\r\n<STOP_OVER>\r\n");			
+			emu_stat = STOP_EMU_ST;
+		}
+		else if (ret_exec == STOP_ERROR)
+		{
+			printf("\r\nERR#:%i<STOP_ERROR>\r\n", ret_exec);			
+			emu_stat = ERROR_EMU_ST;
+		}
+		else if (ret_exec == STOP_ERROR_MB_NUMBER)
+		{
+			printf("\r\nERR#:%i<STOP_ERROR_MB_NUMBER>\r\n", ret_exec);
+			cli_ascii();
+			emu_stat = ERROR_MB_NUMBER_EMU_ST;
+		}
+		else if (ret_exec == STOP_BREAKPOINT)
+		{
+			printf("\r\n<STOP_BREAKPOINT>\r\n");
+			emu_stat = STOP_EMU_ST;
+		}
+		else if (ret_exec == STOP_IDLE)
+		{
+			printf("\r\n<STOP_IDLE>\r\n");
+			emu_stat = STOP_EMU_ST;
+		}
 
-	printf("\r\nreg C = 00001\r\n");
+		if (emu_stat != LOOP_WORK_EMU_ST)
+		{
+			view_run_stat(run_steps, run_time);
+			view_idle_stat(&setun);
+			view_pace_stat(&setun);
+			run_steps = 0;
+			run_time = 0;
+		}
+	}	
+	
+	/* Состояние  */
+	if( emu_stat == STOP_EMU_ST ) {
+		emu_stat = CLI_WELCOM_EMU_ST;
+	} /* if(...) */		
+		
+	/* Состояние  */
+	if( emu_stat == ERROR_EMU_ST ) {
+		emu_stat = CLI_WELCOM_EMU_ST;
+	} /* if(...) */		
+	
+	/* Состояние  */
+	if( emu_stat == ERROR_MB_NUMBER_EMU_ST ) {
+		emu_stat = CLI_WELCOM_EMU_ST;
+	} /* if(...) */
 
-	/**
-	 * work VM Setun-1958
-	 */
-	K = ld_fram(C);
-	exK = control_trs(K);
-	view_short_reg(&K, "K=");
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	printf("ret_exec = %i\r\n", ret_exec);
-	printf("\r\n");
+	/* Состояние  */
+	if( emu_stat == CLI_WELCOM_EMU_ST ) {
+		/* Prints REGS */
+		view_short_regs(&setun);
+		printf("\r\n");		
+		//
+		cli_ascii();
+		emu_stat = WAIT_EMU_ST;
+	} /* if(...) */
+	
 
-	view_short_regs();
+	/* Состояние  */
+	if( emu_stat == WAIT_EMU_ST ) {
+		
+	} /* if(...) */
+		
+} /*  */
 
-	/* Begin address fram */
-	C = smtr("000+0");
-	printf("\r\nreg C = 00010\r\n");
 
-	addr = smtr("000+0");
-	m1 = smtr("00000+0--");
-	st_fram(addr, m1);
+/** ------------------------------------------------------------------------
+*  Командный интепретатор виртуального пульта управления МЦВМ "Сетунь" 1958
+*/
 
-	/**
-	 * work VM Setun-1958
-	 */
-	K = ld_fram(C);
-	exK = control_trs(K);
-	view_short_reg(&K, "K=");
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	printf("ret_exec = %i\r\n", ret_exec);
-	printf("\r\n");
+/** --------------------------------------------------------
+ *  CLI командный интерпретатор
+ */
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof(array[0]))
+//
+#define BUF_SIZE 81        /* размер буфера */
+static char buf[BUF_SIZE]; /* буфер для приема сообщений */
 
-	ad1 = smtr("000-0");
-	ad2 = smtr("00+-0");
-	view_fram(ad1, ad2);
+/* Разбор параметров команды с параметрами */
+char par1[80];
+char par2[80];
+char par3[80];
+char par4[80];
 
-	view_short_regs();
+/* Cтруктура, описывающая ascii-сообщение */
+typedef struct _ascii_message
+{
+    char *name_cmd;                        /* имя команды */
+    char (*parser)(char *buf, void *data); /* функция команды */
+    void *data;                            /* дополнительный параметры команды */
+} ascii_message_t;
 
-	/* Begin address fram */
-	C = smtr("000++");
-	printf("\r\nreg C = 00011\r\n");
+/* Cтруктура описывающая информацию в сообщении. */
+typedef struct _cmd_data
+{
+    int count; /* счетчик парметров */
+    char *par2;
+    char *par3;
+    char *par4;
+} cmd_data_t;
 
-	addr = smtr("000++");
-	m1 = smtr("00000++00");
-	st_fram(addr, m1);
+cmd_data_t cmd_data;
 
-	/**
-	 * work VM Setun-1958
-	 */
-	K = ld_fram(C);
-	exK = control_trs(K);
-	view_short_reg(&K, "K=");
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	printf("ret_exec = %i\r\n", ret_exec);
-	printf("\r\n");
+//
+void Emu_Begin(setun_machine_t *m);
+int Emu_Step(setun_machine_t *m);
+void Emu_Stop(setun_machine_t *m); 
 
-	ad1 = smtr("000-0");
-	ad2 = smtr("00+-0");
-	view_fram(ad1, ad2);
+static char dump_cmd(char *buf, void *data);
+static char load_cmd(char *buf, void *data);
+static char debug_cmd(char *buf, void *data);
+static char test_cmd(char *buf, void *data);
+static char begin_cmd(char *buf, void *data);
+static char pause_cmd(char *buf, void *data);
+static char run_cmd(char *buf, void *data);
+static char step_cmd(char *buf, void *data);
+static char break_cmd(char *buf, void *data);
+static char native_cmd(char *buf, void *data);
+static char idle_cmd(char *buf, void *data);
+static char pace_cmd(char *buf, void *data);
+static char zone_cmd(char *buf, void *data);
+static char reg_cmd(char *buf, void *data);
+static char view_cmd(char *buf, void *data);
+static char fram_cmd(char *buf, void *data);
+static char drum_cmd(char *buf, void *data);
+static char help_cmd(char *buf, void *data);
+static char quit_cmd(char *buf, void *data);
 
-	view_short_regs();
+int emu_send(emu_cmd_t *c);
+int run_test(int test_numb);
 
-	// t20 test mul_trs()
+/* Поток эмуляции и очередь команд пульта управления */
+static emu_queue_t emu_queue;
+static setun_machine_t emu_snap;	/* снимок машины для просмотра */
+static pthread_t emu_tid;
+static _Atomic uint32_t emu_ack;	/* номер последней выполненной команды */
+static uint32_t emu_seq = 0;		/* номер последней отправленной команды */
+static int emu_wake[2];				/* пульт -> поток: есть команда */
+static int emu_reply[2];			/* поток -> пульт: есть подтверждение */
+static uint8_t emu_close = 0;		/* пульт закрыт */
+static double emu_latency = 0;		/* время подтверждения последней команды, с */
 
-	trs_t res;
-	res.l = 18;
-	res.t1 = 0;
-	res.t0 = 0;
+/*
+ * Массив команд CLI
+ */
+ascii_message_t command[] =
+    {        
+		{.name_cmd = "dump",
+         .parser = dump_cmd,
+         .data = &cmd_data},
+		//
+		{.name_cmd = "load",
+         .parser = load_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "l",
+         .parser = load_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "debug",
+         .parser = debug_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "d",
+         .parser = debug_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "test",
+         .parser = test_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "t",
+         .parser = test_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "begin",
+         .parser = begin_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "b",
+         .parser = begin_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "pause",
+         .parser = pause_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "p",
+         .parser = pause_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "run",
+         .parser = run_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "r",
+         .parser = run_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "step",
+         .parser = step_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "s",
+         .parser = step_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "break",
+         .parser = break_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "br",
+         .parser = break_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "native",
+         .parser = native_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "nt",
+         .parser = native_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "idle",
+         .parser = idle_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "id",
+         .parser = idle_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "pace",
+         .parser = pace_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "pc",
+         .parser = pace_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "zone",
+         .parser = zone_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "zn",
+         .parser = zone_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "reg",
+         .parser = reg_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "rg",
+         .parser = reg_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "view",
+         .parser = view_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "v",
+         .parser = view_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "fram",
+         .parser = fram_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "fr",
+         .parser = fram_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "drum",
+         .parser = drum_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "dr",
+         .parser = drum_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "help",
+         .parser = help_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "h",
+         .parser = help_cmd,
+         .data = &cmd_data},
+        //
+        {.name_cmd = "quit",
+         .parser = quit_cmd,
+         .data = &cmd_data},
+        {.name_cmd = "q",
+         .parser = quit_cmd,
+         .data = &cmd_data}};
 
-	S = smtr("0000000-0000000+++");
-	R = smtr("000000000-00+000-");
-	res = mul_trs(S, R);
+/* Func nmea_next_field */
+char *ascii_next_field(char *buf)
+{
+    /* Eсли следующее поле не найдено, то она возвращает NULL */
+    while (*buf++ != ',')
+    {
+        if (*buf == '\0')
+        {
+            return NULL;
+        }
+    }
+    return buf;
+}
 
-	view_short_reg(&S, " S");
-	view_short_reg(&R, " R");
-	view_short_reg(&res, "res = S*R");
+/* Func 'cli_ascii' */
+void cli_ascii(void)
+{
+    puts("");
+    printf("setun1958emu:\r\n");
+}
 
-	// t21 test Oper=k6..8[+00]: (A*)=>(S)
-	printf("\r\nt19: test Oper=k6..8[+00]: (A*)=>(S)\r\n");
+/* Func 'exit_cmd' */
+char exit_cmd(char *buf, void *data)
+{
+    cmd_data_t *msg = (cmd_data_t *)data;
 
-	reset_setun_1958();
+    printf("dbg: exit_cmd() \r\n");
 
-	F = smtr("000++");
+    exit(0);
 
-	addr = smtr("000++");
-	view_short_reg(&addr, "addr=");
-	m0 = smtr("0++++++++");
-	st_fram(addr, m0);
+    return 0;
+}
 
-	addr = smtr("000--");
-	view_short_reg(&addr, "addr=");
-	m0 = smtr("0++++++++");
-	st_fram(addr, m0);
+/* Вывод списка команд виртуальной панели управления */
+void help_print(void)
+{
+    printf("Commands control for setun1958emu:\r\n");
+	printf(" [dump]       [arglist]\r\n");
+	printf(" [load]  [l]  [arglist]\r\n");
+    printf(" [debug] [d]  [arglist]\r\n");
+	printf(" [test]  [t]  [arglist]\r\n");
+    printf(" [view]  [v]\r\n");
+    printf(" [begin] [b]\r\n");
+    printf(" [pause] [p]\r\n");
+    printf(" [run]   [r]\r\n");
+    printf(" [step]  [s]  [arglist] \r\n");
+    printf(" [break] [br] [arglist]\r\n");
+    printf(" [native][nt] [arglist]\r\n");
+    printf(" [idle]  [id] [arglist]\r\n");
+    printf(" [pace]  [pc] [arglist]\r\n");
+    printf(" [zone]  [zn] [arglist]\r\n");
+    printf(" [reg]   [rg] [arglist]\r\n");
+    printf(" [fram]  [fr] [arglist]\r\n");
+    printf(" [drum]  [dr] [arglist]\r\n");
+    printf(" [help]  [h]\r\n");
+    printf(" [quit]  [q]\r\n");
+}
 
-	addr = smtr("000-0");
-	view_short_reg(&addr, "addr=");
-	m0 = smtr("0--------");
-	st_fram(addr, m0);
+/** -------------------------------
+ *   Реализация команд
+ */
+ 
+/* Func 'dump_cmd' */
+char dump_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	addr = smtr("00000");
-	view_short_reg(&addr, "addr=");
-	m0 = smtr("+0-0+0-00");
-	st_fram(addr, m0);
+    if (pars->count > 1)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	addr = smtr("0000+");
-	m1 = smtr("00000++00");
-	st_fram(addr, m1);
+	/* Файл зоны FRAM загружается в потоке эмуляции */
+	emu_cmd_t c = {.code = EMU_CMD_DUMP};
+	strncpy(c.par, pars->par2, EMU_CMD_PAR - 1);
+	emu_send(&c);
+    
+	return 0; /* OK' */
+}
 
-	S = smtr("000000000-00+000-+");
 
-	/* Begin address fram */
-	C = smtr("0000+");
+/* Func 'load_cmd' */
+char load_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	printf("\r\nreg C = 00001\r\n");
+    if (pars->count > 2)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	/**
-	 * work VM Setun-1958
-	 */
-	K = ld_fram(C);
-	exK = control_trs(K);
-	view_short_reg(&K, "K=");
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	printf("ret_exec = %i\r\n", ret_exec);
-	printf("\r\n");
+	/* Проверить путь к каталогам,  файл списка lst */
+	if (ConvertSWtoPaper(pars->par2, pars->par3) != 0)
+	{
+		printf("no path file\r\n");
+	}
+    
+	return 0; /* OK' */
+}
 
-	// views
-	ad1 = smtr("000-0");
-	ad2 = smtr("00+-0");
-	view_fram(ad1, ad2);
+/* Func 'debug_cmd' */
+char debug_cmd(char *buf, void *data)
+{
+    printf("TODO: debug_cmd() \r\n");
 
-	view_short_regs();
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	printf("\r\nt22: test Oper=k6..8[-+-]: Норм.(S)=>(A*); (N)=>(S)\r\n");
+    if (pars->count > 1)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	reset_setun_1958();
+    return 0; /* OK' */
+}
 
-	F = smtr("000++");
+/* Func 'test_cmd' */
+char test_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	addr = smtr("000++");
-	view_short_reg(&addr, "addr=");
-	m0 = smtr("0++++++++");
-	st_fram(addr, m0);
+    if ( (pars->count < 1) || (pars->count > 1) )
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	addr = smtr("000--");
-	view_short_reg(&addr, "addr=");
-	m0 = smtr("0++++++++");
-	st_fram(addr, m0);
+	/* Тест работает с машиной в потоке эмуляции */
+	emu_cmd_t c = {.code = EMU_CMD_TEST};
+	sscanf(pars->par2,"%i", &c.val);
+	emu_send(&c);
 
-	addr = smtr("000-0");
-	view_short_reg(&addr, "addr=");
-	m0 = smtr("0--------");
-	st_fram(addr, m0);
+    return 0; /* OK' */
+}
 
-	addr = smtr("00000");
-	view_short_reg(&addr, "addr=");
-	m0 = smtr("+0-0+0-00");
-	st_fram(addr, m0);
+/* Выполнить тест номер test_numb */
+int run_test(int test_numb)
+{
+	switch(test_numb) {
+		case 1:
+			Test1_Ariphmetic_Ternary();
+			break;
+		case 2:
+			Test2_Opers_TRITS_32();		
+			break;
+		case 3:
+			Test3_Setun_Opers();
+			break;
+		case 4:
+			Test4_Setun_Opers();
+			break;
+		case 5:
+			Test5_Setun_Load();
+			break;
+		case 6:
+			Test6_Setun_Load();
+			break;
+		case 7:
+			Test7_Setun_Load();
+			break;
+		case 8:
+			Test8_Setun_Electrified_Typewriter();
+			break;
+		case 9:
+			Test9_Perforatin_Paper_Line();
+			break;
+		case 10:
+			Test10_LoadSWSetun();			
+			break;			
+		case 11:
+			Test11_Setun_Bench_Step();
+			break;
+		case 12:
+			Test12_Setun_Native();
+			break;
+		case 13:
+			Test13_Setun_Oper_Cost();
+			break;
+		case 14:
+			Test14_Setun_Addr5_Tables();
+			break;
+		case 15:
+			Test15_Setun_Idle_Loop();
+			break;
+		case 16:
+			Test16_Setun_Cmd_Queue();
+			break;
+		case 17:
+			Test17_Setun_Pace();
+			break;
+		case 18:
+			Test18_Setun_Parallel_Jobs();
+			break;
+		case 19:
+			Test19_Setun_Job_Scheduler();
+			break;
+		case 20:
+			Test20_Setun_Sweep();
+			break;
+		case 21:
+			Test21_Setun_Fork_Server();
+			break;
+		case 22:
+			Test22_Setun_Daemon();
+			break;
+		case 23:
+			Test23_Setun_Tape_Bin();
+			break;
+		case 24:
+			Test24_Setun_Tape_Rows();
+			break;
+		case 25:
+			Test25_Setun_Tape_Simd();
+			break;
+		case 26:
+			Test26_Setun_Typewriter();
+			break;
+		case 27:
+			Test27_Setun_Punch();
+			break;
+		case 28:
+			Test28_Setun_Tape_Stream();
+			break;
+		case 29:
+			Test29_Setun_Io_Thread();
+			break;
+		case 30:
+			Test30_Setun_Tape_Zones();
+			break;
+		case 31:
+			Test31_Setun_Tape_Cache();
+			break;
+		case 32:
+			Test32_Setun_Devices();
+			break;
+		default:
+	        /* Error */
+    	    printf("no test#%i\r\n",test_numb);
+        	return 2; /* ERR#2 */
+		break;
+	}
 
-	addr = smtr("0000+");
-	m1 = smtr("00000-+-0");
-	st_fram(addr, m1);
+    return 0; /* OK' */
+}
 
-	S = smtr("000000000-00+000-+");
-	view_short_reg(&S, "S=");
+/* Func 'begin_cmd' */
+char begin_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	/* Begin address fram */
-	C = smtr("0000+");
+    if (pars->count > 0)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
+	
+	emu_cmd_t c = {.code = EMU_CMD_BEGIN};
+	emu_send(&c);
 
-	printf("\r\nreg C = 00001\r\n");
+    return 0; /* OK' */
+}
 
-	/**
-	 * work VM Setun-1958
-	 */
-	K = ld_fram(C);
-	exK = control_trs(K);
-	view_short_reg(&K, "K=");
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	printf("ret_exec = %i\r\n", ret_exec);
-	printf("\r\n");
+/* Func 'pause_cmd' */
+char pause_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
+    
+    if (pars->count > 0)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	// views
-	ad1 = smtr("000-0");
-	ad2 = smtr("00+-0");
-	// view_fram(ad1, ad2);
+	/* Новое состояние пауза */
+	emu_cmd_t c = {.code = EMU_CMD_PAUSE};
+	emu_send(&c);
+	printf("[ Pause latency: %.0f us ]\r\n", emu_latency * 1e6);
 
-	view_short_regs();
+    return 0; /* OK' */
+}
 
-	// t22 test DRUM
-	printf("t22 test zone for drum()\r\n");
-	uint32_t nz;
+/* Func 'run_cmd' */
+char run_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	printf(" ad1 ='000+'");
-	ad1 = smtr("000+");
-	nz = zone_drum_to_index(ad1);
-	printf(" nz = %i\r\n", nz);
+    if (pars->count > 0)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	printf(" ad1 ='00+-2'");
-	ad1 = smtr("00+-");
-	nz = zone_drum_to_index(ad1);
-	printf(" nz = %i\r\n", nz);
+	/* Новое состояние выполнять операцииы */
+	emu_cmd_t c = {.code = EMU_CMD_RUN};
+	emu_send(&c);
 
-	printf(" ad1 ='00+0'");
-	ad1 = smtr("00+0");
-	nz = zone_drum_to_index(ad1);
-	printf(" nz = %i\r\n", nz);
+    return 0; /* OK' */
+}
 
-	printf("t23 test zone for view_drum()\r\n");
+/* Func 'step_cmd' */
+char step_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	printf(" z ='0+--'");
-	ad1 = smtr("0+--");
-	view_drum_zone(ad1);
+    if (pars->count > 1)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	printf(" z ='++++'");
-	ad1 = smtr("++++");
-	view_drum_zone(ad1);
+	emu_cmd_t c = {.code = EMU_CMD_STEP};
+	emu_send(&c);
 
-	printf("\r\nt24 test DRUN fill index and view \r\n");
+    return 0; /* OK' */
+}
 
-	inr.l = 9;
-	inr = smtr("000000000");
+/* Func 'break_cmd' */
+char break_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	trs_t zi;
-	zi.l = 4;
-	zi = smtr("000+"); //-17
+    if ((pars->count < 1) || (pars->count > 1))
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	for (uint8_t zz = 0; zz < NUMBER_ZONE_DRUM; zz++)
+	/* Адрес C(1:5) точки останова или 'off' */
+	emu_cmd_t c = {.code = EMU_CMD_BREAK};
+	if (strcmp(pars->par2, "off") == 0)
 	{
-		for (uint8_t mm = 0; mm < SIZE_ZONE_TRIT_FRAM; mm++)
-		{
-			st_drum(zi, mm, inr);
-			inc_trs(&inr);
-		}
-		inc_trs(&zi);
+		c.val = INT32_MAX;
+		printf("breakpoint off\r\n");
 	}
+	else
+	{
+		c.val = trs2digit(smtr(pars->par2));
+		printf("breakpoint C = %s (%i)\r\n", pars->par2, c.val);
+	}
+	emu_send(&c);
 
-	printf("\r\nt25 test oper='-0-' (Мд*)=>(Фа*) \r\n");
-
-	addr = smtr("0000+");
-	m1 = smtr("00+---0-0"); //-0-
-	st_fram(addr, m1);
+    return 0; /* OK' */
+}
 
-	S = smtr("000000000-00+000-+");
-	view_short_reg(&S, "S=");
+/* Func 'native_cmd' */
+char native_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	/* Begin address fram */
-	C = smtr("0000+");
+    if ((pars->count < 1) || (pars->count > 1))
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	printf("\r\nreg C = 00001\r\n");
+	/* Режим целочисленных регистров S, R, F: 'on' или 'off' */
+	emu_cmd_t c = {.code = EMU_CMD_NATIVE};
+	if (strcmp(pars->par2, "on") == 0)
+	{
+		c.val = 1;
+	}
+	else if (strcmp(pars->par2, "off") == 0)
+	{
+		c.val = 0;
+	}
+	else
+	{
+		printf("dbg: ERR#2\r\n");
+		return 2; /* ERR#2 */
+	}
+	emu_send(&c);
+	printf("native registers %s\r\n", c.val ? "on" : "off");
 
-	/**
-	 * work VM Setun-1958
-	 */
-	K = ld_fram(C);
-	exK = control_trs(K);
-	view_short_reg(&K, "K=");
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	printf("ret_exec = %i\r\n", ret_exec);
+    return 0; /* OK' */
+}
 
-	C = smtr("0000+");
-	addr = smtr("0000+");
-	m1 = smtr("000+--0+0"); //-0+
-	st_fram(addr, m1);
+/* Func 'idle_cmd' */
+char idle_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	K = ld_fram(C);
-	exK = control_trs(K);
-	view_short_reg(&K, "K=");
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	printf("ret_exec = %i\r\n", ret_exec);
+    if ((pars->count < 1) || (pars->count > 1))
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	printf("DRUM zone='0+--'");
-	ad1 = smtr("0+--");
-	view_drum_zone(ad1);
-	printf("\r\n");
-	//
-	printf("DRUM zone='0+--'");
-	ad1 = smtr("0+--");
-	view_drum_zone(ad1);
-	printf("\r\n");
+	/* Холостой цикл: 'off', 'stop' или 'skip' */
+	emu_cmd_t c = {.code = EMU_CMD_IDLE};
+	if (strcmp(pars->par2, "off") == 0)
+	{
+		c.val = IDLE_OFF;
+	}
+	else if (strcmp(pars->par2, "stop") == 0)
+	{
+		c.val = IDLE_STOP;
+	}
+	else if (strcmp(pars->par2, "skip") == 0)
+	{
+		c.val = IDLE_SKIP;
+	}
+	else
+	{
+		printf("dbg: ERR#2\r\n");
+		return 2; /* ERR#2 */
+	}
+	emu_send(&c);
+	printf("idle loop %s\r\n", pars->par2);
 
-	printf("\r\n --- END TEST #8 --- \r\n");
+    return 0; /* OK' */
 }
 
-// Вывод "бумажной ленты.
-void Test9_Perforatin_Paper_Line(void)
+/* Func 'pace_cmd' */
+char pace_cmd(char *buf, void *data)
 {
-	int8_t trit;
-	trs_t aa;
-	trs_t ad1;
-	trs_t ad2;
-	trs_t addr;
-	trs_t oper;
-	trs_t exK;
-	trs_t m0;
-	trs_t m1;
-	int8_t ret_exec;
-
-	printf("\r\n --- TEST #9 Perforatin paper line --- \r\n");
-
-	// t11.1 test Oper=k6..8[+00]: (A*)=>(S)
-	printf("\r\nt11.1:  Oper=k6..8[+00]: (A*)=>(S)\r\n");
-	//
-	reset_setun_1958();
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	/* Инициализация таблиц символов ввода и вывода "Сетунь-1958" */
-	init_tab4();
+    if ((pars->count < 1) || (pars->count > 1))
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	/* ---------------------------------------
-	 *  Открыть файлы для виртуальных устройств
-	 */
-	ptr1 = fopen("ptr1/paper.txt", "r");
-	if (ptr1 == NULL)
+	/* Коротких операций в секунду, 'setun' - 4800 или 'off' */
+	emu_cmd_t c = {.code = EMU_CMD_PACE};
+	if (strcmp(pars->par2, "off") == 0)
 	{
-		printf("Error fopen 'ptr1/paper.txt'\r\n");
-		return;
+		c.val = 0;
 	}
-
-	ptr2 = fopen("ptr2/paper.txt", "r");
-	if (ptr2 == NULL)
+	else if (strcmp(pars->par2, "setun") == 0)
 	{
-		printf("Error fopen 'ptr1/paper.txt'\r\n");
-		return;
+		c.val = PACE_SETUN_OPS;
 	}
-
-	ptp1 = fopen("ptp1/paper.txt", "w");
-	if (ptp1 == NULL)
+	else if (sscanf(pars->par2, "%i", &c.val) != 1 || c.val < 0)
 	{
-		printf("Error fopen 'ptp1/paper.txt'\r\n");
-		return;
+		printf("dbg: ERR#2\r\n");
+		return 2; /* ERR#2 */
+	}
+	emu_send(&c);
+	if (c.val > 0)
+	{
+		printf("pace %i ops/s\r\n", c.val);
+	}
+	else
+	{
+		printf("pace off\r\n");
 	}
 
-	tty1 = fopen("tty1/printout.txt", "w");
-	if (tty1 == NULL)
+    return 0; /* OK' */
+}
+
+/* Func 'zone_cmd' */
+char zone_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
+
+    if (pars->count > 1)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
+
+	/* Без параметра - указатель зон, N - поставить ФТ1 на зону N */
+	emu_cmd_t c = {.code = EMU_CMD_ZONE, .val = -1};
+	if ((pars->count == 1) && ((sscanf(pars->par2, "%i", &c.val) != 1) || (c.val < 0)))
 	{
-		printf("Error fopen 'tty1/printout.txt'\r\n");
-		return;
+		printf("dbg: ERR#2\r\n");
+		return 2; /* ERR#2 */
 	}
+	emu_send(&c);
 
-	/* ----------------------------------
-	 *  Выполнить первый код "Сетунь-1958"
-	 */
-	printf("\r\n[ Start Setun-1958 ]\r\n");
+    return 0; /* OK' */
+}
 
-	/**
-	 * Выполение программы в ферритовой памяти "Сетунь-1958"
-	 */
-	Begin_Read_Commands_from_FT1(ptr1);
+/* Func 'reg_cmd' */
+char reg_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	//
-	addr = smtr("0000+");
-	m0 = smtr("00+00-000");
-	st_fram(addr, m0);
-	view_elem_fram(addr);
-	//
+    if ((pars->count < 1) || (pars->count > 2))
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	/* Begin address fram */
-	C = smtr("0000+");
-	printf("\r\nreg C = 00001\r\n");
+	/* Регистр записывается в потоке эмуляции между командами машины */
+	emu_cmd_t c = {.code = EMU_CMD_REG};
+	c.rg = toupper(pars->par2[0]);
+	c.trs = smtr(pars->par3);
+	emu_send(&c);
 
-	// work VM Setun-1958
-	K = ld_fram(C);
+    return 0; /* OK' */
+}
 
-	exK = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
-	ret_exec = execute_trs(exK, oper);
-	//
-	if (ret_exec == 0)
-		printf("[status: OK']\r\n");
-	if (ret_exec != 0)
-		printf("[status: ERR#%d]\r\n", ret_exec);
-	printf("\r\n");
-	//
-	view_short_regs();
+/* Func 'view_cmd' */
+char view_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	trs_t fa;
-	fa = smtr("0---0");
+    printf("[ View registers Setun-1958 ]\r\n");
+
+    if (pars->count > 0)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	dump_fram_zone(smtr("0"));
+	/* Prints REGS */
+	emu_cmd_t c = {.code = EMU_CMD_SNAP};
+	emu_send(&c);
+	view_short_regs(&emu_snap);
+	printf("\r\n");
 
-	printf("\r\n --- END TEST #9 --- \r\n");
+    return 0; /* OK' */
 }
 
-void Test10_LoadSWSetun(void)
+/* Func 'fram_cmd' */
+char fram_cmd(char *buf, void *data)
 {
-	printf("\r\n --- Load software anf DUMP FRAM  for VM SETUN-1958 --- \r\n\r\n");
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	FILE *file_lst;
+    if (pars->count > 1)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-	/* Переменная, в которую поочередно будут помещаться считываемые строки */
-	char str[80] = {0};
+	emu_cmd_t c = {.code = EMU_CMD_SNAP};
+	emu_send(&c);
+	dump_fram_zone(&emu_snap, smtr(pars->par2));
+    
+	return 0;
+}
 
-	/* Указатель, в который будет помещен адрес массива, в который считана */
-	/* строка, или NULL если достигнут коней файла или произошла ошибка */
-	char *estr;
+/* Func 'drum_cmd' */
+char drum_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-	file_lst = fopen("software/tests/01-test-fram.lst", "r");
-	if (file_lst == NULL)
-	{
-		printf("ERR fopen software/tests/01-test-fram.lst\r\n");
-		return;
-	}
-	else
-	{
-		printf("fopen: software/tests/01-test-fram.lst\r\n");
+    if (pars->count > 1)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
+	
+	emu_cmd_t c = {.code = EMU_CMD_SNAP};
+	emu_send(&c);
+	view_drum_zone(&emu_snap, smtr(pars->par2));
 
-		/* Чтение (построчно) данных из файла в бесконечном цикле */
-		while (1)
-		{
-			/* Чтение одной строки  из файла */
-			estr = fgets(str, sizeof(str), file_lst);
+    return 0; /* OK' */
+}
 
-			/* Проверка на конец файла или ошибку чтения */
-			if (estr == NULL)
-			{
-				/* Проверяем, что именно произошло: кончился файл */
-				/* или это ошибка чтения */
-				if (feof(file_lst) != 0)
-				{
-					/* Если файл закончился, выводим сообщение о завершении */
-					/* чтения и выходим из бесконечного цикла */
-					printf("\r\nЧтение файла закончено\r\n");
-					break;
-				}
-				else
-				{
-					/* Если при чтении произошла ошибка, выводим сообщение */
-					/* об ошибке и выходим из бесконечного цикла */
-					printf("\r\nОшибка чтения из файла\r\n");
-					break;
-				}
-			}
+/* Func 'help_cmd' */
+char help_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-			/* ---------------------------------
-			 * Загрузить из файла тест-программу
-			 * ---------------------------------
-			 */
-			printf("\r\n Load software/tests/%s\r\n", str);
+    if (pars->count > 0)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-			FILE *file;
-			char path_str[160] = {0};
-			uint8_t cmd[20];
-			trs_t inr;
-			trs_t dst;
+    help_print();
 
-			inr = smtr("0---0"); /* cчетчик адреса коротких слов */
-			trs_t sum;
-			trs_t tmp;
+    return 0; /* OK' */
+}
 
-			tmp.l = 18;
-			tmp.t1 = 0;
-			tmp.t0 = 0;
+/* Func 'quit_cmd' */
+char quit_cmd(char *buf, void *data)
+{
+    cmd_data_t *pars = (cmd_data_t *)data;
 
-			int64_t dsun = 0;
-			sum.l = 18;
-			sum.t1 = 0;
-			sum.t0 = 0;
-			//
-			dst.l = 9;
-			MR.l = 18;
-			int i = 0;
+    if (pars->count > 0)
+    {
+        /* Error */
+        printf("dbg: ERR#1\r\n");
+        return 1; /* ERR#1 */
+    }
 
-			strcat(path_str, "software/tests/");
-			if (str[strlen(str) - 1] == 0x0A)
-			{
-				str[strlen(str) - 1] = 0;
-			}
-			str[strlen(str)] = 0;
-			strcat(path_str, str);
+	/* Дождаться завершения потока эмуляции */
+	emu_cmd_t c = {.code = EMU_CMD_QUIT};
+	emu_send(&c);
+	pthread_join(emu_tid, NULL);
 
-			file = fopen(path_str, "r");
-			if (file == NULL)
-			{
-				printf("ERR fopen %s\r\n", path_str);
-				return;
-			}
+	Emu_Stop(&setun);
 
-			while (fscanf(file, "%s", cmd) != EOF)
-			{
-				cmd_str_2_trs(cmd, &dst);
-				sum = add_trs(sum, dst);
-				i += 1;
+    exit(0);
 
-				dsun += trs2digit(dst);
+    return 0;
+}
 
-				LOGGING_print("%s -> [", cmd);
-				trs2str(dst);
-				LOGGING_print("]");
-				if (LOGGING > 0)
-				{
-					view_short_reg(&inr, " addr");
-				}
-				else
-				{
-					printf("\r\n");
-				}
+/** -------------------
+ *   Func 'ascii parser'
+ */
+int ascii_parser(char *buf)
+{
+    int i;
+
+    memset(par1, 0, sizeof(par1));
+    memset(par2, 0, sizeof(par2));
+    memset(par3, 0, sizeof(par3));
+    memset(par4, 0, sizeof(par4));
+    //
+    sscanf(buf, "%s %s %s %s", par1, par2, par3, par4);
+    // viv- old  printf("par1=%s par2=%s par3=%s par3=%s\r\n",par1,par2,par3,par4);
+    //
+    for (i = 0; i < ARRAY_SIZE(command); i++)
+    {
+        if ((strncmp(par1, command[i].name_cmd, strlen(command[i].name_cmd)) == 0) &&
+            (strlen(par1) == strlen(command[i].name_cmd)))
+        {
+            if (command[i].parser)
+            {
+                int cnt = 0;
+                cmd_data.par2 = par2;
+                if (strlen(par2) > 0)
+                    cnt++;
+                cmd_data.par3 = par3;
+                if (strlen(par3) > 0)
+                    cnt++;
+                cmd_data.par4 = par4;
+                if (strlen(par4) > 0)
+                    cnt++;
+                cmd_data.count = cnt;
 
-				st_fram(inr, dst);
-				inr = next_address(inr);
-			}
-			fclose(file);
+                command[i].data = (cmd_data_t *)&cmd_data;
+                return command[i].parser(par1, command[i].data);
+            }
+        }
+    }
+    return -1;
+}
 
-			printf("\r\n i=%i\r\n", i);
+/* Process ascii string + <LF><CR> */
+void Process_ascii_string(char c)
+{
+    static char *p_beg = NULL;
+    static char *p_cur = NULL;
+    static char *p_end = NULL;
 
-			/* Печать контрольных сумм */
-			printf("\r\n");
-			view_checksum_setun(sum);
-		}
-	}
-	fclose(file_lst);
+    static char status = 0;
+    /*
+     * Сканер строк ascii
+     */
+    switch (status)
+    {
+    case 0: /* Иницализация сканера */
+    {
+        memset(buf, 0, ARRAY_SIZE(buf));
+        p_beg = &buf[0];
+        p_cur = p_beg;
+        p_end = p_beg + ARRAY_SIZE(buf) - 1;
+        status = 1;
+    }
+    case 1: /* Ввод символов и прверка 'LF' или 'CR' */
+    {
+        if (c == '\r' || c == '\n')
+        {            
+            static char res = 0;
 
-	// dump_fram_zone(smtr("0"));
-	// dump_fram_zone(smtr("+"));
-	// dump_fram_zone(smtr("-"));
+            res = ascii_parser(buf);
+            if (res >= 0)
+            {
+            }
+            else
+            {
+                printf("no command\r\n");
+            }
+            cli_ascii();
 
-	printf("\r\n END TEST#10 Load software\r\n");
+            /* Новый статус сканера */
+            status = 0;
+        }
+        else
+        {
+            if (p_cur < p_end)
+            {
+                *p_cur++ = c; /* Сохранить байт в буфере */
+            }
+            else
+            {
+                *p_cur = c;
+            }
+        }
+    }
+    break;
+    default:        /* Что-то не так !*/
+        status = 0; /* Сброс сканера фысшш */
+        break;
+    } /* end switch() */
 }
 
-/*----------------- END TESTS ---------------*/
-
-const char *get_file_ext(const char *filename)
-{
-	const char *dot = strrchr(filename, '.');
-	if (!dot || dot == filename)
-		return "";
-	return dot + 1;
-}
 
+/** ------------------------------------------------------------
+ *  Поток эмуляции
+ *  ------------------------------------------------------------
+ *  Машина работает в своём потоке. Пульт управления передаёт
+ *  команды через очередь emu_queue без блокировок и ждёт
+ *  подтверждения. Команды выполняются между пакетами run_for(),
+ *  то есть на границе команд машины. Регистры и память
+ *  пульт печатает из снимка emu_snap, снятого там же.
+ */
 
-void LoadFileListToPaperTxt(char *pathcataloglst, char *pathfilelst, char *pathfiletxt)
+/* Отправить команду потоку эмуляции и дождаться выполнения */
+int emu_send(emu_cmd_t *c)
 {
-	FILE *file_lst;
-	FILE *file_txt;
+	double t = time_monotonic();
+	char b = 0;
 
-	/* Переменная, в которую поочередно будут помещаться считываемые строки */
-	char str[80] = {0};
-
-	/* Указатель, в который будет помещен адрес массива, в который считана */
-	/* строка, или NULL если достигнут коней файла или произошла ошибка */
-	char *estr;
-
-	file_txt = fopen(pathfiletxt, "w");
-	if (file_txt == NULL)
+	c->seq = ++emu_seq;
+	while (!emu_queue_push(&emu_queue, c))
 	{
-		printf("ERR fopen %s\r\n", pathfiletxt);
-		return;
+		sched_yield();
 	}
+	write(emu_wake[1], &b, 1);
 
-	file_lst = fopen(pathfilelst, "r");
-	if (file_lst == NULL)
-	{
-		printf("ERR fopen %s\r\n", pathfilelst);
-		return;
-	}
-	else
+	while (atomic_load_explicit(&emu_ack, memory_order_acquire) < c->seq)
 	{
-		printf("Read file list: %s\r\n", pathfilelst);
-                printf("\r\n");
-
-		/* Чтение (построчно) данных из файла в бесконечном цикле */
-		while (1)
+		if (read(emu_reply[0], &b, 1) < 0 && errno != EINTR)
 		{
-			/* Чтение одной строки  из файла */
-			estr = fgets(str, sizeof(str), file_lst);
-
-			/* Проверка на конец файла или ошибку чтения */
-			if (estr == NULL)
-			{
-				/* Проверяем, что именно произошло: кончился файл */
-				/* или это ошибка чтения */
-				if (feof(file_lst) != 0)
-				{
-					/* Если файл закончился, выводим сообщение о завершении */
-					/* чтения и выходим из бесконечного цикла */
-					// printf("\r\nЧтение файла закончено\r\n");
-					break;
-				}
-				else
-				{
-					/* Если при чтении произошла ошибка, выводим сообщение */
-					/* об ошибке и выходим из бесконечного цикла */
-					// printf("\nОшибка чтения из файла\r\n");
-					break;
-				}
-			}
-
-			/* ---------------------------------
-			 * Загрузить из файла тест-программу
-			 * ---------------------------------
-			 */
-			printf("Read file: %s\r\n", str);
-
-			FILE *file;
-			char path_str[160] = {0};
-			uint8_t cmd[20];
-			trs_t inr;
-			trs_t dst;
-
-			inr = smtr("0---0"); /* cчетчик адреса коротких слов */
-			trs_t sum;
-			trs_t tmp;
-
-			tmp.l = 18;
-			tmp.t1 = 0;
-			tmp.t0 = 0;
-
-			int64_t dsun = 0;
-			sum.l = 18;
-			sum.t1 = 0;
-			sum.t0 = 0;
-			//
-			dst.l = 9;
-			MR.l = 18;
-			int i = 0;
-
-			strcat(path_str, pathcataloglst);
-			strcat(path_str, "/");
-			if (str[strlen(str) - 1] == 0x0A)
-			{
-				str[strlen(str) - 1] = 0;
-			}
-			str[strlen(str)] = 0;
-			strcat(path_str, str);
-
-			file = fopen(path_str, "r");
-			if (file == NULL)
-			{
-				printf("ERR fopen %s\r\n", path_str);
-				return;
-			}
+			return 1;
+		}
+	}
+	emu_latency = time_monotonic() - t;
 
-			while (fscanf(file, "%s", cmd) != EOF)
-			{
-				uint8_t offset4_7 = 4;
-				uint8_t prlile[7];
-				trs_t dst;
-				trs_t trit2;
-				//
-				cmd_str_2_trs(cmd, &dst);
-				trit2.l = 2;
-				//
-				trit2 = set_trit_setun(trit2, 1, 0);
-				trit2 = set_trit_setun(trit2, 2, get_trit_setun(dst, 1));
-				memset(prlile, 0, sizeof(prlile));
-				memmove(prlile, tab4_7[trs2digit(trit2) + offset4_7], sizeof(prlile));
-				fwrite(prlile, 1, strlen(prlile), file_txt);
-				fwrite("\r\n", 1, strlen("\r\n"), file_txt);
-				//
-				trit2 = set_trit_setun(trit2, 1, get_trit_setun(dst, 2));
-				trit2 = set_trit_setun(trit2, 2, get_trit_setun(dst, 3));
-				memset(prlile, 0, sizeof(prlile));
-				memmove(prlile, tab4_7[trs2digit(trit2) + offset4_7], sizeof(prlile));
-				fwrite(prlile, 1, strlen(prlile), file_txt);
-				fwrite("\r\n", 1, strlen("\r\n"), file_txt);
-				//
-				trit2 = set_trit_setun(trit2, 1, get_trit_setun(dst, 4));
-				trit2 = set_trit_setun(trit2, 2, get_trit_setun(dst, 5));
-				memset(prlile, 0, sizeof(prlile));
-				memmove(prlile, tab4_7[trs2digit(trit2) + offset4_7], sizeof(prlile));
-				fwrite(prlile, 1, strlen(prlile), file_txt);
-				fwrite("\r\n", 1, strlen("\r\n"), file_txt);
-				//
-				trit2 = set_trit_setun(trit2, 1, get_trit_setun(dst, 6));
-				trit2 = set_trit_setun(trit2, 2, get_trit_setun(dst, 7));
-				memset(prlile, 0, sizeof(prlile));
-				memmove(prlile, tab4_7[trs2digit(trit2) + offset4_7], sizeof(prlile));
-				fwrite(prlile, 1, strlen(prlile), file_txt);
-				fwrite("\r\n", 1, strlen("\r\n"), file_txt);
-				//
-				trit2 = set_trit_setun(trit2, 1, get_trit_setun(dst, 8));
-				trit2 = set_trit_setun(trit2, 2, get_trit_setun(dst, 9));
-				memset(prlile, 0, sizeof(prlile));
-				memmove(prlile, tab4_7[trs2digit(trit2) + offset4_7], sizeof(prlile));
-				fwrite(prlile, 1, strlen(prlile), file_txt);
-				fwrite("\r\n", 1, strlen("\r\n"), file_txt);
-				//
-				memset(prlile, 0, sizeof(prlile));
-				memmove(prlile, "O__._O", sizeof(prlile));
-				fwrite(prlile, 1, strlen(prlile), file_txt);
-				fwrite("\r\n", 1, strlen("\r\n"), file_txt);
-			}
-			fclose(file);
+	return 0;
+}
 
-			/* Промежуток между зонами на перфоленте */
-			for (int j = 0; j < 5; j++)
-			{
-				fwrite("___.__\r\n", 1, strlen("___.__\r\n"), file_txt);
-			}
-		}
+/* Ждать команду пульта не дольше timeout мс, -1 - без ограничения */
+static void emu_wait(int timeout)
+{
+	struct pollfd pfd;
+	char b[16];
+
+	pfd.fd = emu_wake[0];
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, timeout) > 0)
+	{
+		read(emu_wake[0], b, sizeof(b));
 	}
+}
 
-	/* Закрыть файлы */
-	fclose(file_lst);
-	fclose(file_txt);
+/* Выполнить команду пульта, 1 - завершить поток */
+static uint8_t emu_apply(setun_machine_t *m, emu_cmd_t *c)
+{
+	switch (c->code)
+	{
+	case EMU_CMD_BEGIN:
+		emu_stat = BEGIN_EMU_ST;
+		break;
+	case EMU_CMD_PAUSE:
+		emu_stat = PAUSE_EMU_ST;
+		break;
+	case EMU_CMD_RUN:
+		emu_stat = LOOP_WORK_EMU_ST;
+		break;
+	case EMU_CMD_STEP:
+		if (emu_stat == WAIT_EMU_ST)
+		{
+			emu_stat = STEP_EMU_ST;
+		}
+		break;
+	case EMU_CMD_BREAK:
+		BREAKPOINT = c->val;
+		break;
+	case EMU_CMD_NATIVE:
+		set_native_mode(m, c->val);
+		break;
+	case EMU_CMD_IDLE:
+		IDLE_DETECT = c->val;
+		break;
+	case EMU_CMD_PACE:
+		view_pace_stat(m);
+		PACE_OPS = c->val;
+		break;
+	case EMU_CMD_REG:
+		native_sync(m);
+		switch (c->rg)
+		{
+		case 'K':
+			copy_trs(&c->trs, &m->K);
+			break;
+		case 'F':
+			copy_trs(&c->trs, &m->F);
+			break;
+		case 'C':
+			copy_trs(&c->trs, &m->C);
+			break;
+		case 'W':
+			copy_trs(&c->trs, &m->W);
+			break;
+		case 'S':
+			copy_trs(&c->trs, &m->S);
+			break;
+		case 'R':
+			copy_trs(&c->trs, &m->R);
+			break;
+		case 'M':
+			copy_trs(&c->trs, &m->MB);
+			break;
+		default:
+			break;
+		}
+		/* Целые регистры перечитать из тритов */
+		m->native_state = NATIVE_NONE;
+		break;
+	case EMU_CMD_SNAP:
+		native_sync(m);
+		memcpy(&emu_snap, m, sizeof(emu_snap));
+		break;
+	case EMU_CMD_TEST:
+		run_test(c->val);
+		break;
+	case EMU_CMD_DUMP:
+		/* Проверить путь к каталогам,  файл списка lst */
+		if (DumpFileTxs(c->par) != 0)
+		{
+			printf("no path file\r\n");
+		}
+		break;
+	case EMU_CMD_ZONE:
+		/* Указатель строится при первой команде, если нет FILE.idx */
+		if ((m->ptr1 == NULL) ||
+			((m->ft1.zone == NULL) && (tape_index_open(&m->ft1, m->path_ptr1, 1) != 0)))
+		{
+			printf("no zone index FT1\r\n");
+		}
+		else if (c->val < 0)
+		{
+			view_tape_index(&m->ft1);
+		}
+		else
+		{
+			int res = tape_seek_zone(&m->ft1, m->ptr1, (uint32_t)c->val);
 
-	printf("\r\nWrite file: %s\r\n", pathfiletxt);
+			if (res == 0)
+				printf("zone %i\r\n", c->val);
+			else
+				printf("zone %i: %s\r\n", c->val, (res == -2) ? "stale index" : "no zone");
+		}
+		break;
+	case EMU_CMD_CLOSE:
+		emu_close = 1;
+		break;
+	case EMU_CMD_QUIT:
+		return 1;
+	default:
+		break;
+	}
+	return 0;
 }
 
-int ConvertSWtoPaper(char *path_lst, char *path_txt)
+/* Поток эмуляции: команды пульта и работа машины */
+static void *Emu_Thread(void *arg)
 {
+	uint8_t quit = 0;
 
-	int res = 0;
+	while (1)
+	{
+		emu_cmd_t c;
+		uint32_t seq = 0;
+		uint64_t skipped = setun.idle_skipped;
 
-	char a_fileName[80];
+		while (!quit && emu_queue_pop(&emu_queue, &c))
+		{
+			quit = emu_apply(&setun, &c);
+			seq = c.seq;
+		}
 
-	printf("[ Convert software files to file paper.txt ]\r\n");
-        printf("\r\n");
+		/* Работа виртуальной машины */
+		if (!quit)
+		{
+			Process_Work_Emulation();
+		}
 
-	DIR *dir;
-	struct dirent *ent;
-	if ((dir = opendir(path_lst)) != NULL)
-	{
-		/* print all the files and directories within directory */
-		while ((ent = readdir(dir)) != NULL)
+		if (seq != 0)
 		{
-			char file_ext[10];
-			strcpy(file_ext, get_file_ext(ent->d_name));
-			/* Найти список файлов */
-			if (strcmp(file_ext, "lst") == 0)
+			char b = 0;
+			atomic_store_explicit(&emu_ack, seq, memory_order_release);
+			write(emu_reply[1], &b, 1);
+		}
+
+		if (quit)
+		{
+			break;
+		}
+		if (emu_stat == WAIT_EMU_ST)
+		{
+			if (emu_close && (atomic_load(&emu_queue.head) == atomic_load(&emu_queue.tail)))
 			{
-				strcpy(a_fileName, ent->d_name);
-				res = 0; /* Ok' */
 				break;
 			}
+			emu_wait(-1);
+		}
+		else if (setun.idle_skipped != skipped)
+		{
+			emu_wait(POLL_INPUT_MS);
 		}
-		closedir(dir);
 	}
-	else
+	return NULL;
+}
+
+/** ------------------------------------------------------------
+ *  Пакетный режим
+ *  ------------------------------------------------------------
+ *  Без пульта управления: загрузить перфоленту и барабан,
+ *  выполнять до останова или до исчерпания бюджета команд
+ *  и времени, записать выходные файлы и регистры.
+ *  Код завершения - BATCH_EXIT_...
+ */
+
+/* Загрузить DRUM из файла.txs с зоны 01--, возврат число слов или -1 */
+int load_drum_txs(setun_machine_t *m, const char *path)
+{
+	FILE *file;
+	uint8_t cmd[20];
+	trs_t dst;
+	int i = 0;
+
+	file = fopen(path, "r");
+	if (file == NULL)
 	{
-		/* could not open directory */
-		perror("Could not open directory");
-		res = 1; /* Error#1 */
-		return EXIT_FAILURE;
+		printf("ERR fopen %s\r\n", path);
+		return -1;
 	}
 
-	/* Прочитать файлы из каталога и преобразовать в папер */
-	if (res == 0)
+	dst.l = 9;
+	while ((fscanf(file, "%19s", cmd) != EOF) && (i < SIZE_TRIT_DRUM))
 	{
-		/* Проверить каталог */
-		if ((dir = opendir(path_txt)) != NULL)
-		{
-			res = 0; /* Ok' */
-		}
-		else
-		{
-			res = 2; /* Error#2 */
-		}
+		cmd_str_2_trs(cmd, &dst);
+		copy_trs_setun(&dst, &m->mem_drum[ZONE_DRUM_BEG + i / SIZE_ZONE_TRIT_DRUM][i % SIZE_ZONE_TRIT_DRUM]);
+		i++;
 	}
+	fclose(file);
 
-	/* Прочитать файлы программы из каталога и преобразовать в paper.txt */
-	if (res == 0)
-	{
-		char pathfile1[255];
-		char pathfile2[255];
-		// clear
-		memset(pathfile1, 0, sizeof(pathfile1));
-		memset(pathfile2, 0, sizeof(pathfile2));
-		// path file1
-		strcat(pathfile1, path_lst);
-		strcat(pathfile1, "/");
-		strcat(pathfile1, a_fileName);
-		// path file2
-		strcat(pathfile2, path_txt);
-		strcat(pathfile2, "/");
-		strcat(pathfile2, "paper.txt");
+	return i;
+}
 
-		LoadFileListToPaperTxt(path_lst, pathfile1, pathfile2);
-	}
+/* Записать регистр в файл */
+void fprint_reg(FILE *f, trs_t *t, char *name)
+{
+	int8_t i;
 
-	return res; /* Ok' */
+	fprintf(f, "%s: [", name);
+	for (i = 0; i < t->l; i++)
+	{
+		fprintf(f, "%c", numb2symtrs(get_trit(*t, t->l - 1 - i)));
+	}
+	fprintf(f, "], (%li)\n", (long int)trs2digit(*t));
 }
 
-int DumpFileTxs(char *pathfiletxs)
+/* Записать регистры машины в файл */
+int dump_regs_file(setun_machine_t *m, const char *path)
 {
-	FILE *file_txs;
+	FILE *f = fopen(path, "w");
 
-	file_txs = fopen(pathfiletxs, "r");
-	if (file_txs == NULL)
+	if (f == NULL)
 	{
-		printf("ERR fopen %s\r\n", pathfiletxs);
+		printf("ERR fopen %s\r\n", path);
 		return 1;
 	}
+	native_sync(m);
+	fprint_reg(f, &m->K, "K  ");
+	fprint_reg(f, &m->F, "F  ");
+	fprint_reg(f, &m->C, "C  ");
+	fprint_reg(f, &m->W, "W  ");
+	fprint_reg(f, &m->ph1, "ph1");
+	fprint_reg(f, &m->ph2, "ph2");
+	fprint_reg(f, &m->S, "S  ");
+	fprint_reg(f, &m->R, "R  ");
+	fprint_reg(f, &m->MB, "MB ");
+	fclose(f);
 
-	printf("Read commands from file.txs: %s\r\n", pathfiletxs);
+	return 0;
+}
 
-	uint8_t cmd[20];
-	trs_t inr;
-	trs_t dst;
+/* Код завершения пакетного режима по статусу run_for() */
+int batch_exit_code(int ret)
+{
+	switch (ret)
+	{
+	case STOP:
+		return BATCH_EXIT_STOP;
+	case STOP_OVER:
+		return BATCH_EXIT_OVER;
+	case STOP_ERROR:
+	case STOP_ERROR_MB_NUMBER:
+		return BATCH_EXIT_ERROR;
+	case STOP_BREAKPOINT:
+	case STOP_IDLE:
+		return BATCH_EXIT_BREAK;
+	default:
+		return BATCH_EXIT_BUDGET;
+	}
+}
 
-	inr = smtr("0---0"); /* cчетчик адреса коротких слов */
-	trs_t sum;
-	trs_t tmp;
+/** ------------------------------------------------------------
+ *  Параллельный запуск заданий
+ *  ------------------------------------------------------------
+ *  Каждое задание выполняется на своей машине setun_machine_t
+ *  со своими регистрами, FRAM, DRUM и файлами устройств.
+ *  Общие таблицы готовятся до запуска потоков.
+ *
+ *  JOB_SCHED_SHARED - потоки берут следующее задание из общего
+ *  счётчика и выполняют его до конца.
+ *  JOB_SCHED_STEAL - у каждого потока своя дека заданий: владелец
+ *  берёт задание снизу, другие потоки крадут сверху. Задание
+ *  выполняется квантами по JOB_SLICE_STEPS команд и после кванта
+ *  возвращается наверх деки, так что длинное задание не задерживает
+ *  короткие и первым уходит к освободившемуся потоку.
+ */
+typedef struct job_deque
+{
+	pthread_mutex_t lock;
+	int *ind;	/* номера заданий, кольцо на count элементов */
+	int top;	/* сверху крадут и возвращают после кванта */
+	int bottom; /* снизу берёт владелец */
+} job_deque_t;
 
-	tmp.l = 18;
-	tmp.t1 = 0;
-	tmp.t0 = 0;
+typedef struct job_pool
+{
+	setun_job_t *jobs;
+	int count;
+	int threads;
+	_Atomic int next;	   /* следующее задание, JOB_SCHED_SHARED */
+	_Atomic int remaining; /* не завершено заданий, JOB_SCHED_STEAL */
+	_Atomic uint64_t steals;
+	job_deque_t *deque;
+	pthread_mutex_t idle_lock; /* ожидание работы, JOB_SCHED_STEAL */
+	pthread_cond_t idle_cond;
+	uint64_t events; /* число возвратов в деку и завершений заданий */
+	double t0;
+} job_pool_t;
+
+typedef struct job_worker_arg
+{
+	job_pool_t *pool;
+	int id;
+} job_worker_arg_t;
 
-	int64_t dsun = 0;
-	sum.l = 18;
-	sum.t1 = 0;
-	sum.t0 = 0;
-	//
-	dst.l = 9;
-	MR.l = 18;
-	int i = 0;
+/* Число процессоров хоста */
+int host_cores(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n > 0) ? (int)n : 1;
+}
 
-	while (fscanf(file_txs, "%s", cmd) != EOF)
+/* Подготовить машину задания, 0 - можно выполнять */
+int job_begin(setun_job_t *job)
+{
+	setun_machine_t *m;
+
+	job->ret = STOP_ERROR;
+	job->done = 0;
+	job->time = 0;
+	job->finished = 0;
+
+	m = malloc(sizeof(setun_machine_t));
+	job->m = m;
+	if (m == NULL)
 	{
-		cmd_str_2_trs(cmd, &dst);
-		sum = add_trs(sum, dst);
-		i += 1;
+		return 1;
+	}
+	if (job->base != NULL)
+	{
+		memcpy(m, job->base, sizeof(setun_machine_t));
+	}
+	else
+	{
+		init_setun_machine(m);
+	}
+	m->tty_echo = NULL;
+	memset(&m->tty_dev, 0, sizeof(m->tty_dev));
+	memset(&m->ptp_dev, 0, sizeof(m->ptp_dev));
 
-		dsun += trs2digit(dst);
+	if (job->path_out != NULL)
+	{
+		snprintf(job->path_tty, sizeof(job->path_tty), "%s.tty", job->path_out);
+		snprintf(job->path_ptp, sizeof(job->path_ptp), "%s.ptp", job->path_out);
+		m->path_tty1 = job->path_tty;
+		m->path_ptp1 = job->path_ptp;
+	}
+	else
+	{
+		/* Вывод задания в памяти: в таблице заданий - размер и сумма */
+		m->tty_dev.kind = DEV_MEM;
+		m->ptp_dev.kind = DEV_MEM;
+	}
+	if (job->base != NULL)
+	{
+		/* Фотосчитыватели продолжают чтение с места останова загрузки */
+		m->path_ptr1 = (job->base->ptr1 != NULL) ? job->base->path_ptr1 : "/dev/null";
+		m->path_ptr2 = (job->base->ptr2 != NULL) ? job->base->path_ptr2 : "/dev/null";
+	}
+	else if (job->load != NULL)
+	{
+		m->path_ptr1 = "/dev/null";
+		m->path_ptr2 = "/dev/null";
+	}
+	else
+	{
+		m->path_ptr1 = job->path_tape;
+	}
 
-		st_fram(inr, dst);
-		inr = next_address(inr);
+	Emu_Open_Files(m);
+	if ((m->ptr1 == NULL) || !dev_ok(&m->ptp_dev, m->ptp1) || !dev_ok(&m->tty_dev, m->tty1))
+	{
+		return 1;
 	}
-	/* Закрыть файл */
-	fclose(file_txs);
+	if (job->base != NULL)
+	{
+		if (job->base->ptr1 != NULL)
+		{
+			tape_seek(&m->ft1, m->ptr1, tape_tell(&job->base->ft1, job->base->ptr1));
+		}
+		if ((job->base->ptr2 != NULL) && (m->ptr2 != NULL))
+		{
+			tape_seek(&m->ft2, m->ptr2, tape_tell(&job->base->ft2, job->base->ptr2));
+		}
+		sweep_apply(m, job->set, job->set_count);
+	}
+	else if (job->load != NULL)
+	{
+		job->load(m);
+	}
+	else
+	{
+		Begin_Read_Commands_from_FT1(m, m->ptr1);
+		m->C = smtr("0000+");
+	}
+	return 0;
+}
 
-	dump_fram_zone(smtr("0"));
+/* Выполнить не более slice команд задания (0 - до конца), 1 - задание завершено */
+int job_run_slice(setun_job_t *job, uint64_t slice)
+{
+	uint64_t limit = (slice > 0) ? job->done + slice : UINT64_MAX;
+	double t = time_monotonic();
 
-	printf("\r\n i=%i\r\n", i);
+	while (1)
+	{
+		uint64_t n = RUN_BATCH_STEPS;
+		uint64_t d = 0;
 
-	/* Печать контрольных сумм */
-	printf("\r\n");
-	view_checksum_setun(sum);
+		if ((job->steps > 0) && (job->steps - job->done < n))
+		{
+			n = job->steps - job->done;
+		}
+		if (limit - job->done < n)
+		{
+			n = limit - job->done;
+		}
+		job->ret = run_for(job->m, n, &d);
+		job->done += d;
 
-	return 0; /* Ok' */
+		if ((job->ret != OK) ||
+			((job->steps > 0) && (job->done >= job->steps)) ||
+			((job->seconds > 0) && (job->time + time_monotonic() - t >= job->seconds)))
+		{
+			job->finished = 1;
+			break;
+		}
+		if (job->done >= limit)
+		{
+			break;
+		}
+	}
+	job->time += time_monotonic() - t;
+
+	return job->finished;
 }
 
+/* Записать регистры и освободить машину задания */
+void job_end(setun_job_t *job)
+{
+	setun_machine_t *m = job->m;
+	char path_regs[256];
+
+	job->finished = 1;
+	if (m == NULL)
+	{
+		return;
+	}
+	native_sync(m);
+	job->C = m->C;
+	job->S = m->S;
+	job->R = m->R;
+	for (int i = 0; i < job->cells_count; i++)
+	{
+		job->cell_val[i] = trs2digit(ld_fram(m, job->cells[i]));
+	}
+	if ((job->path_out != NULL) && (m->ptr1 != NULL))
+	{
+		snprintf(path_regs, sizeof(path_regs), "%s.regs", job->path_out);
+		dump_regs_file(m, path_regs);
+	}
+	Emu_Close_Files(m);
+	job->tty_bytes = m->tty_dev.bytes;
+	job->ptp_bytes = m->ptp_dev.bytes;
+	job->tty_sum = dev_sum(&m->tty_dev);
+	job->ptp_sum = dev_sum(&m->ptp_dev);
+	dev_free(&m->tty_dev);
+	dev_free(&m->ptp_dev);
+	free(m);
+	job->m = NULL;
+}
 
-void print_version(void) {
-        printf(" Emulator ternary computer 'Setun-1958':\r\n");
-        printf(" Version: %s\r\n",Version);
-		printf(" Author:  Vladimir V.\r\n");
-        printf(" E-mail:  askfind@ya.ru\r\n");
-        printf("\r\n");
+/* Выполнить одно задание на новой машине */
+void run_job(setun_job_t *job)
+{
+	if (job_begin(job) == 0)
+	{
+		job_run_slice(job, 0);
+	}
+	job_end(job);
 }
 
-int version(const char *argv0)
+/* Поток пула: задания по общему счётчику */
+static void *job_worker(void *arg)
 {
-    printf(" Emulator ternary computer 'Setun-1958': ver.%s\r\n", Version);
-    printf(" Author: Vladimir V.\r\n");
-    printf(" E-mail: askfind@ya.ru\r\n");
-    printf("\r\n");
+	job_pool_t *pool = ((job_worker_arg_t *)arg)->pool;
+	int i;
 
-	exit(0);
+	while ((i = atomic_fetch_add(&pool->next, 1)) < pool->count)
+	{
+		run_job(&pool->jobs[i]);
+		pool->jobs[i].t_done = time_monotonic() - pool->t0;
+	}
+	return NULL;
 }
 
-int usage(const char *argv0)
+/* Положить задание в деку: снизу (владелец) или сверху (после кванта) */
+static void job_push(job_pool_t *pool, job_deque_t *q, int i, uint8_t top)
 {
-    printf("usage: %s [options] FILE SCRIPT(s)...\r\n", argv0);
-	printf("\t--version : version software setun1958emu\r\n");
-	printf("\t--load : load software setun1958emu\r\n");
-	printf("\t--convert : convert software file.lst to paper.txt setun1958emu\r\n");
-	printf("\t--dump : dump zone from file.txs setun1958emu\r\n");
-	printf("\t--LOGGING : view step  setun1958emu\r\n");
-	printf("\t--breakpoint : view stop setun1958emu\r\n");
-	printf("\t--test : number test setun1958emu\r\n");
-    printf("\r\n");
-
-	exit(0);
+	pthread_mutex_lock(&q->lock);
+	if (top)
+	{
+		q->top--;
+		q->ind[((q->top % pool->count) + pool->count) % pool->count] = i;
+	}
+	else
+	{
+		q->ind[((q->bottom % pool->count) + pool->count) % pool->count] = i;
+		q->bottom++;
+	}
+	pthread_mutex_unlock(&q->lock);
 }
 
+/* Взять задание из деки: снизу (владелец) или сверху (кража), -1 - пусто */
+static int job_pop(job_pool_t *pool, job_deque_t *q, uint8_t top)
+{
+	int i = -1;
 
-void Emu_Open_Files_ptr1_ptr2(void) {		
-		/* Открыть файлы для виртуальных устройств	*/
-		ptr1 = fopen("ptr1/paper.txt", "w");
-		if (ptr1 == NULL)
-		{	
-			printf("Error fopen 'ptr1/paper.txt'\r\n");
-			//viv~ TODO
-			//return 0; 
+	pthread_mutex_lock(&q->lock);
+	if (q->bottom > q->top)
+	{
+		if (top)
+		{
+			i = q->ind[((q->top % pool->count) + pool->count) % pool->count];
+			q->top++;
 		}
-
-		ptr2 = fopen("ptr2/paper.txt", "w");
-		if (ptr2 == NULL)
+		else
 		{
-			printf("Error fopen 'ptr1/paper.txt'\r\n");
-			//viv~ TODO
-			//return 0;
+			q->bottom--;
+			i = q->ind[((q->bottom % pool->count) + pool->count) % pool->count];
 		}
+	}
+	pthread_mutex_unlock(&q->lock);
+	return i;
 }
 
-void Emu_Close_Files_ptr1_ptr2(void)
+/* Разбудить потоки, ждущие работу: задание вернулось в деку или завершено */
+static void job_pool_event(job_pool_t *pool)
 {
-			/* Закрыть файлы виртуальных устройств */
-			fclose(ptr1);
-			fclose(ptr2);
+	pthread_mutex_lock(&pool->idle_lock);
+	pool->events++;
+	pthread_cond_broadcast(&pool->idle_cond);
+	pthread_mutex_unlock(&pool->idle_lock);
 }
 
-void Emu_Open_Files(void) {
+/* Поток пула с кражей заданий */
+static void *job_worker_steal(void *arg)
+{
+	job_pool_t *pool = ((job_worker_arg_t *)arg)->pool;
+	int id = ((job_worker_arg_t *)arg)->id;
+	job_deque_t *own = &pool->deque[id];
 
-		/* Открыть файлы для виртуальных устройств	*/
-		ptr1 = fopen("ptr1/paper.txt", "r");
-		if (ptr1 == NULL)
-		{	
-			printf("Error fopen 'ptr1/paper.txt'\r\n");
-			//viv~ TODO
-			//return 0; 
-		}
+	while (atomic_load(&pool->remaining) > 0)
+	{
+		uint64_t seen;
+		int i;
 
-		ptr2 = fopen("ptr2/paper.txt", "r");
-		if (ptr2 == NULL)
+		pthread_mutex_lock(&pool->idle_lock);
+		seen = pool->events;
+		pthread_mutex_unlock(&pool->idle_lock);
+
+		i = job_pop(pool, own, 0);
+
+		/* Своя дека пуста: украсть сверху у соседей */
+		for (int k = 1; (i < 0) && (k < pool->threads); k++)
 		{
-			printf("Error fopen 'ptr1/paper.txt'\r\n");
-			//viv~ TODO
-			//return 0;
+			i = job_pop(pool, &pool->deque[(id + k) % pool->threads], 1);
+			if (i >= 0)
+			{
+				atomic_fetch_add(&pool->steals, 1);
+			}
 		}
-
-		ptp1 = fopen("ptp1/paper.txt", "w");
-		if (ptp1 == NULL)
+		if (i < 0)
 		{
-			printf("Error fopen 'ptp1/paper.txt'\r\n");
-			//viv~ TODO
-			//return 0;
+			/* Остальные задания выполняются другими потоками: ждать
+			   возврата кванта в деку или завершения задания */
+			pthread_mutex_lock(&pool->idle_lock);
+			while ((pool->events == seen) && (atomic_load(&pool->remaining) > 0))
+			{
+				pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+			}
+			pthread_mutex_unlock(&pool->idle_lock);
+			continue;
 		}
 
-		tty1 = fopen("tty1/printout.txt", "w");
-		if (tty1 == NULL)
+		setun_job_t *job = &pool->jobs[i];
+		if ((job->m == NULL) && !job->finished && (job_begin(job) != 0))
 		{
-			printf("Error fopen 'tty1/printout.txt'\r\n");
-			//viv~ TODO
-			//return 0;
+			job->finished = 1;
 		}
+		if (job->finished || job_run_slice(job, JOB_SLICE_STEPS))
+		{
+			job_end(job);
+			job->t_done = time_monotonic() - pool->t0;
+			atomic_fetch_sub(&pool->remaining, 1);
+		}
+		else
+		{
+			job_push(pool, own, i, 1);
+		}
+		job_pool_event(pool);
+	}
+	return NULL;
 }
 
-void Emu_Close_Files(void)
+/**
+ * Выполнить count заданий в threads потоках (0 - по числу процессоров),
+ * sched - JOB_SCHED_SHARED или JOB_SCHED_STEAL.
+ * Возврат: 0 - все потоки запущены
+ */
+int run_jobs(setun_job_t *jobs, int count, int threads, uint8_t sched)
 {
-			/* Закрыть файлы виртуальных устройств */
-			fclose(ptr1);
-			fclose(ptr2);
-			fclose(ptp1);
-			fclose(tty1);
-}
-
-void Emu_Begin(void) {
-
-		/* Инициализация таблиц символов ввода и вывода "Сетунь-1958" */
-		init_tab4();
+	pthread_t tid[JOB_THREADS_MAX];
+	job_worker_arg_t arg[JOB_THREADS_MAX];
+	void *(*worker)(void *) = (sched == JOB_SCHED_STEAL) ? job_worker_steal : job_worker;
+	job_pool_t pool;
+	int started = 0;
+	int ret = 0;
+
+	if (threads <= 0)
+	{
+		threads = host_cores();
+	}
+	if (threads > JOB_THREADS_MAX)
+	{
+		threads = JOB_THREADS_MAX;
+	}
+	if (count <= 0)
+	{
+		return 0;
+	}
 
-		/* Сброс виртуальной машины "Сетунь-1958" */
-		reset_setun_1958();
+	/* Общие таблицы до запуска потоков */
+	init_tables();
 
-		/* В режиме отладки вывод регистров */
-		if (LOGGING > 0)
+	for (int i = 0; i < count; i++)
+	{
+		jobs[i].m = NULL;
+		jobs[i].finished = 0;
+		jobs[i].t_done = 0;
+	}
+
+	pool.jobs = jobs;
+	pool.count = count;
+	pool.threads = threads;
+	pool.deque = NULL;
+	pool.events = 0;
+	pthread_mutex_init(&pool.idle_lock, NULL);
+	pthread_cond_init(&pool.idle_cond, NULL);
+	atomic_store(&pool.next, 0);
+	atomic_store(&pool.remaining, count);
+	atomic_store(&pool.steals, 0);
+
+	/* Начальное распределение заданий по декам потоков */
+	if (sched == JOB_SCHED_STEAL)
+	{
+		pool.deque = calloc(threads, sizeof(job_deque_t));
+		if (pool.deque == NULL)
 		{
-			view_short_regs();
-		}		
-		
-		Emu_Open_Files();
-
-		/*  Выполнить первый код "Сетунь-1958" */
-		printf("\r\n[ Start Setun-1958 ]\r\n");
-
-		/* Выполение программы в ферритовой памяти "Сетунь-1958" */
-		Begin_Read_Commands_from_FT1(ptr1);
+			pthread_mutex_destroy(&pool.idle_lock);
+			pthread_cond_destroy(&pool.idle_cond);
+			return 1;
+		}
+		for (int k = 0; k < threads; k++)
+		{
+			pthread_mutex_init(&pool.deque[k].lock, NULL);
+			pool.deque[k].ind = malloc(count * sizeof(int));
+		}
+		for (int i = count - 1; i >= 0; i--)
+		{
+			job_push(&pool, &pool.deque[i % threads], i, 0);
+		}
+	}
 
-		/* Begin address fram */
-		C = smtr("0000+");
+	pool.t0 = time_monotonic();
+	for (int i = 0; i < threads; i++)
+	{
+		arg[i].pool = &pool;
+		arg[i].id = i;
+		if (pthread_create(&tid[i], NULL, worker, &arg[i]) != 0)
+		{
+			ret = 1;
+			break;
+		}
+		started++;
+	}
+	/* Без потоков задания выполняются здесь, чужие деки - кражей */
+	if (started == 0)
+	{
+		worker(&arg[0]);
+	}
+	for (int i = 0; i < started; i++)
+	{
+		pthread_join(tid[i], NULL);
+	}
+	job_steals = atomic_load(&pool.steals);
 
+	if (pool.deque != NULL)
+	{
+		for (int k = 0; k < threads; k++)
+		{
+			pthread_mutex_destroy(&pool.deque[k].lock);
+			free(pool.deque[k].ind);
+		}
+		free(pool.deque);
+	}
+	pthread_mutex_destroy(&pool.idle_lock);
+	pthread_cond_destroy(&pool.idle_cond);
+	return ret;
 }
 
-int Emu_Step(void) {
-
-	trs_t addr;
-	trs_t C_cur;
-	trs_t oper;
+/* Печать результатов заданий, возврат наибольший код завершения */
+int view_jobs(setun_job_t *jobs, int count)
+{
+	int code = BATCH_EXIT_STOP;
 
-	C_cur = C;
-	K = ld_fram(C);
-	K = slice_trs_setun(K, 1, 9);
+	printf("  job  status      instr     time, s   tty, bytes  sum       ptp, bytes  sum       tape\r\n");
+	for (int i = 0; i < count; i++)
+	{
+		printf(" %4i  %6i %10llu  %10.3f  %10llu  %08x  %10llu  %08x  %s\r\n", i, jobs[i].ret,
+			   (unsigned long long)jobs[i].done, jobs[i].time,
+			   (unsigned long long)jobs[i].tty_bytes, jobs[i].tty_sum,
+			   (unsigned long long)jobs[i].ptp_bytes, jobs[i].ptp_sum, jobs[i].path_tape);
+		if (batch_exit_code(jobs[i].ret) > code)
+		{
+			code = batch_exit_code(jobs[i].ret);
+		}
+	}
+	return code;
+}
 
-	if (LOGGING > 0)
+/** ------------------------------------------------------------
+ *  Перебор вариантов
+ *  ------------------------------------------------------------
+ *  Программа загружается один раз в базовую машину. Каждый вариант
+ *  выполняется на копии базовой машины с заменами регистров и ячеек
+ *  FRAM из строки файла вариантов:
+ *
+ *    # комментарий
+ *    S=+0-0 R=12 0000+=-100
+ *
+ *  Имя - регистр K, F, C, W, S, R или адрес ячейки FRAM A(1:5),
+ *  значение - троичное число из '-', '0', '+' или десятичное целое.
+ *  Результат: строка CSV или запись двоичного файла на вариант.
+ */
+/* Строка из символов '-', '0', '+' */
+static int is_symtrs(const char *s)
+{
+	if (*s == '\0')
+	{
+		return 0;
+	}
+	for (; *s != '\0'; s++)
 	{
-		view_step_short_reg(&C, "\n С");
+		if ((*s != '-') && (*s != '0') && (*s != '+'))
+		{
+			return 0;
+		}
 	}
+	return 1;
+}
 
-	addr = control_trs(K);
-	oper = slice_trs_setun(K, 6, 8);
+/* Значение замены длиной l тритов, 0 - успешно */
+int sweep_value(char *s, uint8_t l, trs_t *v)
+{
+	int64_t n;
+	int64_t half = (pow3(l) - 1) / 2;
+	char *end;
 
-	return  execute_trs(addr, oper);
+	if (is_symtrs(s) && (strlen(s) <= l))
+	{
+		n = trs2digit(smtr((uint8_t *)s));
+	}
+	else
+	{
+		n = strtoll(s, &end, 10);
+		if ((*s == '\0') || (*end != '\0'))
+		{
+			return 1;
+		}
+	}
+	if ((n < -half) || (n > half))
+	{
+		return 1;
+	}
+	*v = int2trs((int32_t)n, l);
+	return 0;
 }
 
-void Emu_Stop(void) {
-			
-			//dump_fram_zone(smtr("-"));
-		    //dump_fram_zone(smtr("0"));
-		    //dump_fram_zone(smtr("+"));
-            
-			/* Prints REGS */
-			view_short_regs();
-			printf("\r\n");
+/**
+ * Разобрать строку варианта в замены.
+ * Возврат: число замен, -1 - ошибка
+ */
+int sweep_parse(char *line, sweep_set_t *set, int max)
+{
+	int count = 0;
+	char *save = NULL;
 
-			/* Prints REGS and FRAM */
-			if (LOGGING > 0)
-			{
-				// dump_fram_zone(smtr("-"));
-				// dump_fram_zone(smtr("0"));
-				// dump_fram_zone(smtr("+"));
-			}
+	for (char *tok = strtok_r(line, " \t,\r\n", &save); tok != NULL;
+		 tok = strtok_r(NULL, " \t,\r\n", &save))
+	{
+		char *eq = strchr(tok, '=');
+		uint8_t l;
 
-			/* Печать завершения работы "Setun-1958" */
-			if (STEP == 0)
-			{
-				printf("\r\n[ Stop Setun-1958 ]\r\n");
-			}
-			else
+		if ((eq == NULL) || (count >= max))
+		{
+			return -1;
+		}
+		*eq = '\0';
+		set[count].rg = 0;
+		if (strlen(tok) == 1)
+		{
+			set[count].rg = toupper(tok[0]);
+			switch (set[count].rg)
 			{
-				printf("\r\n[ Step = %d : Break work Setun-1958 ]\r\n", STEP);
+			case 'K':
+				l = 9;
+				break;
+			case 'F':
+			case 'C':
+				l = 5;
+				break;
+			case 'W':
+				l = 1;
+				break;
+			case 'S':
+			case 'R':
+				l = 18;
+				break;
+			default:
+				return -1;
 			}
-
-			/* Закрыть файлы виртуальных устройств */
-			Emu_Close_Files();
+		}
+		else if (is_symtrs(tok) && (strlen(tok) == 5))
+		{
+			/* A(5) = '-' - длинная ячейка 18 тритов */
+			set[count].addr = smtr((uint8_t *)tok);
+			l = (tok[4] == '-') ? 18 : 9;
+		}
+		else
+		{
+			return -1;
+		}
+		if (sweep_value(eq + 1, l, &set[count].v) != 0)
+		{
+			return -1;
+		}
+		count++;
+	}
+	return count;
 }
 
+/* Замены варианта перебора в машине */
+void sweep_apply(setun_machine_t *m, const sweep_set_t *set, int count)
+{
+	native_sync(m);
+	for (int i = 0; i < count; i++)
+	{
+		switch (set[i].rg)
+		{
+		case 'K':
+			m->K = set[i].v;
+			break;
+		case 'F':
+			m->F = set[i].v;
+			break;
+		case 'C':
+			m->C = set[i].v;
+			break;
+		case 'W':
+			m->W = set[i].v;
+			break;
+		case 'S':
+			m->S = set[i].v;
+			break;
+		case 'R':
+			m->R = set[i].v;
+			break;
+		default:
+			st_fram(m, set[i].addr, set[i].v);
+			break;
+		}
+	}
+	/* Целые регистры перечитать из тритов */
+	m->native_state = NATIVE_NONE;
+}
 
+/* Троичное число символами '-', '0', '+' */
+void fprint_symtrs(FILE *f, trs_t t)
+{
+	for (int8_t i = t.l - 1; i >= 0; i--)
+	{
+		fputc(numb2symtrs(get_trit(t, i)), f);
+	}
+}
 
-/** -------------------------------
- *  
- *  -------------------------------
+/**
+ * Записать результаты вариантов: CSV или двоичный файл.
+ * Двоичный файл (порядок байт хоста): "SETUNSW1", uint32 число ячеек,
+ * int32 адреса ячеек; на вариант: int32 номер, int32 статус,
+ * uint64 команд, int32 C, S, R, int32 значения ячеек.
  */
-int Process_Work_Emulation(void)
-{	
-	int test = 0;
-	int convert = 0;
-	int dump = 0;
-	char *output = "-";
-	int ret = 0;	
+int sweep_write(const char *path, uint8_t binary, setun_job_t *jobs, int count,
+				const trs_t *cells, int cells_count)
+{
+	FILE *f = fopen(path, binary ? "wb" : "w");
 
-	/* ------------------------------
-	*  Переменные emulator Setun-1958
-	*/
-	uint8_t cmd[20] = {0};
-	uint8_t ret_exec = 0;
-	static uint32_t counter_step = 0;
-	
-	LOGGING = 0; /* Вывод отладочной информации  */
+	if (f == NULL)
+	{
+		printf("ERR fopen %s\r\n", path);
+		return 1;
+	}
 
-	/* Состояние после включения питания */
-	if( emu_stat == NOREADY_EMU_ST ) {		
-		
-		Emu_Open_Files();
+	if (binary)
+	{
+		uint32_t n = cells_count;
+
+		fwrite(SWEEP_BIN_MAGIC, 1, 8, f);
+		fwrite(&n, sizeof(n), 1, f);
+		for (int k = 0; k < cells_count; k++)
+		{
+			int32_t a = trs2digit(cells[k]);
+			fwrite(&a, sizeof(a), 1, f);
+		}
+		for (int i = 0; i < count; i++)
+		{
+			int32_t rec[2] = {i, jobs[i].ret};
+			uint64_t done = jobs[i].done;
+			int32_t reg[3] = {trs2digit(jobs[i].C), trs2digit(jobs[i].S), trs2digit(jobs[i].R)};
+
+			fwrite(rec, sizeof(int32_t), 2, f);
+			fwrite(&done, sizeof(done), 1, f);
+			fwrite(reg, sizeof(int32_t), 3, f);
+			fwrite(jobs[i].cell_val, sizeof(int32_t), cells_count, f);
+		}
+	}
+	else
+	{
+		fprintf(f, "variant,status,instr,C,S,R");
+		for (int k = 0; k < cells_count; k++)
+		{
+			fputc(',', f);
+			fprint_symtrs(f, cells[k]);
+		}
+		fputc('\n', f);
+		for (int i = 0; i < count; i++)
+		{
+			fprintf(f, "%i,%i,%llu,%li,%li,%li", i, jobs[i].ret, (unsigned long long)jobs[i].done,
+					(long int)trs2digit(jobs[i].C), (long int)trs2digit(jobs[i].S),
+					(long int)trs2digit(jobs[i].R));
+			for (int k = 0; k < cells_count; k++)
+			{
+				fprintf(f, ",%li", (long int)jobs[i].cell_val[k]);
+			}
+			fputc('\n', f);
+		}
+	}
 
-		/* Инициализация таблиц символов ввода и вывода "Сетунь-1958" */
-		init_tab4();
+	if (fclose(f) != 0)
+	{
+		printf("ERR write %s\r\n", path);
+		return 1;
+	}
+	return 0;
+}
 
-		/* Сброс виртуальной машины "Сетунь-1958" */
-		reset_setun_1958();
-		
-		/* Новое состоняие */
-		emu_stat = WAIT_EMU_ST;
+/* Освободить задания перебора */
+void sweep_free(setun_job_t *jobs, int count)
+{
+	if (jobs == NULL)
+	{
+		return;
+	}
+	for (int i = 0; i < count; i++)
+	{
+		free((void *)jobs[i].set);
+		free(jobs[i].cell_val);
 	}
+	free(jobs);
+}
 
-	if( emu_stat == BEGIN_EMU_ST ) {	
-		/* Начальный старт */
-		Emu_Begin();
+/**
+ * Подготовить задания перебора: по одному на строку файла вариантов,
+ * cells - адреса ячеек FRAM через запятую.
+ * Возврат: число заданий, -1 - ошибка
+ */
+int sweep_jobs(const setun_machine_t *base, const char *path_variants, const char *cells_list,
+			   uint64_t steps, double seconds, setun_job_t **jobs_out, trs_t *cells, int *cells_count)
+{
+	setun_job_t *jobs = NULL;
+	sweep_set_t set[SWEEP_SET_MAX];
+	char *line = NULL;
+	size_t size = 0;
+	int count = 0;
+	int nline = 0;
+	int ncells = 0;
+	int err = 0;
+	FILE *f;
+
+	/* Ячейки FRAM результата */
+	if (cells_list != NULL)
+	{
+		char buf[SWEEP_CELLS_MAX * 6 + 1];
+		char *save = NULL;
 
-		/* Новое состоняие */
-		emu_stat = LOOP_WORK_EMU_ST;
+		snprintf(buf, sizeof(buf), "%s", cells_list);
+		for (char *tok = strtok_r(buf, ", ", &save); tok != NULL; tok = strtok_r(NULL, ", ", &save))
+		{
+			if (!is_symtrs(tok) || (strlen(tok) != 5) || (ncells >= SWEEP_CELLS_MAX))
+			{
+				printf("ERR cell '%s'\r\n", tok);
+				return -1;
+			}
+			cells[ncells++] = smtr((uint8_t *)tok);
+		}
 	}
+	*cells_count = ncells;
 
-	
-	if( emu_stat == STEP_EMU_ST ) {		
-		ret_exec = Emu_Step();
-		
-		if ((ret_exec == STOP))
+	f = fopen(path_variants, "r");
+	if (f == NULL)
+	{
+		printf("ERR fopen %s\r\n", path_variants);
+		return -1;
+	}
+	while (getline(&line, &size, f) > 0)
+	{
+		char *p = line;
+		int n;
+
+		nline++;
+		while ((*p == ' ') || (*p == '\t'))
 		{
-			printf("\r\n<STOP>\r\n");
-			emu_stat = STOP_EMU_ST;
-			//break;
+			p++;
 		}
-		else if (ret_exec == STOP_OVER)
+		if ((*p == '#') || (*p == '\r') || (*p == '\n') || (*p == '\0'))
 		{
-			printf("\r\n<STOP_OVER>\r\n");			
-			emu_stat = STOP_EMU_ST;
-			//break;
+			continue;
 		}
-		else if (ret_exec == STOP_ERROR)
+		n = sweep_parse(p, set, SWEEP_SET_MAX);
+		if (n < 0)
 		{
-			printf("\r\nERR#:%i<STOP_ERROR>\r\n", ret_exec);			
-			emu_stat = ERROR_EMU_ST;
-			//break;
+			printf("ERR %s:%i: bad variant\r\n", path_variants, nline);
+			err = 1;
+			break;
 		}
-		else if (ret_exec == STOP_ERROR_MB_NUMBER)
+
+		setun_job_t *tmp = realloc(jobs, (count + 1) * sizeof(setun_job_t));
+		if (tmp == NULL)
 		{
-			printf("\r\nERR#:%i<STOP_ERROR_MB_NUMBER>\r\n", ret_exec);
-			cli_ascii();
-			emu_stat = ERROR_MB_NUMBER_EMU_ST;
-			//break;
+			err = 1;
+			break;
 		}
+		jobs = tmp;
+		sweep_set_t *copy = malloc((n + 1) * sizeof(sweep_set_t));
+		int32_t *val = calloc(ncells + 1, sizeof(int32_t));
+		if ((copy == NULL) || (val == NULL))
+		{
+			free(copy);
+			free(val);
+			err = 1;
+			break;
+		}
+		memcpy(copy, set, n * sizeof(sweep_set_t));
+		memset(&jobs[count], 0, sizeof(setun_job_t));
+		jobs[count].path_tape = path_variants;
+		jobs[count].base = base;
+		jobs[count].set = copy;
+		jobs[count].set_count = n;
+		jobs[count].cells = cells;
+		jobs[count].cells_count = ncells;
+		jobs[count].cell_val = val;
+		jobs[count].steps = steps;
+		jobs[count].seconds = seconds;
+		count++;
+	}
+	free(line);
+	fclose(f);
+
+	if (err)
+	{
+		sweep_free(jobs, count);
+		return -1;
+	}
+	*jobs_out = jobs;
+	return count;
+}
 
-		/**/
-		counter_step++;		
+/**
+ * Пакетный режим перебора вариантов на копиях машины base
+ * с загруженной программой.
+ */
+int Emu_Batch_Sweep(const setun_machine_t *base, const char *path_variants, const char *path_result,
+					uint8_t binary, const char *cells_list, int threads, uint8_t sched,
+					uint64_t steps, double seconds)
+{
+	setun_job_t *jobs = NULL;
+	trs_t cells[SWEEP_CELLS_MAX];
+	int cells_count = 0;
+	int count;
+	int code = BATCH_EXIT_STOP;
+	uint64_t total = 0;
+	double t;
+
+	count = sweep_jobs(base, path_variants, cells_list, steps, seconds, &jobs, cells, &cells_count);
+	if (count < 0)
+	{
+		return BATCH_EXIT_USAGE;
+	}
 
-		if (STEP == counter_step)
+	t = time_monotonic();
+	run_jobs(jobs, count, threads, sched);
+	t = time_monotonic() - t;
+
+	for (int i = 0; i < count; i++)
+	{
+		total += jobs[i].done;
+		if (batch_exit_code(jobs[i].ret) > code)
 		{
-				//break; // STEP break
+			code = batch_exit_code(jobs[i].ret);
 		}
+	}
+	printf("[ Sweep: %i variants, threads %i, %llu instr, %.3f s, %.0f instr/s ]\r\n",
+		   count, (threads > 0) ? threads : host_cores(), (unsigned long long)total, t,
+		   (t > 0) ? total / t : 0);
 
-		//viv- old code
-		//if (BREAKPOINT == trs2digit(C_cur) && (BREAKPOINT != INT32_MAX))
-		//{
-		//	//break; // BREAKPOINT break
-		//}	
-		
-		view_short_regs();
+	if ((path_result != NULL) && (sweep_write(path_result, binary, jobs, count, cells, cells_count) != 0))
+	{
+		code = BATCH_EXIT_USAGE;
+	}
+	sweep_free(jobs, count);
 
-		/* Новое состояние */
-		emu_stat = WAIT_EMU_ST;
+	return code;
+}
+
+/** ------------------------------------------------------------
+ *  Сервер заданий на fork()
+ *  ------------------------------------------------------------
+ *  Родительский процесс один раз готовит таблицы и загружает
+ *  программу в базовую машину, затем принимает соединения на
+ *  локальном сокете. На каждую строку запроса (замены в формате
+ *  перебора вариантов) порождается процесс с копией памяти
+ *  родителя при записи, он выполняет задание и отвечает строкой:
+ *
+ *    <статус> <команд> <C> <S> <R>
+ *
+ *  или "ERR" при ошибке в строке запроса.
+ */
+/* Останов серверов по SIGINT или SIGTERM */
+static volatile sig_atomic_t server_stop = 0;
+
+static void server_signal(int sig)
+{
+	(void)sig;
+	server_stop = 1;
+}
+
+/* Выполнить задание в порождённом процессе и ответить в сокет fd */
+static void fork_server_job(setun_machine_t *base, int fd, const sweep_set_t *set, int count,
+							uint64_t steps, double seconds)
+{
+	setun_job_t job;
+	char reply[128];
+	long pos1 = tape_tell(&base->ft1, base->ptr1);
+	long pos2 = tape_tell(&base->ft2, base->ptr2);
+	int len;
+
+	/*
+	 * Описатели файлов общие с родителем: свои файлы устройств,
+	 * унаследованные не закрываются, чтобы не сдвинуть позицию чтения
+	 */
+	base->tty_echo = NULL;
+	base->ptr1 = fopen((base->ptr1 != NULL) ? base->path_ptr1 : "/dev/null", "r");
+	base->ptr2 = fopen((base->ptr2 != NULL) ? base->path_ptr2 : "/dev/null", "r");
+	base->ptp1 = fopen("/dev/null", "w");
+	base->tty1 = fopen("/dev/null", "w");
+	if ((base->ptr1 == NULL) || (base->ptr2 == NULL) || (base->ptp1 == NULL) || (base->tty1 == NULL))
+	{
+		len = snprintf(reply, sizeof(reply), "ERR\n");
+		write(fd, reply, len);
+		return;
 	}
-	
-	if( emu_stat == PAUSE_EMU_ST ) {		
-		emu_stat = WAIT_EMU_ST;
+	/* Отображение ленты родителя остаётся в памяти процесса */
+	tape_open(&base->ft1, base->ptr1);
+	tape_open(&base->ft2, base->ptr2);
+	tape_seek(&base->ft1, base->ptr1, pos1);
+	tape_seek(&base->ft2, base->ptr2, pos2);
+	sweep_apply(base, set, count);
+
+	memset(&job, 0, sizeof(job));
+	job.m = base;
+	job.steps = steps;
+	job.seconds = seconds;
+	job_run_slice(&job, 0);
+	native_sync(base);
+
+	len = snprintf(reply, sizeof(reply), "%i %llu %li %li %li\n", job.ret, (unsigned long long)job.done,
+				   (long int)trs2digit(base->C), (long int)trs2digit(base->S), (long int)trs2digit(base->R));
+	write(fd, reply, len);
+}
+
+/* Обслужить соединение: задания по строкам запроса */
+static void fork_server_conn(setun_machine_t *base, int fd, uint64_t steps, double seconds)
+{
+	sweep_set_t set[SWEEP_SET_MAX];
+	FILE *in = fdopen(dup(fd), "r");
+	char *line = NULL;
+	size_t size = 0;
+
+	if (in == NULL)
+	{
+		return;
 	}
-	
-	/* Состояние готов к работе */
-	if( emu_stat == LOOP_WORK_EMU_ST ) {
-		
-		ret_exec = Emu_Step();
-		
-		if ((ret_exec == STOP))
-		{
-			printf("\r\n<STOP>\r\n");
-			emu_stat = STOP_EMU_ST;
-			//break;
-		}
-		else if (ret_exec == STOP_OVER)
+	while (getline(&line, &size, in) > 0)
+	{
+		int count = sweep_parse(line, set, SWEEP_SET_MAX);
+		pid_t pid;
+
+		if (count < 0)
 		{
-			printf("\r\n<STOP_OVER>\r\n");			
-			emu_stat = STOP_EMU_ST;
-			//break;
+			write(fd, "ERR\n", 4);
+			continue;
 		}
-		else if (ret_exec == STOP_ERROR)
+		pid = fork();
+		if (pid == 0)
 		{
-			printf("\r\nERR#:%i<STOP_ERROR>\r\n", ret_exec);			
-			emu_stat = ERROR_EMU_ST;
-			//break;
+			fork_server_job(base, fd, set, count, steps, seconds);
+			_exit(0);
 		}
-		else if (ret_exec == STOP_ERROR_MB_NUMBER)
+		if (pid < 0)
 		{
-			printf("\r\nERR#:%i<STOP_ERROR_MB_NUMBER>\r\n", ret_exec);
-			cli_ascii();
-			emu_stat = ERROR_MB_NUMBER_EMU_ST;
-			//break;
+			write(fd, "ERR\n", 4);
+			continue;
 		}
+		waitpid(pid, NULL, 0);
+	}
+	free(line);
+	fclose(in);
+}
 
-		/**/
-		counter_step++;		
+/**
+ * Сервер заданий на сокете path_sock для машины base с загруженной
+ * программой. Работает до SIGINT или SIGTERM.
+ */
+int Emu_Fork_Server(setun_machine_t *base, const char *path_sock, uint64_t steps, double seconds)
+{
+	struct sockaddr_un addr;
+	struct sigaction sa;
+	int fd;
 
-		if (STEP == counter_step)
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		printf("ERR socket\r\n");
+		return BATCH_EXIT_USAGE;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path_sock);
+	unlink(path_sock);
+	if ((bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) || (listen(fd, 64) != 0))
+	{
+		printf("ERR bind %s\r\n", path_sock);
+		close(fd);
+		return BATCH_EXIT_USAGE;
+	}
+
+	/* accept() прерывается сигналом останова, процессы соединений не ждём */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = server_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGCHLD, SIG_IGN);
+
+	/* Буферы stdout не должны попасть в вывод процессов заданий */
+	fflush(NULL);
+	printf("[ Fork server: %s ]\r\n", path_sock);
+	fflush(stdout);
+
+	while (!server_stop)
+	{
+		int conn = accept(fd, NULL, NULL);
+		pid_t pid;
+
+		if (conn < 0)
 		{
-				//break; // STEP break
+			continue;
 		}
+		pid = fork();
+		if (pid == 0)
+		{
+			close(fd);
+			signal(SIGCHLD, SIG_DFL);
+			fork_server_conn(base, conn, steps, seconds);
+			close(conn);
+			_exit(0);
+		}
+		close(conn);
+	}
 
-		//viv- old code
-		//if (BREAKPOINT == trs2digit(C_cur) && (BREAKPOINT != INT32_MAX))
-		//{
-		//	//break; // BREAKPOINT break
-		//}	
-	}	
-	
-	/* Состояние  */
-	if( emu_stat == STOP_EMU_ST ) {
-		emu_stat = CLI_WELCOM_EMU_ST;
-	} /* if(...) */		
-		
-	/* Состояние  */
-	if( emu_stat == ERROR_EMU_ST ) {
-		emu_stat = CLI_WELCOM_EMU_ST;
-	} /* if(...) */		
-	
-	/* Состояние  */
-	if( emu_stat == ERROR_MB_NUMBER_EMU_ST ) {
-		emu_stat = CLI_WELCOM_EMU_ST;
-	} /* if(...) */
+	close(fd);
+	unlink(path_sock);
+	signal(SIGCHLD, SIG_DFL);
 
-	/* Состояние  */
-	if( emu_stat == CLI_WELCOM_EMU_ST ) {
-		/* Prints REGS */
-		view_short_regs();
-		printf("\r\n");		
-		//
-		cli_ascii();
-		emu_stat = WAIT_EMU_ST;
-	} /* if(...) */
-	
+	return BATCH_EXIT_STOP;
+}
 
-	/* Состояние  */
-	if( emu_stat == WAIT_EMU_ST ) {
-		
-	} /* if(...) */
-		
-} /*  */
+/**
+ * Запрос серверу заданий: строка line, ответ в reply.
+ * fd - соединение, -1 - подключиться к path_sock.
+ * Возврат: соединение, -1 - ошибка
+ */
+int fork_client_request(int fd, const char *path_sock, const char *line, char *reply, size_t size)
+{
+	size_t n = 0;
 
+	if (fd < 0)
+	{
+		struct sockaddr_un addr;
 
-/** ------------------------------------------------------------------------
-*  Командный интепретатор виртуального пульта управления МЦВМ "Сетунь" 1958
-*/
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path_sock);
+		if ((fd < 0) || (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0))
+		{
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+			return -1;
+		}
+	}
+	if (write(fd, line, strlen(line)) != (ssize_t)strlen(line))
+	{
+		close(fd);
+		return -1;
+	}
+	/* Ответ - одна строка */
+	while (n + 1 < size)
+	{
+		ssize_t r = read(fd, reply + n, 1);
+		if (r <= 0)
+		{
+			close(fd);
+			return -1;
+		}
+		if (reply[n++] == '\n')
+		{
+			break;
+		}
+	}
+	reply[n] = '\0';
+	return fd;
+}
 
-/** --------------------------------------------------------
- *  CLI командный интерпретатор
+/** ------------------------------------------------------------
+ *  Служба заданий на локальном сокете
+ *  ------------------------------------------------------------
+ *  Протокол кадров описан в emusetun.h.
+ *
+ *  Задания всех соединений попадают в общую очередь пула потоков.
+ *  Малые задания (бюджет не больше DAEMON_SMALL_STEPS) поток берёт
+ *  пакетом до DAEMON_BATCH_MAX заданий за одно обращение к очереди.
+ *  Вывод передаётся после каждого кванта DAEMON_SLICE_STEPS команд
+ *  и при заполнении буфера DAEMON_STREAM_BUF.
  */
-#define ARRAY_SIZE(array) (sizeof(array) / sizeof(array[0]))
-//
-#define BUF_SIZE 81        /* размер буфера */
-static char buf[BUF_SIZE]; /* буфер для приема сообщений */
+#define DAEMON_SMALL_STEPS (100000)
+#define DAEMON_BATCH_MAX (16)
+#define DAEMON_SLICE_STEPS (100000)
+#define DAEMON_STREAM_BUF (4096)
 
-/* Разбор параметров команды с параметрами */
-char par1[80];
-char par2[80];
-char par3[80];
-char par4[80];
-
-/* Cтруктура, описывающая ascii-сообщение */
-typedef struct _ascii_message
+/* Соединение, освобождается последним заданием или читателем */
+typedef struct daemon_conn
 {
-    char *name_cmd;                        /* имя команды */
-    char (*parser)(char *buf, void *data); /* функция команды */
-    void *data;                            /* дополнительный параметры команды */
-} ascii_message_t;
+	int fd;
+	pthread_mutex_t lock; /* кадры разных заданий не перемешиваются */
+	_Atomic int refs;
+} daemon_conn_t;
 
-/* Cтруктура описывающая информацию в сообщении. */
-typedef struct _cmd_data
+typedef struct daemon_job
+{
+	daemon_conn_t *conn;
+	uint32_t id;
+	uint16_t flags;
+	uint64_t steps;
+	double seconds;
+	char *tape;
+	size_t tape_len;
+	struct daemon_job *next;
+} daemon_job_t;
+
+typedef struct daemon_queue
+{
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	daemon_job_t *head;
+	daemon_job_t *tail;
+	uint8_t stop;
+	uint64_t jobs;
+	uint64_t batches;
+} daemon_queue_t;
+
+/* Поток вывода задания в кадры DAEMON_TTY или DAEMON_PTP */
+typedef struct daemon_stream
 {
-    int count; /* счетчик парметров */
-    char *par2;
-    char *par3;
-    char *par4;
-} cmd_data_t;
+	daemon_conn_t *conn;
+	uint32_t id;
+	uint16_t type;
+} daemon_stream_t;
 
-cmd_data_t cmd_data;
+static daemon_queue_t daemon_queue = {.lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
 
-//
-void Emu_Begin(void);
-int Emu_Step(void);
-void Emu_Stop(void); 
+/* Записать/прочитать ровно size байт, 0 - успешно */
+static int fd_write_all(int fd, const void *buf, size_t size)
+{
+	const char *p = buf;
 
-static char dump_cmd(char *buf, void *data);
-static char load_cmd(char *buf, void *data);
-static char debug_cmd(char *buf, void *data);
-static char test_cmd(char *buf, void *data);
-static char begin_cmd(char *buf, void *data);
-static char pause_cmd(char *buf, void *data);
-static char run_cmd(char *buf, void *data);
-static char step_cmd(char *buf, void *data);
-static char break_cmd(char *buf, void *data);
-static char reg_cmd(char *buf, void *data);
-static char view_cmd(char *buf, void *data);
-static char fram_cmd(char *buf, void *data);
-static char drum_cmd(char *buf, void *data);
-static char help_cmd(char *buf, void *data);
-static char quit_cmd(char *buf, void *data);
+	while (size > 0)
+	{
+		ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return 1;
+		}
+		p += n;
+		size -= n;
+	}
+	return 0;
+}
 
-/*
- * Массив команд CLI
- */
-ascii_message_t command[] =
-    {        
-		{.name_cmd = "dump",
-         .parser = dump_cmd,
-         .data = &cmd_data},
-		//
-		{.name_cmd = "load",
-         .parser = load_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "l",
-         .parser = load_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "debug",
-         .parser = debug_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "d",
-         .parser = debug_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "test",
-         .parser = test_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "t",
-         .parser = test_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "begin",
-         .parser = begin_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "b",
-         .parser = begin_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "pause",
-         .parser = pause_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "p",
-         .parser = pause_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "run",
-         .parser = run_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "r",
-         .parser = run_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "step",
-         .parser = step_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "s",
-         .parser = step_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "break",
-         .parser = break_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "br",
-         .parser = break_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "reg",
-         .parser = reg_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "rg",
-         .parser = reg_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "view",
-         .parser = view_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "v",
-         .parser = view_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "fram",
-         .parser = fram_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "fr",
-         .parser = fram_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "drum",
-         .parser = drum_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "dr",
-         .parser = drum_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "help",
-         .parser = help_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "h",
-         .parser = help_cmd,
-         .data = &cmd_data},
-        //
-        {.name_cmd = "quit",
-         .parser = quit_cmd,
-         .data = &cmd_data},
-        {.name_cmd = "q",
-         .parser = quit_cmd,
-         .data = &cmd_data}};
+static int fd_read_all(int fd, void *buf, size_t size)
+{
+	char *p = buf;
 
-/* Func nmea_next_field */
-char *ascii_next_field(char *buf)
+	while (size > 0)
+	{
+		ssize_t n = read(fd, p, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return 1;
+		p += n;
+		size -= n;
+	}
+	return 0;
+}
+
+/* Отправить кадр из двух частей данных, 0 - успешно */
+int daemon_send(int fd, uint16_t type, uint16_t flags, uint32_t id,
+				const void *a, size_t alen, const void *b, size_t blen)
 {
-    /* Eсли следующее поле не найдено, то она возвращает NULL */
-    while (*buf++ != ',')
-    {
-        if (*buf == '\0')
-        {
-            return NULL;
-        }
-    }
-    return buf;
+	daemon_hdr_t h = {DAEMON_MAGIC, type, flags, id, (uint32_t)(alen + blen)};
+
+	if (fd_write_all(fd, &h, sizeof(h)) != 0)
+		return 1;
+	if ((alen > 0) && (fd_write_all(fd, a, alen) != 0))
+		return 1;
+	if ((blen > 0) && (fd_write_all(fd, b, blen) != 0))
+		return 1;
+	return 0;
 }
 
-/* Func 'cli_ascii' */
-void cli_ascii(void)
+/**
+ * Принять кадр: данные в *buf (malloc, освобождает вызывающий).
+ * Возврат: 0 - успешно, 1 - конец соединения или ошибка кадра
+ */
+int daemon_recv(int fd, daemon_hdr_t *h, char **buf)
 {
-    puts("");
-    printf("setun1958emu:\r\n");
+	*buf = NULL;
+	if ((fd_read_all(fd, h, sizeof(*h)) != 0) || (h->magic != DAEMON_MAGIC) ||
+		(h->len > DAEMON_FRAME_MAX))
+	{
+		return 1;
+	}
+	*buf = malloc(h->len + 1);
+	if ((*buf == NULL) || ((h->len > 0) && (fd_read_all(fd, *buf, h->len) != 0)))
+	{
+		free(*buf);
+		*buf = NULL;
+		return 1;
+	}
+	return 0;
 }
 
-/* Func 'exit_cmd' */
-char exit_cmd(char *buf, void *data)
+static void daemon_conn_send(daemon_conn_t *c, uint16_t type, uint32_t id,
+							 const void *a, size_t alen, const void *b, size_t blen)
 {
-    cmd_data_t *msg = (cmd_data_t *)data;
+	pthread_mutex_lock(&c->lock);
+	daemon_send(c->fd, type, 0, id, a, alen, b, blen);
+	pthread_mutex_unlock(&c->lock);
+}
 
-    printf("dbg: exit_cmd() \r\n");
+static void daemon_conn_put(daemon_conn_t *c)
+{
+	if (atomic_fetch_sub(&c->refs, 1) == 1)
+	{
+		close(c->fd);
+		pthread_mutex_destroy(&c->lock);
+		free(c);
+	}
+}
 
-    exit(0);
+static ssize_t daemon_stream_write(void *cookie, const char *buf, size_t size)
+{
+	daemon_stream_t *st = cookie;
 
-    return 0;
+	daemon_conn_send(st->conn, st->type, st->id, buf, size, NULL, 0);
+	return size;
 }
 
-/* Вывод списка команд виртуальной панели управления */
-void help_print(void)
+static int daemon_stream_close(void *cookie)
 {
-    printf("Commands control for setun1958emu:\r\n");
-	printf(" [dump]       [arglist]\r\n");
-	printf(" [load]  [l]  [arglist]\r\n");
-    printf(" [debug] [d]  [arglist]\r\n");
-	printf(" [test]  [t]  [arglist]\r\n");
-    printf(" [view]  [v]\r\n");
-    printf(" [begin] [b]\r\n");
-    printf(" [pause] [p]\r\n");
-    printf(" [run]   [r]\r\n");
-    printf(" [step]  [s]  [arglist] \r\n");
-    printf(" [break] [br] [arglist]\r\n");
-    printf(" [reg]   [rg] [arglist]\r\n");
-    printf(" [fram]  [fr] [arglist]\r\n");
-    printf(" [drum]  [dr] [arglist]\r\n");
-    printf(" [help]  [h]\r\n");
-    printf(" [quit]  [q]\r\n");
+	free(cookie);
+	return 0;
 }
 
-/** -------------------------------
- *   Реализация команд
- */
- 
-/* Func 'dump_cmd' */
-char dump_cmd(char *buf, void *data)
+/* Файл устройства вывода: кадры type клиенту или /dev/null */
+static FILE *daemon_stream_open(daemon_job_t *dj, uint16_t type, uint16_t want)
 {
-    cmd_data_t *pars = (cmd_data_t *)data;
+	cookie_io_functions_t io = {NULL, daemon_stream_write, NULL, daemon_stream_close};
+	daemon_stream_t *st;
+	FILE *f;
 
-    if (pars->count > 1)
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
+	if ((dj->flags & want) == 0)
+	{
+		return fopen("/dev/null", "w");
+	}
+	st = malloc(sizeof(daemon_stream_t));
+	if (st == NULL)
+	{
+		return NULL;
+	}
+	st->conn = dj->conn;
+	st->id = dj->id;
+	st->type = type;
+	f = fopencookie(st, "w", io);
+	if (f == NULL)
+	{
+		free(st);
+		return NULL;
+	}
+	setvbuf(f, NULL, _IOFBF, DAEMON_STREAM_BUF);
+	return f;
+}
 
-	/* Проверить путь к каталогам,  файл списка lst */
-	if (DumpFileTxs(pars->par2) != 0)
+/* Выполнить задание службы и ответить DAEMON_DONE */
+static void daemon_run(daemon_job_t *dj)
+{
+	setun_machine_t *m = malloc(sizeof(setun_machine_t));
+	setun_job_t job;
+	daemon_done_t d;
+
+	if (m != NULL)
 	{
-		printf("no path file\r\n");
+		init_setun_machine(m);
+		m->tty_echo = NULL;
+		m->ptr1 = (dj->tape_len > 0) ? fmemopen(dj->tape, dj->tape_len, "r") : fopen("/dev/null", "r");
+		m->ptr2 = fopen("/dev/null", "r");
+		tape_open_mem(&m->ft1, dj->tape, dj->tape_len);
+		m->tty1 = daemon_stream_open(dj, DAEMON_TTY, DAEMON_OUT_TTY);
+		m->ptp1 = daemon_stream_open(dj, DAEMON_PTP, DAEMON_OUT_PTP);
+		ptp_begin(m);
+	}
+	if ((m == NULL) || (m->ptr1 == NULL) || (m->ptr2 == NULL) || (m->tty1 == NULL) || (m->ptp1 == NULL))
+	{
+		if (m != NULL)
+		{
+			Emu_Close_Files(m);
+		}
+		daemon_conn_send(dj->conn, DAEMON_ERR, dj->id, NULL, 0, NULL, 0);
 	}
-    
-	return 0; /* OK' */
+	else
+	{
+		Begin_Read_Commands_from_FT1(m, m->ptr1);
+		m->C = smtr("0000+");
+
+		memset(&job, 0, sizeof(job));
+		job.m = m;
+		job.steps = dj->steps;
+		job.seconds = dj->seconds;
+		while (!job_run_slice(&job, DAEMON_SLICE_STEPS))
+		{
+			tty_flush(m);
+			fflush(m->tty1);
+			fflush(m->ptp1);
+		}
+		native_sync(m);
+		d.ret = job.ret;
+		d.C = trs2digit(m->C);
+		d.S = trs2digit(m->S);
+		d.R = trs2digit(m->R);
+		d.done = job.done;
+
+		/* Остаток вывода до DAEMON_DONE */
+		Emu_Close_Files(m);
+		daemon_conn_send(dj->conn, DAEMON_DONE, dj->id, &d, sizeof(d), NULL, 0);
+	}
+	free(m);
+	daemon_conn_put(dj->conn);
+	free(dj->tape);
+	free(dj);
+}
+
+/* Поток пула службы: задание или пакет малых заданий из очереди */
+static void *daemon_worker(void *arg)
+{
+	daemon_queue_t *q = arg;
+
+	while (1)
+	{
+		daemon_job_t *batch;
+		daemon_job_t *last;
+		int n = 1;
+
+		pthread_mutex_lock(&q->lock);
+		while ((q->head == NULL) && !q->stop)
+		{
+			pthread_cond_wait(&q->cond, &q->lock);
+		}
+		if (q->head == NULL)
+		{
+			pthread_mutex_unlock(&q->lock);
+			break;
+		}
+		batch = q->head;
+		last = batch;
+		while ((n < DAEMON_BATCH_MAX) && (last->next != NULL) &&
+			   (last->steps > 0) && (last->steps <= DAEMON_SMALL_STEPS) &&
+			   (last->next->steps > 0) && (last->next->steps <= DAEMON_SMALL_STEPS))
+		{
+			last = last->next;
+			n++;
+		}
+		q->head = last->next;
+		if (q->head == NULL)
+		{
+			q->tail = NULL;
+		}
+		last->next = NULL;
+		q->jobs += n;
+		q->batches++;
+		pthread_mutex_unlock(&q->lock);
+
+		while (batch != NULL)
+		{
+			daemon_job_t *next = batch->next;
+			daemon_run(batch);
+			batch = next;
+		}
+	}
+	return NULL;
 }
 
-
-/* Func 'load_cmd' */
-char load_cmd(char *buf, void *data)
+/* Поток чтения кадров соединения */
+static void *daemon_reader(void *arg)
 {
-    cmd_data_t *pars = (cmd_data_t *)data;
-
-    if (pars->count > 2)
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
+	daemon_conn_t *c = arg;
+	daemon_queue_t *q = &daemon_queue;
+	daemon_hdr_t h;
+	char *buf;
 
-	/* Проверить путь к каталогам,  файл списка lst */
-	if (ConvertSWtoPaper(pars->par2, pars->par3) != 0)
+	while (daemon_recv(c->fd, &h, &buf) == 0)
 	{
-		printf("no path file\r\n");
+		daemon_job_t *dj;
+		daemon_job_req_t req;
+
+		if ((h.type != DAEMON_JOB) || (h.len < sizeof(req)) ||
+			((dj = calloc(1, sizeof(daemon_job_t))) == NULL))
+		{
+			daemon_conn_send(c, DAEMON_ERR, h.id, NULL, 0, NULL, 0);
+			free(buf);
+			continue;
+		}
+		memcpy(&req, buf, sizeof(req));
+		dj->conn = c;
+		dj->id = h.id;
+		dj->flags = h.flags;
+		dj->steps = req.steps;
+		dj->seconds = req.ms / 1000.0;
+		dj->tape_len = h.len - sizeof(req);
+		dj->tape = buf;
+		memmove(buf, buf + sizeof(req), dj->tape_len);
+		atomic_fetch_add(&c->refs, 1);
+
+		pthread_mutex_lock(&q->lock);
+		if (q->tail != NULL)
+		{
+			q->tail->next = dj;
+		}
+		else
+		{
+			q->head = dj;
+		}
+		q->tail = dj;
+		pthread_cond_signal(&q->cond);
+		pthread_mutex_unlock(&q->lock);
 	}
-    
-	return 0; /* OK' */
+	daemon_conn_put(c);
+	return NULL;
 }
 
-/* Func 'debug_cmd' */
-char debug_cmd(char *buf, void *data)
+/**
+ * Поток службы без SIGINT и SIGTERM: сигнал останова приходит главному
+ * потоку и прерывает accept()
+ */
+static int daemon_thread_create(pthread_t *tid, void *(*fn)(void *), void *arg)
 {
-    printf("TODO: debug_cmd() \r\n");
-
-    cmd_data_t *pars = (cmd_data_t *)data;
-
-    if (pars->count > 1)
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
-
-    return 0; /* OK' */
+	sigset_t set, old;
+	int ret;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGINT);
+	sigaddset(&set, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &set, &old);
+	ret = pthread_create(tid, NULL, fn, arg);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	return ret;
 }
 
-/* Func 'test_cmd' */
-char test_cmd(char *buf, void *data)
+/**
+ * Служба заданий на сокете path_sock, threads потоков (0 - по числу
+ * процессоров). Работает до SIGINT или SIGTERM.
+ */
+int Emu_Daemon(const char *path_sock, int threads)
 {
-    cmd_data_t *pars = (cmd_data_t *)data;
+	pthread_t tid[JOB_THREADS_MAX];
+	daemon_queue_t *q = &daemon_queue;
+	struct sockaddr_un addr;
+	struct sigaction sa;
+	int started = 0;
+	int fd;
+
+	if (threads <= 0)
+	{
+		threads = host_cores();
+	}
+	if (threads > JOB_THREADS_MAX)
+	{
+		threads = JOB_THREADS_MAX;
+	}
 
-    if ( (pars->count < 1) || (pars->count > 1) )
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		printf("ERR socket\r\n");
+		return BATCH_EXIT_USAGE;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path_sock);
+	unlink(path_sock);
+	if ((bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) || (listen(fd, 64) != 0))
+	{
+		printf("ERR bind %s\r\n", path_sock);
+		close(fd);
+		return BATCH_EXIT_USAGE;
+	}
 
-	int test_numb = 0;
-	sscanf(pars->par2,"%i", &test_numb);
+	/* Общие таблицы до запуска потоков */
+	init_tables();
 
-	switch(test_numb) {
-		case 1:
-			Test1_Ariphmetic_Ternary();
-			break;
-		case 2:
-			Test2_Opers_TRITS_32();		
-			break;
-		case 3:
-			Test3_Setun_Opers();
-			break;
-		case 4:
-			Test4_Setun_Opers();
-			break;
-		case 5:
-			Test5_Setun_Load();
-			break;
-		case 6:
-			Test6_Setun_Load();
-			break;
-		case 7:
-			Test7_Setun_Load();
-			break;
-		case 8:
-			Test8_Setun_Electrified_Typewriter();
-			break;
-		case 9:
-			Test9_Perforatin_Paper_Line();
+	q->stop = 0;
+	for (int i = 0; i < threads; i++)
+	{
+		if (daemon_thread_create(&tid[i], daemon_worker, q) != 0)
+		{
 			break;
-		case 10:
-			Test10_LoadSWSetun();			
-			break;			
-		default:
-	        /* Error */
-    	    printf("no test#%i\r\n",test_numb);
-        	return 2; /* ERR#2 */
-		break;
+		}
+		started++;
 	}
-    
-    return 0; /* OK' */
-}
 
-/* Func 'begin_cmd' */
-char begin_cmd(char *buf, void *data)
-{
-    cmd_data_t *pars = (cmd_data_t *)data;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = server_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
 
-    if (pars->count > 0)
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
-	
-	emu_stat = BEGIN_EMU_ST;
+	printf("[ Daemon: %s, threads %i ]\r\n", path_sock, started);
+	fflush(stdout);
 
-    return 0; /* OK' */
-}
+	while (!server_stop && (started > 0))
+	{
+		int conn = accept(fd, NULL, NULL);
+		daemon_conn_t *c;
+		pthread_t reader;
 
-/* Func 'pause_cmd' */
-char pause_cmd(char *buf, void *data)
-{
-    cmd_data_t *pars = (cmd_data_t *)data;
-    
-    if (pars->count > 0)
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
+		if (conn < 0)
+		{
+			continue;
+		}
+		c = malloc(sizeof(daemon_conn_t));
+		if (c == NULL)
+		{
+			close(conn);
+			continue;
+		}
+		c->fd = conn;
+		pthread_mutex_init(&c->lock, NULL);
+		atomic_store(&c->refs, 1);
+		if (daemon_thread_create(&reader, daemon_reader, c) != 0)
+		{
+			daemon_conn_put(c);
+			continue;
+		}
+		pthread_detach(reader);
+	}
 
-	/* Новое состояние пауза */
-	emu_stat = PAUSE_EMU_ST;	
+	/* Задания в очереди выполняются до конца */
+	pthread_mutex_lock(&q->lock);
+	q->stop = 1;
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+	for (int i = 0; i < started; i++)
+	{
+		pthread_join(tid[i], NULL);
+	}
+	close(fd);
+	unlink(path_sock);
 
-    return 0; /* OK' */
+	printf("[ Daemon: %llu jobs, %llu batches ]\r\n",
+		   (unsigned long long)q->jobs, (unsigned long long)q->batches);
+
+	return BATCH_EXIT_STOP;
 }
 
-/* Func 'run_cmd' */
-char run_cmd(char *buf, void *data)
+/* Подключиться к службе заданий, -1 - ошибка */
+int daemon_connect(const char *path_sock)
 {
-    cmd_data_t *pars = (cmd_data_t *)data;
+	struct sockaddr_un addr;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
 
-    if (pars->count > 0)
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
-
-	/* Новое состояние выполнять операцииы */
-	emu_stat = LOOP_WORK_EMU_ST;	
-
-    return 0; /* OK' */
+	if (fd < 0)
+	{
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path_sock);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
 }
 
-/* Func 'step_cmd' */
-char step_cmd(char *buf, void *data)
+/**
+ * Пакетный режим со списком перфолент: по одной на строку файла path_list.
+ * threads = 0 - замер на 1, 2, 4 и всех процессорах хоста.
+ */
+int Emu_Batch_Jobs(const char *path_list, const char *path_out, int threads,
+				   uint8_t sched, uint64_t steps, double seconds)
 {
-    cmd_data_t *pars = (cmd_data_t *)data;
-
-    if (pars->count > 1)
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
+	static const int sweep[] = {1, 2, 4, 0};
+	setun_job_t *jobs = NULL;
+	char line[256];
+	int count = 0;
+	int code = BATCH_EXIT_STOP;
+	FILE *f;
+
+	f = fopen(path_list, "r");
+	if (f == NULL)
+	{
+		printf("ERR fopen %s\r\n", path_list);
+		return BATCH_EXIT_USAGE;
+	}
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		char *p = strtok(line, "\r\n");
+		setun_job_t *nj;
 
-	if( emu_stat == WAIT_EMU_ST ) {
-		emu_stat = STEP_EMU_ST;	
+		if ((p == NULL) || (*p == '\0') || (*p == '#'))
+		{
+			continue;
+		}
+		nj = realloc(jobs, (count + 1) * sizeof(setun_job_t));
+		if (nj == NULL)
+		{
+			break;
+		}
+		jobs = nj;
+		memset(&jobs[count], 0, sizeof(setun_job_t));
+		jobs[count].path_tape = strdup(p);
+		if (path_out != NULL)
+		{
+			snprintf(line, sizeof(line), "%s/%04i", path_out, count);
+			jobs[count].path_out = strdup(line);
+		}
+		jobs[count].steps = steps;
+		jobs[count].seconds = seconds;
+		count++;
 	}
+	fclose(f);
 
-    return 0; /* OK' */
-}
+	for (int k = 0; k < 4; k++)
+	{
+		int n = (threads > 0) ? threads : (sweep[k] > 0) ? sweep[k] : host_cores();
+		uint64_t total = 0;
+		double t = time_monotonic();
 
-/* Func 'break_cmd' */
-char break_cmd(char *buf, void *data)
-{
-    cmd_data_t *pars = (cmd_data_t *)data;
+		run_jobs(jobs, count, n, sched);
+		t = time_monotonic() - t;
+		for (int i = 0; i < count; i++)
+		{
+			total += jobs[i].done;
+		}
+		printf("[ Jobs: %i, threads %i, %s, %llu instr, %.3f s, %.0f instr/s ]\r\n",
+			   count, n, (sched == JOB_SCHED_STEAL) ? "steal" : "shared",
+			   (unsigned long long)total, t, (t > 0) ? total / t : 0);
+		if (threads > 0)
+		{
+			break;
+		}
+	}
+	code = view_jobs(jobs, count);
+	view_tape_cache_stat();
 
-    if ((pars->count < 1) || (pars->count > 1))
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
+	for (int i = 0; i < count; i++)
+	{
+		free((char *)jobs[i].path_tape);
+		free((char *)jobs[i].path_out);
+	}
+	free(jobs);
 
-    return 0; /* OK' */
+	return code;
 }
 
-/* Func 'reg_cmd' */
-char reg_cmd(char *buf, void *data)
+/* Пакетный режим по параметрам командной строки */
+int Emu_Batch(int argc, char *argv[])
 {
-    cmd_data_t *pars = (cmd_data_t *)data;
-
-    if ((pars->count < 1) || (pars->count > 2))
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
-
-	int rg = toupper(pars->par2[0]);	
-	trs_t trs = smtr(pars->par3);
-	switch(rg) {
-		case 'K':
-			copy_trs(&trs,&K);
-			break;		
-		case 'F':
-			copy_trs(&trs,&F);
-			break;		
-		case 'C':
-			copy_trs(&trs,&C);
-			break;		
-		case 'W':
-			copy_trs(&trs,&W);
-			break;		
+	static struct option long_options[] = {
+		{"version", no_argument, 0, 'v'},
+		{"help", no_argument, 0, 'h'},
+		{"tape", required_argument, 0, 't'},
+		{"load", required_argument, 0, 'l'},
+		{"convert", required_argument, 0, 'c'},
+		{"drum", required_argument, 0, 'm'},
+		{"steps", required_argument, 0, 'n'},
+		{"seconds", required_argument, 0, 's'},
+		{"tty", required_argument, 0, 'o'},
+		{"ptp", required_argument, 0, 'p'},
+		{"ptp-bin", no_argument, 0, 'Q'},
+		{"io-thread", no_argument, 0, 'A'},
+		{"regs", required_argument, 0, 'r'},
+		{"native", no_argument, 0, 'N'},
+		{"idle", required_argument, 0, 'i'},
+		{"pace", required_argument, 0, 'P'},
+		{"jobs", required_argument, 0, 'j'},
+		{"threads", required_argument, 0, 'J'},
+		{"sched", required_argument, 0, 'S'},
+		{"out", required_argument, 0, 'O'},
+		{"sweep", required_argument, 0, 'w'},
+		{"cells", required_argument, 0, 'e'},
+		{"result", required_argument, 0, 'R'},
+		{"binary", no_argument, 0, 'B'},
+		{"fork-server", required_argument, 0, 'F'},
+		{"daemon", required_argument, 0, 'D'},
+		{"tape2bin", required_argument, 0, 'x'},
+		{"bin2tape", required_argument, 0, 'X'},
+		{"tape-index", required_argument, 0, 'I'},
+		{"zone", required_argument, 0, 'Z'},
+		{"tape-cache", required_argument, 0, 'K'},
+		{"dump", required_argument, 0, 'd'},
+		{"LOGGING", no_argument, 0, 'L'},
+		{"breakpoint", required_argument, 0, 'b'},
+		{"test", required_argument, 0, 'T'},
+		{0, 0, 0, 0}};
+
+	setun_machine_t *m = &setun;
+	char *path_lst = NULL;
+	char *path_drum = NULL;
+	char *path_regs = NULL;
+	char *path_jobs = NULL;
+	char *path_out = NULL;
+	char *path_sweep = NULL;
+	char *path_result = NULL;
+	char *cells = NULL;
+	char *path_sock = NULL;
+	char *path_daemon = NULL;
+	char *path_tape2bin = NULL;
+	char *path_bin2tape = NULL;
+	char *path_index = NULL;
+	long zone = -1; /* -1 - с начала ленты */
+	uint8_t tty_kind = DEV_MEM;
+	uint8_t ptp_kind = DEV_MEM;
+	uint8_t binary = 0;
+	int threads = 0;
+	uint8_t sched = JOB_SCHED_SHARED;
+	uint8_t convert_only = 0;
+	uint8_t native = 0;
+	uint64_t steps = 0;	/* 0 - без ограничения */
+	double seconds = 0; /* 0 - без ограничения */
+	uint64_t done = 0;
+	int ret = OK;
+	int opt;
+	double t_start, t_run, t_stop;
+	char io_stat[256];
+
+	t_start = time_monotonic();
+
+	/* Без оператора холостой цикл - останов */
+	IDLE_DETECT = IDLE_STOP;
+
+	init_tables();
+	init_setun_machine(m);
+
+	while ((opt = getopt_long(argc, argv, "vht:l:c:m:n:s:o:p:QAr:Ni:P:j:J:S:O:w:e:R:BF:D:x:X:I:Z:K:d:Lb:T:", long_options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+		case 'v':
+			version(argv[0]);
+			break;
+		case 't':
+			m->path_ptr1 = optarg;
+			break;
+		case 'c':
+			convert_only = 1;
+			/* FALLTHROUGH */
+		case 'l':
+			path_lst = optarg;
+			break;
+		case 'm':
+			path_drum = optarg;
+			break;
+		case 'n':
+			steps = strtoull(optarg, NULL, 10);
+			break;
+		case 's':
+			seconds = atof(optarg);
+			break;
+		case 'o':
+			tty_kind = dev_kind(optarg);
+			m->path_tty1 = optarg;
+			break;
+		case 'p':
+			ptp_kind = dev_kind(optarg);
+			m->path_ptp1 = optarg;
+			break;
+		case 'r':
+			path_regs = optarg;
+			break;
+		case 'N':
+			native = 1;
+			break;
+		case 'i':
+			if (strcmp(optarg, "off") == 0)
+				IDLE_DETECT = IDLE_OFF;
+			else if (strcmp(optarg, "stop") == 0)
+				IDLE_DETECT = IDLE_STOP;
+			else if (strcmp(optarg, "skip") == 0)
+				IDLE_DETECT = IDLE_SKIP;
+			else
+				return BATCH_EXIT_USAGE;
+			break;
+		case 'P':
+			PACE_OPS = (strcmp(optarg, "setun") == 0) ? PACE_SETUN_OPS : strtoul(optarg, NULL, 10);
+			break;
+		case 'j':
+			path_jobs = optarg;
+			break;
+		case 'J':
+			threads = atoi(optarg);
+			break;
 		case 'S':
-			copy_trs(&trs,&S);
-			break;		
+			if (strcmp(optarg, "shared") == 0)
+				sched = JOB_SCHED_SHARED;
+			else if (strcmp(optarg, "steal") == 0)
+				sched = JOB_SCHED_STEAL;
+			else
+				return BATCH_EXIT_USAGE;
+			break;
+		case 'O':
+			path_out = optarg;
+			break;
+		case 'w':
+			path_sweep = optarg;
+			break;
+		case 'e':
+			cells = optarg;
+			break;
 		case 'R':
-			copy_trs(&trs,&R);
-			break;		
-		case 'M':
-			copy_trs(&trs,&MB);
+			path_result = optarg;
+			break;
+		case 'B':
+			binary = 1;
+			break;
+		case 'Q':
+			PTP_FORMAT = TAPE_BIN;
+			m->ptp_fmt = TAPE_BIN;
+			break;
+		case 'A':
+			IO_THREAD = 1;
+			break;
+		case 'F':
+			path_sock = optarg;
+			break;
+		case 'D':
+			path_daemon = optarg;
+			break;
+		case 'x':
+			path_tape2bin = optarg;
+			break;
+		case 'X':
+			path_bin2tape = optarg;
+			break;
+		case 'I':
+			path_index = optarg;
+			break;
+		case 'Z':
+			zone = strtol(optarg, NULL, 10);
+			if (zone < 0)
+				return BATCH_EXIT_USAGE;
+			break;
+		case 'K':
+			TAPE_CACHE_MAX = strtoull(optarg, NULL, 10) << 20;
 			break;
-		default:
+		case 'd':
+			return (DumpFileTxs(optarg) == 0) ? 0 : BATCH_EXIT_USAGE;
+		case 'L':
+			LOGGING = 1;
+			break;
+		case 'b':
+			BREAKPOINT = trs2digit(smtr(optarg));
 			break;
+		case 'T':
+			return run_test(atoi(optarg));
+		case 'h':
+			return usage(stdout, argv[0]);
+		default:
+			usage(stderr, argv[0]);
+			return BATCH_EXIT_USAGE;
+		}
 	}
 
-    return 0; /* OK' */
-}
-
-/* Func 'view_cmd' */
-char view_cmd(char *buf, void *data)
-{
-    cmd_data_t *pars = (cmd_data_t *)data;
-
-    printf("[ View registers Setun-1958 ]\r\n");
-
-    if (pars->count > 0)
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
-
-	/* Prints REGS */
-	view_short_regs();
-	printf("\r\n");
-
-    return 0; /* OK' */
-}
-
-/* Func 'fram_cmd' */
-char fram_cmd(char *buf, void *data)
-{
-    cmd_data_t *pars = (cmd_data_t *)data;
-
-    if (pars->count > 1)
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
+	/* Преобразование формата перфоленты */
+	if ((path_tape2bin != NULL) || (path_bin2tape != NULL))
+	{
+		if (path_out == NULL)
+		{
+			return BATCH_EXIT_USAGE;
+		}
+		if (path_tape2bin != NULL)
+		{
+			return (tape_text_to_bin(path_tape2bin, path_out) == 0) ? 0 : BATCH_EXIT_USAGE;
+		}
+		return (tape_bin_to_text(path_bin2tape, path_out) == 0) ? 0 : BATCH_EXIT_USAGE;
+	}
 
-	dump_fram_zone(smtr(pars->par2));
-    
-	return 0;
-}
+	/* Указатель зон перфоленты */
+	if (path_index != NULL)
+	{
+		tape_reader_t r = {0};
+		int code = BATCH_EXIT_USAGE;
 
-/* Func 'drum_cmd' */
-char drum_cmd(char *buf, void *data)
-{
-    cmd_data_t *pars = (cmd_data_t *)data;
+		if ((tape_index_open(&r, path_index, 1) == 0) && (tape_index_save(&r, path_index) == 0))
+		{
+			view_tape_index(&r);
+			code = 0;
+		}
+		free(r.zone);
+		return code;
+	}
 
-    if (pars->count > 1)
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
-	
-	view_drum_zone(smtr(pars->par2));
+	/* Служба заданий */
+	if (path_daemon != NULL)
+	{
+		return Emu_Daemon(path_daemon, threads);
+	}
 
-    return 0; /* OK' */
-}
+	/* Список перфолент в пуле потоков */
+	if (path_jobs != NULL)
+	{
+		return Emu_Batch_Jobs(path_jobs, path_out, threads, sched, steps, seconds);
+	}
 
-/* Func 'help_cmd' */
-char help_cmd(char *buf, void *data)
-{
-    cmd_data_t *pars = (cmd_data_t *)data;
+	/* Перфолента из каталога программы */
+	if (path_lst != NULL)
+	{
+		if (ConvertSWtoPaper(path_lst, "ptr1") != 0)
+		{
+			return BATCH_EXIT_USAGE;
+		}
+		m->path_ptr1 = "ptr1/paper.txt";
+		if (convert_only)
+		{
+			return 0;
+		}
+	}
 
-    if (pars->count > 0)
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
+	/* Начальный старт и загрузка барабана */
+	m->tty_dev.kind = tty_kind;
+	m->ptp_dev.kind = ptp_kind;
+	Emu_Begin(m);
+	if (m->ptr1 == NULL || !dev_ok(&m->ptp_dev, m->ptp1) || !dev_ok(&m->tty_dev, m->tty1))
+	{
+		Emu_Close_Files(m);
+		return BATCH_EXIT_USAGE;
+	}
+	if ((path_drum != NULL) && (load_drum_txs(m, path_drum) < 0))
+	{
+		Emu_Close_Files(m);
+		return BATCH_EXIT_USAGE;
+	}
+	if (native)
+	{
+		set_native_mode(m, 1);
+	}
 
-    help_print();
+	/* Начальный старт с зоны N: перечитать первые команды */
+	if (zone >= 0)
+	{
+		int res = -1;
 
-    return 0; /* OK' */
-}
+		if ((m->ft1.zone != NULL) || (tape_index_open(&m->ft1, m->path_ptr1, 1) == 0))
+		{
+			res = tape_seek_zone(&m->ft1, m->ptr1, (uint32_t)zone);
+		}
+		if (res != 0)
+		{
+			printf("ERR zone %li: %s\r\n", zone, (res == -2) ? "stale index" : "no zone");
+			Emu_Close_Files(m);
+			return BATCH_EXIT_USAGE;
+		}
+		Begin_Read_Commands_from_FT1(m, m->ptr1);
+	}
 
-/* Func 'quit_cmd' */
-char quit_cmd(char *buf, void *data)
-{
-    cmd_data_t *pars = (cmd_data_t *)data;
+	/* Варианты на копиях загруженной машины */
+	if (path_sweep != NULL)
+	{
+		int code = Emu_Batch_Sweep(m, path_sweep, path_result, binary, cells, threads, sched, steps, seconds);
+		Emu_Close_Files(m);
+		return code;
+	}
 
-    if (pars->count > 0)
-    {
-        /* Error */
-        printf("dbg: ERR#1\r\n");
-        return 1; /* ERR#1 */
-    }
+	/* Задания с сокета на копиях загруженной машины */
+	if (path_sock != NULL)
+	{
+		int code = Emu_Fork_Server(m, path_sock, steps, seconds);
+		Emu_Close_Files(m);
+		return code;
+	}
 
-	Emu_Stop();
+	/* Печать, перфорация и чтение перфоленты из потока - в потоке устройств */
+	if (IO_THREAD && (io_start(m) != 0))
+	{
+		printf("WARN io thread, synchronous I/O\r\n");
+	}
 
-    exit(0);
+	t_run = time_monotonic();
+	t_start = t_run - t_start;
 
-    return 0;
-}
+	/* Выполнять до останова или исчерпания бюджета */
+	while (1)
+	{
+		uint64_t n = RUN_BATCH_STEPS;
+		uint64_t d = 0;
 
-/** -------------------
- *   Func 'ascii parser'
- */
-int ascii_parser(char *buf)
-{
-    int i;
+		if ((steps > 0) && (steps - done < n))
+		{
+			n = steps - done;
+		}
+		ret = (PACE_OPS > 0) ? run_paced(m, n, &d) : run_for(m, n, &d);
+		done += d;
+		dev_post(m);
 
-    memset(par1, 0, sizeof(par1));
-    memset(par2, 0, sizeof(par2));
-    memset(par3, 0, sizeof(par3));
-    memset(par4, 0, sizeof(par4));
-    //
-    sscanf(buf, "%s %s %s %s", par1, par2, par3, par4);
-    // viv- old  printf("par1=%s par2=%s par3=%s par3=%s\r\n",par1,par2,par3,par4);
-    //
-    for (i = 0; i < ARRAY_SIZE(command); i++)
-    {
-        if ((strncmp(par1, command[i].name_cmd, strlen(command[i].name_cmd)) == 0) &&
-            (strlen(par1) == strlen(command[i].name_cmd)))
-        {
-            if (command[i].parser)
-            {
-                int cnt = 0;
-                cmd_data.par2 = par2;
-                if (strlen(par2) > 0)
-                    cnt++;
-                cmd_data.par3 = par3;
-                if (strlen(par3) > 0)
-                    cnt++;
-                cmd_data.par4 = par4;
-                if (strlen(par4) > 0)
-                    cnt++;
-                cmd_data.count = cnt;
+		if (ret != OK)
+			break;
+		if ((steps > 0) && (done >= steps))
+			break;
+		if ((seconds > 0) && (time_monotonic() - t_run >= seconds))
+			break;
+	}
 
-                command[i].data = (cmd_data_t *)&cmd_data;
-                return command[i].parser(par1, command[i].data);
-            }
-        }
-    }
-    return -1;
-}
+	dev_sync(m);
+	t_stop = time_monotonic();
+	t_run = t_stop - t_run;
+	io_stat_str(m, io_stat, sizeof(io_stat));
 
-/* Process ascii string + <LF><CR> */
-void Process_ascii_string(char c)
-{
-    static char *p_beg = NULL;
-    static char *p_cur = NULL;
-    static char *p_end = NULL;
+	/* Выходные файлы и регистры */
+	if (path_regs != NULL)
+	{
+		dump_regs_file(m, path_regs);
+	}
+	native_sync(m);
+	Emu_Stop(m);
 
-    static char status = 0;
-    /*
-     * Сканер строк ascii
-     */
-    switch (status)
-    {
-    case 0: /* Иницализация сканера */
-    {
-        memset(buf, 0, ARRAY_SIZE(buf));
-        p_beg = &buf[0];
-        p_cur = p_beg;
-        p_end = p_beg + ARRAY_SIZE(buf) - 1;
-        status = 1;
-    }
-    case 1: /* Ввод символов и прверка 'LF' или 'CR' */
-    {
-        if (c == '\r' || c == '\n')
-        {            
-            static char res = 0;
+	t_stop = time_monotonic() - t_stop;
 
-            res = ascii_parser(buf);
-            if (res >= 0)
-            {
-            }
-            else
-            {
-                printf("no command\r\n");
-            }
-            cli_ascii();
+	view_run_stat(done, t_run);
+	view_idle_stat(m);
+	view_pace_stat(m);
+	if (io_stat[0] != '\0')
+	{
+		printf("%s\r\n", io_stat);
+	}
+	view_dev_stat(m);
+	printf("[ Batch: status %i, exit %i, startup %.3f ms, run %.3f ms, shutdown %.3f ms ]\r\n",
+		   ret, batch_exit_code(ret), t_start * 1e3, t_run * 1e3, t_stop * 1e3);
 
-            /* Новый статус сканера */
-            status = 0;
-        }
-        else
-        {
-            if (p_cur < p_end)
-            {
-                *p_cur++ = c; /* Сохранить байт в буфере */
-            }
-            else
-            {
-                *p_cur = c;
-            }
-        }
-    }
-    break;
-    default:        /* Что-то не так !*/
-        status = 0; /* Сброс сканера фысшш */
-        break;
-    } /* end switch() */
+	return batch_exit_code(ret);
 }
 
-
 /** ------
  *  main()
  */
-int main(void)
+int main(int argc, char *argv[])
 {
     int c;
 
@@ -9390,33 +17495,76 @@ int main(void)
 	char *output = "-";
 	int ret = 0;	
 
+	/* Пакетный режим без пульта управления */
+	if (argc > 1)
+	{
+		return Emu_Batch(argc, argv);
+	}
+
 	/* Печать версии приложение */
 	print_version();
 
     /* Строка приглашение */
 	cli_ascii();
 
-	/* Инициализация таблиц символов ввода и вывода "Сетунь-1958" */
-	init_tab4();
+	/* Инициализация таблиц "Сетунь-1958" до запуска потоков */
+	init_tables();
+
+	/* Включение питания виртуальной машины "Сетунь-1958" */
+	init_setun_machine(&setun);
 
-	/* Сброс виртуальной машины "Сетунь-1958" */
-	reset_setun_1958();
+	/* Машина работает в потоке эмуляции */
+	if ((pipe(emu_wake) != 0) || (pipe(emu_reply) != 0) ||
+		(pthread_create(&emu_tid, NULL, Emu_Thread, NULL) != 0))
+	{
+		printf("ERR#: emulation thread\r\n");
+		return 1;
+	}
 
-    /* Loop work CLI and setun1958emu */	
+    /*
+     * Loop work CLI.
+     * Пульт ждёт ввод в poll() и не мешает потоку эмуляции.
+     */
     while(1)
 	{
-		char bufin[80]; 
-		
-    	fcntl(0, F_SETFL, fcntl(0, F_GETFL) | O_NONBLOCK);
-    	
-    	int numRead = read(0, bufin, 1);
-    	if (numRead > 0) {        	
+		struct pollfd pfd = {.fd = 0, .events = POLLIN};
+		char bufin[80];
+		int numRead;
+
+		if (poll(&pfd, 1, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			numRead = -1;
+		}
+		else
+		{
+			numRead = read(0, bufin, sizeof(bufin));
+		}
+
+		if (numRead > 0)
+		{
 			/* Проверить команду CLI */
-       		Process_ascii_string(bufin[0]);
-    	}
-    	else {       		
-			/* Работа виртуальной машины */
-			Process_Work_Emulation();
+			for (int i = 0; i < numRead; i++)
+			{
+				Process_ascii_string(bufin[i]);
+			}
+		}
+		else if ((numRead < 0) && ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK)))
+		{
+			/* Ввода ещё нет (сигнал или неблокирующий stdin) */
+			continue;
+		}
+		else
+		{
+			/* Пульт закрыт: работать до останова машины */
+			emu_cmd_t c = {.code = EMU_CMD_CLOSE};
+			emu_send(&c);
+			pthread_join(emu_tid, NULL);
+			Emu_Stop(&setun);
+			break;
 		}
     }
 
@@ -26,6 +26,52 @@ extern "C" {
        __typeof__ (b) _b = (b); \
      _a > _b ? _a : _b; })
 
+/**
+ * Протокол службы заданий (--daemon SOCKET)
+ * ------------------------------------------
+ * Кадр: заголовок daemon_hdr_t и len байт данных, порядок байт хоста.
+ *
+ * Клиент -> служба:
+ *   DAEMON_JOB  - daemon_job_req_t и образ перфоленты ФТ1 (текст),
+ *                 flags - нужный вывод DAEMON_OUT_TTY, DAEMON_OUT_PTP.
+ * Служба -> клиент, id - номер задания из DAEMON_JOB:
+ *   DAEMON_TTY, DAEMON_PTP - очередная порция вывода ПМ или ПЛ,
+ *   DAEMON_DONE - daemon_done_t после останова задания, последний кадр задания,
+ *   DAEMON_ERR  - ошибка в кадре или задании.
+ */
+#define DAEMON_MAGIC (0x55544553) /* "SETU" */
+#define DAEMON_JOB (1)
+#define DAEMON_TTY (2)
+#define DAEMON_PTP (3)
+#define DAEMON_DONE (4)
+#define DAEMON_ERR (5)
+#define DAEMON_OUT_TTY (1)
+#define DAEMON_OUT_PTP (2)
+#define DAEMON_FRAME_MAX (16 * 1024 * 1024)
+
+typedef struct daemon_hdr
+{
+	uint32_t magic;
+	uint16_t type;
+	uint16_t flags;
+	uint32_t id; /* номер задания клиента */
+	uint32_t len;
+} daemon_hdr_t;
+
+typedef struct daemon_job_req
+{
+	uint64_t steps; /* бюджет команд, 0 - без ограничения */
+	uint32_t ms;	/* бюджет времени, 0 - без ограничения */
+	uint32_t reserved;
+} daemon_job_req_t;
+
+typedef struct daemon_done
+{
+	int32_t ret; /* статус останова */
+	int32_t C, S, R;
+	uint64_t done; /* выполнено команд */
+} daemon_done_t;
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus